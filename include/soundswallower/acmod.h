@@ -56,6 +56,7 @@
 #include <soundswallower/logmath.h>
 #include <soundswallower/mllr.h>
 #include <soundswallower/prim_type.h>
+#include <soundswallower/snapshot.h>
 #include <soundswallower/tmat.h>
 
 #ifdef __cplusplus
@@ -103,6 +104,16 @@ typedef struct mgaufuncs_s {
     int (*transform)(mgau_t *mgau,
                      mllr_t *mllr);
     void (*free)(mgau_t *mgau);
+    int (*tune)(mgau_t *mgau,
+                int *inout_topn,
+                int *inout_ds); /**< Adjust top-N and downsampling (may be
+                                   NULL), returning the values used, or 0
+                                   for ds if downsampling is not
+                                   supported. */
+    void (*snapshot_save)(mgau_t *mgau,
+                          snapshot_t *s); /**< Save top-N history (may be NULL). */
+    int (*snapshot_load)(mgau_t *mgau,
+                         snapshot_t *s); /**< Restore top-N history (may be NULL). */
 } mgaufuncs_t;
 
 struct mgau_s {
@@ -117,6 +128,19 @@ struct mgau_s {
     (*ps_mgau_base(mg)->vt->transform)(mg, mllr)
 #define ps_mgau_free(mg) \
     (*ps_mgau_base(mg)->vt->free)(mg)
+#define mgau_tune(mg, inout_topn, inout_ds)                             \
+    (ps_mgau_base(mg)->vt->tune                                         \
+         ? (*ps_mgau_base(mg)->vt->tune)(mg, inout_topn, inout_ds)      \
+         : -1)
+#define mgau_snapshot_save(mg, s)                                       \
+    do {                                                                \
+        if (ps_mgau_base(mg)->vt->snapshot_save)                        \
+            (*ps_mgau_base(mg)->vt->snapshot_save)(mg, s);              \
+    } while (0)
+#define mgau_snapshot_load(mg, s)                                       \
+    (ps_mgau_base(mg)->vt->snapshot_load                                \
+         ? (*ps_mgau_base(mg)->vt->snapshot_load)(mg, s)                \
+         : 0)
 
 /**
  * Acoustic model structure.
@@ -162,15 +186,16 @@ struct acmod_s {
     /* Utterance processing: */
     mfcc_t **mfc_buf; /**< Temporary buffer of acoustic features. */
     mfcc_t ***feat_buf; /**< Temporary buffer of dynamic features. */
-    long *framepos; /**< File positions of recent frames in senone file. */
+    const int16 *insen; /**< Precomputed senone scores for this utterance. */
 
     /* A whole bunch of flags and counters: */
     uint8 state; /**< State of utterance processing. */
     uint8 compallsen; /**< Compute all senones? */
     uint8 grow_feat; /**< Whether to grow feat_buf. */
-    uint8 insen_swap; /**< Whether to swap input senone score. */
+    uint8 hold_active; /**< Keep active senones and scores for this frame. */
 
     frame_idx_t output_frame; /**< Index of next frame of dynamic features. */
+    frame_idx_t first_frame; /**< First frame in feat_buf (non-zero if restored from a snapshot). */
     frame_idx_t n_mfc_alloc; /**< Number of frames allocated in mfc_buf */
     frame_idx_t n_mfc_frame; /**< Number of frames active in mfc_buf */
     frame_idx_t mfc_outidx; /**< Start of active frames in mfc_buf */
@@ -278,6 +303,30 @@ int acmod_end_utt(acmod_t *acmod);
  */
 int acmod_rewind(acmod_t *acmod);
 
+/**
+ * Save the state of acoustic processing in the middle of an utterance.
+ *
+ * This includes the state of the front end and dynamic feature
+ * computation, any features not yet scored, and whatever the
+ * acoustic model keeps from one frame to the next.  Features already
+ * scored are not included, so the restored utterance cannot be
+ * rewound.
+ *
+ * @return 0 for success, <0 if the utterance is not in progress or
+ *         its senone scores were set with acmod_set_insen().
+ */
+int acmod_snapshot_save(acmod_t *acmod, snapshot_t *s);
+
+/**
+ * Restore the state of acoustic processing from a snapshot.
+ *
+ * The utterance must have been started with acmod_start_utt() and no
+ * data processed yet.
+ *
+ * @return 0 for success, <0 for error.
+ */
+int acmod_snapshot_load(acmod_t *acmod, snapshot_t *s);
+
 /**
  * Advance the frame index.
  *
@@ -372,6 +421,22 @@ int acmod_process_cep(acmod_t *acmod,
 int acmod_process_feat(acmod_t *acmod,
                        mfcc_t **feat);
 
+/**
+ * Use precomputed senone scores for the current utterance.
+ *
+ * Instead of processing features, the scores for all senones in each
+ * frame are taken from the given array, and all frames are
+ * immediately available for searching.  This must be called after
+ * acmod_start_utt() and before any other input.
+ *
+ * @param senscr Scores for all senones, one frame after another,
+ *               which must remain valid until the end of the
+ *               utterance.
+ * @param n_frames Number of frames of scores.
+ * @return 0, or <0 on error.
+ */
+int acmod_set_insen(acmod_t *acmod, const int16 *senscr, int n_frames);
+
 /**
  * Get a frame of dynamic feature data.
  *
@@ -419,6 +484,17 @@ void acmod_activate_hmm(acmod_t *acmod, hmm_t *hmm);
  */
 #define acmod_activate_sen(acmod, sen) bitvec_set((acmod)->senone_active_vec, sen)
 
+/**
+ * Share one scoring pass between several searches.
+ *
+ * While held, acmod_clear_active() and acmod_activate_hmm() do
+ * nothing, and acmod_score() returns the scores already computed for
+ * the current frame.  To use this, clear the active senones, let
+ * every search activate its own, call acmod_score(), then hold the
+ * scores while stepping the searches.
+ */
+void acmod_hold_active(acmod_t *acmod, int hold);
+
 /**
  * Build active list.
  */
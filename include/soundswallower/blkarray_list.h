@@ -135,6 +135,15 @@ void blkarray_list_reset(blkarray_list_t *);
 /* Gets n-th element of the array list */
 void *blkarray_list_get(blkarray_list_t *, int32 n);
 
+/*
+ * Remove entries from the list, keeping the order of the others.
+ * On input, keep[i] is non-zero for each entry i to be kept.  On
+ * output, keep[i] is the new index of entry i, or -1 if it was freed
+ * (using ckd_free).  Blocks no longer needed are also freed.
+ * Return the number of entries freed.
+ */
+int32 blkarray_list_compact(blkarray_list_t *, int32 *keep);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
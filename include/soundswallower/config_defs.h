@@ -106,7 +106,39 @@
         { "maxhmmpf",                                                                           \
           ARG_INTEGER,                                                                          \
           "30000",                                                                              \
-          "Maximum number of active HMMs to maintain at each frame (or -1 for no pruning)" }
+          "Maximum number of active HMMs to maintain at each frame (or -1 for no pruning)" },   \
+        { "maxwpf",                                                                             \
+          ARG_INTEGER,                                                                          \
+          "-1",                                                                                 \
+          "Maximum number of word exits to allow at each frame (or -1 for no pruning)" },       \
+        { "rtf",                                                                                \
+          ARG_FLOATING,                                                                         \
+          "0",                                                                                  \
+          "Target real-time factor for adaptive pruning (0 to disable)" },                      \
+        { "rtf_beam",                                                                           \
+          ARG_FLOATING,                                                                         \
+          "1e-20",                                                                              \
+          "Narrowest beam allowed by adaptive pruning" },                                       \
+        { "rtf_maxhmmpf",                                                                       \
+          ARG_INTEGER,                                                                          \
+          "1000",                                                                               \
+          "Lowest maxhmmpf allowed by adaptive pruning" },                                      \
+        { "rtf_topn",                                                                           \
+          ARG_INTEGER,                                                                          \
+          "1",                                                                                  \
+          "Lowest topn allowed by adaptive pruning" },                                          \
+        { "rtf_ds",                                                                             \
+          ARG_INTEGER,                                                                          \
+          "2",                                                                                  \
+          "Highest ds allowed by adaptive pruning" },                                           \
+        { "rolling",                                                                            \
+          ARG_INTEGER,                                                                          \
+          "0",                                                                                  \
+          "Frames between finalizing the stable part of the hypothesis (0 to disable)" },       \
+        { "publish",                                                                            \
+          ARG_BOOLEAN,                                                                          \
+          "no",                                                                                 \
+          "Publish results after each block of audio, for other threads to read" }
 
 /** Command-line options for finite state grammars. */
 #define FSG_OPTIONS                                               \
@@ -227,6 +259,14 @@
           ARG_STRING,                                                                \
           NULL,                                                                      \
           "Senone dump (compressed mixture weights) input file" },                   \
+        { "nnet",                                                                    \
+          ARG_STRING,                                                                \
+          NULL,                                                                      \
+          "Neural network acoustic model input file (replaces GMMs)" },              \
+        { "nnbatch",                                                                 \
+          ARG_INTEGER,                                                               \
+          "8",                                                                       \
+          "Maximum number of buffered frames scored at once by -nnet" },             \
         { "mllr",                                                                    \
           ARG_STRING,                                                                \
           NULL,                                                                      \
@@ -247,6 +287,14 @@
           ARG_STRING,                                                                \
           "0",                                                                       \
           "Beam width used to determine top-N Gaussians (or a list, per-feature)" }, \
+        { "subvq",                                                                   \
+          ARG_INTEGER,                                                               \
+          "0",                                                                       \
+          "Gaussians per codebook rescored after sub-vector quantized preselection (0 to disable, continuous models only)" }, \
+        { "subvqsize",                                                               \
+          ARG_INTEGER,                                                               \
+          "64",                                                                      \
+          "Number of codewords for each sub-vector with -subvq" },                   \
         { "logbase",                                                                 \
           ARG_FLOATING,                                                              \
           "1.0001",                                                                  \
@@ -43,11 +43,15 @@
 #include <soundswallower/acmod.h>
 #include <soundswallower/alignment.h>
 #include <soundswallower/configuration.h>
+#include <soundswallower/decoder_event.h>
+#include <soundswallower/decoder_result.h>
 #include <soundswallower/dict.h>
 #include <soundswallower/dict2pid.h>
 #include <soundswallower/fe.h>
 #include <soundswallower/feat.h>
+#include <soundswallower/feat_archive.h>
 #include <soundswallower/fsg_model.h>
+#include <soundswallower/glist.h>
 #include <soundswallower/lattice.h>
 #include <soundswallower/logmath.h>
 #include <soundswallower/mllr.h>
@@ -202,6 +206,13 @@ fe_t *decoder_fe(decoder_t *d);
  */
 feat_t *decoder_feat(decoder_t *d);
 
+/**
+ * Get the number of senones in the acoustic model for this decoder.
+ *
+ * @return Number of senones, or 0 if no acoustic model is loaded.
+ */
+int32 decoder_n_senones(decoder_t *d);
+
 /**
  * Get the current cepstral mean as a string.
  *
@@ -249,6 +260,48 @@ int decoder_set_cmn(decoder_t *ps, const char *cmn);
  */
 int decoder_set_fsg(decoder_t *d, fsg_model_t *fsg);
 
+/**
+ * Add a finite state grammar to be searched in parallel.
+ *
+ * Each grammar added this way is searched on the same audio as the
+ * main one (set with decoder_set_fsg() or the configuration), and
+ * senone scores are computed only once per frame for all of them.
+ * Use decoder_search_hyp() to get the result for a given grammar.
+ * Parallel searches are removed by decoder_reinit().
+ *
+ * @note The decoder consumes the pointer <code>fsg</code>, even if
+ * this fails, so you should call fsg_model_retain() on it if you wish
+ * to use it elsewhere.
+ *
+ * @param d Decoder.
+ * @param name Name for this search, which must be unique.
+ * @param fsg Grammar to search.
+ * @return 0 for success, <0 on error (including if an utterance is
+ *         in progress).
+ */
+int decoder_add_fsg(decoder_t *d, const char *name, fsg_model_t *fsg);
+
+/**
+ * Remove a search added with decoder_add_fsg().
+ *
+ * @return 0 for success, <0 if there is no such search or an
+ *         utterance is in progress.
+ */
+int decoder_remove_search(decoder_t *d, const char *name);
+
+/**
+ * Get hypothesis string and path score from a parallel search.
+ *
+ * @param d Decoder.
+ * @param name Name given to decoder_add_fsg().
+ * @param out_best_score Output: path score corresponding to returned string.
+ * @return String containing best hypothesis for this search, or NULL
+ *         if none is available (or there is no such search).  This
+ *         string is owned by the decoder.
+ */
+const char *decoder_search_hyp(decoder_t *d, const char *name,
+                               int32 *out_best_score);
+
 /**
  * Load new finite state grammar from JSGF file.
  */
@@ -365,6 +418,111 @@ decoder_process_float32(decoder_t *d,
                         int no_search,
                         int full_utt);
 
+/**
+ * Queue integer audio data to be decoded by decoder_step().
+ *
+ * Unlike decoder_process_int16(), this only copies the data, so it
+ * takes very little time.  Audio still in the queue is decoded by
+ * decoder_end_utt(), but is not included in snapshots.
+ *
+ * @param ps Decoder.
+ * @return 0 for success, <0 on error.
+ */
+int decoder_enqueue_int16(decoder_t *d,
+                          const int16 *data,
+                          size_t n_samples);
+
+/**
+ * Queue floating-point audio data to be decoded by decoder_step().
+ *
+ * The same utterance cannot queue both integer and floating-point
+ * data unless the queue has been emptied in between.
+ *
+ * @param ps Decoder.
+ * @return 0 for success, <0 on error.
+ */
+int decoder_enqueue_float32(decoder_t *d,
+                            const float32 *data,
+                            size_t n_samples);
+
+/**
+ * Decode some of the queued audio data.
+ *
+ * This computes features for as much of the audio queued with
+ * decoder_enqueue_int16() or decoder_enqueue_float32() as needed and
+ * searches them, stopping after a number of frames or an amount of
+ * time, so that a single-threaded event loop can interleave decoding
+ * with other work by calling it repeatedly until it returns 0.  The
+ * time limit is checked after each frame, so it may be exceeded by
+ * the time needed to search one.
+ *
+ * @param ps Decoder.
+ * @param max_frames Maximum number of frames to search, or 0 for no
+ *                   limit.
+ * @param max_usec Maximum time to spend in microseconds, or 0 for
+ *                 no limit.
+ * @return Number of frames searched, 0 if there is nothing more to
+ *         do until more audio is queued, or <0 for error.
+ */
+int decoder_step(decoder_t *d, int max_frames, int max_usec);
+
+/**
+ * Decode an utterance from a feature archive.
+ *
+ * This must be called between decoder_start_utt() and
+ * decoder_end_utt(), and skips feature computation entirely.  The
+ * features must have been computed with the same parameters as
+ * those of the decoder, for instance by decoder_archive_int16().
+ *
+ * If the archive contains senone scores (written by
+ * decoder_archive_senscr_int16()) then acoustic scoring is skipped
+ * as well, and only the search is run.  The scores must have been
+ * computed with the same acoustic model.
+ *
+ * @param ps Decoder.
+ * @param fa Feature archive.
+ * @param utt Index of utterance in archive.
+ * @return Number of frames of data searched, or <0 for error.
+ */
+int decoder_process_archive(decoder_t *d, feat_archive_t *fa, int32 utt);
+
+/**
+ * Compute features for integer audio data and add them to an archive.
+ *
+ * The audio is processed as a full utterance, but not decoded.  This
+ * cannot be called while an utterance is in progress.
+ *
+ * @param ps Decoder.
+ * @param w Feature archive writer, created with the decoder's
+ *          feature computation (see feat_archive_writer_init()).
+ * @param uttid Utterance ID to store in the archive.
+ * @return Number of frames of features written, or <0 for error.
+ */
+int decoder_archive_int16(decoder_t *d,
+                          feat_archive_writer_t *w,
+                          const char *uttid,
+                          int16 *data,
+                          size_t n_samples);
+
+/**
+ * Compute senone scores for integer audio data and add them to an archive.
+ *
+ * The audio is processed as a full utterance and the scores of all
+ * senones are computed for each frame, as with the `compallsen`
+ * parameter, but not searched.  This cannot be called while an
+ * utterance is in progress.
+ *
+ * @param ps Decoder.
+ * @param w Archive writer, created with feat_archive_writer_init_senscr().
+ * @param uttid Utterance ID to store in the archive.
+ * @return Number of frames of scores written, or <0 for error.
+ */
+int decoder_archive_senscr_int16(decoder_t *d,
+                                 feat_archive_writer_t *w,
+                                 const char *uttid,
+                                 int16 *data,
+                                 size_t n_samples);
+
 /**
  * Get the number of frames of data searched.
  *
@@ -388,6 +546,72 @@ int decoder_n_frames(decoder_t *d);
  */
 int decoder_end_utt(decoder_t *d);
 
+/**
+ * Search the current or last utterance again from the beginning.
+ *
+ * This reuses the features already computed for the utterance, so
+ * it is much cheaper than decoding the audio again.  In particular,
+ * you can use it to try a different grammar (for instance, a
+ * fallback when the confidence of a result is low) by calling
+ * decoder_set_fsg() or decoder_set_jsgf_string() and then this
+ * function.  If the utterance was decoded from senone scores with
+ * decoder_process_archive(), these are reused as well, and the
+ * archive must not have been freed.
+ *
+ * If the utterance has ended, the new result is available
+ * immediately.  Otherwise, the search catches up to where it was
+ * and decoding continues as usual with the next input.
+ *
+ * This is not possible with `rolling` decoding (unless the
+ * utterance is short enough that features are still available), or
+ * after decoder_restore().
+ *
+ * @param ps Decoder.
+ * @return Number of frames searched, or <0 on error.
+ */
+int decoder_rewind(decoder_t *d);
+
+/**
+ * Save the state of an utterance in progress.
+ *
+ * The snapshot contains everything needed to continue decoding the
+ * utterance in another decoder (possibly in another process) with
+ * decoder_restore(): audio and features not yet searched, CMN and
+ * noise statistics, and the active part of the search.  Its size
+ * depends on the number of active HMMs and history entries, not on
+ * the size of the model or grammar.  Features which were already
+ * searched are not saved, so the restored utterance cannot be
+ * aligned with decoder_alignment(); use `rolling` decoding if this
+ * matters.
+ *
+ * Snapshots are in native byte order and are only valid for a
+ * decoder with the same configuration, acoustic model, dictionary
+ * and grammar.  They cannot be taken while decoding feature archives
+ * or with a state alignment search.
+ *
+ * @param ps Decoder.
+ * @param out_size Output: size of the snapshot in bytes.
+ * @return Newly allocated snapshot, to be freed with ckd_free(), or
+ *         NULL on error (for instance, if no utterance is in
+ *         progress).
+ */
+uint8 *decoder_snapshot(decoder_t *d, size_t *out_size);
+
+/**
+ * Restore an utterance in progress from a snapshot.
+ *
+ * Any utterance in progress in this decoder is ended first.
+ * Decoding then continues as if the input given to the decoder from
+ * which the snapshot was taken had been given to this one.
+ *
+ * @param ps Decoder.
+ * @param data Snapshot from decoder_snapshot().
+ * @param size Size of snapshot in bytes.
+ * @return 0 for success, <0 on error, in which case no utterance is
+ *         in progress.
+ */
+int decoder_restore(decoder_t *d, const uint8 *data, size_t size);
+
 /**
  * Get hypothesis string and path score.
  *
@@ -399,6 +623,67 @@ int decoder_end_utt(decoder_t *d);
  */
 const char *decoder_hyp(decoder_t *d, int32 *out_best_score);
 
+/**
+ * Get the words which have become stable since the last call.
+ *
+ * If the `rolling` parameter is non-zero, the search periodically
+ * finds the part of the hypothesis shared by all active paths, which
+ * later input can no longer change, and discards its search history.
+ * This allows a continuous stream to be decoded as a single
+ * utterance using bounded memory.  The words in that part are
+ * returned (once) by this function, and are no longer included in
+ * decoder_hyp() or decoder_seg_iter().  Lattices and alignment are
+ * not available for such an utterance.
+ *
+ * @param ps Decoder.
+ * @param out_frame Output: last frame of the stable part of the
+ *                  utterance, or -1 if there is none (yet).  May be NULL.
+ * @return Words separated by spaces, or NULL if none have become
+ *         stable since the last call.  This string is owned by the
+ *         decoder and is valid until the next call.
+ */
+const char *decoder_stable_hyp(decoder_t *d, int32 *out_frame);
+
+/**
+ * Set a callback for changes in the recognition result.
+ *
+ * After each block of audio is searched, the callback is given a
+ * DECODER_EVENT_STABLE event with any words that have become stable
+ * (only if `rolling` is non-zero; see decoder_stable_hyp(), which
+ * will then return nothing), and a
+ * DECODER_EVENT_PARTIAL event if the partial hypothesis is different
+ * from the last one.  When the utterance ends it gets a
+ * DECODER_EVENT_FINAL event with the final hypothesis.
+ *
+ * The callback is called from decoder_process_int16() and friends,
+ * and must not call any of them (or start or end an utterance)
+ * itself.
+ *
+ * @param ps Decoder.
+ * @param cb Callback, or NULL to remove it.
+ * @param user_data Data passed to the callback.
+ */
+void decoder_set_event_callback(decoder_t *d, decoder_event_cb_t cb,
+                                void *user_data);
+
+/**
+ * Get the most recently published result.
+ *
+ * Unlike the other functions which get results, this can be called
+ * from any thread, even while another one is processing audio with
+ * the same decoder, and does not block it.  It only returns
+ * something if the -publish option is enabled, in which case a copy
+ * of the result is published when each utterance starts, after each
+ * block of audio is processed, and when the utterance ends.
+ *
+ * @param ps Decoder.
+ * @return Result, which you must release with decoder_result_free(),
+ *         or NULL if none has been published.  It stays valid even
+ *         after the decoder is freed, but the decoder must not be
+ *         freed while this function is running.
+ */
+decoder_result_t *decoder_result(decoder_t *d);
+
 /**
  * Get posterior probability.
  *
@@ -608,13 +893,35 @@ struct decoder_s {
     logmath_t *lmath; /**< Log math computation. */
     search_module_t *search; /**< Main search module. */
     search_module_t *align; /**< State alignment module. */
+    glist_t searches; /**< Searches run in parallel with the main one. */
     char *json_result; /**< Decoding result as JSON. */
+    result_slot_t *results; /**< Results published for other threads. */
+    int publish; /**< Publish results in this utterance. */
+    decoder_event_cb_t event_cb; /**< Callback for events. */
+    void *event_data; /**< Data for event_cb. */
+    char *event_hyp; /**< Last partial hypothesis given to event_cb. */
+    int32 event_bpidx; /**< History entry for the last word of event_hyp. */
+    int32 event_collect_frame; /**< Last collection of history before
+                                  event_hyp (see fsg_search_collect()). */
+    void *queue; /**< Audio waiting for decoder_step(). */
+    size_t queue_alloc; /**< Samples allocated in queue. */
+    size_t queue_pos; /**< First sample not yet processed in queue. */
+    size_t queue_len; /**< Number of samples in queue. */
+    int queue_float32; /**< Queue contains float32 rather than int16. */
 
     /* Utterance-processing related stuff. */
     uint32 uttno; /**< Utterance counter. */
     ptmr_t perf; /**< Performance counter for all of decoding. */
     uint32 n_frame; /**< Total number of frames processed. */
 
+    /* Adaptive pruning to meet a target real-time factor. */
+    float32 rtf_target; /**< Target real-time factor (0 for none). */
+    ptmr_t rtf_perf; /**< Search time since the last adjustment. */
+    int32 rtf_n_frame; /**< Frames searched since the last adjustment. */
+    int32 rtf_level; /**< Current pruning level (0 is as configured). */
+    int32 rtf_max_level; /**< Highest pruning level in this utterance. */
+    int32 rtf_n_adjust; /**< Number of adjustments in this utterance. */
+
 #ifndef EMSCRIPTEN
     /* Logging. */
     FILE *logfh;
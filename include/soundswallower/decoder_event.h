@@ -0,0 +1,99 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file decoder_event.h
+ * @brief Events emitted by the decoder and endpointer.
+ *
+ * Instead of polling for the hypothesis and comparing it to the
+ * previous one, a callback can be set with
+ * decoder_set_event_callback() to be told when it changes, when
+ * words become stable, and when the utterance is finished.  The same
+ * callback can be given to endpointer_set_event_callback() to be told
+ * when speech starts and ends.
+ *
+ * Words only become stable, and DECODER_EVENT_STABLE is only sent,
+ * if the `rolling` parameter is non-zero.  Finding them means
+ * scanning the whole search history, which is only kept short by
+ * the rolling collection that discards them (see
+ * decoder_stable_hyp()).  Otherwise, all words are in the
+ * DECODER_EVENT_PARTIAL and DECODER_EVENT_FINAL events.
+ */
+
+#ifndef __DECODER_EVENT_H__
+#define __DECODER_EVENT_H__
+
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Type of event.
+ */
+typedef enum decoder_event_type_e {
+    DECODER_EVENT_PARTIAL, /**< Partial hypothesis has changed */
+    DECODER_EVENT_STABLE, /**< Words have become stable (only if
+                             `rolling` is non-zero) */
+    DECODER_EVENT_FINAL, /**< Utterance has ended */
+    DECODER_EVENT_SPEECH_START, /**< Endpointer found start of speech */
+    DECODER_EVENT_SPEECH_END /**< Endpointer found end of speech */
+} decoder_event_type_t;
+
+/**
+ * Event, valid only for the duration of the callback.
+ */
+typedef struct decoder_event_s {
+    decoder_event_type_t type; /**< Type of event. */
+    const char *hyp; /**< Hypothesis (words separated by spaces) for
+                        PARTIAL and FINAL, newly stable words for
+                        STABLE, or NULL. */
+    int32 score; /**< Path score for PARTIAL and FINAL. */
+    int frame; /**< Number of frames searched for PARTIAL and FINAL,
+                  last stable frame for STABLE. */
+    double time; /**< Time in seconds for SPEECH_START and SPEECH_END. */
+} decoder_event_t;
+
+/**
+ * Callback for events.
+ * @param user_data Data given when the callback was set.
+ * @param event Event.  This and its contents are owned by the caller.
+ */
+typedef void (*decoder_event_cb_t)(void *user_data,
+                                   const decoder_event_t *event);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __DECODER_EVENT_H__ */
@@ -0,0 +1,164 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file decoder_result.h
+ * @brief Recognition results published for other threads.
+ *
+ * Getting the hypothesis from a decoder modifies it, so it cannot be
+ * done while another thread is processing audio.  With the -publish
+ * option, the decoder instead takes an immutable copy of the current
+ * result after each block of audio and at the end of the utterance,
+ * which can be obtained with decoder_result() from any thread
+ * without locking.  The copy is replaced with an atomic pointer
+ * exchange, and old ones are only freed by the decoding thread once
+ * no other thread can still be in the middle of obtaining them.
+ */
+
+#ifndef __DECODER_RESULT_H__
+#define __DECODER_RESULT_H__
+
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Published recognition result.
+ */
+typedef struct decoder_result_s decoder_result_t;
+
+/**
+ * Segment in a published result.
+ */
+typedef struct decoder_seg_s {
+    const char *word; /**< Word string. */
+    int sf; /**< First frame (inclusive). */
+    int ef; /**< Last frame (inclusive). */
+    int32 ascr; /**< Acoustic score. */
+    int32 lscr; /**< Language (grammar) score. */
+    int32 prob; /**< Log posterior probability. */
+} decoder_seg_t;
+
+/**
+ * Where a decoder publishes its results.
+ */
+typedef struct result_slot_s result_slot_t;
+
+/**
+ * Retain a published result.
+ * @return The same result.
+ */
+decoder_result_t *decoder_result_retain(decoder_result_t *r);
+
+/**
+ * Release a published result.  This may be done from any thread.
+ * @return New reference count (0 if freed).
+ */
+int decoder_result_free(decoder_result_t *r);
+
+/**
+ * Get the hypothesis string and path score.
+ * @param out_best_score Output: path score.  May be NULL.
+ * @return Words separated by spaces (empty if there are none).  This
+ *         string is owned by the result.
+ */
+const char *decoder_result_hyp(decoder_result_t *r, int32 *out_best_score);
+
+/**
+ * Get the posterior probability of the hypothesis.
+ * @return As for decoder_prob(), but always zero for partial results.
+ */
+int32 decoder_result_prob(decoder_result_t *r);
+
+/**
+ * Get the word segmentation.
+ * @param out_n_seg Output: number of segments.
+ * @return Array of segments, owned by the result.
+ */
+const decoder_seg_t *decoder_result_seg(decoder_result_t *r, int *out_n_seg);
+
+/**
+ * Get the number of frames searched when this result was published.
+ */
+int decoder_result_n_frames(decoder_result_t *r);
+
+/**
+ * Get the utterance number (counting from zero) of a result.
+ */
+int decoder_result_uttno(decoder_result_t *r);
+
+/**
+ * Is this the final result for its utterance?
+ */
+int decoder_result_final(decoder_result_t *r);
+
+struct decoder_s;
+
+/**
+ * Take a copy of a decoder's current result.  Decoding thread only.
+ * @param final Was the utterance just ended?
+ * @return Newly created result, or NULL if there is no search.
+ */
+decoder_result_t *decoder_result_build(struct decoder_s *d, int final);
+
+/**
+ * Create an empty result slot.
+ */
+result_slot_t *result_slot_init(void);
+
+/**
+ * Free a result slot, releasing the results in it.  No other thread
+ * may be using it.
+ */
+void result_slot_free(result_slot_t *slot);
+
+/**
+ * Publish a result, replacing the current one.  Decoding thread only.
+ * @param r Result, whose reference is taken over by the slot.  May
+ *          be NULL to publish nothing.
+ */
+void result_slot_publish(result_slot_t *slot, decoder_result_t *r);
+
+/**
+ * Get the current result.  This may be done from any thread.
+ * @return Retained result, which must be released with
+ *         decoder_result_free(), or NULL if there is none.
+ */
+decoder_result_t *result_slot_get(result_slot_t *slot);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __DECODER_RESULT_H__ */
@@ -42,6 +42,7 @@ extern "C" {
 }
 #endif
 
+#include <soundswallower/decoder_event.h>
 #include <soundswallower/prim_type.h>
 #include <soundswallower/vad.h>
 
@@ -190,6 +191,23 @@ const int16 *endpointer_end_stream(endpointer_t *ep,
  */
 int endpointer_in_speech(endpointer_t *ep);
 
+/**
+ * Set a callback for speech start and end.
+ *
+ * The callback is given a DECODER_EVENT_SPEECH_START event from
+ * endpointer_process() when a speech segment starts, and a
+ * DECODER_EVENT_SPEECH_END event from endpointer_process() or
+ * endpointer_end_stream() when it ends, with the same times as
+ * endpointer_speech_start() and endpointer_speech_end().
+ *
+ * @memberof endpointer_t
+ * @param ep Endpointer.
+ * @param cb Callback, or NULL to remove it.
+ * @param user_data Data passed to the callback.
+ */
+void endpointer_set_event_callback(endpointer_t *ep, decoder_event_cb_t cb,
+                                   void *user_data);
+
 /**
  * Get the start time of the last speech segment.
  * @memberof endpointer_t
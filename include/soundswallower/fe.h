@@ -68,6 +68,16 @@ extern "C" {
 }
 #endif
 
+#ifdef FIXED_POINT
+/** MFCC computation type. */
+typedef fixed32 mfcc_t;
+/** Convert a floating-point value to mfcc_t. */
+#define FLOAT2MFCC(x) FLOAT2FIX(x)
+/** Convert a mfcc_t value to floating-point. */
+#define MFCC2FLOAT(x) FIX2FLOAT(x)
+/** Multiply two mfcc_t values. */
+#define MFCCMUL(a, b) FIXMUL(a, b)
+#else
 /** MFCC computation type. */
 typedef float32 mfcc_t;
 /** Convert a floating-point value to mfcc_t. */
@@ -76,7 +86,7 @@ typedef float32 mfcc_t;
 #define MFCC2FLOAT(x) (x)
 /** Multiply two mfcc_t values. */
 #define MFCCMUL(a, b) ((a) * (b))
-#define MFCCLN(x, in, out) log(x)
+#endif
 
 /**
  * Structure for the front-end computation.
@@ -173,6 +183,25 @@ void fe_get_input_size(fe_t *fe, int *out_frame_shift,
  */
 int fe_start(fe_t *fe);
 
+/**
+ * Save the state of the front end in the middle of an utterance.
+ *
+ * This consists of the samples left over from the last call to
+ * fe_process_int16() or fe_process_float32(), the pre-emphasis
+ * filter state, and the noise statistics, if any.
+ */
+void fe_snapshot_save(fe_t *fe, snapshot_t *s);
+
+/**
+ * Restore the state of the front end from a snapshot.
+ *
+ * The front end must have the same parameters as the one from which
+ * the snapshot was taken.
+ *
+ * @return 0 for success, <0 for error.
+ */
+int fe_snapshot_load(fe_t *fe, snapshot_t *s);
+
 /**
  * Process a block of samples.
  *
@@ -444,6 +473,11 @@ void fe_create_twiddle(fe_t *fe);
 void fe_spec2cep(fe_t *fe, const powspec_t *mflogspec, mfcc_t *mfcep);
 void fe_dct2(fe_t *fe, const powspec_t *mflogspec, mfcc_t *mfcep, int htk);
 void fe_dct3(fe_t *fe, const mfcc_t *mfcep, powspec_t *mflogspec);
+#ifdef FIXED_POINT
+/* Log-domain addition and subtraction of fixed-point natural logs. */
+fixed32 fe_log_add(fixed32 x, fixed32 y);
+fixed32 fe_log_sub(fixed32 x, fixed32 y);
+#endif
 
 #ifdef __cplusplus
 }
@@ -38,6 +38,7 @@
 #define FE_NOISE_H
 
 #include <soundswallower/fe_type.h>
+#include <soundswallower/snapshot.h>
 
 typedef struct noise_stats_s noise_stats_t;
 typedef struct fe_s fe_t;
@@ -51,6 +52,12 @@ void fe_reset_noisestats(noise_stats_t *noise_stats);
 /* Frees allocated data */
 void fe_free_noisestats(noise_stats_t *noise_stats);
 
+/* Saves collected noise statistics to a snapshot */
+void fe_noisestats_snapshot_save(noise_stats_t *noise_stats, snapshot_t *s);
+
+/* Restores collected noise statistics from a snapshot */
+int fe_noisestats_snapshot_load(noise_stats_t *noise_stats, snapshot_t *s);
+
 /**
  * Process frame, update noise statistics, remove noise components if needed.
  */
@@ -37,13 +37,26 @@
 #ifndef FE_TYPE_H
 #define FE_TYPE_H
 
+#include <soundswallower/fixpoint.h>
 #include <soundswallower/prim_type.h>
 
+#ifdef FIXED_POINT
+/* Waveform, with DEFAULT_RADIX fractional bits. */
+typedef fixed32 frame_t;
+/* Natural log of power, with DEFAULT_RADIX fractional bits. */
+typedef fixed32 powspec_t;
+/* Window, with COS_BITS fractional bits. */
+typedef fixed32 window_t;
+typedef struct {
+    fixed32 r, i;
+} complex;
+#else
 typedef float64 frame_t;
 typedef float64 powspec_t;
 typedef float64 window_t;
 typedef struct {
     float64 r, i;
 } complex;
+#endif
 
 #endif /* FE_TYPE_H */
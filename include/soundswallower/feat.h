@@ -47,6 +47,7 @@
 #include <soundswallower/fe.h>
 #include <soundswallower/prim_type.h>
 #include <soundswallower/s3file.h>
+#include <soundswallower/snapshot.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -328,6 +329,22 @@ int32 feat_s2mfc2feat_live(feat_t *fcb, /**< In: Descriptor from feat_init() */
  */
 void feat_update_stats(feat_t *fcb);
 
+/**
+ * Save the state of live feature computation.
+ *
+ * This consists of the CMN statistics and the frames in the input
+ * buffer (including the window of past frames needed to compute
+ * dynamic features).
+ */
+void feat_snapshot_save(feat_t *fcb, snapshot_t *s);
+
+/**
+ * Restore the state of live feature computation from a snapshot.
+ *
+ * @return 0 for success, <0 for error.
+ */
+int feat_snapshot_load(feat_t *fcb, snapshot_t *s);
+
 /**
  * Retain ownership of feat_t.
  *
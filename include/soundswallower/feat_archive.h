@@ -0,0 +1,239 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file feat_archive.h
+ * @brief Archives of precomputed dynamic features or senone scores.
+ *
+ * When the same audio is decoded many times over (to compare
+ * grammars or search parameters, for instance) the front end and
+ * dynamic feature computation can be done once and their output
+ * saved in a feature archive, which is memory-mapped and fed
+ * directly to the acoustic model when decoding.
+ *
+ * Features are stored after CMN, AGC, LDA and so on, so an archive
+ * is only valid for a decoder with the same feature parameters as
+ * the one which wrote it.  Only the stream dimensions are checked
+ * when reading.
+ *
+ * An archive can instead hold the scores of all senones for each
+ * frame, which are used directly by the search, skipping acoustic
+ * scoring as well.  These are only valid for the same acoustic
+ * model, and only the number of senones is checked.
+ *
+ * The file is in native byte order (the reader will refuse a file
+ * with the wrong one) and is laid out as follows:
+ *
+ * - Header: the magic string "SSFA", a uint32 byte order marker
+ *   (0x11223344), uint32 version (2), uint32 number of feature
+ *   streams, uint32 number of utterances, uint32 type of data
+ *   (feat_archive_type_t), uint32 format of data elements, uint32
+ *   padding and uint64 offset of the index.  The format is the size
+ *   of an element (4 for features, 2 for senone scores), except for
+ *   features from a fixed-point build, where it is 0x100 plus the
+ *   radix point.  The reader refuses a format other than its own.
+ * - The length of each stream (uint32), padded to 8 bytes.  Senone
+ *   scores have one stream, whose length is the number of senones.
+ * - Data for each utterance, one frame after another with all streams
+ *   concatenated, starting on a 16-byte boundary.  Features are
+ *   float32 (or fixed-point int32) and senone scores are int16.
+ * - The index: for each utterance, uint64 offset of its feature
+ *   data, uint64 offset of its ID, uint32 number of frames and uint32
+ *   padding.
+ * - The utterance IDs, as NUL-terminated strings.
+ */
+
+#ifndef __FEAT_ARCHIVE_H__
+#define __FEAT_ARCHIVE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <soundswallower/fe.h>
+#include <soundswallower/feat.h>
+#include <soundswallower/prim_type.h>
+
+/**
+ * Type of data in an archive.
+ */
+typedef enum feat_archive_type_e {
+    FEAT_ARCHIVE_FEAT = 0, /**< Dynamic features. */
+    FEAT_ARCHIVE_SENSCR = 1 /**< Senone scores. */
+} feat_archive_type_t;
+
+/**
+ * @struct feat_archive_t
+ * @brief Memory-mapped feature archive.
+ */
+typedef struct feat_archive_s feat_archive_t;
+
+/**
+ * @struct feat_archive_writer_t
+ * @brief Feature archive being written.
+ */
+typedef struct feat_archive_writer_s feat_archive_writer_t;
+
+/**
+ * Create a feature archive for writing.
+ *
+ * @param filename File to write.
+ * @param fcb Dynamic feature computation whose output will be written.
+ * @return Newly created writer, or NULL on failure.
+ */
+feat_archive_writer_t *feat_archive_writer_init(const char *filename,
+                                                feat_t *fcb);
+
+/**
+ * Create an archive of senone scores for writing.
+ *
+ * @param filename File to write.
+ * @param n_sen Number of senones in the acoustic model.
+ * @return Newly created writer, or NULL on failure.
+ */
+feat_archive_writer_t *feat_archive_writer_init_senscr(const char *filename,
+                                                       int32 n_sen);
+
+/**
+ * Start a new utterance in an archive.
+ *
+ * @param uttid Utterance ID.
+ * @return 0, or <0 on failure.
+ */
+int feat_archive_writer_start(feat_archive_writer_t *w, const char *uttid);
+
+/**
+ * Add a frame of senone scores to the current utterance in an archive.
+ *
+ * @param senscr Scores for all senones.
+ * @return 0, or <0 on failure.
+ */
+int feat_archive_writer_add_senscr(feat_archive_writer_t *w,
+                                   const int16 *senscr);
+
+/**
+ * Add an utterance to a feature archive.
+ *
+ * @param uttid Utterance ID.
+ * @param feat Dynamic features, as created by feat_array_alloc().
+ * @param n_frames Number of frames in feat.
+ * @return 0, or <0 on failure.
+ */
+int feat_archive_writer_add(feat_archive_writer_t *w, const char *uttid,
+                            mfcc_t ***feat, int32 n_frames);
+
+/**
+ * Finish writing a feature archive and free the writer.
+ *
+ * @return 0, or <0 on failure (the archive will not be usable).
+ */
+int feat_archive_writer_close(feat_archive_writer_t *w);
+
+/**
+ * Open a feature archive for reading.
+ *
+ * @param filename File to read.
+ * @return Newly opened archive, or NULL on failure.
+ */
+feat_archive_t *feat_archive_read(const char *filename);
+
+/**
+ * Close a feature archive.
+ */
+void feat_archive_free(feat_archive_t *fa);
+
+/**
+ * Get the type of data in an archive.
+ */
+int feat_archive_type(feat_archive_t *fa);
+
+/**
+ * Get the number of senones in an archive of senone scores.
+ *
+ * @return Number of senones, or 0 if the archive contains features.
+ */
+int32 feat_archive_n_sen(feat_archive_t *fa);
+
+/**
+ * Check that an archive contains features for a given configuration.
+ *
+ * @return TRUE if the archive does not contain features or the
+ *         stream dimensions differ from those of fcb.
+ */
+int feat_archive_mismatch(feat_archive_t *fa, feat_t *fcb);
+
+/**
+ * Get the number of utterances in a feature archive.
+ */
+int32 feat_archive_n_utt(feat_archive_t *fa);
+
+/**
+ * Get the ID of an utterance in a feature archive.
+ *
+ * @return Utterance ID, or NULL if utt is out of range.
+ */
+const char *feat_archive_uttid(feat_archive_t *fa, int32 utt);
+
+/**
+ * Get the number of frames in an utterance in a feature archive.
+ *
+ * @return Number of frames, or <0 if utt is out of range.
+ */
+int32 feat_archive_n_frames(feat_archive_t *fa, int32 utt);
+
+/**
+ * Get features for a frame of an utterance in a feature archive.
+ *
+ * @return Pointer to the features for all streams, concatenated,
+ *         which is valid until feat_archive_free() is called, or NULL
+ *         if utt or frame are out of range or the archive contains
+ *         senone scores.
+ */
+const mfcc_t *feat_archive_frame(feat_archive_t *fa, int32 utt, int32 frame);
+
+/**
+ * Get senone scores for a frame of an utterance in an archive.
+ *
+ * Frames of an utterance are contiguous, so this can also be used to
+ * get all the scores for an utterance.
+ *
+ * @return Pointer to the scores for all senones, which is valid
+ *         until feat_archive_free() is called, or NULL if utt or
+ *         frame are out of range or the archive contains features.
+ */
+const int16 *feat_archive_senscr(feat_archive_t *fa, int32 utt, int32 frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FEAT_ARCHIVE_H__ */
@@ -0,0 +1,112 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file fixpoint.h
+ * @brief Fixed-point arithmetic macros.
+ *
+ * These are used throughout the front end and acoustic model when
+ * building with FIXED_POINT, in which case mfcc_t is a fixed32 with
+ * DEFAULT_RADIX fractional bits.
+ */
+
+#ifndef __FIXPOINT_H__
+#define __FIXPOINT_H__
+
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Fixed-point number. */
+typedef int32 fixed32;
+
+/** Default number of fractional bits. */
+#ifndef DEFAULT_RADIX
+#define DEFAULT_RADIX 12
+#endif
+
+/** Convert floating point to fixed point with a given radix. */
+#define FLOAT2FIX_ANY(x, radix)                                  \
+    (((x) < 0.0)                                                 \
+         ? ((fixed32)((x) * (float64)(1 << (radix)) - 0.5))      \
+         : ((fixed32)((x) * (float64)(1 << (radix)) + 0.5)))
+/** Convert floating point to fixed point with the default radix. */
+#define FLOAT2FIX(x) FLOAT2FIX_ANY(x, DEFAULT_RADIX)
+/** Convert fixed point with a given radix to floating point. */
+#define FIX2FLOAT_ANY(x, radix) ((float32)(x) / (1 << (radix)))
+/** Convert fixed point with the default radix to floating point. */
+#define FIX2FLOAT(x) FIX2FLOAT_ANY(x, DEFAULT_RADIX)
+
+/**
+ * Multiply two fixed-point numbers, where b has the given radix
+ * (and thus the result has the same radix as a).
+ */
+#define FIXMUL_ANY(a, b, radix) ((fixed32)(((int64)(a) * (b)) >> (radix)))
+/** Multiply two fixed-point numbers with the default radix. */
+#define FIXMUL(a, b) FIXMUL_ANY(a, b, DEFAULT_RADIX)
+
+/** ln(2) with 30 fractional bits. */
+#define FIXLN_2_Q30 744261118
+/** n * ln(2) with the default radix, for integer n. */
+#define FIXLN_2_MUL(n) \
+    ((fixed32)(((int64)(n) * FIXLN_2_Q30) >> (30 - DEFAULT_RADIX)))
+/** ln(2) with the default radix. */
+#define FIXLN_2 FIXLN_2_MUL(1)
+/** Natural log of a fixed-point number with the default radix. */
+#define FIXLN(x) (fixlog(x) - FIXLN_2_MUL(DEFAULT_RADIX))
+
+/** Log of zero, as returned by fixlog() (about ln(1e-300)). */
+#define MIN_FIXLOG -2829416
+/** Log of zero, as returned by fixlog2(). */
+#define MIN_FIXLOG2 -4081985
+
+/**
+ * Base-2 logarithm of an integer.
+ * @return log2(x) with DEFAULT_RADIX fractional bits, or MIN_FIXLOG2
+ *         if x is zero.
+ */
+int32 fixlog2(uint64 x);
+
+/**
+ * Natural logarithm of an integer.
+ * @return ln(x) with DEFAULT_RADIX fractional bits, or MIN_FIXLOG if
+ *         x is zero.
+ */
+int32 fixlog(uint64 x);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FIXPOINT_H__ */
@@ -78,6 +78,7 @@
 #include <soundswallower/fsg_lextree.h>
 #include <soundswallower/fsg_model.h>
 #include <soundswallower/prim_type.h>
+#include <soundswallower/snapshot.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -187,6 +188,15 @@ void fsg_history_end_frame(fsg_history_t *h);
 /* Clear the history table */
 void fsg_history_reset(fsg_history_t *h);
 
+/*
+ * Discard the entries for which keep[i] is zero, renumbering the
+ * others (in order).  On return keep[i] is the new index of entry i,
+ * or -1 if it was discarded.  Predecessors are updated to match, and
+ * any kept entry whose predecessor was discarded becomes a root.
+ * Return the number of entries discarded.
+ */
+int32 fsg_history_compact(fsg_history_t *h, int32 *keep);
+
 /* Return the number of valid entries in the given history table */
 int32 fsg_history_n_entries(fsg_history_t *h);
 
@@ -202,6 +212,20 @@ fsg_hist_entry_t *fsg_history_entry_get(fsg_history_t *h, int32 id);
  */
 void fsg_history_set_fsg(fsg_history_t *h, fsg_model_t *fsg, dict_t *dict);
 
+/*
+ * Save the history table to a snapshot.  Transitions are saved as
+ * their source and destination states and word ID, so the history
+ * can be restored with an identical FSG in another process.  Only
+ * valid between frames (when there are no temporary entries).
+ */
+void fsg_history_snapshot_save(fsg_history_t *h, snapshot_t *s);
+
+/*
+ * Replace the history table with the one saved in a snapshot.  Return
+ * 0 for success, <0 on error (if the FSG does not match).
+ */
+int fsg_history_snapshot_load(fsg_history_t *h, snapshot_t *s);
+
 /* Free the given Viterbi search history object */
 void fsg_history_free(fsg_history_t *h);
 
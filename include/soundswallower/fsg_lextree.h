@@ -131,6 +131,7 @@ typedef struct fsg_pnode_s {
     uint16 ci_ext; /* This node's CIphone as viewed externally (context) */
     uint8 ppos; /* Phoneme position in pronunciation */
     uint8 leaf; /* Whether this is a leaf node */
+    int32 id; /* Index of this node in the lextree (in order of allocation) */
 
     /* HMM-state-level stuff here */
     hmm_context_t *ctx;
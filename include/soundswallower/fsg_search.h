@@ -65,6 +65,12 @@ typedef struct fsg_seg_s {
     int16 cur; /**< Current position in hist. */
 } fsg_seg_t;
 
+/**
+ * Number of bins used for histogram pruning (the beams are divided
+ * into this many equal parts).
+ */
+#define FSG_SEARCH_HIST_BINS 256
+
 /**
  * Implementation of FSG search (and "FSG set") structure.
  */
@@ -84,10 +90,11 @@ typedef struct fsg_search_s {
     int32 beam_orig; /**< Global pruning threshold */
     int32 pbeam_orig; /**< Pruning threshold for phone transition */
     int32 wbeam_orig; /**< Pruning threshold for word exit */
-    float32 beam_factor; /**< Dynamic/adaptive factor (<=1) applied to above
-                              beams to determine actual effective beams.
-                              For implementing absolute pruning. */
-    int32 beam, pbeam, wbeam; /**< Effective beams after applying beam_factor */
+    int32 beam, pbeam, wbeam; /**< Effective beams after histogram pruning */
+    int32 maxhmmpf; /**< Maximum number of active HMMs per frame (or -1) */
+    int32 maxwpf; /**< Maximum number of word exits per frame (or -1) */
+    int32 hmm_hist[FSG_SEARCH_HIST_BINS]; /**< Histogram of HMM scores */
+    int32 word_hist[FSG_SEARCH_HIST_BINS]; /**< Histogram of word exit scores */
     float32 lw; /**< Language weight */
     int32 pip, wip; /**< Log insertion penalties */
 
@@ -108,6 +115,24 @@ typedef struct fsg_search_s {
     ptmr_t perf; /**< Performance counter */
     int32 n_tot_frame;
 
+    int32 rolling; /**< Frames between collections of stable history (or 0) */
+    frame_idx_t collect_frame; /**< Frame of the last collection (or -1) */
+    frame_idx_t stable_frame; /**< Last frame of the stable part (or -1) */
+    char *stable_hyp; /**< Stable words not yet returned */
+    size_t stable_len, stable_alloc; /**< Length and size of stable_hyp */
+    char *stable_out; /**< Stable words last returned */
+    int32 *keep; /**< Temporary marks for history collection */
+    int32 n_keep_alloc; /**< Size of keep */
+
+    hmm_t **share_hmm; /**< Active HMMs in this frame */
+    int32 *share_next; /**< Next HMM in the same state, or -1 */
+    uint8 *share_dup; /**< Whether HMM is in the same state as a previous one */
+    hmm_t **share_group; /**< HMMs in the group being evaluated */
+    int32 n_share_alloc; /**< Size of share_hmm, share_next, share_dup,
+                            share_group */
+    int32 *share_hash; /**< Hash table of HMMs by state */
+    int32 n_share_hash; /**< Size of share_hash (a power of 2) */
+
 } fsg_search_t;
 
 /* Access macros */
@@ -149,6 +174,73 @@ int fsg_search_step(search_module_t *search, int frame_idx);
  */
 int fsg_search_finish(search_module_t *search);
 
+/**
+ * Change the beams and the maximum number of active HMMs.
+ *
+ * The beams are in the same (log, shifted by SENSCR_SHIFT) units as
+ * beam_orig, pbeam_orig and wbeam_orig, and take effect in the next
+ * frame searched.
+ */
+void fsg_search_set_pruning(search_module_t *search, int32 beam,
+                            int32 pbeam, int32 wbeam, int32 maxhmmpf);
+
+/**
+ * Finalize the stable part of the search history and discard it.
+ *
+ * The stable part ends with the most recent history entry shared by
+ * all paths still active, which no later frames can change.  Its
+ * words are appended to those returned by fsg_search_stable_hyp(),
+ * and all history entries before it, along with those no active path
+ * leads back to, are freed.  Path scores are also renormalized to the
+ * best one in the current frame.  This is done automatically every
+ * `rolling` frames, if that is non-zero.
+ *
+ * @return Number of history entries freed.
+ */
+int32 fsg_search_collect(search_module_t *search);
+
+/**
+ * Get the words which have become stable since the last call.
+ *
+ * @param out_frame Output: Last frame of the stable part, or -1 if
+ *                  there is none.  May be NULL.
+ * @return Words separated by spaces, or NULL if there are none.  Valid
+ *         until the next call or until the search is freed.
+ */
+const char *fsg_search_stable_hyp(search_module_t *search, int32 *out_frame);
+
+/**
+ * Get the history entry for the last word of the hypothesis.
+ *
+ * This is much cheaper than getting the hypothesis itself, and the
+ * hypothesis will be the same as long as this and collect_frame are.
+ *
+ * @return History entry index, or 0 if there are no words yet.
+ */
+int32 fsg_search_hyp_entry(search_module_t *search);
+
+/**
+ * Save the state of the search between two frames.
+ *
+ * This consists of the history table, the active HMMs and the
+ * pruning state, so its size depends on the number of active HMMs
+ * and history entries rather than on the size of the grammar.
+ *
+ * @return 0 for success, <0 if the utterance is finished.
+ */
+int fsg_search_snapshot_save(search_module_t *search, snapshot_t *s);
+
+/**
+ * Restore the state of the search from a snapshot.
+ *
+ * The search must have been started with fsg_search_start(), with
+ * the same grammar and dictionary as the one from which the snapshot
+ * was taken.
+ *
+ * @return 0 for success, <0 for error.
+ */
+int fsg_search_snapshot_load(search_module_t *search, snapshot_t *s);
+
 /**
  * Get hypothesis string from the FSG search.
  */
@@ -281,6 +281,26 @@ void hmm_enter(hmm_t *h, int32 score,
  */
 int32 hmm_vit_eval(hmm_t *hmm);
 
+/**
+ * Check whether two HMMs are in exactly the same state, i.e. they
+ * have the same topology, senones and state scores (though possibly
+ * different histories), and thus will still be after Viterbi
+ * evaluation.
+ */
+int hmm_same_state(hmm_t const *a, hmm_t const *b);
+
+/**
+ * Viterbi evaluation of several HMMs in the same state (as given by
+ * hmm_same_state()).  Only the first one is actually evaluated, the
+ * others simply receive copies of its scores, and their histories
+ * are updated to follow the same transitions.
+ *
+ * @param hmms HMMs to evaluate.
+ * @param n_hmm Number of HMMs in hmms.
+ * @return Best score, as for hmm_vit_eval().
+ */
+int32 hmm_vit_eval_shared(hmm_t **hmms, int32 n_hmm);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -90,6 +90,7 @@ typedef struct gauden_s {
     int32 n_feat; /**< Number feature streams in each codebook */
     int32 n_density; /**< Number gaussian densities in each codebook-feature stream */
     int32 *featlen; /**< feature length for each feature */
+    int32 *seed; /**< Scratch space for last frame's top-N codewords */
 } gauden_t;
 
 /**
@@ -130,10 +131,31 @@ gauden_dist(gauden_t *g, /**< In: handle to entire ensemble of codebooks */
             int n_top, /**< In: Number top densities to be evaluated */
             mfcc_t **obs, /**< In: Observation vector; obs[f] = for feature f */
             gauden_dist_t **out_dist
-            /**< Out: n_top best codewords and density values,
+            /**< In/Out: n_top best codewords and density values,
                in worsening order, for each feature stream.
                out_dist[f][i] = i-th best density for feature f.
-               Caller must allocate memory for this output */
+               Caller must allocate (and zero) memory for this
+               output, and the codewords already in it are evaluated
+               first, so pass the previous frame's output to speed
+               up the search */
+);
+
+/**
+ * Like gauden_dist(), but for a single feature stream, and only
+ * considering the given codewords (e.g. after preselection).
+ * @return 0 if successful, -1 otherwise.
+ */
+int32
+gauden_dist_subset(gauden_t *g, /**< In: handle to entire ensemble of codebooks */
+                   int mgau, /**< In: codebook for which density values to be evaluated */
+                   int feat, /**< In: feature stream */
+                   int32 n_top, /**< In: Number top densities to be evaluated */
+                   mfcc_t *obs, /**< In: Observation vector for feat */
+                   gauden_dist_t *out_dist, /**< Out: n_top best codewords
+                                               and density values, in
+                                               worsening order */
+                   int32 const *cw, /**< In: codewords to evaluate */
+                   int32 n_cw /**< In: number of codewords in cw (at least n_top) */
 );
 
 /**
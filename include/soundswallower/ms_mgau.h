@@ -102,6 +102,7 @@
 #include <soundswallower/logmath.h>
 #include <soundswallower/ms_gauden.h>
 #include <soundswallower/ms_senone.h>
+#include <soundswallower/ms_subvq.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -119,11 +120,13 @@ typedef struct ms_mgau_model_s {
     gauden_t *g; /**< The codebook */
     senone_t *s; /**< The senone */
     int topn; /**< Top-n gaussian will be computed */
+    int max_topn; /**< Top-n gaussians allocated */
 
     /**< Intermediate used in computation */
     gauden_dist_t ***dist;
     uint8 *mgau_active;
     config_t *config;
+    subvq_t *svq; /**< Sub-vector quantized preselection (or NULL) */
 } ms_mgau_model_t;
 
 #define ms_mgau_gauden(msg) (msg->g)
@@ -144,6 +147,7 @@ int32 ms_cont_mgau_frame_eval(mgau_t *msg,
                               int32 compallsen);
 int32 ms_mgau_mllr_transform(mgau_t *s,
                              mllr_t *mllr);
+int ms_mgau_tune(mgau_t *s, int *inout_topn, int *inout_ds);
 
 #ifdef __cplusplus
 } /* extern "C" */
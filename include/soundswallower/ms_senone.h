@@ -82,6 +82,9 @@ typedef struct senone_s {
                          if (n_gauden == 1): pdf[feat][codeword][sen].  Optimized
                          for the shared-distribution semi-continuous case. */
     logmath_t *lmath; /**< log math computation */
+    uint8 const *logadd; /**< lmath's add table if 8 bits wide, else NULL */
+    uint32 logadd_size; /**< Size of logadd */
+    int32 logzero; /**< lmath's zero */
     uint32 n_sen; /**< Number senones in this set */
     uint32 n_feat; /**< Number feature streams */
     uint32 n_cw; /**< Number codewords per codebook,stream */
@@ -138,6 +141,35 @@ int32 senone_eval(senone_t *s, int id, /**< In: senone for which score desired *
                   int n_top /**< In: Length of dist[f], for each f */
 );
 
+/**
+ * Evaluate the scores for a range of senones.  Scores are written
+ * only to senscr[start..end), so different ranges can be evaluated
+ * in parallel.
+ * @return best (lowest) score in the range, or MAX_INT32 if empty.
+ */
+int32 senone_eval_range(senone_t *s,
+                        gauden_dist_t ***dist, /**< In: top N codewords and
+                                                  densities for each codebook,
+                                                  i.e. dist[mgau][f][i] */
+                        int32 n_top, /**< In: Length of dist[mgau][f] */
+                        int32 start, /**< In: First senone */
+                        int32 end, /**< In: One past the last senone */
+                        int16 *senscr /**< Out: Senone scores */
+);
+
+/**
+ * Evaluate the scores for a list of active senones, as given to
+ * ps_mgau_frame_eval() (i.e. as deltas from the previous one).
+ * @return best (lowest) score, or MAX_INT32 if none are active.
+ */
+int32 senone_eval_active(senone_t *s,
+                         gauden_dist_t ***dist, /**< In: as for senone_eval_range() */
+                         int32 n_top, /**< In: Length of dist[mgau][f] */
+                         uint8 const *senone_active, /**< In: Active senones */
+                         int32 n_senone_active, /**< In: Length of senone_active */
+                         int16 *senscr /**< Out: Senone scores */
+);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,132 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file ms_subvq.h
+ * @brief Sub-vector quantized Gaussian preselection for ms_gauden.
+ *
+ * As in Sphinx3, each feature stream is split into short sub-vectors
+ * and the (mean, variance) sub-vectors of all the Gaussians in the
+ * model are vector quantized, giving a small codebook for each
+ * sub-vector.  In each frame the distance from the observation to
+ * every sub-vector codeword is computed once, after which the
+ * log-likelihood of any Gaussian can be approximated with one table
+ * lookup and one addition per sub-vector.  Only the Gaussians with
+ * the best approximate scores are then evaluated exactly.
+ *
+ * Unlike Sphinx3, the sub-vector codebooks are not read from a file
+ * but trained by k-means when the model is loaded.
+ */
+
+#ifndef __MS_SUBVQ_H__
+#define __MS_SUBVQ_H__
+
+#include <soundswallower/ms_gauden.h>
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Maximum length of a sub-vector.  Streams are split into
+ * sub-vectors of (nearly) equal length no longer than this.
+ */
+#define SUBVQ_MAX_SVLEN 3
+
+/**
+ * Sub-vector quantized model.
+ */
+typedef struct subvq_s {
+    int32 n_feat; /**< Number of feature streams */
+    int32 n_mgau; /**< Number of codebooks (from gauden_t) */
+    int32 n_density; /**< Number of Gaussians in each codebook */
+    int32 n_cw; /**< Number of codewords for each sub-vector */
+    int32 n_rescore; /**< Number of Gaussians evaluated exactly */
+    int32 *n_sv; /**< Number of sub-vectors in each stream */
+    int32 **sv_start; /**< First dimension of each sub-vector in each
+                         stream (n_sv[f] + 1 entries) */
+    mfcc_t ***mean; /**< mean[f][sv] = n_cw codeword means, one after
+                       another */
+    mfcc_t ***var; /**< var[f][sv] = n_cw codeword (precomputed)
+                      variances, like mean */
+    uint8 ***map; /**< map[f][mgau] = codeword for each Gaussian in
+                     each sub-vector (n_sv[f] * n_density entries) */
+    mfcc_t ***dist; /**< dist[f][sv][cw] = distance from the current
+                       frame to each codeword */
+    gauden_dist_t *cand; /**< Best approximate scores (n_rescore) */
+    int32 *cand_id; /**< Gaussians to rescore exactly (n_rescore) */
+    mfcc_t *approx; /**< Approximate scores for a codebook (n_density) */
+} subvq_t;
+
+/**
+ * Build sub-vector codebooks for a set of Gaussians.
+ * @param g Gaussians, with precomputed variances.
+ * @param n_cw Number of codewords for each sub-vector (at most 256).
+ * @param n_rescore Number of Gaussians from each codebook to evaluate
+ *                  exactly in subvq_gauden_dist().
+ * @return Newly created model, or NULL on failure.
+ */
+subvq_t *subvq_init(gauden_t *g, int32 n_cw, int32 n_rescore);
+
+/**
+ * Release a sub-vector quantized model.
+ */
+void subvq_free(subvq_t *vq);
+
+/**
+ * Compute the sub-vector distance tables for a frame.
+ * @param vq Sub-vector quantized model.
+ * @param obs Observation vector for each stream.
+ */
+void subvq_frame_eval(subvq_t *vq, mfcc_t **obs);
+
+/**
+ * Compute the top-N Gaussians in a codebook for the frame last
+ * passed to subvq_frame_eval(), like gauden_dist(), but only
+ * evaluating exactly those with the best approximate scores.
+ * @param vq Sub-vector quantized model.
+ * @param g Gaussians from which vq was built.
+ * @param mgau Codebook to evaluate.
+ * @param n_top Number of top Gaussians (no more than vq->n_rescore).
+ * @param obs Observation vector for each stream.
+ * @param out_dist Output, as for gauden_dist().
+ * @return 0 for success, <0 on failure.
+ */
+int32 subvq_gauden_dist(subvq_t *vq, gauden_t *g, int mgau, int32 n_top,
+                        mfcc_t **obs, gauden_dist_t **out_dist);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __MS_SUBVQ_H__ */
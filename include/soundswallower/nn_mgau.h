@@ -0,0 +1,198 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file nn_mgau.h
+ * @brief Small feed-forward neural network senone scorer.
+ *
+ * This is an acoustic model backend which computes senone scores
+ * with a multi-layer perceptron over a window of spliced feature
+ * frames (equivalently, a TDNN whose layers have been unrolled).  It
+ * is selected in place of the GMM backends when the `nnet` parameter
+ * is set (or a file called `nnet` exists in the acoustic model
+ * directory).
+ *
+ * Several frames are evaluated together so that each weight matrix
+ * is traversed once per batch instead of once per frame.  Only
+ * frames already present in the acoustic model's feature buffer are
+ * batched, and never more than `nnbatch` of them, so batching never
+ * waits for input.  Frames whose right context has not arrived yet
+ * are not scored ahead; if the search asks for one anyway, the last
+ * available frame stands in for the missing context.
+ *
+ * The weight file is a Sphinx-3 binary file (see s3file.h) with the
+ * following header fields:
+ *
+ * <pre>
+ *     s3
+ *     version 1.0
+ *     feat_len D        (length of one feature frame, all streams)
+ *     ctx_left L        (frames of left context)
+ *     ctx_right R       (frames of right context)
+ *     n_layer N
+ *     endhdr
+ * </pre>
+ *
+ * followed by the 32-bit byte-order magic number and then, for each
+ * of the N layers:
+ *
+ * <pre>
+ *     int32 n_out, int32 n_in, int32 activation, int32 weight_type
+ *     (weight_type 1 only) 1-d float32 array of n_out row scales
+ *     1-d array of n_out * n_in weights, row-major
+ *                       (float32 if weight_type 0, int8 if 1)
+ *     1-d float32 array of n_out biases
+ * </pre>
+ *
+ * and finally a 1-d float32 array of natural-log senone priors,
+ * which are subtracted from the log-softmax output to obtain scaled
+ * likelihoods.  A 1-d array is a 32-bit element count followed by
+ * the elements, as written by bio_fwrite_1d() in SphinxTrain.
+ * Activation 0 is linear, 1 is ReLU.  The first layer must have
+ * n_in = (L + 1 + R) * D, the last must have n_out equal to the
+ * number of senones in the model definition.  For int8 layers, the
+ * real-valued weight is the stored value times the row scale.  An
+ * optional `chksum0` header enables checksum verification as for
+ * other model files.
+ *
+ * The Python module soundswallower.nnet writes this format from NumPy
+ * arrays (`python -m soundswallower.nnet --help`).
+ */
+
+#ifndef __NN_MGAU_H__
+#define __NN_MGAU_H__
+
+#include <soundswallower/acmod.h>
+#include <soundswallower/s3file.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Activation functions for layers. */
+enum nn_activation_e {
+    NN_ACT_LINEAR = 0,
+    NN_ACT_RELU = 1
+};
+
+/** Storage types for layer weights. */
+enum nn_weight_type_e {
+    NN_WEIGHT_FLOAT32 = 0,
+    NN_WEIGHT_INT8 = 1
+};
+
+/**
+ * @struct nn_layer_t
+ * @brief One affine layer (plus activation) of the network.
+ */
+typedef struct nn_layer_s {
+    int32 n_out; /**< Output dimension. */
+    int32 n_in; /**< Input dimension. */
+    int32 activation; /**< One of nn_activation_e. */
+    int32 weight_type; /**< One of nn_weight_type_e. */
+    float32 *weights; /**< n_out x n_in weights (float32 layers). */
+    int8 *qweights; /**< n_out x n_in weights (int8 layers). */
+    float32 *scale; /**< Per-row dequantization scales (int8 layers). */
+    float32 *bias; /**< n_out biases. */
+} nn_layer_t;
+
+/**
+ * @struct nn_mgau_t
+ * @brief Neural network acoustic scorer.
+ */
+typedef struct nn_mgau_s {
+    mgau_t base; /**< base structure. */
+    acmod_t *acmod; /**< Parent acoustic model (not retained). */
+    int32 feat_len; /**< Length of one (concatenated) feature frame. */
+    int32 ctx_left; /**< Frames of left context. */
+    int32 ctx_right; /**< Frames of right context. */
+    int32 n_layer; /**< Number of layers. */
+    nn_layer_t *layers; /**< Layers, input to output. */
+    float32 *log_prior; /**< Natural-log senone priors. */
+    int32 n_sen; /**< Number of senones (outputs). */
+    int32 max_dim; /**< Largest input or output dimension. */
+    int32 max_batch; /**< Maximum number of frames per batch. */
+    float32 inv_scale; /**< Natural log to shifted logmath units. */
+
+    /* Working storage. */
+    float32 **act_in; /**< max_batch x max_dim layer inputs. */
+    float32 **act_out; /**< max_batch x max_dim layer outputs. */
+    int8 **qin; /**< max_batch x max_dim quantized layer inputs. */
+    float32 *qin_scale; /**< Quantization scale of each input. */
+
+    /* Scores computed ahead of the search. */
+    int16 **cache; /**< max_batch x n_sen senone scores. */
+    int32 cache_start; /**< First frame in cache. */
+    int32 n_cache; /**< Number of frames in cache. */
+} nn_mgau_t;
+
+/**
+ * Create a neural network scorer from the `nnet` parameter of the
+ * acoustic model's configuration.
+ */
+mgau_t *nn_mgau_init(acmod_t *acmod);
+
+/**
+ * Create a neural network scorer from an already opened file.
+ */
+mgau_t *nn_mgau_init_s3file(acmod_t *acmod, s3file_t *nnet);
+
+/**
+ * Free a neural network scorer.
+ */
+void nn_mgau_free(mgau_t *s);
+
+/**
+ * Compute senone scores for a frame.
+ *
+ * Since the network produces all outputs at once, all senone scores
+ * are always computed, regardless of the active list.
+ */
+int nn_mgau_frame_eval(mgau_t *s,
+                       int16 *senone_scores,
+                       uint8 *senone_active,
+                       int32 n_senone_active,
+                       mfcc_t **featbuf,
+                       int32 frame,
+                       int32 compallsen);
+
+/**
+ * Speaker adaptation is not supported for neural network models.
+ * @return -1 always.
+ */
+int nn_mgau_mllr_transform(mgau_t *s, mllr_t *mllr);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __NN_MGAU_H__ */
@@ -69,6 +69,14 @@ typedef struct ptm_fast_eval_s {
     bitvec_t *mgau_active; /**< Set of active codebooks */
 } ptm_fast_eval_t;
 
+/**
+ * Senone evaluation kernel, specialized for the storage of mixture
+ * weights.
+ */
+typedef int (*ptm_senone_eval_t)(ptm_mgau_t *s, int16 *senone_scores,
+                                 uint8 *senone_active, int32 n_senone_active,
+                                 int compall);
+
 struct ptm_mgau_s {
     mgau_t base; /**< base structure. */
     config_t *config; /**< Configuration parameters */
@@ -78,7 +86,16 @@ struct ptm_mgau_s {
     uint8 ***mixw; /**< Mixture weight distributions by feature, codeword, senone */
     s3file_t *sendump_mmap; /* Memory map for mixw (or NULL if not mmap) */
     uint8 *mixw_cb; /* Mixture weight codebook, if any (assume it contains 16 values) */
+    ptm_senone_eval_t senone_eval; /**< Kernel for mixw and mixw_cb. */
+    int32 *cb_sen; /**< Senones sorted by codebook (reverse of sen2cb). */
+    int32 *cb_sen_start; /**< Start of each codebook in cb_sen (n_mgau + 1). */
+    int32 *eval_sen; /**< Active senones sorted by codebook. */
+    int32 *eval_start; /**< Start of each codebook in eval_sen (n_mgau + 1). */
+    int32 *eval_next; /**< Next free entry for each codebook in eval_sen. */
+    int32 *eval_fden; /**< Feature densities for a codebook's senones. */
+    int32 *eval_ascore; /**< Scores for a codebook's senones. */
     int16 max_topn;
+    int16 alloc_topn; /**< Size of top-N arrays (max_topn can be lower). */
     int16 ds_ratio;
 
     ptm_fast_eval_t *hist; /**< Fast evaluation info for past frames. */
@@ -105,6 +122,9 @@ int ptm_mgau_frame_eval(mgau_t *s,
 int ptm_mgau_mllr_transform(mgau_t *s,
                             mllr_t *mllr);
 void ptm_mgau_reset_fast_hist(mgau_t *ps);
+int ptm_mgau_tune(mgau_t *ps, int *inout_topn, int *inout_ds);
+void ptm_mgau_snapshot_save(mgau_t *ps, snapshot_t *s);
+int ptm_mgau_snapshot_load(mgau_t *ps, snapshot_t *s);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -73,6 +73,7 @@ struct s2_semi_mgau_s {
     int32 n_sen; /* Number of senones */
     uint8 *topn_beam; /* Beam for determining per-frame top-N densities */
     int16 max_topn;
+    int16 alloc_topn; /**< Size of top-N arrays (max_topn can be lower). */
     int16 ds_ratio;
 
     vqFeature_t ***topn_hist; /**< Top-N scores and codewords for past frames. */
@@ -99,6 +100,9 @@ int s2_semi_mgau_frame_eval(mgau_t *s,
                             int32 compallsen);
 int s2_semi_mgau_mllr_transform(mgau_t *s,
                                 mllr_t *mllr);
+int s2_semi_mgau_tune(mgau_t *s, int *inout_topn, int *inout_ds);
+void s2_semi_mgau_snapshot_save(mgau_t *s, snapshot_t *sn);
+int s2_semi_mgau_snapshot_load(mgau_t *s, snapshot_t *sn);
 
 #ifdef __cplusplus
 } /* extern "C" */
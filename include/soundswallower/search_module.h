@@ -39,6 +39,7 @@
 #define __SEARCH_MODULE_H__
 
 #include <soundswallower/prim_type.h>
+#include <soundswallower/snapshot.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +81,9 @@ typedef struct searchfuncs_s {
     const char *(*hyp)(search_module_t *search, int32 *out_score);
     int32 (*prob)(search_module_t *search);
     seg_iter_t *(*seg_iter)(search_module_t *search);
+    void (*sen_active)(search_module_t *search);
+    int (*snapshot_save)(search_module_t *search, snapshot_t *s);
+    int (*snapshot_load)(search_module_t *search, snapshot_t *s);
 } searchfuncs_t;
 
 /**
@@ -129,6 +133,9 @@ struct search_module_s {
 #define search_module_hyp(s, sc) (*(search_module_base(s)->vt->hyp))(s, sc)
 #define search_module_prob(s) (*(search_module_base(s)->vt->prob))(s)
 #define search_module_seg_iter(s) (*(search_module_base(s)->vt->seg_iter))(s)
+#define search_module_sen_active(s) (*(search_module_base(s)->vt->sen_active))(s)
+#define search_module_snapshot_save(s, sn) (*(search_module_base(s)->vt->snapshot_save))(s, sn)
+#define search_module_snapshot_load(s, sn) (*(search_module_base(s)->vt->snapshot_load))(s, sn)
 
 /* For convenience... */
 #define search_module_silence_wid(s) search_module_base(s)->silence_wid
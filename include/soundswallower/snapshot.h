@@ -0,0 +1,122 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file snapshot.h
+ * @brief Serialization of decoder state in the middle of an utterance.
+ *
+ * A snapshot is a flat buffer of native-endian binary data, written
+ * and read back in the same order by each module of the decoder, so
+ * there is no need for a self-describing format.  It is only valid
+ * for a decoder with the same acoustic model, dictionary and grammar
+ * (and on a machine with the same byte order).
+ */
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stddef.h>
+
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Buffer for writing or reading a snapshot.
+ */
+typedef struct snapshot_s {
+    uint8 *buf; /**< Data. */
+    size_t len; /**< Number of bytes of data. */
+    size_t alloc; /**< Bytes allocated for buf, or 0 if not owned. */
+    size_t pos; /**< Read position. */
+    int error; /**< Set if a read went past the end of the data. */
+} snapshot_t;
+
+/**
+ * Create an empty snapshot for writing.
+ */
+snapshot_t *snapshot_init(void);
+
+/**
+ * Create a snapshot for reading existing data.
+ *
+ * @param data Data to read, which is not copied, and must remain
+ *             valid until snapshot_free() is called.
+ */
+snapshot_t *snapshot_init_data(const void *data, size_t len);
+
+/**
+ * Free a snapshot.
+ */
+void snapshot_free(snapshot_t *s);
+
+/**
+ * Take ownership of the data in a snapshot and free it.
+ *
+ * @param out_len Output: size of the data.
+ * @return Data, to be freed with ckd_free().
+ */
+uint8 *snapshot_detach(snapshot_t *s, size_t *out_len);
+
+/**
+ * Append data to a snapshot.
+ */
+void snapshot_write(snapshot_t *s, const void *data, size_t size);
+
+/**
+ * Read data from a snapshot.
+ *
+ * If there is not enough data, the output is zero-filled and the
+ * error flag is set, so that callers can read an entire section and
+ * check for errors once.
+ *
+ * @return 0 for success, <0 if there was not enough data.
+ */
+int snapshot_read(snapshot_t *s, void *data, size_t size);
+
+/**
+ * Append a 32-bit integer to a snapshot.
+ */
+void snapshot_write_int32(snapshot_t *s, int32 val);
+
+/**
+ * Read a 32-bit integer from a snapshot (0 if there is no more data).
+ */
+int32 snapshot_read_int32(snapshot_t *s);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __SNAPSHOT_H__ */
@@ -59,8 +59,43 @@ extern "C" {
 #define NONE -1
 #define WORST_DIST MAX_NEG_INT32
 
+#ifdef FIXED_POINT
+/* Saturate rather than wrapping around, since Gaussian densities can
+ * get very small. */
+#define GMMSUB(a, b) \
+    (((int64)(a) - (b) < MAX_NEG_INT32) ? MAX_NEG_INT32 : ((a) - (b)))
+#define GMMADD(a, b) \
+    (((int64)(a) + (b) > MAX_INT32) ? MAX_INT32 : ((a) + (b)))
+/* Component log-likelihood of a difference from the mean. */
+#define GMMCOMPL(diff, var) gmm_fixed_compl(diff, var)
+
+/* Limits on precomputed variances and differences from the mean,
+ * such that their product fits in 64 bits. */
+#define GMM_MAX_VAR ((1 << 26) - 1)
+#define GMM_MAX_DIFF ((1 << 19) - 1)
+
+/**
+ * Squared difference times precomputed variance.  The variances are
+ * in (integer) logmath units, so floored ones can be very large, and
+ * the squared difference needs all of its fractional bits.  This
+ * saturates for outliers.
+ */
+static inline int32
+gmm_fixed_compl(mfcc_t diff, mfcc_t var)
+{
+    uint64 ad = (diff < 0) ? (uint64)(-(int64)diff) : (uint64)diff;
+    uint64 c;
+
+    if (ad > GMM_MAX_DIFF)
+        ad = GMM_MAX_DIFF;
+    c = (ad * ad * (uint32)var) >> (2 * DEFAULT_RADIX);
+    return (c > (uint64)MAX_INT32) ? MAX_INT32 : (int32)c;
+}
+#else
 #define GMMSUB(a, b) ((a) - (b))
 #define GMMADD(a, b) ((a) + (b))
+#define GMMCOMPL(diff, var) MFCCMUL(MFCCMUL(diff, diff), var)
+#endif
 
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -2,27 +2,80 @@
  * Async read some JSON (maybe there is a built-in that does this?)
  */
 async function load_json(path) {
+  const preloaded = get_preloaded_file(path);
+  // TextDecoder does not accept shared memory, so copy it
+  if (preloaded !== undefined)
+    return JSON.parse(new TextDecoder().decode(preloaded.slice()));
   const data = await readFile(path, { encoding: "utf8" });
   return JSON.parse(data);
 }
 
+/**
+ * Get a file from those given in `Module.modelFiles`, if any.
+ *
+ * This is an Object mapping paths to `ArrayBuffer` or
+ * `SharedArrayBuffer`, so that several instances of the module (in
+ * worker threads, for example) can load a model from memory rather
+ * than reading and storing it separately.
+ */
+function get_preloaded_file(path) {
+  if (!Module.modelFiles || !(path in Module.modelFiles)) return undefined;
+  return new Uint8Array(Module.modelFiles[path]);
+}
+
+/**
+ * Size of the chunks in which files are read.
+ */
+const LOAD_CHUNK_SIZE = 1 << 20;
+
 /**
  * Load a file from disk or Internet and make it into an s3file_t.
+ *
+ * The file is read in chunks and copied into memory allocated in the
+ * heap, without first reading all of it into a separate buffer.  It
+ * is not read directly into the heap, since memory may grow (moving
+ * the heap) while a read is in progress.
  */
 async function load_to_s3file(path) {
-  let blob_u8;
-  // FIXME: Should read directly to emscripten memory... how?
-  const blob = await readFile(path);
-  blob_u8 = new Uint8Array(blob.buffer);
-  const blob_len = blob_u8.length + 1;
-  const blob_addr = Module._malloc(blob_len);
-  if (blob_addr == 0)
-    throw new Error("Failed to allocate " + blob_len + " bytes for " + path);
-  writeArrayToMemory(blob_u8, blob_addr);
-  // Ensure it is NUL-terminated in case someone treats it as a string
-  HEAP8[blob_addr + blob_len] = 0;
-  // But exclude the trailing NUL from file size so it works normally
-  return Module._s3file_init(blob_addr, blob_len - 1);
+  const preloaded = get_preloaded_file(path);
+  if (preloaded !== undefined) {
+    const blob_addr = Module._malloc(preloaded.length + 1);
+    if (blob_addr == 0)
+      throw new Error(
+        "Failed to allocate " + (preloaded.length + 1) + " bytes for " + path
+      );
+    HEAPU8.set(preloaded, blob_addr);
+    HEAPU8[blob_addr + preloaded.length] = 0;
+    return Module._s3file_init(blob_addr, preloaded.length);
+  }
+  const fh = await open(path);
+  try {
+    const { size } = await fh.stat();
+    const blob_addr = Module._malloc(size + 1);
+    if (blob_addr == 0)
+      throw new Error(
+        "Failed to allocate " + (size + 1) + " bytes for " + path
+      );
+    const chunk = Buffer.allocUnsafe(Math.min(size, LOAD_CHUNK_SIZE) || 1);
+    let blob_len = 0;
+    try {
+      while (blob_len < size) {
+        const { bytesRead } = await fh.read(chunk, 0, chunk.length, blob_len);
+        if (bytesRead == 0) break;
+        HEAPU8.set(chunk.subarray(0, bytesRead), blob_addr + blob_len);
+        blob_len += bytesRead;
+      }
+    } catch (e) {
+      Module._free(blob_addr);
+      throw e;
+    }
+    // Ensure it is NUL-terminated in case someone treats it as a string
+    HEAPU8[blob_addr + blob_len] = 0;
+    // But exclude the trailing NUL from file size so it works normally
+    return Module._s3file_init(blob_addr, blob_len);
+  } finally {
+    await fh.close();
+  }
 }
 
 /**
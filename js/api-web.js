@@ -1,33 +1,81 @@
+/**
+ * Fetch a model file, from the cache if possible.
+ *
+ * If `Module.modelCache` is set, it is the name of a Cache Storage
+ * cache where model files are kept, so that they need not be
+ * downloaded again on later page loads.
+ */
+async function fetch_model_file(path) {
+  if (Module.modelCache && typeof caches !== "undefined") {
+    const cache = await caches.open(Module.modelCache);
+    let response = await cache.match(path);
+    if (response !== undefined) return response;
+    response = await fetch(path);
+    // Don't wait for it to be stored before reading it
+    if (response.ok) cache.put(path, response.clone()).catch(() => {});
+    return response;
+  }
+  return fetch(path);
+}
+
 /**
  * Async read some JSON (maybe there is a built-in that does this?)
  */
 async function load_json(path) {
-  const response = await fetch(path);
+  const response = await fetch_model_file(path);
   if (response.ok) return response.json();
   else throw new Error("Failed to fetch " + path + " :" + response.statusText);
 }
 
 /**
  * Load a file from disk or Internet and make it into an s3file_t.
+ *
+ * The file is streamed directly into memory allocated in the heap,
+ * using its length if known (and growing it otherwise).
  */
 async function load_to_s3file(path) {
-  let blob_u8;
-  const response = await fetch(path);
-  if (response.ok) {
-    const blob = await response.blob();
-    const blob_buf = await blob.arrayBuffer();
-    blob_u8 = new Uint8Array(blob_buf);
-  } else
+  const response = await fetch_model_file(path);
+  if (!response.ok)
     throw new Error("Failed to fetch " + path + " :" + response.statusText);
-  const blob_len = blob_u8.length + 1;
-  const blob_addr = Module._malloc(blob_len);
+  // Content-Length is the compressed size if Content-Encoding is
+  // set, but it is still a good guess
+  const length = parseInt(response.headers.get("Content-Length"));
+  let blob_alloc = (length > 0 ? length : 65536) + 1;
+  let blob_addr = Module._malloc(blob_alloc);
   if (blob_addr == 0)
-    throw new Error("Failed to allocate " + blob_len + " bytes for " + path);
-  writeArrayToMemory(blob_u8, blob_addr);
+    throw new Error("Failed to allocate " + blob_alloc + " bytes for " + path);
+  let blob_len = 0;
+  try {
+    const append = (chunk) => {
+      if (blob_len + chunk.length + 1 > blob_alloc) {
+        blob_alloc = Math.max(blob_alloc * 2, blob_len + chunk.length + 1);
+        const new_addr = Module._realloc(blob_addr, blob_alloc);
+        if (new_addr == 0)
+          throw new Error(
+            "Failed to allocate " + blob_alloc + " bytes for " + path
+          );
+        blob_addr = new_addr;
+      }
+      // Do not hold on to HEAPU8 across an await, as memory may grow
+      HEAPU8.set(chunk, blob_addr + blob_len);
+      blob_len += chunk.length;
+    };
+    if (response.body) {
+      const reader = response.body.getReader();
+      for (;;) {
+        const { done, value } = await reader.read();
+        if (done) break;
+        append(value);
+      }
+    } else append(new Uint8Array(await response.arrayBuffer()));
+  } catch (e) {
+    Module._free(blob_addr);
+    throw e;
+  }
   // Ensure it is NUL-terminated in case someone treats it as a string
-  HEAP8[blob_addr + blob_len] = 0;
+  HEAPU8[blob_addr + blob_len] = 0;
   // But exclude the trailing NUL from file size so it works normally
-  return Module._s3file_init(blob_addr, blob_len - 1);
+  return Module._s3file_init(blob_addr, blob_len);
 }
 
 /**
@@ -4,6 +4,20 @@ const ARG_STRING = 1 << 3;
 const ARG_BOOLEAN = 1 << 4;
 
 const DEFAULT_MODEL = "en-us";
+/* Configuration parameters naming files to load in parallel.  Note
+ * that mixw is not here as sendump is used instead if it exists. */
+const PREFETCH_KEYS = [
+  "lda",
+  "mdef",
+  "tmat",
+  "mean",
+  "var",
+  "sendump",
+  "dict",
+  "fdict",
+  "jsgf",
+  "fsg",
+];
 
 if (typeof Module.modelBase === "undefined") {
   Module.modelBase = "model/";
@@ -11,6 +25,9 @@ if (typeof Module.modelBase === "undefined") {
 if (typeof Module.defaultModel === "undefined") {
   Module.defaultModel = DEFAULT_MODEL;
 }
+if (typeof Module.modelCache === "undefined") {
+  Module.modelCache = null;
+}
 
 /**
  * Speech recognizer object.
@@ -34,6 +51,8 @@ class Decoder {
     Module._free(cjson);
     this.cdecoder = Module._decoder_create(cconfig);
     if (this.cdecoder == 0) throw new Error("Failed to construct Decoder");
+    this.pcm_addr = 0;
+    this.pcm_alloc = 0;
   }
   /**
    * Free resources used by the decoder.
@@ -41,6 +60,9 @@ class Decoder {
   delete() {
     if (this.cdecoder != 0) Module._decoder_free(this.cdecoder);
     this.cdecoder = 0;
+    if (this.pcm_addr != 0) Module._free(this.pcm_addr);
+    this.pcm_addr = 0;
+    this.pcm_alloc = 0;
   }
   /**
    * Get configuration as JSON.
@@ -144,18 +166,86 @@ class Decoder {
   async initialize() {
     if (this.cdecoder == 0)
       throw new Error("Decoder was somehow not constructed (ps==0)");
-    await this.init_featparams();
-    await this.init_cleanup();
-    await this.init_fe();
-    await this.init_feat();
-    this.cacmod = await this.init_acmod();
-    await this.load_acmod_files();
-    await this.init_dict();
-    await this.init_grammar();
+    // Start loading all the files at once, they are used in order below
+    this.prefetch_files();
+    try {
+      await this.init_featparams();
+      await this.init_cleanup();
+      await this.init_fe();
+      await this.init_feat();
+      this.cacmod = await this.init_acmod();
+      await this.load_acmod_files();
+      await this.init_dict();
+      await this.init_grammar();
+    } finally {
+      await this.free_prefetched();
+    }
 
     this.initialized = true;
   }
 
+  /**
+   * Get the paths of all files the decoder may load when initialized.
+   *
+   * Some of these (such as `sendump`) may not exist, in which case
+   * the decoder does without them.
+   * @returns {Array<string>} Paths of model files.
+   */
+  get_model_files() {
+    const files = [];
+    for (const key of ["featparams", ...PREFETCH_KEYS, "mixw"]) {
+      const path = this.get_config(key);
+      if (path !== null && !files.includes(path)) files.push(path);
+    }
+    return files;
+  }
+
+  /**
+   * Start loading model files named in the configuration.
+   *
+   * They are loaded concurrently, and used by the various `init_*`
+   * and `load_*` methods if the configuration still names them.
+   */
+  prefetch_files() {
+    this.prefetched = new Map();
+    for (const key of PREFETCH_KEYS) {
+      const path = this.get_config(key);
+      if (path === null || this.prefetched.has(path)) continue;
+      const s3f = load_to_s3file(path);
+      // Errors are reported (or ignored) when the file is used
+      s3f.catch(() => {});
+      this.prefetched.set(path, s3f);
+    }
+  }
+
+  /**
+   * Load a file (or take it from those being prefetched) as an s3file_t.
+   * @param {string} path Path or URL of file.
+   */
+  async load_s3file(path) {
+    if (this.prefetched !== undefined && this.prefetched.has(path)) {
+      const s3f = this.prefetched.get(path);
+      this.prefetched.delete(path);
+      return s3f;
+    }
+    return load_to_s3file(path);
+  }
+
+  /**
+   * Free any prefetched files which were not used.
+   */
+  async free_prefetched() {
+    if (this.prefetched === undefined) return;
+    for (const s3f of this.prefetched.values()) {
+      try {
+        Module._s3file_free(await s3f);
+      } catch (e) {
+        /* It didn't load, never mind */
+      }
+    }
+    this.prefetched = undefined;
+  }
+
   /**
    * Read feature parameters from acoustic model.
    */
@@ -192,7 +282,7 @@ class Decoder {
   async init_feat() {
     let rv;
     try {
-      const lda = await load_to_s3file(this.get_config("lda"));
+      const lda = await this.load_s3file(this.get_config("lda"));
       rv = Module._decoder_init_feat_s3file(this.cdecoder, lda);
     } catch (e) {
       rv = Module._decoder_init_feat_s3file(this.cdecoder, 0);
@@ -229,7 +319,7 @@ class Decoder {
    * Load binary model definition file
    */
   async load_mdef() {
-    const s3f = await load_to_s3file(this.get_config("mdef"));
+    const s3f = await this.load_s3file(this.get_config("mdef"));
     if (s3f == 0)
       throw new Error("Failed to read mdef from " + this.get_config("mdef"));
     const mdef = Module._bin_mdef_read_s3file(s3f, this.get_config("cionly"));
@@ -244,7 +334,7 @@ class Decoder {
    * Load transition matrices
    */
   async load_tmat(tmat_path) {
-    const s3f = await load_to_s3file(tmat_path);
+    const s3f = await this.load_s3file(tmat_path);
     const logmath = Module._decoder_logmath(this.cdecoder);
     const tpfloor = this.get_config("tmatfloor");
     const tmat = Module._tmat_init_s3file(s3f, logmath, tpfloor);
@@ -258,16 +348,16 @@ class Decoder {
    * Load Gaussian mixture models
    */
   async load_gmm(means_path, variances_path, sendump_path, mixw_path) {
-    const means = await load_to_s3file(means_path);
-    const variances = await load_to_s3file(variances_path);
+    const means = await this.load_s3file(means_path);
+    const variances = await this.load_s3file(variances_path);
     var sendump, mixw;
     /* Prefer sendump if available. */
     try {
-      sendump = await load_to_s3file(sendump_path);
+      sendump = await this.load_s3file(sendump_path);
       mixw = 0;
     } catch (e) {
       sendump = 0;
-      mixw = await load_to_s3file(mixw_path);
+      mixw = await this.load_s3file(mixw_path);
     }
     if (Module._load_gmm(this.cdecoder, means, variances, mixw, sendump) < 0)
       throw new Error("Failed to load GMM parameters");
@@ -279,13 +369,13 @@ class Decoder {
   async init_dict() {
     let dict;
     try {
-      dict = await load_to_s3file(this.get_config("dict"));
+      dict = await this.load_s3file(this.get_config("dict"));
     } catch (e) {
       dict = 0;
     }
     let fdict;
     try {
-      fdict = await load_to_s3file(this.get_config("fdict"));
+      fdict = await this.load_s3file(this.get_config("fdict"));
     } catch (e) {
       fdict = 0;
     }
@@ -300,9 +390,9 @@ class Decoder {
     let fsg = 0,
       jsgf = 0;
     const jsgf_path = this.get_config("jsgf");
-    if (jsgf_path != null) jsgf = await load_to_s3file(jsgf_path);
+    if (jsgf_path != null) jsgf = await this.load_s3file(jsgf_path);
     const fsg_path = this.get_config("fsg");
-    if (fsg_path != null) fsg = await load_to_s3file(fsg_path);
+    if (fsg_path != null) fsg = await this.load_s3file(fsg_path);
     if (fsg || jsgf) {
       const rv = Module._decoder_init_grammar_s3file(this.cdecoder, fsg, jsgf);
       if (rv < 0) throw new Error("Failed to initialize grammar");
@@ -348,34 +438,147 @@ class Decoder {
   }
 
   /**
-   * Process a block of audio data.
-   * @param {Float32Array} pcm Audio data, in float32 format, in
-   * the range [-1.0, 1.0].
+   * Make sure the audio input buffer can hold some data.
+   *
+   * The buffer is kept in the heap between calls, growing as needed,
+   * to avoid allocating and freeing memory for every block of audio.
+   * @param {number} pcm_bytes Size of data in bytes.
+   */
+  reserve_audio(pcm_bytes) {
+    if (pcm_bytes <= this.pcm_alloc) return;
+    let alloc = this.pcm_alloc || 4096;
+    while (alloc < pcm_bytes) alloc *= 2;
+    // Contents don't need to be kept, so don't realloc
+    if (this.pcm_addr != 0) Module._free(this.pcm_addr);
+    this.pcm_alloc = 0;
+    this.pcm_addr = Module._malloc(alloc);
+    if (this.pcm_addr == 0)
+      throw new Error(`Failed to allocate ${alloc} bytes for audio`);
+    this.pcm_alloc = alloc;
+  }
+
+  /**
+   * Get a view of the audio input buffer to write data into.
+   *
+   * This allows audio to be written directly into the decoder's
+   * memory and then processed with `process_audio_buffer`, without
+   * an extra copy.  The view is only valid until the next call to
+   * any other decoder method, as memory may grow and move.
+   * @param {number} n_samples Number of samples to make room for.
+   * @returns {Float32Array} View of (at least) `n_samples` samples.
+   */
+  get_audio_buffer(n_samples) {
+    this.assert_initialized();
+    this.reserve_audio(n_samples * 4);
+    const start = this.pcm_addr >> 2;
+    return HEAPF32.subarray(start, start + n_samples);
+  }
+
+  /**
+   * Process audio data written into the buffer from `get_audio_buffer`.
+   * @param {number} n_samples Number of samples written.
    * @returns Number of frames processed.
    */
-  process_audio(pcm, no_search = false, full_utt = false) {
+  process_audio_buffer(n_samples, no_search = false, full_utt = false) {
     this.assert_initialized();
-    const pcm_bytes = pcm.length * pcm.BYTES_PER_ELEMENT;
-    const pcm_addr = Module._malloc(pcm_bytes);
-    // This Javascript API is rather stupid.  DO NOT forget byteOffset and length.
-    const pcm_u8 = new Uint8Array(pcm.buffer, pcm.byteOffset, pcm_bytes);
-    // Emscripten documentation (what documentation) fails to
-    // mention that this function specifically takes a Uint8Array
-    writeArrayToMemory(pcm_u8, pcm_addr);
+    if (n_samples * 4 > this.pcm_alloc)
+      throw new Error(`Audio buffer does not contain ${n_samples} samples`);
     const rv = Module._decoder_process_float32(
       this.cdecoder,
-      pcm_addr,
-      pcm_bytes / 4,
+      this.pcm_addr,
+      n_samples,
       no_search,
       full_utt
     );
-    Module._free(pcm_addr);
     if (rv < 0) {
       throw new Error("Utterance processing failed");
     }
     return rv;
   }
 
+  /**
+   * Process a block of audio data.
+   * @param {Float32Array} pcm Audio data, in float32 format, in
+   * the range [-1.0, 1.0].
+   * @returns Number of frames processed.
+   */
+  process_audio(pcm, no_search = false, full_utt = false) {
+    return this.process_audio_batch([pcm], no_search, full_utt);
+  }
+
+  /**
+   * Process several blocks of audio data at once.
+   *
+   * This is the same as calling `process_audio` on each of them in
+   * turn, but copies them all into the decoder's memory and then
+   * processes them with a single call.
+   * @param {Array<Float32Array>} chunks Audio data, in float32 format,
+   * in the range [-1.0, 1.0].
+   * @returns Number of frames processed.
+   */
+  process_audio_batch(chunks, no_search = false, full_utt = false) {
+    this.assert_initialized();
+    let pcm_bytes = 0;
+    for (const pcm of chunks) pcm_bytes += pcm.length * pcm.BYTES_PER_ELEMENT;
+    this.reserve_audio(pcm_bytes);
+    let pos = this.pcm_addr;
+    for (const pcm of chunks) {
+      const nbytes = pcm.length * pcm.BYTES_PER_ELEMENT;
+      // This Javascript API is rather stupid.  DO NOT forget byteOffset and length.
+      HEAPU8.set(new Uint8Array(pcm.buffer, pcm.byteOffset, nbytes), pos);
+      pos += nbytes;
+    }
+    return this.process_audio_buffer(pcm_bytes / 4, no_search, full_utt);
+  }
+
+  /**
+   * Queue a block of audio data to be decoded by `step`.
+   *
+   * This only copies the data, so it returns right away.  Anything
+   * left in the queue is decoded by `stop`.
+   * @param {Float32Array} pcm Audio data, in float32 format, in
+   * the range [-1.0, 1.0].
+   */
+  enqueue_audio(pcm) {
+    this.assert_initialized();
+    const nbytes = pcm.length * pcm.BYTES_PER_ELEMENT;
+    this.reserve_audio(nbytes);
+    HEAPU8.set(
+      new Uint8Array(pcm.buffer, pcm.byteOffset, nbytes),
+      this.pcm_addr
+    );
+    const rv = Module._decoder_enqueue_float32(
+      this.cdecoder,
+      this.pcm_addr,
+      nbytes / 4
+    );
+    if (rv < 0) {
+      throw new Error("Failed to queue audio");
+    }
+  }
+
+  /**
+   * Decode some of the audio queued with `enqueue_audio`.
+   *
+   * This allows decoding to be interleaved with other work on the
+   * same thread, for instance by calling it (and yielding to the
+   * event loop) until it returns 0.
+   * @param {number} max_frames Maximum number of frames to search,
+   * or 0 for no limit.
+   * @param {number} max_usec Maximum time to spend, in microseconds,
+   * or 0 for no limit.
+   * @returns Number of frames searched, or 0 if there is nothing to
+   * do until more audio is queued.
+   */
+  step(max_frames = 0, max_usec = 0) {
+    this.assert_initialized();
+    const rv = Module._decoder_step(this.cdecoder, max_frames, max_usec);
+    if (rv < 0) {
+      throw new Error("Failed to decode queued audio");
+    }
+    return rv;
+  }
+
   /**
    * Get the currently recognized text.
    * @returns {string} Currently recognized text.
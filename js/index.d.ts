@@ -8,6 +8,7 @@ export class Decoder {
   get_config(key: string): string | number;
   has_config(key: string): boolean;
   initialize(): Promise<any>;
+  get_model_files(): Array<string>;
   reinitialize_audio(): Promise<void>;
   start(): void;
   stop(): void;
@@ -16,6 +17,19 @@ export class Decoder {
     no_search?: boolean,
     full_utt?: boolean
   ): number;
+  process_audio_batch(
+    chunks: Array<Float32Array | Uint8Array>,
+    no_search?: boolean,
+    full_utt?: boolean
+  ): number;
+  get_audio_buffer(n_samples: number): Float32Array;
+  process_audio_buffer(
+    n_samples: number,
+    no_search?: boolean,
+    full_utt?: boolean
+  ): number;
+  enqueue_audio(pcm: Float32Array | Uint8Array): void;
+  step(max_frames?: number, max_usec?: number): number;
   get_text(): string;
   get_alignment({
     start,
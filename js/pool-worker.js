@@ -0,0 +1,39 @@
+/**
+ * Worker thread for DecoderPool.
+ */
+import { parentPort, workerData } from "node:worker_threads";
+import { default as createModule } from "./soundswallower.node.js";
+
+const { wasmModule, modelFiles, config } = workerData;
+let decoder;
+try {
+  const soundswallower = await createModule({
+    instantiateWasm(imports, receiveInstance) {
+      WebAssembly.instantiate(wasmModule, imports).then((instance) =>
+        receiveInstance(instance, wasmModule)
+      );
+      return {};
+    },
+    modelFiles,
+  });
+  decoder = new soundswallower.Decoder(config);
+  await decoder.initialize();
+  parentPort.postMessage({});
+} catch (e) {
+  parentPort.postMessage({ error: e.message });
+}
+
+parentPort.on("message", ({ id, pcm, align_level }) => {
+  try {
+    decoder.start();
+    decoder.process_audio(pcm, false, true);
+    decoder.stop();
+    parentPort.postMessage({
+      id,
+      text: decoder.get_text(),
+      alignment: decoder.get_alignment({ align_level }),
+    });
+  } catch (e) {
+    parentPort.postMessage({ id, error: e.message });
+  }
+});
@@ -0,0 +1,15 @@
+import { Config, Segment } from "./index.js";
+export interface PoolResult {
+  text: string;
+  alignment: Segment;
+}
+export class DecoderPool {
+  constructor(options?: { config?: Config; size?: number });
+  size: number;
+  initialize(): Promise<void>;
+  decode(
+    pcm: Float32Array | Uint8Array,
+    options?: { align_level?: number }
+  ): Promise<PoolResult>;
+  terminate(): Promise<void>;
+}
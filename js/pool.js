@@ -0,0 +1,195 @@
+/**
+ * Pool of decoders running in worker threads (Node.js only).
+ *
+ * Each worker has its own instance of the WebAssembly module, since
+ * they cannot share memory, but the module is only compiled once, and
+ * the model files are only read once, into shared memory from which
+ * each worker loads them.
+ */
+import { availableParallelism, cpus } from "node:os";
+import { readFile } from "node:fs/promises";
+import { Worker } from "node:worker_threads";
+import { default as createModule } from "./soundswallower.node.js";
+
+/**
+ * Compile the WebAssembly module, once, so it can be sent to workers.
+ */
+async function compile_wasm() {
+  const wasm = await readFile(
+    new URL("soundswallower.node.wasm", import.meta.url)
+  );
+  return WebAssembly.compile(wasm);
+}
+
+/**
+ * Read model files into shared memory.
+ */
+async function read_model_files(paths) {
+  const files = {};
+  await Promise.all(
+    paths.map(async (path) => {
+      let data;
+      try {
+        data = await readFile(path);
+      } catch (e) {
+        /* Optional files may not exist, the decoder will complain if
+         * required ones do not. */
+        return;
+      }
+      const shared = new SharedArrayBuffer(data.length);
+      new Uint8Array(shared).set(data);
+      files[path] = shared;
+    })
+  );
+  return files;
+}
+
+/**
+ * Pool of decoders running in worker threads.
+ */
+export class DecoderPool {
+  /**
+   * Create the pool (but do not start it).
+   * @param {Object} [options]
+   * @param {Object} [options.config] Configuration parameters for
+   * the decoders (as for `Decoder`).
+   * @param {number} [options.size] Number of workers, by default the
+   * number of CPUs available.
+   */
+  constructor({ config = {}, size } = {}) {
+    this.config = config;
+    this.size =
+      size === undefined
+        ? typeof availableParallelism === "function"
+          ? availableParallelism()
+          : cpus().length
+        : size;
+    this.workers = [];
+    this.idle = [];
+    this.queue = [];
+    this.jobs = new Map();
+    this.next_id = 0;
+  }
+
+  /**
+   * Start the workers and load the model in each of them.
+   * @returns {Promise} Promise resolved once all workers are ready.
+   */
+  async initialize() {
+    const wasmModule = await compile_wasm();
+    const instantiateWasm = (imports, receiveInstance) => {
+      WebAssembly.instantiate(wasmModule, imports).then((instance) =>
+        receiveInstance(instance, wasmModule)
+      );
+      return {};
+    };
+    /* Use a decoder (which we will not initialize) to find the
+     * model files with the full configuration. */
+    const soundswallower = await createModule({ instantiateWasm });
+    const decoder = new soundswallower.Decoder({ ...this.config });
+    const modelFiles = await read_model_files(decoder.get_model_files());
+    decoder.delete();
+
+    const ready = [];
+    for (let i = 0; i < this.size; ++i) {
+      const worker = new Worker(new URL("pool-worker.js", import.meta.url), {
+        workerData: { wasmModule, modelFiles, config: this.config },
+      });
+      ready.push(
+        new Promise((resolve, reject) => {
+          worker.once("message", ({ error }) =>
+            error === undefined ? resolve() : reject(new Error(error))
+          );
+          worker.once("error", reject);
+        })
+      );
+      this.workers.push(worker);
+    }
+    try {
+      await Promise.all(ready);
+    } catch (e) {
+      await this.terminate();
+      throw e;
+    }
+    for (const worker of this.workers) {
+      worker.on("message", (msg) => this.on_message(worker, msg));
+      worker.on("error", (e) => this.on_error(worker, e));
+      this.idle.push(worker);
+    }
+  }
+
+  /**
+   * Recognize an utterance in the next available worker.
+   * @param {Float32Array} pcm Audio data, in float32 format, in the
+   * range [-1.0, 1.0].  It is copied to the worker.
+   * @param {Object} [options]
+   * @param {number} [options.align_level] Level of detail for the
+   * alignment, as for `Decoder.get_alignment`.
+   * @returns {Promise<Object>} Promise resolved with an Object with
+   * the keys `text` (the recognized text) and `alignment` (as
+   * returned by `Decoder.get_alignment`).
+   */
+  decode(pcm, { align_level = 0 } = {}) {
+    if (this.workers.length == 0)
+      return Promise.reject(new Error("Pool not yet initialized"));
+    return new Promise((resolve, reject) => {
+      const id = this.next_id++;
+      this.queue.push({ id, pcm, align_level, resolve, reject });
+      this.dispatch();
+    });
+  }
+
+  /**
+   * Stop all the workers.  Any pending requests are rejected.
+   */
+  async terminate() {
+    const error = new Error("Pool terminated");
+    for (const { reject } of this.jobs.values()) reject(error);
+    for (const { reject } of this.queue) reject(error);
+    this.jobs.clear();
+    this.queue = [];
+    this.idle = [];
+    const workers = this.workers;
+    this.workers = [];
+    await Promise.all(workers.map((worker) => worker.terminate()));
+  }
+
+  /**
+   * Send queued requests to idle workers.
+   */
+  dispatch() {
+    while (this.idle.length > 0 && this.queue.length > 0) {
+      const worker = this.idle.pop();
+      const job = this.queue.shift();
+      this.jobs.set(worker, job);
+      worker.postMessage({
+        id: job.id,
+        pcm: job.pcm,
+        align_level: job.align_level,
+      });
+    }
+  }
+
+  on_message(worker, { id, error, text, alignment }) {
+    const job = this.jobs.get(worker);
+    this.jobs.delete(worker);
+    this.idle.push(worker);
+    if (job !== undefined && job.id == id) {
+      if (error !== undefined) job.reject(new Error(error));
+      else job.resolve({ text, alignment });
+    }
+    this.dispatch();
+  }
+
+  on_error(worker, e) {
+    /* The worker is gone, so is its request. */
+    const job = this.jobs.get(worker);
+    this.jobs.delete(worker);
+    this.workers = this.workers.filter((w) => w !== worker);
+    if (job !== undefined) job.reject(e);
+    if (this.workers.length == 0) {
+      for (const { reject } of this.queue) reject(e);
+      this.queue = [];
+    }
+  }
+}
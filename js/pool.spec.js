@@ -0,0 +1,29 @@
+import { load_binary_file } from "soundswallower";
+import { DecoderPool } from "soundswallower/pool";
+import { assert } from "chai";
+
+describe("Test decoder pool", () => {
+  it("Should decode in several workers at once", async () => {
+    const pool = new DecoderPool({
+      config: { fsg: "testdata/goforward.fsg", samprate: 16000 },
+      size: 2,
+    });
+    await pool.initialize();
+    const pcm = await load_binary_file("testdata/goforward-float32.raw");
+    const results = await Promise.all(
+      [0, 1, 2, 3].map(() => pool.decode(pcm, { align_level: 1 }))
+    );
+    for (const { text, alignment } of results) {
+      assert.equal(text, "go forward ten meters");
+      assert.equal(alignment.t, "go forward ten meters");
+    }
+    await pool.terminate();
+    let failed = false;
+    try {
+      await pool.decode(pcm);
+    } catch (e) {
+      failed = true;
+    }
+    assert.ok(failed);
+  });
+});
@@ -98,6 +98,33 @@ export function make_tests(soundswallower, load_binary_file, assert) {
       assert.equal("go forward ten meters", decoder.get_text());
       decoder.delete();
     });
+    it("Should process batches and the audio buffer", async () => {
+      let decoder = new soundswallower.Decoder({
+        fsg: "testdata/goforward.fsg",
+        samprate: 16000,
+      });
+      await decoder.initialize();
+      let pcm = await load_binary_file("testdata/goforward-float32.raw");
+      let pcm32 = new Float32Array(pcm.buffer, pcm.byteOffset, pcm.length / 4);
+      decoder.start();
+      // First half in batches of 128-sample chunks
+      const half = 1024 * Math.floor(pcm32.length / 2048);
+      for (let pos = 0; pos < half; pos += 1024) {
+        let chunks = [];
+        for (let i = 0; i < 1024; i += 128)
+          chunks.push(pcm32.subarray(pos + i, pos + i + 128));
+        decoder.process_audio_batch(chunks);
+      }
+      // Second half written directly into the decoder's buffer
+      for (let pos = half; pos < pcm32.length; pos += 1024) {
+        const chunk = pcm32.subarray(pos, pos + 1024);
+        decoder.get_audio_buffer(chunk.length).set(chunk);
+        decoder.process_audio_buffer(chunk.length);
+      }
+      decoder.stop();
+      assert.equal("go forward ten meters", decoder.get_text());
+      decoder.delete();
+    });
     it('Should align "go forward ten meters"', async () => {
       let decoder = new soundswallower.Decoder({
         samprate: 16000,
@@ -45,6 +45,25 @@ cdef extern from "soundswallower/fe.h":
     ctypedef struct fe_t:
         pass
 
+cdef extern from "soundswallower/feat.h":
+    ctypedef struct feat_t:
+        pass
+
+cdef extern from "soundswallower/feat_archive.h":
+    ctypedef struct feat_archive_t:
+        pass
+    ctypedef struct feat_archive_writer_t:
+        pass
+    feat_archive_writer_t *feat_archive_writer_init(const char *filename,
+                                                    feat_t *fcb)
+    feat_archive_writer_t *feat_archive_writer_init_senscr(const char *filename,
+                                                           int n_sen)
+    int feat_archive_writer_close(feat_archive_writer_t *w)
+    feat_archive_t *feat_archive_read(const char *filename)
+    void feat_archive_free(feat_archive_t *fa)
+    int feat_archive_n_utt(feat_archive_t *fa)
+    const char *feat_archive_uttid(feat_archive_t *fa, int utt)
+
 cdef extern from "soundswallower/hash_table.h":
     ctypedef struct hash_table_t:
         pass
@@ -147,6 +166,23 @@ cdef extern from "soundswallower/jsgf.h":
                                 logmath_t *lmath, float lw)
 
 
+cdef extern from "soundswallower/decoder_result.h":
+    ctypedef struct decoder_result_t:
+        pass
+    ctypedef struct decoder_seg_t:
+        const char *word
+        int sf
+        int ef
+        int ascr
+        int lscr
+        int prob
+    int decoder_result_free(decoder_result_t *r)
+    const char *decoder_result_hyp(decoder_result_t *r, int *out_best_score)
+    int decoder_result_prob(decoder_result_t *r)
+    const decoder_seg_t *decoder_result_seg(decoder_result_t *r, int *out_n_seg)
+    int decoder_result_final(decoder_result_t *r)
+
+
 cdef extern from "soundswallower/decoder.h":
     ctypedef struct decoder_t:
         pass
@@ -160,13 +196,34 @@ cdef extern from "soundswallower/decoder.h":
     int decoder_reinit_feat(decoder_t *ps, config_t *config)
     config_t *decoder_config(decoder_t *ps)
     logmath_t *decoder_logmath(decoder_t *ps)
+    feat_t *decoder_feat(decoder_t *ps)
+    int decoder_n_senones(decoder_t *ps)
     int decoder_start_utt(decoder_t *ps)
     int decoder_process_int16(decoder_t *ps,
                               short *data, size_t n_samples,
-                              int no_search, int full_utt)
-    int decoder_end_utt(decoder_t *ps)
+                              int no_search, int full_utt) nogil
+    int decoder_process_float32(decoder_t *ps,
+                                float *data, size_t n_samples,
+                                int no_search, int full_utt) nogil
+    int decoder_enqueue_int16(decoder_t *ps,
+                              const short *data, size_t n_samples)
+    int decoder_step(decoder_t *ps, int max_frames, int max_usec) nogil
+    int decoder_end_utt(decoder_t *ps) nogil
+    int decoder_rewind(decoder_t *ps) nogil
+    unsigned char *decoder_snapshot(decoder_t *d, size_t *out_size)
+    int decoder_restore(decoder_t *d, const unsigned char *data, size_t size)
+    int decoder_process_archive(decoder_t *ps, feat_archive_t *fa,
+                                int utt) nogil
+    int decoder_archive_int16(decoder_t *ps, feat_archive_writer_t *w,
+                              const char *uttid, short *data,
+                              size_t n_samples) nogil
+    int decoder_archive_senscr_int16(decoder_t *ps, feat_archive_writer_t *w,
+                                     const char *uttid, short *data,
+                                     size_t n_samples) nogil
     const char *decoder_hyp(decoder_t *ps, int *out_best_score)
+    const char *decoder_stable_hyp(decoder_t *ps, int *out_frame)
     int decoder_prob(decoder_t *ps)
+    decoder_result_t *decoder_result(decoder_t *ps)
     seg_iter_t *decoder_seg_iter(decoder_t *ps)
     seg_iter_t *seg_iter_next(seg_iter_t *seg)
     const char *seg_iter_word(seg_iter_t *seg)
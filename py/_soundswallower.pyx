@@ -8,10 +8,12 @@
 #
 # Author: David Huggins-Daines <dhdaines@gmail.com>
 
-from libc.stdlib cimport free, malloc
+from libc.stdlib cimport free, malloc, realloc
+from libc.string cimport memcpy
 
 import itertools
 import logging
+import threading
 
 import soundswallower
 
@@ -19,6 +21,20 @@ cimport _soundswallower
 
 LOGGER = logging.getLogger("soundswallower")
 
+# Layout of one row of the array returned by Decoder.decode_batch
+cdef struct batch_seg_t:
+    int utt
+    int word
+    int start
+    int end
+    double ascr
+    double lscr
+    double prob
+
+BATCH_SEG_FIELDS = [("utt", "i4"), ("word", "i4"),
+                    ("start", "i4"), ("end", "i4"),
+                    ("ascr", "f8"), ("lscr", "f8"), ("prob", "f8")]
+
 cdef class Config:
     """Configuration object for SoundSwallower.
 
@@ -253,6 +269,14 @@ cdef class Decoder:
 
     See :doc:`config_params` for a description of keyword arguments.
 
+    A decoder can be shared between threads.  Its methods release the
+    GIL while decoding, but each one holds a lock on the decoder while
+    it runs, so if one thread calls `hyp`, `seg`, `set_fsg` or
+    anything else while another is in `process_raw` or `end_utt`,
+    it waits until that has finished.  Only `result` can be read
+    without waiting.  To decode in parallel, use a separate decoder
+    for each thread.
+
     Args:
         hmm(str): Path to directory containing acoustic model files.
         dict(str): Path to pronunciation dictionary.
@@ -268,6 +292,13 @@ cdef class Decoder:
         RuntimeError: on failure to create decoder.
     """
     cdef decoder_t *_ps
+    cdef object _lock
+
+    def __cinit__(self, *args, **kwargs):
+        # Held while using the decoder, so that other threads can
+        # run while it is processing audio (without the GIL) but not
+        # use the same decoder at the same time.
+        self._lock = threading.RLock()
 
     def __init__(self, *args, **kwargs):
         cdef Config config
@@ -340,14 +371,15 @@ cdef class Decoder:
                           reinitialize decoder.
         """
         cdef config_t *cconfig
-        if config is None:
-            cconfig = NULL
-        else:
-            self.config = config
-            # Because decoder owns configs, but Python does too
-            cconfig = config_retain(config.config)
-        if decoder_reinit(self._ps, cconfig) != 0:
-            raise RuntimeError("Failed to initialize decoder")
+        with self._lock:
+            if config is None:
+                cconfig = NULL
+            else:
+                self.config = config
+                # Because decoder owns configs, but Python does too
+                cconfig = config_retain(config.config)
+            if decoder_reinit(self._ps, cconfig) != 0:
+                raise RuntimeError("Failed to initialize decoder")
 
     def reinit_feat(self, Config config=None):
         """Reinitialize only the feature computation.
@@ -361,13 +393,14 @@ cdef class Decoder:
                           initialize feature computation.
         """
         cdef config_t *cconfig
-        if config is None:
-            cconfig = NULL
-        else:
-            self.config = config
-            cconfig = config_retain(config.config)
-        if decoder_reinit_feat(self._ps, cconfig) < 0:
-            raise RuntimeError("Failed to reinitialize feature extraction")
+        with self._lock:
+            if config is None:
+                cconfig = NULL
+            else:
+                self.config = config
+                cconfig = config_retain(config.config)
+            if decoder_reinit_feat(self._ps, cconfig) < 0:
+                raise RuntimeError("Failed to reinitialize feature extraction")
 
     @property
     def config(self):
@@ -388,9 +421,11 @@ cdef class Decoder:
         Returns:
             Config: decoder configuration.
         """
-        # Decoder owns the config, so we must retain it
-        cdef config_t *config = decoder_config(self._ps)
-        return Config.create_from_ptr(config_retain(config))
+        cdef config_t *config
+        with self._lock:
+            # Decoder owns the config, so we must retain it
+            config = decoder_config(self._ps)
+            return Config.create_from_ptr(config_retain(config))
 
     def update_cmn(self):
         """Update current cepstral mean.
@@ -398,8 +433,10 @@ cdef class Decoder:
         Returns:
           str: New cepstral mean as a comma-separated list of numbers.
         """
-        cdef const char *cmn = decoder_get_cmn(self._ps, True)
-        return cmn.decode("utf-8")
+        cdef const char *cmn
+        with self._lock:
+            cmn = decoder_get_cmn(self._ps, True)
+            return cmn.decode("utf-8")
 
     @property
     def cmn(self):
@@ -410,8 +447,10 @@ cdef class Decoder:
         Returns:
           str: Cepstral mean as a comma-separated list of numbers.
         """
-        cdef const char *cmn = decoder_get_cmn(self._ps, False)
-        return cmn.decode("utf-8")
+        cdef const char *cmn
+        with self._lock:
+            cmn = decoder_get_cmn(self._ps, False)
+            return cmn.decode("utf-8")
 
     @cmn.setter
     def cmn(self, cmn):
@@ -420,9 +459,11 @@ cdef class Decoder:
         Args:
           cmn(str): Cepstral mean as a comma-separated list of numbers.
         """
-        cdef int rv = decoder_set_cmn(self._ps, cmn.encode("utf-8"))
-        if rv != 0:
-            raise ValueError("Invalid CMN string")
+        cdef int rv
+        with self._lock:
+            rv = decoder_set_cmn(self._ps, cmn.encode("utf-8"))
+            if rv != 0:
+                raise ValueError("Invalid CMN string")
 
     def start_utt(self):
         """Start processing raw audio input.
@@ -434,8 +475,9 @@ cdef class Decoder:
             RuntimeError: If processing fails to start (usually if it
                           has already been started).
         """
-        if decoder_start_utt(self._ps) < 0:
-            raise RuntimeError, "Failed to start utterance processing"
+        with self._lock:
+            if decoder_start_utt(self._ps) < 0:
+                raise RuntimeError, "Failed to start utterance processing"
 
     def process_raw(self, data, no_search=False, full_utt=False):
         """Process a block of raw audio.
@@ -450,9 +492,62 @@ cdef class Decoder:
         """
         cdef const unsigned char[:] cdata = data
         cdef Py_ssize_t n_samples = len(cdata) // 2
-        if decoder_process_int16(self._ps, <const short *>&cdata[0],
-                            n_samples, no_search, full_utt) < 0:
-            raise RuntimeError, "Failed to process %d samples of audio data" % len / 2
+        cdef int c_no_search = no_search, c_full_utt = full_utt
+        cdef int rv
+        with self._lock:
+            # Release the GIL so other threads (or an event loop) can run
+            with nogil:
+                rv = decoder_process_int16(self._ps, <short *>&cdata[0],
+                                           n_samples, c_no_search, c_full_utt)
+            if rv < 0:
+                raise RuntimeError, "Failed to process %d samples of audio data" % n_samples
+
+    def enqueue_raw(self, data):
+        """Queue a block of raw audio to be decoded by `step`.
+
+        This only copies the data, so it returns right away.  Anything
+        left in the queue is decoded by `end_utt`.
+
+        Args:
+            data(bytes): Raw audio data, a block of 16-bit signed integer binary data.
+        Raises:
+            RuntimeError: If the utterance is not started.
+        """
+        cdef const unsigned char[:] cdata = data
+        cdef Py_ssize_t n_samples = len(cdata) // 2
+        with self._lock:
+            if n_samples == 0:
+                return
+            if decoder_enqueue_int16(self._ps, <const short *>&cdata[0],
+                                     n_samples) < 0:
+                raise RuntimeError, "Failed to queue %d samples of audio data" % n_samples
+
+    def step(self, max_frames=0, max_usec=0):
+        """Decode some of the audio queued with `enqueue_raw`.
+
+        This allows an event loop to interleave decoding with other
+        work, for instance by calling it until it returns 0 and
+        yielding between calls.
+
+        Args:
+            max_frames(int): Maximum number of frames to search, or 0
+                             for no limit.
+            max_usec(int): Maximum time to spend, in microseconds, or
+                           0 for no limit.
+        Returns:
+            int: Number of frames searched, or 0 if there is nothing
+            to do until more audio is queued.
+        Raises:
+            RuntimeError: If decoding fails.
+        """
+        cdef int c_max_frames = max_frames, c_max_usec = max_usec
+        cdef int rv
+        with self._lock:
+            with nogil:
+                rv = decoder_step(self._ps, c_max_frames, c_max_usec)
+            if rv < 0:
+                raise RuntimeError, "Failed to decode queued audio data"
+            return rv
 
     def end_utt(self):
         """Finish processing raw audio input.
@@ -462,8 +557,84 @@ cdef class Decoder:
         internal buffers and finalizing recognition results.
 
         """
-        if decoder_end_utt(self._ps) < 0:
-            raise RuntimeError, "Failed to stop utterance processing"
+        cdef int rv
+        with self._lock:
+            with nogil:
+                rv = decoder_end_utt(self._ps)
+            if rv < 0:
+                raise RuntimeError, "Failed to stop utterance processing"
+
+    def rewind(self):
+        """Search the current or last utterance again.
+
+        This reuses the features already computed from the audio, so
+        it is a cheap way to try another grammar (set with
+        `set_fsg` or `set_jsgf_string`) on the same input, for
+        instance if the confidence of the first result is low.  If
+        the utterance has ended, the new result is available
+        immediately, otherwise decoding continues as usual.
+
+        Returns:
+            int: Number of frames searched.
+        Raises:
+            RuntimeError: If features are not available for the
+                          whole utterance (for instance with
+                          `rolling` decoding).
+        """
+        cdef int rv
+        with self._lock:
+            with nogil:
+                rv = decoder_rewind(self._ps)
+            if rv < 0:
+                raise RuntimeError("Failed to rewind utterance")
+            return rv
+
+    def snapshot(self):
+        """Save the state of the current utterance.
+
+        The snapshot can be passed to `restore` on a decoder created
+        with the same configuration, possibly in another process, to
+        continue recognition where this one left off.  It is only
+        valid on a machine with the same byte order.
+
+        Returns:
+            bytes: Snapshot of the utterance in progress.
+        Raises:
+            RuntimeError: If no utterance is in progress or the
+                          current search does not support snapshots.
+        """
+        cdef unsigned char *data
+        cdef size_t size
+        with self._lock:
+            data = decoder_snapshot(self._ps, &size)
+            if data == NULL:
+                raise RuntimeError("Failed to save decoder state")
+            try:
+                return data[:size]
+            finally:
+                free(data)
+
+    def restore(self, data):
+        """Continue an utterance saved with `snapshot`.
+
+        Any utterance in progress is ended first.  After restoring,
+        pass the remaining audio to `process_raw` and call `end_utt`
+        as usual.  Word alignment (`set_align_text`) is not available
+        for a restored utterance.
+
+        Args:
+            data(bytes): Snapshot returned by `snapshot`.
+        Raises:
+            RuntimeError: If the snapshot is invalid or does not match
+                          this decoder's configuration.
+        """
+        cdef const unsigned char[:] cdata = data
+        cdef int rv
+        with self._lock:
+            rv = decoder_restore(self._ps, &cdata[0] if len(cdata) else NULL,
+                                 len(cdata))
+            if rv < 0:
+                raise RuntimeError("Failed to restore decoder state")
 
     @property
     def hyp(self):
@@ -476,15 +647,80 @@ cdef class Decoder:
         cdef const char *hyp
         cdef logmath_t *lmath
         cdef int score
+        with self._lock:
+            hyp = decoder_hyp(self._ps, &score)
+            if hyp == NULL:
+                 return soundswallower.Hyp(text=None, score=0., prob=0.)
+            lmath = decoder_logmath(self._ps)
+            prob = decoder_prob(self._ps)
+            return soundswallower.Hyp(text=hyp.decode('utf-8'),
+                                      score=logmath_exp(lmath, score),
+                                      prob=logmath_exp(lmath, prob))
 
-        hyp = decoder_hyp(self._ps, &score)
-        if hyp == NULL:
-             return soundswallower.Hyp(text=None, score=0., prob=0.)
-        lmath = decoder_logmath(self._ps)
-        prob = decoder_prob(self._ps)
-        return soundswallower.Hyp(text=hyp.decode('utf-8'),
-                                  score=logmath_exp(lmath, score),
-                                  prob=logmath_exp(lmath, prob))
+    @property
+    def result(self):
+        """Most recently published recognition result.
+
+        Unlike `hyp` and `seg`, this can be read from another thread
+        while `process_raw` or `end_utt` is running, without waiting
+        for it (though not while `initialize` is running, as it
+        replaces the configuration).  The decoder must have been
+        created with `publish=True`, in which case it publishes a
+        result when each utterance starts, after each block of audio,
+        and when the utterance ends.
+
+        Returns:
+            Optional[Result]: Current result, or None if none has
+            been published.
+        """
+        cdef config_t *cconfig = decoder_config(self._ps)
+        cdef logmath_t *lmath = decoder_logmath(self._ps)
+        cdef int frate = config_int(cconfig, "frate")
+        cdef decoder_result_t *r = decoder_result(self._ps)
+        cdef const decoder_seg_t *segs
+        cdef int score, n_seg, i
+        if r == NULL:
+            return None
+        try:
+            hyp = decoder_result_hyp(r, &score).decode("utf-8")
+            segs = decoder_result_seg(r, &n_seg)
+            seg = []
+            for i in range(n_seg):
+                seg.append(soundswallower.Seg(
+                    text=segs[i].word.decode("utf-8"),
+                    start=<double>segs[i].sf / frate,
+                    duration=<double>(segs[i].ef + 1 - segs[i].sf) / frate,
+                    ascore=logmath_exp(lmath, segs[i].ascr),
+                    lscore=logmath_exp(lmath, segs[i].lscr)))
+            return soundswallower.Result(
+                hyp=soundswallower.Hyp(
+                    text=hyp,
+                    score=logmath_exp(lmath, score),
+                    prob=logmath_exp(lmath, decoder_result_prob(r))),
+                seg=seg,
+                final=bool(decoder_result_final(r)))
+        finally:
+            decoder_result_free(r)
+
+    def stable_hyp(self):
+        """Words which have become stable since the last call.
+
+        With the `rolling` parameter, long streams can be decoded as a
+        single utterance, periodically finalizing the part of the
+        hypothesis which can no longer change.  Those words are
+        returned (once) by this method and are no longer included in
+        `hyp` or `seg`.
+
+        Returns:
+            Optional[str]: Space-separated words, or None if none have
+            become stable.
+        """
+        cdef const char *hyp
+        with self._lock:
+            hyp = decoder_stable_hyp(self._ps, NULL)
+            if hyp == NULL:
+                return None
+            return hyp.decode('utf-8')
 
     def add_word(self, str word, str phones, update=True):
         """Add a word to the pronunciation dictionary.
@@ -504,10 +740,12 @@ cdef class Decoder:
         Raises:
             KeyError: If word already exists in dictionary.
         """
-        cdef rv = decoder_add_word(self._ps, word.encode("utf-8"),
-                                   phones.encode("utf-8"), update)
-        if rv < 0:
-            raise KeyError("Word %s already exists" % word)
+        cdef object rv
+        with self._lock:
+            rv = decoder_add_word(self._ps, word.encode("utf-8"),
+                                  phones.encode("utf-8"), update)
+            if rv < 0:
+                raise KeyError("Word %s already exists" % word)
 
     def lookup_word(self, str word):
         """Look up a word in the dictionary and return phone transcription
@@ -519,13 +757,14 @@ cdef class Decoder:
             str: Space-separated list of phones, or None if not found.
         """
         cdef char *cphones
-        cphones = decoder_lookup_word(self._ps, word.encode("utf-8"))
-        if cphones == NULL:
-            return None
-        else:
-            phones = cphones.decode("utf-8")
-            free(cphones)
-            return phones
+        with self._lock:
+            cphones = decoder_lookup_word(self._ps, word.encode("utf-8"))
+            if cphones == NULL:
+                return None
+            else:
+                phones = cphones.decode("utf-8")
+                free(cphones)
+                return phones
 
     @property
     def seg(self):
@@ -535,23 +774,29 @@ cdef class Decoder:
             Iterable[Seg]: Generator over word segmentations.
 
         """
-        cdef config_t *cconfig = decoder_config(self._ps)
-        cdef logmath_t *lmath = decoder_logmath(self._ps)
-        cdef seg_iter_t *itor = decoder_seg_iter(self._ps)
-        cdef int frate = config_int(cconfig, "frate")
+        cdef config_t *cconfig
+        cdef logmath_t *lmath
+        cdef seg_iter_t *itor
+        cdef int frate
         cdef int prob, ascr, lscr, sf, ef
-        if itor == NULL:
-            return
-        while itor != NULL:
-            seg_iter_frames(itor, &sf, &ef)
-            prob = seg_iter_prob(itor, &ascr, &lscr)
-            yield soundswallower.Seg(
-                text=seg_iter_word(itor).decode('utf-8'),
-                start=<double>sf / frate,
-                duration=<double>(ef + 1 - sf) / frate,
-                ascore=logmath_exp(lmath, ascr),
-                lscore=logmath_exp(lmath, lscr))
-            itor = seg_iter_next(itor)
+        segs = []
+        # Not holding the lock while the caller iterates over them
+        with self._lock:
+            cconfig = decoder_config(self._ps)
+            lmath = decoder_logmath(self._ps)
+            frate = config_int(cconfig, "frate")
+            itor = decoder_seg_iter(self._ps)
+            while itor != NULL:
+                seg_iter_frames(itor, &sf, &ef)
+                prob = seg_iter_prob(itor, &ascr, &lscr)
+                segs.append(soundswallower.Seg(
+                    text=seg_iter_word(itor).decode('utf-8'),
+                    start=<double>sf / frate,
+                    duration=<double>(ef + 1 - sf) / frate,
+                    ascore=logmath_exp(lmath, ascr),
+                    lscore=logmath_exp(lmath, lscr)))
+                itor = seg_iter_next(itor)
+        yield from segs
 
     def read_fsg(self, filename):
         """Read a grammar from an FSG file.
@@ -562,17 +807,19 @@ cdef class Decoder:
         Returns:
             FsgModel: Newly loaded finite-state grammar.
         """
-        cdef config_t *cconfig = decoder_config(self._ps)
-        cdef logmath_t *lmath = decoder_logmath(self._ps)
+        cdef config_t *cconfig
+        cdef logmath_t *lmath
         cdef float lw
-
-        lw = config_float(cconfig, "lw")
-        fsg = FsgModel()
-        # FIXME: not the proper way to encode filenames on Windows, I think
-        fsg.fsg = fsg_model_readfile(filename.encode(), lmath, lw)
-        if fsg.fsg == NULL:
-            raise RuntimeError("Failed to read FSG from %s" % filename)
-        return fsg
+        with self._lock:
+            cconfig = decoder_config(self._ps)
+            lmath = decoder_logmath(self._ps)
+            lw = config_float(cconfig, "lw")
+            fsg = FsgModel()
+            # FIXME: not the proper way to encode filenames on Windows, I think
+            fsg.fsg = fsg_model_readfile(filename.encode(), lmath, lw)
+            if fsg.fsg == NULL:
+                raise RuntimeError("Failed to read FSG from %s" % filename)
+            return fsg
 
     def read_jsgf(self, filename):
         """Read a grammar from a JSGF file.
@@ -585,16 +832,18 @@ cdef class Decoder:
         Returns:
             FsgModel: Newly loaded finite-state grammar.
         """
-        cdef config_t *cconfig = decoder_config(self._ps)
-        cdef logmath_t *lmath = decoder_logmath(self._ps)
+        cdef config_t *cconfig
+        cdef logmath_t *lmath
         cdef float lw
-
-        lw = config_float(cconfig, "lw")
-        fsg = FsgModel()
-        fsg.fsg = jsgf_read_file(filename.encode(), lmath, lw)
-        if fsg.fsg == NULL:
-            raise RuntimeError("Failed to read JSGF from %s" % filename)
-        return fsg
+        with self._lock:
+            cconfig = decoder_config(self._ps)
+            lmath = decoder_logmath(self._ps)
+            lw = config_float(cconfig, "lw")
+            fsg = FsgModel()
+            fsg.fsg = jsgf_read_file(filename.encode(), lmath, lw)
+            if fsg.fsg == NULL:
+                raise RuntimeError("Failed to read JSGF from %s" % filename)
+            return fsg
 
     def create_fsg(self, name, start_state, final_state, transitions):
         """Create a finite-state grammar.
@@ -629,30 +878,32 @@ cdef class Decoder:
         Raises:
             ValueError: On invalid input.
         """
-        cdef config_t *cconfig = decoder_config(self._ps)
-        cdef logmath_t *lmath = decoder_logmath(self._ps)
+        cdef config_t *cconfig
+        cdef logmath_t *lmath
         cdef float lw
         cdef int wid
-
-        lw = config_float(cconfig, "lw")
-        fsg = FsgModel()
-        n_state = max(itertools.chain(*((t[0], t[1]) for t in transitions))) + 1
-        fsg.fsg = fsg_model_init(name.encode("utf-8"), lmath, lw, n_state)
-        fsg.fsg.start_state = start_state
-        fsg.fsg.final_state = final_state
-        for t in transitions:
-            source, dest, prob = t[0:3]
-            if len(t) > 3:
-                word = t[3]
-                wid = fsg_model_word_add(fsg.fsg, word.encode("utf-8"))
-                if wid == -1:
-                    raise RuntimeError("Failed to add word to FSG: %s" % word)
-                fsg_model_trans_add(fsg.fsg, source, dest,
-                                    logmath_log(lmath, prob), wid)
-            else:
-                fsg_model_null_trans_add(fsg.fsg, source, dest,
-                                         logmath_log(lmath, prob))
-        return fsg
+        with self._lock:
+            cconfig = decoder_config(self._ps)
+            lmath = decoder_logmath(self._ps)
+            lw = config_float(cconfig, "lw")
+            fsg = FsgModel()
+            n_state = max(itertools.chain(*((t[0], t[1]) for t in transitions))) + 1
+            fsg.fsg = fsg_model_init(name.encode("utf-8"), lmath, lw, n_state)
+            fsg.fsg.start_state = start_state
+            fsg.fsg.final_state = final_state
+            for t in transitions:
+                source, dest, prob = t[0:3]
+                if len(t) > 3:
+                    word = t[3]
+                    wid = fsg_model_word_add(fsg.fsg, word.encode("utf-8"))
+                    if wid == -1:
+                        raise RuntimeError("Failed to add word to FSG: %s" % word)
+                    fsg_model_trans_add(fsg.fsg, source, dest,
+                                        logmath_log(lmath, prob), wid)
+                else:
+                    fsg_model_null_trans_add(fsg.fsg, source, dest,
+                                             logmath_log(lmath, prob))
+            return fsg
 
     def parse_jsgf(self, jsgf_string, toprule=None):
         """Parse a JSGF grammar from bytes or string.
@@ -672,32 +923,35 @@ cdef class Decoder:
             ValueError: On failure to parse or find `toprule`.
             RuntimeError: If JSGF has no public rules.
         """
-        cdef config_t *cconfig = decoder_config(self._ps)
-        cdef logmath_t *lmath = decoder_logmath(self._ps)
+        cdef config_t *cconfig
+        cdef logmath_t *lmath
         cdef jsgf_t *jsgf
         cdef jsgf_rule_t *rule
         cdef float lw
-
-        if not isinstance(jsgf_string, bytes):
-            jsgf_string = jsgf_string.encode("utf-8")
-        jsgf = jsgf_parse_string(jsgf_string, NULL)
-        if jsgf == NULL:
-            raise ValueError("Failed to parse JSGF")
-        if toprule is not None:
-            rule = jsgf_get_rule(jsgf, toprule.encode('utf-8'))
-            if rule == NULL:
-                jsgf_grammar_free(jsgf)
-                raise ValueError("Failed to find top rule %s" % toprule)
-        else:
-            rule = jsgf_get_public_rule(jsgf)
-            if rule == NULL:
-                jsgf_grammar_free(jsgf)
-                raise RuntimeError("No public rules found in JSGF")
-        lw = config_float(cconfig, "lw")
-        fsg = FsgModel()
-        fsg.fsg = jsgf_build_fsg(jsgf, rule, lmath, lw)
-        jsgf_grammar_free(jsgf)
-        return fsg
+        with self._lock:
+            cconfig = decoder_config(self._ps)
+            lmath = decoder_logmath(self._ps)
+
+            if not isinstance(jsgf_string, bytes):
+                jsgf_string = jsgf_string.encode("utf-8")
+            jsgf = jsgf_parse_string(jsgf_string, NULL)
+            if jsgf == NULL:
+                raise ValueError("Failed to parse JSGF")
+            if toprule is not None:
+                rule = jsgf_get_rule(jsgf, toprule.encode('utf-8'))
+                if rule == NULL:
+                    jsgf_grammar_free(jsgf)
+                    raise ValueError("Failed to find top rule %s" % toprule)
+            else:
+                rule = jsgf_get_public_rule(jsgf)
+                if rule == NULL:
+                    jsgf_grammar_free(jsgf)
+                    raise RuntimeError("No public rules found in JSGF")
+            lw = config_float(cconfig, "lw")
+            fsg = FsgModel()
+            fsg.fsg = jsgf_build_fsg(jsgf, rule, lmath, lw)
+            jsgf_grammar_free(jsgf)
+            return fsg
 
     def set_fsg(self, FsgModel fsg):
         """Set the grammar for recognition.
@@ -706,9 +960,10 @@ cdef class Decoder:
             fsg(FsgModel): Previously loaded or constructed grammar.
 
         """
-        # Decoder owns FSG, but so does Python
-        if decoder_set_fsg(self._ps, fsg_model_retain(fsg.fsg)) != 0:
-            raise RuntimeError("Failed to set FSG in decoder")
+        with self._lock:
+            # Decoder owns FSG, but so does Python
+            if decoder_set_fsg(self._ps, fsg_model_retain(fsg.fsg)) != 0:
+                raise RuntimeError("Failed to set FSG in decoder")
 
     def set_jsgf_file(self, filename):
         """Set the grammar for recognition from a JSGF file.
@@ -716,8 +971,9 @@ cdef class Decoder:
         Args:
             filename(str): Path to a JSGF file to load.
         """
-        if decoder_set_jsgf_file(self._ps, filename.encode()) != 0:
-            raise RuntimeError("Failed to set JSGF from %s" % filename)
+        with self._lock:
+            if decoder_set_jsgf_file(self._ps, filename.encode()) != 0:
+                raise RuntimeError("Failed to set JSGF from %s" % filename)
 
     def set_jsgf_string(self, jsgf_string):
         """Set the grammar for recognition from JSGF bytes or string.
@@ -726,10 +982,11 @@ cdef class Decoder:
             jsgf_string(bytes): JSGF grammar as string or UTF-8 encoded
                                 bytes.
         """
-        if not isinstance(jsgf_string, bytes):
-            jsgf_string = jsgf_string.encode("utf-8")
-        if decoder_set_jsgf_string(self._ps, jsgf_string) != 0:
-            raise RuntimeError("Failed to parse JSGF in decoder")
+        with self._lock:
+            if not isinstance(jsgf_string, bytes):
+                jsgf_string = jsgf_string.encode("utf-8")
+            if decoder_set_jsgf_string(self._ps, jsgf_string) != 0:
+                raise RuntimeError("Failed to parse JSGF in decoder")
 
     def decode_file(self, input_file):
         """Decode audio from a file in the filesystem.
@@ -752,30 +1009,247 @@ cdef class Decoder:
             (str, Iterable[Seg]): Recognized text, Word segmentation.
 
         """
-        data, sample_rate = soundswallower.get_audio_data(input_file)
-        if sample_rate is None:
-            sample_rate = self.config["samprate"]
-        # Reinitialize the decoder if necessary
-        if sample_rate != self.config["samprate"]:
-            LOGGER.info("Setting sample rate to %d", sample_rate)
-            self.config["samprate"] = sample_rate
-            self.reinit_feat()
+        with self._lock:
+            data, sample_rate = soundswallower.get_audio_data(input_file)
+            if sample_rate is None:
+                sample_rate = self.config["samprate"]
+            # Reinitialize the decoder if necessary
+            if sample_rate != self.config["samprate"]:
+                LOGGER.info("Setting sample rate to %d", sample_rate)
+                self.config["samprate"] = sample_rate
+                self.reinit_feat()
+
+            self.start_utt()
+            self.process_raw(data, no_search=False, full_utt=True)
+            self.end_utt()
+
+            if self.hyp.text is None:
+                raise RuntimeError("Decoding produced no segments, "
+                                   "please examine dictionary/grammar and input audio.")
+
+            return self.hyp.text, self.seg
+
+    def decode_batch(self, utterances):
+        """Decode several utterances, returning all their segmentations.
+
+        Each utterance is decoded in full, one after the other, with
+        the global interpreter lock released, so several decoders can
+        be run in parallel in separate threads.  The segmentations are
+        collected without creating any Python objects other than the
+        words themselves, which makes this a lot faster than calling
+        `seg` for many short utterances.
+
+        This requires NumPy.
+
+        Args:
+            utterances(Iterable): Audio data for each utterance, as
+                                  either 16-bit signed integer (a
+                                  `bytes` object or an array of
+                                  `int16`) or floating-point (an
+                                  array of `float32`) samples.
+        Returns:
+            (numpy.ndarray, List[str]): Structured array of word
+            segments with the fields `utt` (index of utterance),
+            `word` (index into the list of words), `start` and `end`
+            (inclusive start and end frames), `ascr`, `lscr` and
+            `prob` (acoustic and language model scores and posterior
+            probability, as natural logarithms), and the list of
+            words.
+        Raises:
+            ValueError: If the audio data is not in a supported format.
+            RuntimeError: If decoding fails.
+        """
+        import numpy
 
-        self.start_utt()
-        self.process_raw(data, no_search=False, full_utt=True)
-        self.end_utt()
+        cdef logmath_t *lmath
+        cdef const short[::1] int16_data
+        cdef const float[::1] float32_data
+        cdef seg_iter_t *itor
+        cdef batch_seg_t *segs = NULL
+        cdef batch_seg_t *new_segs
+        cdef size_t n_segs = 0, n_alloc = 0
+        cdef const char *word
+        cdef int utt, sf, ef, ascr, lscr, prob, rv
+        cdef unsigned char[::1] out
+        with self._lock:
+            lmath = decoder_logmath(self._ps)
+            word_ids = {}
+            words = []
+            try:
+                for utt, data in enumerate(utterances):
+                    view = memoryview(data)
+                    if view.format in ("B", "b", "c"):
+                        view = view.cast("B").cast("h")
+                    if decoder_start_utt(self._ps) < 0:
+                        raise RuntimeError("Failed to start utterance %d" % utt)
+                    rv = 0
+                    if view.format == "f":
+                        float32_data = view
+                        if len(float32_data) > 0:
+                            with nogil:
+                                rv = decoder_process_float32(
+                                    self._ps, <float *>&float32_data[0],
+                                    len(float32_data), False, True)
+                    elif view.format == "h":
+                        int16_data = view
+                        if len(int16_data) > 0:
+                            with nogil:
+                                rv = decoder_process_int16(
+                                    self._ps, <short *>&int16_data[0],
+                                    len(int16_data), False, True)
+                    else:
+                        decoder_end_utt(self._ps)
+                        raise ValueError("Unsupported audio format '%s' for "
+                                         "utterance %d (int16 or float32 expected)"
+                                         % (view.format, utt))
+                    with nogil:
+                        if decoder_end_utt(self._ps) < 0:
+                            rv = -1
+                    if rv < 0:
+                        raise RuntimeError("Failed to decode utterance %d" % utt)
+                    itor = decoder_seg_iter(self._ps)
+                    while itor != NULL:
+                        if n_segs == n_alloc:
+                            n_alloc = n_alloc * 2 if n_alloc else 256
+                            new_segs = <batch_seg_t *>realloc(
+                                segs, n_alloc * sizeof(batch_seg_t))
+                            if new_segs == NULL:
+                                seg_iter_free(itor)
+                                raise MemoryError()
+                            segs = new_segs
+                        # Words are interned in the dictionary, so the
+                        # pointer identifies them.
+                        word = seg_iter_word(itor)
+                        wid = word_ids.get(<size_t>word)
+                        if wid is None:
+                            wid = word_ids[<size_t>word] = len(words)
+                            words.append(word.decode("utf-8"))
+                        seg_iter_frames(itor, &sf, &ef)
+                        prob = seg_iter_prob(itor, &ascr, &lscr)
+                        segs[n_segs].utt = utt
+                        segs[n_segs].word = wid
+                        segs[n_segs].start = sf
+                        segs[n_segs].end = ef
+                        segs[n_segs].ascr = logmath_log_to_ln(lmath, ascr)
+                        segs[n_segs].lscr = logmath_log_to_ln(lmath, lscr)
+                        segs[n_segs].prob = logmath_log_to_ln(lmath, prob)
+                        n_segs += 1
+                        itor = seg_iter_next(itor)
+                dtype = numpy.dtype(BATCH_SEG_FIELDS)
+                assert dtype.itemsize == sizeof(batch_seg_t)
+                result = numpy.empty(n_segs, dtype)
+                if n_segs > 0:
+                    out = result.view(numpy.uint8)
+                    memcpy(&out[0], segs, n_segs * sizeof(batch_seg_t))
+                return result, words
+            finally:
+                free(segs)
+
+    def write_features(self, filename, utterances, senones=False):
+        """Compute features for some utterances and write them to an archive.
+
+        The archive can then be decoded (many times, with different
+        grammars or parameters, for instance) with `decode_features`,
+        which is much faster than decoding the audio, as the features
+        are not recomputed.  It is only valid for decoders with the
+        same acoustic model and feature parameters as this one.
+
+        With `senones`, the scores of all senones are written instead
+        of features, so that decoding only runs the search.
 
-        if self.hyp.text is None:
-            raise RuntimeError("Decoding produced no segments, "
-                               "please examine dictionary/grammar and input audio.")
+        Args:
+            filename(str): Path to archive to create.
+            utterances(Iterable[Tuple[str, bytes]]): Utterance IDs and
+                           raw audio data (16-bit signed integer) for
+                           each utterance.
+            senones(bool): Write senone scores instead of features.
+        Returns:
+            int: Number of utterances written.
+        Raises:
+            RuntimeError: If feature computation or writing fails.
+        """
+        cdef feat_archive_writer_t *writer
+        cdef const unsigned char[:] cdata
+        cdef const char *c_uttid
+        cdef size_t n_samples
+        cdef int rv
+        cdef int c_senones = senones
+        with self._lock:
+            if senones:
+                writer = feat_archive_writer_init_senscr(
+                    filename.encode(), decoder_n_senones(self._ps))
+            else:
+                writer = feat_archive_writer_init(filename.encode(),
+                                                  decoder_feat(self._ps))
+            if writer == NULL:
+                raise RuntimeError("Failed to create feature archive %s" % filename)
+            n_utt = 0
+            try:
+                for uttid, data in utterances:
+                    buttid = uttid.encode("utf-8")
+                    c_uttid = buttid
+                    cdata = data
+                    n_samples = len(cdata) // 2
+                    if n_samples == 0:
+                        raise RuntimeError("No audio data for %s" % uttid)
+                    with nogil:
+                        if c_senones:
+                            rv = decoder_archive_senscr_int16(
+                                self._ps, writer, c_uttid,
+                                <short *>&cdata[0], n_samples)
+                        else:
+                            rv = decoder_archive_int16(
+                                self._ps, writer, c_uttid,
+                                <short *>&cdata[0], n_samples)
+                    if rv < 0:
+                        raise RuntimeError("Failed to compute features for %s"
+                                           % uttid)
+                    n_utt += 1
+            finally:
+                rv = feat_archive_writer_close(writer)
+            if rv < 0:
+                raise RuntimeError("Failed to write feature archive %s" % filename)
+            return n_utt
+
+    def decode_features(self, filename):
+        """Decode all the utterances in a feature archive.
+
+        The archive may contain features or senone scores.  Results for each utterance are available from `hyp`, `seg`,
+        `dumps()` and so on, until the next one is decoded.
 
-        return self.hyp.text, self.seg
+        Args:
+            filename(str): Path to archive created by `write_features`.
+        Yields:
+            str: ID of each utterance, after decoding it.
+        Raises:
+            RuntimeError: If the archive cannot be read or decoding fails.
+        """
+        cdef feat_archive_t *archive
+        cdef int utt, rv
+        with self._lock:
+            archive = feat_archive_read(filename.encode())
+            if archive == NULL:
+                raise RuntimeError("Failed to read feature archive %s" % filename)
+            try:
+                for utt in range(feat_archive_n_utt(archive)):
+                    uttid = feat_archive_uttid(archive, utt).decode("utf-8")
+                    self.start_utt()
+                    with nogil:
+                        rv = decoder_process_archive(self._ps, archive, utt)
+                    self.end_utt()
+                    if rv < 0:
+                        raise RuntimeError("Failed to decode %s" % uttid)
+                    yield uttid
+            finally:
+                feat_archive_free(archive)
 
     def dumps(self, start_time=0., align_level=0):
         """Get decoding result as JSON."""
-        cdef const char *json_result = decoder_result_json(self._ps, start_time,
-                                                           align_level)
-        return json_result.decode("utf-8")
+        cdef const char *json_result
+        with self._lock:
+            json_result = decoder_result_json(self._ps, start_time,
+                                              align_level)
+            return json_result.decode("utf-8")
 
     def set_align_text(self, text):
         """Set a word sequence for alignment.
@@ -792,9 +1266,11 @@ cdef class Decoder:
         Raises:
             RuntimeError: If text is invalid somehow.
         """
-        cdef int rv = decoder_set_align_text(self._ps, text.encode("utf-8"))
-        if rv < 0:
-            raise RuntimeError("Failed to set up alignment of %s" % (text))
+        cdef int rv
+        with self._lock:
+            rv = decoder_set_align_text(self._ps, text.encode("utf-8"))
+            if rv < 0:
+                raise RuntimeError("Failed to set up alignment of %s" % (text))
 
     @property
     def alignment(self):
@@ -807,10 +1283,12 @@ cdef class Decoder:
             Alignment - if an alignment exists.
 
         """
-        cdef alignment_t *al = decoder_alignment(self._ps)
-        if al == NULL:
-            return None
-        return Alignment.create_from_ptr(alignment_retain(al))
+        cdef alignment_t *al
+        with self._lock:
+            al = decoder_alignment(self._ps)
+            if al == NULL:
+                return None
+            return Alignment.create_from_ptr(alignment_retain(al))
 
     @property
     def n_frames(self):
@@ -819,7 +1297,8 @@ cdef class Decoder:
         Returns:
             int: Like it says.
         """
-        return decoder_n_frames(self._ps)
+        with self._lock:
+            return decoder_n_frames(self._ps)
 
 
 cdef class Vad:
@@ -86,6 +86,12 @@ Hyp.text.__doc__ = "Recognized text."
 Hyp.score.__doc__ = "Best path score."
 Hyp.prob.__doc__ = "Posterior probability of hypothesis (often 1.0, sorry)."
 
+Result = collections.namedtuple("Result", ["hyp", "seg", "final"])
+Result.__doc__ = "Recognition result published by a decoder."
+Result.hyp.__doc__ = "Recognition hypothesis (as a `Hyp`)."
+Result.seg.__doc__ = "Word segmentation (as a list of `Seg`)."
+Result.final.__doc__ = "Is this the final result for the utterance?"
+
 __all__ = [
     "Arg",
     "Config",
@@ -93,6 +99,7 @@ __all__ = [
     "Endpointer",
     "FsgModel",
     "Hyp",
+    "Result",
     "Seg",
     "Vad",
     "get_audio_data",
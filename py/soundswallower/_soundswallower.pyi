@@ -1,4 +1,14 @@
-from typing import ClassVar, Iterator, Optional, Sequence, Tuple, Union
+from typing import (
+    Any,
+    ClassVar,
+    Iterable,
+    Iterator,
+    List,
+    Optional,
+    Sequence,
+    Tuple,
+    Union,
+)
 
 import soundswallower
 
@@ -26,6 +36,7 @@ class Decoder:
     cmn: str
     hyp: soundswallower.Hyp
     seg: Iterator[soundswallower.Seg]
+    result: Optional[soundswallower.Result]
     alignment: Alignment
     n_frames: int
 
@@ -42,7 +53,13 @@ class Decoder:
         no_search: bool = ...,
         full_utt: bool = ...,
     ): ...
+    def enqueue_raw(self, data: bytes) -> None: ...
+    def step(self, max_frames: int = ..., max_usec: int = ...) -> int: ...
     def end_utt(self) -> None: ...
+    def rewind(self) -> int: ...
+    def snapshot(self) -> bytes: ...
+    def restore(self, data: bytes) -> None: ...
+    def stable_hyp(self) -> Optional[str]: ...
     def add_word(self, word: str, phones: str, update: bool = ...) -> int: ...
     def lookup_word(self, word: str) -> int: ...
     def read_fsg(self, filename: str) -> FsgModel: ...
@@ -63,6 +80,14 @@ class Decoder:
     def decode_file(
         self, input_file: str
     ) -> Tuple[str, Iterator[soundswallower.Seg]]: ...
+    def decode_batch(self, utterances: Iterable[Any]) -> Tuple[Any, List[str]]: ...
+    def write_features(
+        self,
+        filename: str,
+        utterances: Iterable[Tuple[str, bytes]],
+        senones: bool = ...,
+    ) -> int: ...
+    def decode_features(self, filename: str) -> Iterator[str]: ...
     def dumps(self, start_time: float = ..., align_level: int = ...) -> str: ...
     def set_align_text(self, text: str): ...
 
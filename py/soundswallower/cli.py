@@ -21,15 +21,24 @@ To use a custom dictionary::
 
   soundswallower --dict /path/to/dictionary.dict
 
+To compute features once and decode them many times (with different
+grammars or parameters)::
+
+  soundswallower --write-features corpus.feat audio1.wav audio2.wav ...
+  soundswallower --features corpus.feat --grammar input.gram
+
+Or, to skip acoustic scoring as well and only run the search, use
+``--write-scores`` instead of ``--write-features``.
+
 """
 
 import argparse
 import logging
 import os
 import sys
-from typing import Any, Optional, Sequence
+from typing import Any, Iterator, List, Optional, Sequence, Tuple
 
-from soundswallower import Config, Decoder, get_model_path
+from soundswallower import Config, Decoder, get_audio_data, get_model_path
 
 
 def make_argparse() -> argparse.ArgumentParser:
@@ -59,6 +68,22 @@ def make_argparse() -> argparse.ArgumentParser:
     parser.add_argument(
         "-o", "--output", help="Filename for output (default is standard output)"
     )
+    parser.add_argument(
+        "--write-features",
+        metavar="ARCHIVE",
+        help="Compute features for inputs, write them to ARCHIVE and exit.",
+    )
+    parser.add_argument(
+        "--write-scores",
+        metavar="ARCHIVE",
+        help="Compute senone scores for inputs, write them to ARCHIVE and exit.",
+    )
+    parser.add_argument(
+        "--features",
+        metavar="ARCHIVE",
+        help="Decode features or scores from ARCHIVE "
+        "(created with --write-features or --write-scores).",
+    )
     parser.add_argument("-v", "--verbose", action="store_true", help="Be verbose.")
     parser.add_argument(
         "--phone-align", help="Produce phone-level alignments", action="store_true"
@@ -136,6 +161,33 @@ def write_config(config: Config, output: Optional[str] = None) -> None:
         outfh.close()
 
 
+def get_input_audio(
+    decoder: Decoder, inputs: Sequence[str]
+) -> Iterator[Tuple[str, bytes]]:
+    """Read audio from input files, making sure the sampling rate is
+    the same for all of them."""
+    for input_file in inputs:
+        data, sample_rate = get_audio_data(input_file)
+        if sample_rate is not None and sample_rate != decoder.config["samprate"]:
+            raise ValueError(
+                "Sampling rate of %s (%s) does not match configuration (%s)"
+                % (input_file, sample_rate, decoder.config["samprate"])
+            )
+        yield input_file, data
+
+
+def decode_inputs(decoder: Decoder, args: argparse.Namespace) -> List[str]:
+    """Decode input files and features, returning results as JSON."""
+    results = []
+    for input_file in args.inputs:
+        decoder.decode_file(input_file)
+        results.append(decoder.dumps(align_level=args.phone_align))
+    if args.features is not None:
+        for _ in decoder.decode_features(args.features):
+            results.append(decoder.dumps(align_level=args.phone_align))
+    return results
+
+
 def main(argv: Optional[Sequence[str]] = None) -> None:
     """Main entry point for SoundSwallower."""
     logging.basicConfig(level=logging.INFO)
@@ -147,6 +199,15 @@ def main(argv: Optional[Sequence[str]] = None) -> None:
         sys.exit(0)
     if args.write_config is not None:
         write_config(config, args.write_config)
+    if args.write_features is not None or args.write_scores is not None:
+        decoder = Decoder(config)
+        senones = args.write_scores is not None
+        decoder.write_features(
+            args.write_scores if senones else args.write_features,
+            get_input_audio(decoder, args.inputs),
+            senones=senones,
+        )
+        return
     if args.align:
         with open(args.align) as fh:
             args.align_text = fh.read().strip()
@@ -158,10 +219,7 @@ def main(argv: Optional[Sequence[str]] = None) -> None:
     decoder = Decoder(config)
     if args.align_text is not None:
         decoder.set_align_text(args.align_text)
-    results = []
-    for input_file in args.inputs:
-        decoder.decode_file(input_file)
-        results.append(decoder.dumps(align_level=args.phone_align))
+    results = decode_inputs(decoder, args)
     if args.output is not None:
         with open(args.output, "w") as outfh:
             for json_line in results:
@@ -0,0 +1,380 @@
+#!/usr/bin/env python3
+
+"""Quantize mixture weights for SoundSwallower.
+
+Tied-mixture (PTM and semi-continuous) acoustic models store their
+mixture weights either as 32-bit floating point probabilities in a
+`mixture_weights` file, which must be converted when the model is
+loaded, or as 8-bit negated log probabilities in a memory-mapped
+`sendump` file.  The weights can also be clustered to 16 values, in
+which case the `sendump` stores a 4-bit index for each weight,
+halving its size.
+
+To convert the mixture weights from a model trained with SphinxTrain
+to a `sendump`, using 4-bit clusters::
+
+  python -m soundswallower.mixw --bits 4 \\
+      model/mixture_weights model/sendump
+
+The input can also be an existing 8-bit `sendump`.  The accuracy of
+the quantized weights is reported as the error in log probabilities,
+and as the total variation distance between the original and
+quantized mixtures.  To check how this affects recognition, decode
+some audio with the original and quantized models::
+
+  python -m soundswallower.mixw --bits 4 --model model \\
+      --grammar test.gram --test audio1.wav audio2.wav ... \\
+      model/sendump sendump-4bit
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+import time
+from typing import BinaryIO, Dict, List, Optional, Sequence, Tuple
+
+import numpy as np
+
+from soundswallower import Decoder, get_model_path
+
+BYTE_ORDER_MAGIC = 0x11223344
+LOG_BASE = 1.0001  # Base of the decoder's logarithms
+SENSCR_SHIFT = 10  # Scaling of mixture weights to fit in 8 bits
+MAX_NEG_MIXW = 159  # Largest (negated) weight, see tied_mgau_common.h
+N_CLUSTERS = 16  # Number of clusters for 4-bit weights
+CLUSTER_BITS = 4  # Bits per clustered weight
+MAX_TITLE = 999  # Longest title in a sendump (used to detect byte order)
+
+
+def prob_to_mixw(pdf: np.ndarray) -> np.ndarray:
+    """Convert probabilities to 8-bit mixture weights as the decoder does.
+
+    Args:
+        pdf: Array of probabilities.
+    Returns:
+        Array of `uint8` negated, scaled log probabilities."""
+    p = pdf.astype(np.float64)
+    logp = np.full(p.shape, -(2.0**31))
+    np.log(p, out=logp, where=p > 0)
+    # logmath_log() truncates, then shifts (rounding towards -inf)
+    logp[p > 0] *= 1.0 / math.log(LOG_BASE)
+    qscr = -(np.trunc(np.maximum(logp, -(2.0**31))).astype(np.int64) >> SENSCR_SHIFT)
+    qscr[(qscr > MAX_NEG_MIXW) | (qscr < 0)] = MAX_NEG_MIXW
+    return qscr.astype(np.uint8)
+
+
+def mixw_to_prob(mixw: np.ndarray) -> np.ndarray:
+    """Convert 8-bit mixture weights back to (approximate) probabilities."""
+    return np.power(LOG_BASE, -(mixw.astype(np.float64) * (1 << SENSCR_SHIFT)))
+
+
+def _parse_s3_header(data: bytes) -> Tuple[Dict[str, str], int, str]:
+    """Parse the header of an S3 binary file, returning the header
+    values, the offset of the data and its byte order."""
+    if not data.startswith(b"s3\n"):
+        raise ValueError("Not an S3 binary file")
+    end = data.index(b"endhdr\n") + len(b"endhdr\n")
+    header = {}
+    for line in data[3:end].decode("ascii").splitlines()[:-1]:
+        if line.startswith("#") or not line.strip():
+            continue
+        name, _, value = line.partition(" ")
+        header[name] = value.strip()
+    for byteorder in "<>":
+        if struct.unpack_from(byteorder + "I", data, end)[0] == BYTE_ORDER_MAGIC:
+            return header, end + 4, byteorder
+    raise ValueError("Bad byte order magic in S3 binary file")
+
+
+def _sum_norm(pdf: np.ndarray) -> np.ndarray:
+    """Normalize float32 distributions along the last axis, like
+    vector_sum_norm() in C."""
+    total = pdf.astype(np.float64).sum(axis=-1, keepdims=True)
+    scale = np.divide(1.0, total, out=np.ones_like(total), where=total != 0)
+    return (pdf * scale).astype(np.float32)
+
+
+def read_mixw(path: str, floor: float = 1e-7) -> np.ndarray:
+    """Read floating-point mixture weights and quantize them to 8 bits.
+
+    Args:
+        path: Path to `mixture_weights` file.
+        floor: Minimum probability of a mixture component (the
+               decoder's `mixwfloor` parameter).
+    Returns:
+        Array of `uint8` weights of shape `(n_feat, n_density, n_sen)`."""
+    with open(path, "rb") as fh:
+        data = fh.read()
+    _, offset, byteorder = _parse_s3_header(data)
+    n_sen, n_feat, n_density, n = struct.unpack_from(byteorder + "4i", data, offset)
+    if n != n_sen * n_feat * n_density:
+        raise ValueError(
+            f"Size {n} of mixture weights does not match "
+            f"{n_sen} x {n_feat} x {n_density}"
+        )
+    pdf = np.frombuffer(
+        data, dtype=byteorder + "f4", count=n, offset=offset + 16
+    ).reshape(n_sen, n_feat, n_density)
+    # Normalize, floor and normalize again, like read_mixw() in C
+    pdf = _sum_norm(pdf)
+    pdf = np.where(pdf < floor, np.float32(floor), pdf)
+    pdf = _sum_norm(pdf)
+    return prob_to_mixw(pdf).transpose(1, 2, 0).copy()
+
+
+def read_sendump(path: str) -> np.ndarray:
+    """Read weights from a `sendump` file.
+
+    Args:
+        path: Path to `sendump` file.
+    Returns:
+        Array of `uint8` weights of shape `(n_feat, n_density, n_sen)`
+        (clustered weights are looked up in their codebook)."""
+    with open(path, "rb") as fh:
+        data = fh.read()
+    byteorder = "<"
+    if not 0 < struct.unpack_from("<i", data)[0] <= MAX_TITLE:
+        byteorder = ">"
+    offset = 0
+    header: Dict[str, str] = {}
+    while True:
+        (n,) = struct.unpack_from(byteorder + "i", data, offset)
+        offset += 4
+        if n == 0:
+            break
+        name, _, value = data[offset : offset + n - 1].decode("ascii").partition(" ")
+        header[name] = value
+        offset += n
+    n_feat = int(header.get("feature_count", 1))
+    n_clust = int(header.get("cluster_count", 0))
+    n_bits = int(header.get("cluster_bits", 8))
+    if n_clust == 0:
+        n_density, n_sen = struct.unpack_from(byteorder + "2i", data, offset)
+        offset += 8
+        codebook = None
+    else:
+        n_density = int(header["mixture_count"])
+        n_sen = int(header["model_count"])
+        n_clust = max(n_clust, N_CLUSTERS)
+        codebook = np.frombuffer(data, dtype=np.uint8, count=n_clust, offset=offset)
+        offset += n_clust
+    if n_bits == CLUSTER_BITS:
+        row = (n_sen + 1) // 2
+        packed = np.frombuffer(
+            data, dtype=np.uint8, count=n_feat * n_density * row, offset=offset
+        ).reshape(n_feat, n_density, row)
+        codes = np.empty((n_feat, n_density, row * 2), dtype=np.uint8)
+        codes[..., 0::2] = packed & 0x0F
+        codes[..., 1::2] = packed >> 4
+        codes = codes[..., :n_sen]
+    else:
+        codes = np.frombuffer(
+            data, dtype=np.uint8, count=n_feat * n_density * n_sen, offset=offset
+        ).reshape(n_feat, n_density, n_sen)
+    if codebook is not None:
+        return codebook[codes]
+    return codes.copy()
+
+
+def cluster(mixw: np.ndarray, n_clusters: int = N_CLUSTERS) -> np.ndarray:
+    """Learn a codebook for 8-bit weights with the Lloyd algorithm.
+
+    Since there are only 160 possible weights, this works on their
+    histogram.  It minimizes the squared error in the log domain,
+    weighted by the square root of the probability of each weight: the
+    squared log error alone spends most of the codebook on the many
+    tiny weights, while weighting by probability (approximately the
+    KL divergence) makes very large errors in them.
+
+    Args:
+        mixw: Array of `uint8` weights.
+        n_clusters: Size of codebook.
+    Returns:
+        Array of `uint8` codebook values, in increasing order."""
+    counts = np.bincount(mixw.ravel(), minlength=MAX_NEG_MIXW + 1).astype(np.float64)
+    values = np.arange(len(counts), dtype=np.float64)
+    used = values[counts > 0]
+    if len(used) <= n_clusters:
+        codebook = np.full(n_clusters, used[-1])
+        codebook[: len(used)] = used
+        return codebook.astype(np.uint8)
+    weights = counts * np.sqrt(mixw_to_prob(values))
+    # Start from quantiles of the weighted distribution
+    cdf = np.cumsum(weights) / weights.sum()
+    centroids = np.unique(
+        np.searchsorted(cdf, (np.arange(n_clusters) + 0.5) / n_clusters)
+    ).astype(np.float64)
+    while len(centroids) < n_clusters:
+        gaps = np.setdiff1d(used, centroids)
+        centroids = np.sort(np.append(centroids, gaps[len(gaps) // 2]))
+    for _ in range(100):
+        bounds = (centroids[1:] + centroids[:-1]) / 2
+        assign = np.searchsorted(bounds, values)
+        mass = np.bincount(assign, weights=weights, minlength=n_clusters)
+        total = np.bincount(assign, weights=weights * values, minlength=n_clusters)
+        new = np.where(mass > 0, total / np.where(mass > 0, mass, 1), centroids)
+        if np.allclose(new, centroids):
+            break
+        centroids = new
+    return np.sort(np.rint(centroids)).astype(np.uint8)
+
+
+def encode(mixw: np.ndarray, codebook: np.ndarray) -> np.ndarray:
+    """Find the nearest codebook entry for each weight."""
+    cb = codebook.astype(np.int16)
+    table = np.abs(np.arange(256, dtype=np.int16)[:, None] - cb[None, :]).argmin(axis=1)
+    return table.astype(np.uint8)[mixw]
+
+
+def write_sendump(
+    outfh: BinaryIO, mixw: np.ndarray, codebook: Optional[np.ndarray] = None
+) -> None:
+    """Write weights to a `sendump` file.
+
+    Args:
+        outfh: Binary file to write to.
+        mixw: Array of `uint8` weights of shape `(n_feat, n_density,
+              n_sen)`, or of 4-bit codes if `codebook` is given.
+        codebook: Codebook of 16 weights for 4-bit clustered weights.
+    """
+    n_feat, n_density, n_sen = mixw.shape
+    header = [
+        "SoundSwallower mixture weights",
+        f"{'4-bit clustered' if codebook is not None else '8-bit'} negated log"
+        f" probabilities (base {LOG_BASE}, shifted by {SENSCR_SHIFT} bits)",
+        f"cluster_count {N_CLUSTERS if codebook is not None else 0}",
+        f"cluster_bits {CLUSTER_BITS if codebook is not None else 8}",
+        f"feature_count {n_feat}",
+        f"mixture_count {n_density}",
+        f"model_count {n_sen}",
+    ]
+    for line in header:
+        data = line.encode("ascii") + b"\0"
+        outfh.write(struct.pack("<i", len(data)))
+        outfh.write(data)
+    outfh.write(struct.pack("<i", 0))
+    if codebook is None:
+        outfh.write(struct.pack("<2i", n_density, n_sen))
+        outfh.write(np.ascontiguousarray(mixw, dtype=np.uint8).tobytes())
+        return
+    if len(codebook) != N_CLUSTERS:
+        raise ValueError(f"Codebook must have {N_CLUSTERS} entries")
+    outfh.write(codebook.astype(np.uint8).tobytes())
+    codes = np.zeros((n_feat, n_density, (n_sen + 1) // 2 * 2), dtype=np.uint8)
+    codes[..., :n_sen] = mixw
+    outfh.write((codes[..., 0::2] | (codes[..., 1::2] << 4)).tobytes())
+
+
+def quantization_error(mixw: np.ndarray, quantized: np.ndarray) -> Dict[str, float]:
+    """Measure the accuracy of quantized weights.
+
+    Returns:
+        Mean and maximum absolute error in natural log probability,
+        and mean total variation distance between mixtures."""
+    scale = (1 << SENSCR_SHIFT) * math.log(LOG_BASE)
+    err = np.abs(mixw.astype(np.int16) - quantized.astype(np.int16)) * scale
+    tvd = 0.5 * np.abs(mixw_to_prob(mixw) - mixw_to_prob(quantized)).sum(axis=1)
+    return {
+        "mean_log_error": float(err.mean()),
+        "max_log_error": float(err.max()),
+        "mean_tvd": float(tvd.mean()),
+    }
+
+
+def quantize(mixw: np.ndarray, bits: int) -> Tuple[np.ndarray, Optional[np.ndarray]]:
+    """Quantize 8-bit weights to the given number of bits.
+
+    Returns:
+        Weights or codes to pass to `write_sendump`, and the codebook
+        (or `None` for 8 bits)."""
+    if bits == CLUSTER_BITS:
+        codebook = cluster(mixw)
+        return encode(mixw, codebook), codebook
+    if bits != 8:  # noqa: PLR2004
+        raise ValueError("Weights can only be quantized to 4 or 8 bits")
+    return mixw, None
+
+
+def compare_decoding(
+    model: str, sendump: str, grammar: str, inputs: Sequence[str]
+) -> List[Tuple[str, str, str]]:
+    """Decode audio with the original and quantized weights.
+
+    Returns:
+        List of input, original and quantized results which differ."""
+    if model in os.listdir(get_model_path()):
+        model = get_model_path(model)
+    decoders = [
+        Decoder(hmm=model, jsgf=grammar, loglevel="ERROR"),
+        Decoder(hmm=model, jsgf=grammar, sendump=sendump, loglevel="ERROR"),
+    ]
+    times = [0.0, 0.0]
+    diffs = []
+    for path in inputs:
+        hyps = []
+        for idx, decoder in enumerate(decoders):
+            start = time.process_time()
+            hyp, _ = decoder.decode_file(path)
+            times[idx] += time.process_time() - start
+            hyps.append(hyp)
+        if hyps[0] != hyps[1]:
+            diffs.append((path, hyps[0], hyps[1]))
+    print(f"{len(inputs) - len(diffs)}/{len(inputs)} results identical")
+    print(f"Decoding time: original {times[0]:.3f}s, quantized {times[1]:.3f}s")
+    return diffs
+
+
+def make_argparse() -> argparse.ArgumentParser:
+    """Function to make the argument parser (for auto-documentation purposes)"""
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("input", help="Input mixture_weights or sendump file.")
+    parser.add_argument("output", help="Output sendump file.")
+    parser.add_argument(
+        "--bits", type=int, choices=(4, 8), default=4, help="Bits per weight."
+    )
+    parser.add_argument(
+        "--floor",
+        type=float,
+        default=1e-7,
+        help="Floor for probabilities in mixture_weights.",
+    )
+    parser.add_argument(
+        "--model", default="en-us", help="Model, built-in or from directory."
+    )
+    parser.add_argument("--grammar", help="Grammar file for --test.")
+    parser.add_argument(
+        "--test", nargs="+", metavar="AUDIO", help="Compare decoding of audio files."
+    )
+    return parser
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    parser = make_argparse()
+    args = parser.parse_args(argv)
+    if args.test and not args.grammar:
+        parser.error("--test requires --grammar")
+    with open(args.input, "rb") as fh:
+        is_mixw = fh.read(3) == b"s3\n"
+    mixw = read_mixw(args.input, args.floor) if is_mixw else read_sendump(args.input)
+    codes, codebook = quantize(mixw, args.bits)
+    with open(args.output, "wb") as outfh:
+        write_sendump(outfh, codes, codebook)
+    quantized = mixw if codebook is None else codebook[codes]
+    print(f"Wrote {args.bits}-bit weights for {mixw.shape[2]} senones")
+    if codebook is not None:
+        print("Codebook:", " ".join(str(x) for x in codebook))
+    for name, value in quantization_error(mixw, quantized).items():
+        print(f"{name}: {value:.4f}")
+    if args.test:
+        for path, orig, quant in compare_decoding(
+            args.model, args.output, args.grammar, args.test
+        ):
+            print(f"{path}: {orig!r} != {quant!r}")
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
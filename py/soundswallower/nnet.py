@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+
+"""Write neural network acoustic models for SoundSwallower.
+
+The decoder can use a small feed-forward network (an MLP over a
+window of spliced feature frames) instead of Gaussian mixtures to
+score senones.  This module writes such networks in the binary format
+documented in `nn_mgau.h`, optionally quantizing the weights of each
+layer to 8 bits.
+
+To convert a network saved with `numpy.savez`, containing arrays
+`w0`, `b0`, `w1`, `b1`, ... (weights of shape `(n_out, n_in)` and
+biases), `priors` (senone priors, which need not be normalized) and
+optionally `activations` (0 for linear, 1 for ReLU, default ReLU for
+all but the last layer)::
+
+  python -m soundswallower.nnet --ctx-left 4 --ctx-right 4 \\
+      network.npz model/en-us/nnet
+
+The output file should be placed in the acoustic model directory with
+the name `nnet`, or passed to the decoder with the `nnet` parameter.
+"""
+
+import argparse
+import struct
+import sys
+from typing import BinaryIO, List, Optional, Sequence, Tuple
+
+import numpy as np
+import numpy.typing as npt
+
+ACT_LINEAR = 0
+ACT_RELU = 1
+WEIGHT_FLOAT32 = 0
+WEIGHT_INT8 = 1
+BYTE_ORDER_MAGIC = 0x11223344
+
+Layer = Tuple[npt.ArrayLike, npt.ArrayLike, int]
+
+
+def _write_1d(outfh: BinaryIO, arr: np.ndarray) -> None:
+    outfh.write(struct.pack("=i", arr.size))
+    outfh.write(arr.tobytes())
+
+
+def quantize(weights: npt.ArrayLike) -> Tuple[np.ndarray, np.ndarray]:
+    """Quantize a weight matrix to 8 bits with one scale per row.
+
+    Args:
+        weights: Matrix of shape `(n_out, n_in)`.
+    Returns:
+        Tuple of the `int8` quantized matrix and the `float32` row
+        scales by which it must be multiplied to recover the weights."""
+    w = np.asarray(weights, dtype=np.float32)
+    scale = np.abs(w).max(axis=1) / 127.0
+    scale[scale == 0] = 1.0
+    q = np.clip(np.rint(w / scale[:, None]), -127, 127).astype(np.int8)
+    return q, scale.astype(np.float32)
+
+
+def write_nnet(  # noqa: PLR0913
+    outfh: BinaryIO,
+    layers: Sequence[Layer],
+    priors: npt.ArrayLike,
+    feat_len: int,
+    *,
+    ctx_left: int = 0,
+    ctx_right: int = 0,
+    quantize_layers: Optional[Sequence[bool]] = None,
+) -> None:
+    """Write a network in SoundSwallower's format.
+
+    Args:
+        outfh: Binary file to write to.
+        layers: List of `(weights, bias, activation)` for each layer,
+                from input to output.  Weights have shape `(n_out, n_in)`.
+        priors: Senone prior probabilities (normalized if necessary).
+        feat_len: Length of a single frame of features.
+        ctx_left: Number of frames of left context.
+        ctx_right: Number of frames of right context.
+        quantize_layers: Whether to quantize each layer to 8 bits.  By
+                         default all layers but the last are quantized.
+    Raises:
+        ValueError: if the dimensions do not fit together."""
+    if quantize_layers is None:
+        quantize_layers = [True] * (len(layers) - 1) + [False]
+    n_in = (ctx_left + 1 + ctx_right) * feat_len
+    p = np.asarray(priors, dtype=np.float64)
+    log_prior = np.log(p / p.sum()).astype(np.float32)
+    header = (
+        "s3\nversion 1.0\n"
+        f"feat_len {feat_len}\nctx_left {ctx_left}\nctx_right {ctx_right}\n"
+        f"n_layer {len(layers)}\nendhdr\n"
+    )
+    outfh.write(header.encode("ascii"))
+    outfh.write(struct.pack("=I", BYTE_ORDER_MAGIC))
+    for idx, (weights, bias, activation) in enumerate(layers):
+        w = np.asarray(weights, dtype=np.float32)
+        b = np.asarray(bias, dtype=np.float32)
+        n_out = w.shape[0]
+        if w.shape[1:] != (n_in,):
+            raise ValueError(
+                f"Layer {idx} weights have shape {w.shape}, expected (*, {n_in})"
+            )
+        if b.shape != (n_out,):
+            raise ValueError(f"Layer {idx} bias has shape {b.shape}, expected {n_out}")
+        outfh.write(
+            struct.pack(
+                "=iiii",
+                n_out,
+                n_in,
+                activation,
+                WEIGHT_INT8 if quantize_layers[idx] else WEIGHT_FLOAT32,
+            )
+        )
+        if quantize_layers[idx]:
+            q, scale = quantize(w)
+            _write_1d(outfh, scale)
+            _write_1d(outfh, q)
+        else:
+            _write_1d(outfh, w)
+        _write_1d(outfh, b)
+        n_in = n_out
+    if log_prior.shape != (n_in,):
+        raise ValueError(f"Priors have shape {log_prior.shape}, expected {n_in}")
+    _write_1d(outfh, log_prior)
+
+
+def read_npz(path: str) -> Tuple[List[Layer], np.ndarray]:
+    """Read layers and priors from a file written by `numpy.savez`."""
+    data = np.load(path)
+    n_layer = 0
+    while f"w{n_layer}" in data:
+        n_layer += 1
+    if n_layer == 0:
+        raise ValueError(f"No layers (w0, b0, ...) found in {path}")
+    if "activations" in data:
+        activations = [int(x) for x in data["activations"]]
+    else:
+        activations = [ACT_RELU] * (n_layer - 1) + [ACT_LINEAR]
+    layers: List[Layer] = [
+        (data[f"w{i}"], data[f"b{i}"], activations[i]) for i in range(n_layer)
+    ]
+    return layers, data["priors"]
+
+
+def make_argparse() -> argparse.ArgumentParser:
+    """Function to make the argument parser (for auto-documentation purposes)"""
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("input", help="Input .npz file.")
+    parser.add_argument("output", help="Output network file.")
+    parser.add_argument(
+        "--feat-len", type=int, default=39, help="Length of a feature frame."
+    )
+    parser.add_argument(
+        "--ctx-left", type=int, default=0, help="Frames of left context."
+    )
+    parser.add_argument(
+        "--ctx-right", type=int, default=0, help="Frames of right context."
+    )
+    parser.add_argument(
+        "--float", action="store_true", help="Do not quantize any layers."
+    )
+    return parser
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    parser = make_argparse()
+    args = parser.parse_args(argv)
+    layers, priors = read_npz(args.input)
+    quantize_layers = [False] * len(layers) if args.float else None
+    with open(args.output, "wb") as outfh:
+        write_nnet(
+            outfh,
+            layers,
+            priors,
+            args.feat_len,
+            ctx_left=args.ctx_left,
+            ctx_right=args.ctx_right,
+            quantize_layers=quantize_layers,
+        )
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
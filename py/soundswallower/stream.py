@@ -0,0 +1,188 @@
+"""Asynchronous streaming interface for SoundSwallower.
+
+Decoding is done in a separate thread, which does not hold the global
+interpreter lock while processing audio, so that an `asyncio` event
+loop can feed audio as it arrives without being blocked by the
+recognizer.  Results are returned as an asynchronous iterator of
+`Event`, for instance::
+
+  async with AsyncDecoder(decoder) as stream:
+      async def feed():
+          async for chunk in audio_source():
+              stream.feed(chunk)
+          stream.close()
+
+      task = asyncio.create_task(feed())
+      async for event in stream:
+          print("final" if event.final else "partial", event.result["t"])
+      await task
+
+"""
+
+import asyncio
+import collections
+import json
+import queue
+import threading
+from typing import Any, AsyncIterator, Optional
+
+from ._soundswallower import Decoder
+
+Event = collections.namedtuple("Event", ["final", "result"])
+Event.__doc__ = "Partial or final recognition result."
+Event.final.__doc__ = "Is this the final result for the utterance?"
+Event.result.__doc__ = (
+    "Recognition result, as returned by `Decoder.dumps`, decoded from JSON."
+)
+
+_END_UTT = object()
+_CLOSE = object()
+
+
+class AsyncDecoder:
+    """Streaming wrapper around a `Decoder` for use with `asyncio`.
+
+    Audio is queued with `feed`, which never blocks.  An utterance is
+    started by the first audio fed after creation or after `end_utt`,
+    and finished by `end_utt` or `close`.  Times in the results are
+    relative to the start of the stream rather than the utterance.
+
+    The decoder must not be used by anything else until the stream
+    has been closed and all its events consumed.
+
+    Args:
+        decoder(Decoder): Decoder, which must already be configured
+                          with a grammar or alignment.
+        partial(bool): Return partial results when the hypothesis
+                       changes while decoding.
+        align_level(int): Level of detail for alignments in results,
+                          as for `Decoder.dumps`.
+    """
+
+    def __init__(self, decoder: Decoder, partial: bool = True, align_level: int = 0):
+        self.decoder = decoder
+        self.partial = partial
+        self.align_level = align_level
+        self._input: "queue.SimpleQueue[Any]" = queue.SimpleQueue()
+        self._events: Optional["asyncio.Queue[Any]"] = None
+        self._loop: Optional[asyncio.AbstractEventLoop] = None
+        self._thread: Optional[threading.Thread] = None
+        self._samprate = float(decoder.config["samprate"])
+        self._n_samples = 0
+        self._start_time = 0.0
+        self._in_utt = False
+        self._last_hyp: Optional[str] = None
+
+    def start(self) -> None:
+        """Start the decoding thread.
+
+        This must be called from a coroutine running in the event
+        loop which will receive the results (it is done automatically
+        when used as an asynchronous context manager).
+        """
+        if self._thread is not None:
+            raise RuntimeError("Stream already started")
+        self._loop = asyncio.get_running_loop()
+        self._events = asyncio.Queue()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def feed(self, data: bytes) -> None:
+        """Queue audio for decoding.
+
+        Args:
+            data(bytes): Raw audio data, 16-bit signed integer samples.
+        """
+        self._input.put(bytes(data))
+
+    def end_utt(self) -> None:
+        """Finish the current utterance, producing a final result."""
+        self._input.put(_END_UTT)
+
+    def close(self) -> None:
+        """Finish the current utterance, if any, and stop decoding."""
+        self._input.put(_CLOSE)
+
+    async def wait_closed(self) -> None:
+        """Wait for the decoding thread to finish."""
+        if self._thread is not None:
+            assert self._loop is not None
+            await self._loop.run_in_executor(None, self._thread.join)
+
+    async def __aenter__(self) -> "AsyncDecoder":
+        self.start()
+        return self
+
+    async def __aexit__(self, *exc_info: Any) -> None:
+        self.close()
+        await self.wait_closed()
+
+    def __aiter__(self) -> AsyncIterator[Event]:
+        return self._iter_events()
+
+    async def _iter_events(self) -> AsyncIterator[Event]:
+        if self._events is None:
+            raise RuntimeError("Stream not started")
+        while True:
+            item = await self._events.get()
+            if item is _CLOSE:
+                return
+            if isinstance(item, BaseException):
+                raise item
+            yield item
+
+    def _post(self, item: Any) -> None:
+        assert self._loop is not None and self._events is not None
+        try:
+            self._loop.call_soon_threadsafe(self._events.put_nowait, item)
+        except RuntimeError:
+            # Event loop was closed, nobody is listening
+            pass
+
+    def _result(self) -> Any:
+        return json.loads(self.decoder.dumps(self._start_time, self.align_level))
+
+    def _end_utt(self) -> None:
+        if self._in_utt:
+            self._in_utt = False
+            self.decoder.end_utt()
+            self._post(Event(True, self._result()))
+
+    def _process(self, data: bytes) -> None:
+        n_samples = len(data) // 2
+        if n_samples == 0:
+            return
+        if not self._in_utt:
+            self.decoder.start_utt()
+            self._in_utt = True
+            self._last_hyp = None
+            self._start_time = self._n_samples / self._samprate
+        self.decoder.process_raw(data)
+        self._n_samples += n_samples
+        if self.partial:
+            hyp = self.decoder.hyp.text
+            if hyp is not None and hyp != self._last_hyp:
+                self._last_hyp = hyp
+                self._post(Event(False, self._result()))
+
+    def _run(self) -> None:
+        try:
+            while True:
+                item = self._input.get()
+                if item is _END_UTT:
+                    self._end_utt()
+                elif item is _CLOSE:
+                    self._end_utt()
+                    break
+                else:
+                    self._process(item)
+        except (RuntimeError, ValueError) as e:
+            if self._in_utt:
+                self._in_utt = False
+                try:
+                    self.decoder.end_utt()
+                except RuntimeError:
+                    pass
+            self._post(e)
+        finally:
+            self._post(_CLOSE)
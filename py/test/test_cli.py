@@ -43,6 +43,36 @@ class TestCLI(unittest.TestCase):
             )
             self.check_output(jpath)
 
+    def test_cli_features(self) -> None:
+        for option in "--write-features", "--write-scores":
+            self._test_cli_features(option)
+
+    def _test_cli_features(self, option: str) -> None:
+        with TemporaryDirectory() as tmpdir:
+            fpath = os.path.join(tmpdir, "features.feat")
+            jpath = os.path.join(tmpdir, "output.json")
+            cli.main(
+                (
+                    option,
+                    fpath,
+                    os.path.join(DATADIR, "goforward.wav"),
+                    os.path.join(DATADIR, "goforward.raw"),
+                )
+            )
+            cli.main(
+                (
+                    "--grammar",
+                    os.path.join(DATADIR, "goforward.gram"),
+                    "--features",
+                    fpath,
+                    "-o",
+                    jpath,
+                )
+            )
+            with open(jpath, "rt") as infh:
+                self.assertEqual(len(infh.readlines()), 2)
+            self.check_output(jpath)
+
     def test_cli_other_model(self) -> None:
         with TemporaryDirectory() as tmpdir:
             jpath = os.path.join(tmpdir, "output.json")
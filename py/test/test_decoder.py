@@ -1,10 +1,13 @@
 #!/usr/bin/python3
 
 import os
+import threading
 import unittest
 from typing import Iterator
 
-from soundswallower import Decoder, Seg, get_model_path
+import numpy as np
+
+from soundswallower import Decoder, Hyp, Seg, get_model_path
 
 DATADIR = os.path.join(os.path.dirname(__file__), "..", "..", "tests", "data")
 
@@ -89,6 +92,210 @@ class TestDecoder(unittest.TestCase):
         )
         self._run_decode(decoder)
 
+    def test_rolling(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+            rolling=50,
+        )
+        decoder.set_jsgf_string(
+            "#JSGF V1.0; grammar loop; public <loop> = <move>+;"
+            "<move> = go (forward | backward) (one | two | ten) meters;"
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        words = []
+        decoder.start_utt()
+        for _ in range(3):
+            decoder.process_raw(data)
+            stable = decoder.stable_hyp()
+            if stable is not None:
+                words.append(stable)
+        decoder.end_utt()
+        self.assertIsNone(decoder.stable_hyp())
+        words.append(decoder.hyp.text)
+        self.assertEqual(" ".join(words), " ".join(["go forward ten meters"] * 3))
+
+    def test_publish(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+            publish=True,
+        )
+        self.assertIsNone(decoder.result)
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        decoder.start_utt()
+        self.assertEqual(decoder.result.hyp.text, "")
+        results = []
+
+        # Read results while the main thread decodes (without the GIL)
+        def read_results() -> None:
+            while not results or not results[-1].final:
+                results.append(decoder.result)
+
+        reader = threading.Thread(target=read_results)
+        reader.start()
+        for pos in range(0, len(data), 4096):
+            decoder.process_raw(data[pos : pos + 4096])
+        decoder.end_utt()
+        reader.join()
+        self.assertEqual(results[-1].hyp, decoder.hyp)
+        self._check_hyp(results[-1].hyp.text, results[-1].seg)
+
+    def test_shared(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        cmn = decoder.cmn
+
+        def decode() -> Hyp:
+            decoder.cmn = cmn
+            decoder.start_utt()
+            decoder.process_raw(data)
+            n_frames.add(decoder.n_frames)
+            decoder.end_utt()
+            n_frames.add(decoder.n_frames)
+            return decoder.hyp
+
+        n_frames = {0}
+        ref = decode()
+        started = threading.Event()
+        done = threading.Event()
+        errors = []
+        seen_frames = set()
+
+        # Use the decoder while the main thread decodes (without the
+        # GIL), which has to wait for each call to finish
+        def use_decoder() -> None:
+            try:
+                while not done.is_set():
+                    hyp = decoder.hyp
+                    if hyp is not None and hyp.text is not None:
+                        for word in hyp.text.split():
+                            self.assertIsNotNone(decoder.lookup_word(word))
+                    for seg in decoder.seg:
+                        self.assertTrue(0 <= seg.start <= seg.start + seg.duration)
+                    seen_frames.add(decoder.n_frames)
+                    started.set()
+            except Exception as e:
+                errors.append(e)
+                started.set()
+
+        user = threading.Thread(target=use_decoder)
+        user.start()
+        started.wait()
+        hyps = [decode() for _ in range(3)]
+        done.set()
+        user.join()
+        self.assertEqual(errors, [])
+        # Never in the middle of processing audio
+        self.assertTrue(seen_frames <= n_frames, (seen_frames, n_frames))
+        for hyp in hyps:
+            self.assertEqual(hyp, ref)
+
+    def test_step(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        decoder.start_utt()
+        for pos in range(0, len(data), 4096):
+            decoder.enqueue_raw(data[pos : pos + 4096])
+            while decoder.step(max_frames=5) > 0:
+                pass
+        decoder.end_utt()
+        self._check_hyp(decoder.hyp.text, decoder.seg)
+        # Audio left in the queue is decoded at the end
+        decoder.start_utt()
+        decoder.enqueue_raw(data)
+        decoder.end_utt()
+        self.assertEqual(decoder.hyp.text, "go forward ten meters")
+
+    def test_rewind(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+        self._run_decode(decoder)
+        score = decoder.hyp.score
+        decoder.set_jsgf_string(
+            "#JSGF V1.0; grammar fallback; public <move> = go backward ten meters;"
+        )
+        decoder.rewind()
+        self.assertEqual(decoder.hyp.text, "go backward ten meters")
+        self.assertLess(decoder.hyp.score, score)
+
+    def test_snapshot(self) -> None:
+        def make_decoder() -> Decoder:
+            return Decoder(
+                hmm=os.path.join(get_model_path("en-us")),
+                fsg=os.path.join(DATADIR, "goforward.fsg"),
+                dict=os.path.join(DATADIR, "turtle.dic"),
+            )
+
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        half = len(data) // 4 * 2
+        decoder = make_decoder()
+        decoder.start_utt()
+        decoder.process_raw(data[:half])
+        snapshot = decoder.snapshot()
+        decoder.end_utt()
+        with self.assertRaises(RuntimeError):
+            decoder.snapshot()
+        decoder = make_decoder()
+        decoder.restore(snapshot)
+        decoder.process_raw(data[half:])
+        decoder.end_utt()
+        self._check_hyp(decoder.hyp.text, decoder.seg)
+        with self.assertRaises(RuntimeError):
+            decoder.restore(snapshot[:-4])
+        with self.assertRaises(RuntimeError):
+            decoder.restore(b"")
+        self._run_decode(decoder)
+
+    def test_decode_batch(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+        int16 = np.frombuffer(data, dtype=np.int16)
+        float32 = int16.astype(np.float32) / 32768
+        segs, words = decoder.decode_batch([data, int16, float32])
+        self.assertEqual(set(segs["utt"]), {0, 1, 2})
+        for utt in range(3):
+            useg = segs[segs["utt"] == utt]
+            text = [
+                words[w] for w in useg["word"] if words[w] not in ("<sil>", "(NULL)")
+            ]
+            self.assertEqual(text, "go forward ten meters".split())
+            self.assertTrue(np.all(useg["start"] <= useg["end"]))
+            self.assertTrue(np.all(useg["ascr"] <= 0))
+        # Same results as decoding one at a time
+        self._run_decode(decoder)
+        useg = segs[segs["utt"] == 0]
+        self.assertEqual(
+            [words[w] for w in useg["word"]], [s.text for s in decoder.seg]
+        )
+        self.assertEqual(
+            list(useg["start"]), [round(s.start * 100) for s in decoder.seg]
+        )
+        with self.assertRaises(ValueError):
+            decoder.decode_batch([int16.astype(np.float64)])
+
     def test_loglevel(self) -> None:
         Decoder(hmm=os.path.join(get_model_path(), "en-us"), loglevel="FATAL")
         with self.assertRaises(RuntimeError):
@@ -0,0 +1,113 @@
+#!/usr/bin/python3
+
+import os
+import struct
+import unittest
+from tempfile import TemporaryDirectory
+from typing import Tuple
+
+import numpy as np
+
+from soundswallower import Decoder, get_model_path
+from soundswallower.mixw import (
+    BYTE_ORDER_MAGIC,
+    N_CLUSTERS,
+    cluster,
+    encode,
+    main,
+    mixw_to_prob,
+    quantize,
+    read_mixw,
+    read_sendump,
+    write_sendump,
+)
+
+DATADIR = os.path.join(os.path.dirname(__file__), "..", "..", "tests", "data")
+MODEL = get_model_path("en-us")
+
+
+def decode(**kwargs: str) -> Tuple[str, int]:
+    decoder = Decoder(
+        fsg=os.path.join(DATADIR, "goforward.fsg"),
+        dict=os.path.join(DATADIR, "turtle.dic"),
+        **kwargs,
+    )
+    decoder.decode_file(os.path.join(DATADIR, "goforward.raw"))
+    return decoder.hyp.text, decoder.hyp.score
+
+
+def write_mixw_model(tempdir: str) -> str:
+    """Make a model with floating-point mixture weights only."""
+    orig = read_sendump(os.path.join(MODEL, "sendump"))
+    pdf = mixw_to_prob(orig).transpose(2, 0, 1).astype(np.float32)
+    for name in os.listdir(MODEL):
+        if name != "sendump":
+            os.symlink(os.path.join(MODEL, name), os.path.join(tempdir, name))
+    mixw_file = os.path.join(tempdir, "mixture_weights")
+    with open(mixw_file, "wb") as outfh:
+        outfh.write(b"s3\nversion 1.0\nendhdr\n")
+        outfh.write(struct.pack("=I", BYTE_ORDER_MAGIC))
+        outfh.write(struct.pack("=4i", *pdf.shape, pdf.size))
+        outfh.write(pdf.tobytes())
+    return mixw_file
+
+
+class TestMixw(unittest.TestCase):
+    def test_8bit(self) -> None:
+        mixw = read_sendump(os.path.join(MODEL, "sendump"))
+        self.assertEqual(mixw.shape, (3, 128, 5126))
+        codes, codebook = quantize(mixw, 8)
+        self.assertIsNone(codebook)
+        with TemporaryDirectory() as tempdir:
+            sendump = os.path.join(tempdir, "sendump")
+            with open(sendump, "wb") as outfh:
+                write_sendump(outfh, codes)
+            np.testing.assert_array_equal(read_sendump(sendump), mixw)
+            self.assertEqual(decode(hmm=MODEL, sendump=sendump), decode(hmm=MODEL))
+
+    def test_4bit(self) -> None:
+        mixw = read_sendump(os.path.join(MODEL, "sendump"))
+        codebook = cluster(mixw)
+        self.assertEqual(len(codebook), N_CLUSTERS)
+        self.assertTrue(np.all(np.diff(codebook.astype(int)) >= 0))
+        with TemporaryDirectory() as tempdir:
+            sendump = os.path.join(tempdir, "sendump")
+            main([os.path.join(MODEL, "sendump"), sendump])
+            self.assertLess(
+                os.path.getsize(sendump),
+                os.path.getsize(os.path.join(MODEL, "sendump")) // 2 + 1024,
+            )
+            quantized = read_sendump(sendump)
+            self.assertEqual(set(np.unique(quantized)), set(codebook))
+            # Odd and even senones are both decoded correctly
+            np.testing.assert_array_equal(quantized, codebook[encode(mixw, codebook)])
+            text, _ = decode(hmm=MODEL, sendump=sendump)
+            self.assertEqual(text, "go forward ten meters")
+
+    def test_mixw(self) -> None:
+        orig = read_sendump(os.path.join(MODEL, "sendump"))
+        with TemporaryDirectory() as tempdir:
+            mixw_file = write_mixw_model(tempdir)
+            mixw = read_mixw(mixw_file)
+            self.assertEqual(mixw.shape, orig.shape)
+            self.assertLessEqual(np.abs(mixw.astype(int) - orig).max(), 1)
+            sendump = os.path.join(tempdir, "sendump-8bit")
+            main(["--bits", "8", mixw_file, sendump])
+            # Same weights as the decoder computes when loading them
+            self.assertEqual(decode(hmm=tempdir, sendump=sendump), decode(hmm=tempdir))
+
+
+class TestSubvq(unittest.TestCase):
+    def test_subvq(self) -> None:
+        with TemporaryDirectory() as tempdir:
+            write_mixw_model(tempdir)
+            # As a general multi-stream model, with and without
+            # sub-vector quantized Gaussian preselection
+            text, _ = decode(hmm=tempdir, senmgau=".ptm.")
+            self.assertEqual(text, "go forward ten meters")
+            text, _ = decode(hmm=tempdir, senmgau=".ptm.", subvq="16")
+            self.assertEqual(text, "go forward ten meters")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,91 @@
+#!/usr/bin/python3
+
+import os
+import unittest
+from tempfile import TemporaryDirectory
+from typing import List, Tuple
+
+import numpy as np
+
+from soundswallower import Decoder, get_model_path
+from soundswallower.nnet import (
+    ACT_LINEAR,
+    ACT_RELU,
+    Layer,
+    main,
+    quantize,
+    write_nnet,
+)
+
+DATADIR = os.path.join(os.path.dirname(__file__), "..", "..", "tests", "data")
+N_SEN = 5126  # Number of senones in en-us model
+FEAT_LEN = 39
+
+
+def random_network(n_hidden: int = 64, ctx: int = 1) -> Tuple[List[Layer], np.ndarray]:
+    rng = np.random.default_rng(42)
+    n_in = (2 * ctx + 1) * FEAT_LEN
+    return [
+        (rng.normal(0, 0.1, (n_hidden, n_in)), np.zeros(n_hidden), ACT_RELU),
+        (rng.normal(0, 0.1, (N_SEN, n_hidden)), np.zeros(N_SEN), ACT_LINEAR),
+    ], np.ones(N_SEN)
+
+
+class TestNnet(unittest.TestCase):
+    def test_quantize(self) -> None:
+        w = np.array([[0.5, -1.0, 0.25], [0.0, 0.0, 0.0]])
+        q, scale = quantize(w)
+        self.assertEqual(q.dtype, np.int8)
+        self.assertEqual(list(q[0]), [64, -127, 32])
+        self.assertEqual(list(q[1]), [0, 0, 0])
+        np.testing.assert_allclose(q[0] * scale[0], w[0], atol=scale[0])
+
+    def test_bad_dimensions(self) -> None:
+        layers, priors = random_network()
+        with TemporaryDirectory() as tempdir:
+            with open(os.path.join(tempdir, "nnet"), "wb") as outfh:
+                with self.assertRaises(ValueError):
+                    write_nnet(outfh, layers, priors, FEAT_LEN)
+                with self.assertRaises(ValueError):
+                    write_nnet(
+                        outfh, layers, priors[1:], FEAT_LEN, ctx_left=1, ctx_right=1
+                    )
+
+    def test_decode(self) -> None:
+        layers, priors = random_network()
+        with TemporaryDirectory() as tempdir:
+            npzfile = os.path.join(tempdir, "nnet.npz")
+            nnetfile = os.path.join(tempdir, "nnet")
+            np.savez(
+                npzfile,
+                w0=layers[0][0],
+                b0=layers[0][1],
+                w1=layers[1][0],
+                b1=layers[1][1],
+                priors=priors,
+            )
+            main([npzfile, nnetfile, "--ctx-left", "1", "--ctx-right", "1"])
+            decoder = Decoder(
+                hmm=get_model_path("en-us"),
+                nnet=nnetfile,
+                fsg=os.path.join(DATADIR, "goforward.fsg"),
+                beam=0.0,
+                wbeam=0.0,
+                pbeam=0.0,
+            )
+            # It's a random network, so we can't expect a sensible
+            # result, but we can expect one (with no pruning).
+            hyp, _ = decoder.decode_file(os.path.join(DATADIR, "goforward.wav"))
+            self.assertIsNotNone(hyp)
+            # Mismatched feature length is caught
+            main([npzfile, nnetfile, "--feat-len", str(FEAT_LEN * 3)])
+            with self.assertRaises(RuntimeError):
+                _ = Decoder(
+                    hmm=get_model_path("en-us"),
+                    nnet=nnetfile,
+                    fsg=os.path.join(DATADIR, "goforward.fsg"),
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
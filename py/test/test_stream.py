@@ -0,0 +1,76 @@
+#!/usr/bin/python3
+
+import asyncio
+import os
+import unittest
+from typing import List
+
+from soundswallower import Decoder, get_model_path
+from soundswallower.stream import AsyncDecoder, Event
+
+DATADIR = os.path.join(os.path.dirname(__file__), "..", "..", "tests", "data")
+
+
+class TestStream(unittest.TestCase):
+    def test_stream(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            fsg=os.path.join(DATADIR, "goforward.fsg"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            data = fh.read()
+
+        async def decode() -> List[Event]:
+            events = []
+            ticks = 0
+
+            async def tick() -> None:
+                nonlocal ticks
+                while True:
+                    await asyncio.sleep(0)
+                    ticks += 1
+
+            async with AsyncDecoder(decoder) as stream:
+                ticker = asyncio.create_task(tick())
+                for _ in range(2):
+                    for i in range(0, len(data), 4096):
+                        stream.feed(data[i : i + 4096])
+                    stream.end_utt()
+                stream.close()
+                async for event in stream:
+                    events.append(event)
+                ticker.cancel()
+            # The event loop kept running while decoding
+            self.assertGreater(ticks, len(events))
+            return events
+
+        events = asyncio.run(decode())
+        final = [e.result for e in events if e.final]
+        self.assertEqual(len(final), 2)
+        for result in final:
+            self.assertEqual(result["t"], "go forward ten meters")
+        # Times are relative to the start of the stream
+        self.assertAlmostEqual(final[1]["b"], len(data) / 2 / 16000, places=2)
+        self.assertTrue(any(not e.final for e in events))
+
+    def test_stream_error(self) -> None:
+        decoder = Decoder(
+            hmm=os.path.join(get_model_path("en-us")),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+        )
+
+        async def decode() -> None:
+            async with AsyncDecoder(decoder) as stream:
+                stream.feed(b"\0\0" * 1600)
+                stream.close()
+                async for _ in stream:
+                    pass
+
+        # No grammar, so decoding fails
+        with self.assertRaises(RuntimeError):
+            asyncio.run(decode())
+
+
+if __name__ == "__main__":
+    unittest.main()
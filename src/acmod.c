@@ -52,6 +52,7 @@
 #include <soundswallower/err.h>
 #include <soundswallower/feat.h>
 #include <soundswallower/ms_mgau.h>
+#include <soundswallower/nn_mgau.h>
 #include <soundswallower/prim_type.h>
 #include <soundswallower/ptm_mgau.h>
 #include <soundswallower/s2_semi_mgau.h>
@@ -91,6 +92,12 @@ acmod_load_am(acmod_t *acmod)
                             config_float(acmod->config, "tmatfloor"));
 
     /* Read the acoustic models. */
+    if (config_str(acmod->config, "nnet")) {
+        E_INFO("Using neural network acoustic model\n");
+        if ((acmod->mgau = nn_mgau_init(acmod)) == NULL)
+            return -1;
+        return 0;
+    }
     if ((config_str(acmod->config, "mean") == NULL)
         || (config_str(acmod->config, "var") == NULL)
         || (config_str(acmod->config, "tmat") == NULL)) {
@@ -198,7 +205,6 @@ acmod_alloc_buffers(acmod_t *acmod)
     /* Feature buffer has to be at least as large as MFCC buffer. */
     acmod->n_feat_alloc = acmod->n_mfc_alloc;
     acmod->feat_buf = feat_array_alloc(acmod->fcb, acmod->n_feat_alloc);
-    acmod->framepos = ckd_calloc(acmod->n_feat_alloc, sizeof(*acmod->framepos));
     return 0;
 }
 
@@ -265,7 +271,6 @@ acmod_free(acmod_t *acmod)
     if (acmod->feat_buf)
         feat_array_free(acmod->feat_buf);
 
-    ckd_free(acmod->framepos);
     if (acmod->senone_scores)
         ckd_free(acmod->senone_scores);
     if (acmod->senone_active_vec)
@@ -307,8 +312,6 @@ acmod_reinit_feat(acmod_t *acmod, fe_t *fe, feat_t *fcb)
         ckd_free_2d(acmod->mfc_buf);
     if (acmod->feat_buf)
         feat_array_free(acmod->feat_buf);
-    if (acmod->framepos)
-        ckd_free(acmod->framepos);
 
     return acmod_alloc_buffers(acmod);
 }
@@ -334,8 +337,6 @@ acmod_grow_feat_buf(acmod_t *acmod, int nfr)
 
     acmod->feat_buf = feat_array_realloc(acmod->fcb, acmod->feat_buf,
                                          acmod->n_feat_alloc, nfr);
-    acmod->framepos = ckd_realloc(acmod->framepos,
-                                  nfr * sizeof(*acmod->framepos));
     acmod->n_feat_alloc = nfr;
 }
 
@@ -362,8 +363,11 @@ acmod_start_utt(acmod_t *acmod)
     acmod->mfc_outidx = 0;
     acmod->feat_outidx = 0;
     acmod->output_frame = 0;
+    acmod->first_frame = 0;
     acmod->senscr_frame = -1;
     acmod->n_senone_active = 0;
+    acmod->hold_active = FALSE;
+    acmod->insen = NULL;
     acmod->mgau->frame_idx = 0;
     return 0;
 }
@@ -727,14 +731,69 @@ acmod_process_cep(acmod_t *acmod,
     return orig_n_frames - *inout_n_frames;
 }
 
+int
+acmod_process_feat(acmod_t *acmod,
+                   mfcc_t **feat)
+{
+    int i, inptr;
+
+    if (acmod->n_feat_frame == acmod->n_feat_alloc) {
+        if (acmod->grow_feat)
+            acmod_grow_feat_buf(acmod, acmod->n_feat_alloc * 2);
+        else
+            return 0;
+    }
+
+    if (acmod->grow_feat) {
+        /* Grow to avoid wraparound if grow_feat == TRUE. */
+        inptr = acmod->feat_outidx + acmod->n_feat_frame;
+        while (inptr + 1 >= acmod->n_feat_alloc)
+            acmod_grow_feat_buf(acmod, acmod->n_feat_alloc * 2);
+    } else {
+        inptr = (acmod->feat_outidx + acmod->n_feat_frame) % acmod->n_feat_alloc;
+    }
+
+    for (i = 0; i < feat_dimension1(acmod->fcb); ++i)
+        memcpy(acmod->feat_buf[inptr][i],
+               feat[i], feat_dimension2(acmod->fcb, i) * sizeof(**feat));
+    ++acmod->n_feat_frame;
+    assert(acmod->n_feat_frame <= acmod->n_feat_alloc);
+    if (acmod->state == ACMOD_STARTED)
+        acmod->state = ACMOD_PROCESSING;
+
+    return 1;
+}
+
+int
+acmod_set_insen(acmod_t *acmod, const int16 *senscr, int n_frames)
+{
+    if (acmod->state != ACMOD_STARTED || acmod->n_feat_frame != 0) {
+        E_ERROR("Senone scores must be set at the start of an utterance\n");
+        return -1;
+    }
+    acmod->insen = senscr;
+    acmod->n_feat_frame = n_frames;
+    acmod->state = ACMOD_PROCESSING;
+    return 0;
+}
+
 int
 acmod_rewind(acmod_t *acmod)
 {
-    /* If the feature buffer is circular, this is not possible. */
-    if (acmod->output_frame > acmod->n_feat_alloc) {
+    /* Nor if the start of the utterance was not restored. */
+    if (acmod->first_frame > 0) {
+        E_ERROR("Utterance restored at frame %d cannot be rewound\n",
+                acmod->first_frame);
+        return -1;
+    }
+    /* If the feature buffer has wrapped around, this is not possible
+     * (precomputed senone scores are always all available). */
+    if (acmod->insen == NULL
+        && acmod->output_frame + acmod->n_feat_frame > acmod->n_feat_alloc) {
         E_ERROR("Circular feature buffer cannot be rewound (output frame %d, "
                 "alloc %d)\n",
-                acmod->output_frame, acmod->n_feat_alloc);
+                acmod->output_frame + acmod->n_feat_frame,
+                acmod->n_feat_alloc);
         return -1;
     }
 
@@ -750,6 +809,129 @@ acmod_rewind(acmod_t *acmod)
     return 0;
 }
 
+/* Size of one frame in feat_buf, before LDA or subvector projection. */
+static int32
+feat_frame_size(feat_t *fcb)
+{
+    int32 i, k;
+
+    for (k = i = 0; i < fcb->n_stream; ++i)
+        k += fcb->stream_len[i];
+    return k;
+}
+
+int
+acmod_snapshot_save(acmod_t *acmod, snapshot_t *s)
+{
+    int32 i, cepsize, featsize;
+
+    if (acmod->state != ACMOD_STARTED && acmod->state != ACMOD_PROCESSING) {
+        E_ERROR("Utterance is not in progress\n");
+        return -1;
+    }
+    if (acmod->insen) {
+        E_ERROR("Cannot save state when decoding precomputed senone scores\n");
+        return -1;
+    }
+    cepsize = feat_cepsize(acmod->fcb);
+    featsize = feat_frame_size(acmod->fcb);
+
+    snapshot_write_int32(s, acmod->state);
+    snapshot_write_int32(s, acmod->output_frame);
+    snapshot_write_int32(s, acmod->mgau->frame_idx);
+    fe_snapshot_save(acmod->fe, s);
+    feat_snapshot_save(acmod->fcb, s);
+
+    /* Cepstra and features computed but not yet used. */
+    snapshot_write_int32(s, cepsize);
+    snapshot_write_int32(s, acmod->n_mfc_frame);
+    for (i = 0; i < acmod->n_mfc_frame; ++i) {
+        int idx = (acmod->mfc_outidx + i) % acmod->n_mfc_alloc;
+        snapshot_write(s, acmod->mfc_buf[idx], cepsize * sizeof(mfcc_t));
+    }
+    snapshot_write_int32(s, featsize);
+    snapshot_write_int32(s, acmod->n_feat_frame);
+    for (i = 0; i < acmod->n_feat_frame; ++i) {
+        int idx = (acmod->feat_outidx + i) % acmod->n_feat_alloc;
+        snapshot_write(s, acmod->feat_buf[idx][0], featsize * sizeof(mfcc_t));
+    }
+
+    mgau_snapshot_save(acmod->mgau, s);
+    return 0;
+}
+
+int
+acmod_snapshot_load(acmod_t *acmod, snapshot_t *s)
+{
+    int32 i, state, output_frame, frame_idx, n_mfc_frame, n_feat_frame;
+    int32 cepsize, featsize;
+
+    if (acmod->state != ACMOD_STARTED || acmod->output_frame != 0) {
+        E_ERROR("Utterance must be started and empty to restore it\n");
+        return -1;
+    }
+    cepsize = feat_cepsize(acmod->fcb);
+    featsize = feat_frame_size(acmod->fcb);
+
+    state = snapshot_read_int32(s);
+    output_frame = snapshot_read_int32(s);
+    frame_idx = snapshot_read_int32(s);
+    if ((state != ACMOD_STARTED && state != ACMOD_PROCESSING)
+        || output_frame < 0 || frame_idx < 0) {
+        E_ERROR("Invalid acoustic model state in snapshot\n");
+        return -1;
+    }
+    if (fe_snapshot_load(acmod->fe, s) < 0)
+        return -1;
+    if (feat_snapshot_load(acmod->fcb, s) < 0)
+        return -1;
+
+    if (snapshot_read_int32(s) != cepsize) {
+        E_ERROR("Snapshot has a different cepstral dimension\n");
+        return -1;
+    }
+    n_mfc_frame = snapshot_read_int32(s);
+    if (n_mfc_frame < 0 || n_mfc_frame > acmod->n_mfc_alloc) {
+        E_ERROR("Invalid number of cepstral frames %d in snapshot\n",
+                n_mfc_frame);
+        return -1;
+    }
+    for (i = 0; i < n_mfc_frame; ++i)
+        snapshot_read(s, acmod->mfc_buf[i], cepsize * sizeof(mfcc_t));
+    acmod->mfc_outidx = 0;
+    acmod->n_mfc_frame = n_mfc_frame;
+
+    if (snapshot_read_int32(s) != featsize) {
+        E_ERROR("Snapshot has a different feature dimension\n");
+        return -1;
+    }
+    n_feat_frame = snapshot_read_int32(s);
+    if (n_feat_frame < 0) {
+        E_ERROR("Invalid number of feature frames %d in snapshot\n",
+                n_feat_frame);
+        return -1;
+    }
+    if (n_feat_frame > acmod->n_feat_alloc) {
+        if (!acmod->grow_feat) {
+            E_ERROR("Snapshot has %d feature frames, buffer only holds %d\n",
+                    n_feat_frame, acmod->n_feat_alloc);
+            return -1;
+        }
+        acmod_grow_feat_buf(acmod, n_feat_frame * 2);
+    }
+    for (i = 0; i < n_feat_frame; ++i)
+        snapshot_read(s, acmod->feat_buf[i][0], featsize * sizeof(mfcc_t));
+    acmod->feat_outidx = 0;
+    acmod->n_feat_frame = n_feat_frame;
+
+    acmod->state = state;
+    acmod->output_frame = acmod->first_frame = output_frame;
+    acmod->mgau->frame_idx = frame_idx;
+    if (mgau_snapshot_load(acmod->mgau, s) < 0)
+        return -1;
+    return s->error ? -1 : 0;
+}
+
 int
 acmod_advance(acmod_t *acmod)
 {
@@ -793,7 +975,7 @@ calc_feat_idx(acmod_t *acmod, int frame_idx)
         return -1;
     }
 
-    /* Get the index in feat_buf/framepos of the frame to be scored. */
+    /* Get the index in feat_buf of the frame to be scored. */
     feat_idx = (acmod->feat_outidx + frame_idx - acmod->output_frame) % acmod->n_feat_alloc;
     if (feat_idx < 0)
         feat_idx += acmod->n_feat_alloc;
@@ -829,13 +1011,31 @@ acmod_score(acmod_t *acmod, int *inout_frame_idx)
 
     /* If all senones are being computed then we can reuse existing
        scores. */
-    if ((acmod->compallsen)
+    if ((acmod->compallsen || acmod->hold_active)
         && frame_idx == acmod->senscr_frame) {
         if (inout_frame_idx)
             *inout_frame_idx = frame_idx;
         return acmod->senone_scores;
     }
 
+    /* Precomputed scores are all available, for all senones. */
+    if (acmod->insen) {
+        int n_sen = bin_mdef_n_sen(acmod->mdef);
+        if (frame_idx < 0
+            || frame_idx >= acmod->output_frame + acmod->n_feat_frame) {
+            E_ERROR("Frame %d outside %d frames of senone scores\n",
+                    frame_idx, acmod->output_frame + acmod->n_feat_frame);
+            return NULL;
+        }
+        acmod_flags2list(acmod);
+        memcpy(acmod->senone_scores, acmod->insen + (size_t)frame_idx * n_sen,
+               n_sen * sizeof(*acmod->senone_scores));
+        if (inout_frame_idx)
+            *inout_frame_idx = frame_idx;
+        acmod->senscr_frame = frame_idx;
+        return acmod->senone_scores;
+    }
+
     /* Calculate position of requested frame in circular buffer. */
     if ((feat_idx = calc_feat_idx(acmod, frame_idx)) < 0)
         return NULL;
@@ -889,7 +1089,7 @@ acmod_best_score(acmod_t *acmod, int *out_best_senid)
 void
 acmod_clear_active(acmod_t *acmod)
 {
-    if (acmod->compallsen)
+    if (acmod->compallsen || acmod->hold_active)
         return;
     bitvec_clear_all(acmod->senone_active_vec, bin_mdef_n_sen(acmod->mdef));
     acmod->n_senone_active = 0;
@@ -907,7 +1107,7 @@ acmod_activate_hmm(acmod_t *acmod, hmm_t *hmm)
 {
     int i;
 
-    if (acmod->compallsen)
+    if (acmod->compallsen || acmod->hold_active)
         return;
     if (hmm_is_mpx(hmm)) {
         switch (hmm_n_emit_state(hmm)) {
@@ -944,6 +1144,12 @@ acmod_activate_hmm(acmod_t *acmod, hmm_t *hmm)
     }
 }
 
+void
+acmod_hold_active(acmod_t *acmod, int hold)
+{
+    acmod->hold_active = hold;
+}
+
 int32
 acmod_flags2list(acmod_t *acmod)
 {
@@ -161,3 +161,36 @@ blkarray_list_get(blkarray_list_t *list, int32 n)
 
     return blkarray_list_ptr(list, r, c);
 }
+
+int32
+blkarray_list_compact(blkarray_list_t *bl, int32 *keep)
+{
+    int32 i, n, r, n_valid;
+
+    n = 0;
+    n_valid = blkarray_list_n_valid(bl);
+    for (i = 0; i < n_valid; i++) {
+        void **src = &blkarray_list_ptr(bl, i / bl->blksize, i % bl->blksize);
+
+        if (keep[i]) {
+            blkarray_list_ptr(bl, n / bl->blksize, n % bl->blksize) = *src;
+            keep[i] = n++;
+        } else {
+            ckd_free(*src);
+            keep[i] = -1;
+        }
+    }
+
+    /* Free the rows that are now empty */
+    r = (n == 0) ? -1 : (n - 1) / bl->blksize;
+    for (i = r + 1; i <= bl->cur_row; i++) {
+        ckd_free(bl->ptr[i]);
+        bl->ptr[i] = NULL;
+    }
+
+    bl->n_valid = n;
+    bl->cur_row = r;
+    bl->cur_row_free = (r < 0) ? bl->blksize : n - r * bl->blksize;
+
+    return n_valid - n;
+}
@@ -57,31 +57,42 @@ cmn_live_set(cmn_t *cmn, mfcc_t const *vec)
     E_INFO("Update to   < %s >\n", cmn_update_repr(cmn));
 }
 
+/* Make the accumulation decay exponentially */
+static void
+cmn_live_decay(cmn_t *cmn)
+{
+    int32 i;
+#ifdef FIXED_POINT
+    /* 1.0 / nframe has too few bits in fixed-point, so rescale
+     * exactly instead. */
+    for (i = 0; i < cmn->veclen; i++)
+        cmn->sum[i] = (mfcc_t)((int64)cmn->sum[i] * CMN_WIN / cmn->nframe);
+#else
+    mfcc_t sf = CMN_WIN * (FLOAT2MFCC(1.0) / cmn->nframe);
+
+    for (i = 0; i < cmn->veclen; i++)
+        cmn->sum[i] = MFCCMUL(cmn->sum[i], sf);
+#endif
+    cmn->nframe = CMN_WIN;
+}
+
 static void
 cmn_live_shiftwin(cmn_t *cmn)
 {
-    mfcc_t sf;
     int32 i;
 
     E_INFO("Update from < %s >\n", cmn->repr);
-    sf = FLOAT2MFCC(1.0) / cmn->nframe;
     for (i = 0; i < cmn->veclen; i++)
-        cmn->cmn_mean[i] = cmn->sum[i] / cmn->nframe; /* sum[i] * sf */
-
-    /* Make the accumulation decay exponentially */
-    if (cmn->nframe >= CMN_WIN_HWM) {
-        sf = CMN_WIN * sf;
-        for (i = 0; i < cmn->veclen; i++)
-            cmn->sum[i] = MFCCMUL(cmn->sum[i], sf);
-        cmn->nframe = CMN_WIN;
-    }
+        cmn->cmn_mean[i] = cmn->sum[i] / cmn->nframe;
+
+    if (cmn->nframe >= CMN_WIN_HWM)
+        cmn_live_decay(cmn);
     E_INFO("Update to   < %s >\n", cmn_update_repr(cmn));
 }
 
 void
 cmn_live_update(cmn_t *cmn)
 {
-    mfcc_t sf;
     int32 i;
 
     if (cmn->nframe <= 0)
@@ -89,17 +100,11 @@ cmn_live_update(cmn_t *cmn)
 
     E_INFO("Update from < %s >\n", cmn->repr);
     /* Update mean buffer */
-    sf = FLOAT2MFCC(1.0) / cmn->nframe;
     for (i = 0; i < cmn->veclen; i++)
-        cmn->cmn_mean[i] = cmn->sum[i] / cmn->nframe; /* sum[i] * sf; */
-
-    /* Make the accumulation decay exponentially */
-    if (cmn->nframe > CMN_WIN_HWM) {
-        sf = CMN_WIN * sf;
-        for (i = 0; i < cmn->veclen; i++)
-            cmn->sum[i] = MFCCMUL(cmn->sum[i], sf);
-        cmn->nframe = CMN_WIN;
-    }
+        cmn->cmn_mean[i] = cmn->sum[i] / cmn->nframe;
+
+    if (cmn->nframe > CMN_WIN_HWM)
+        cmn_live_decay(cmn);
     E_INFO("Update to   < %s >\n", cmn_update_repr(cmn));
 }
 
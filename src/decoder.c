@@ -39,6 +39,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -119,6 +120,10 @@ config_expand(config_t *config)
         expand_file_config(config, "lda", hmmdir, "feature_transform");
         expand_file_config(config, "featparams", hmmdir, "feat_params.json");
         expand_file_config(config, "senmgau", hmmdir, "senmgau");
+#ifndef __EMSCRIPTEN__
+        /* Only used if present, which we can't check here otherwise. */
+        expand_file_config(config, "nnet", hmmdir, "nnet");
+#endif
         expand_file_config(config, "dict", hmmdir, "dict.txt");
         expand_file_config(config, "fdict", hmmdir, "noisedict.txt");
     }
@@ -162,6 +167,8 @@ config_expand(config_t *config)
 static void
 decoder_free_searches(decoder_t *d)
 {
+    gnode_t *gn;
+
     if (d->search) {
         search_module_free(d->search);
         d->search = NULL;
@@ -170,6 +177,10 @@ decoder_free_searches(decoder_t *d)
         search_module_free(d->align);
         d->align = NULL;
     }
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        search_module_free((search_module_t *)gnode_ptr(gn));
+    glist_free(d->searches);
+    d->searches = NULL;
 }
 
 static int
@@ -506,6 +517,7 @@ decoder_create(config_t *config)
 
     d = ckd_calloc(1, sizeof(*d));
     d->refcount = 1;
+    d->results = result_slot_init();
     if (config) {
         if (decoder_init_config(d, config) < 0) {
             decoder_free(d);
@@ -553,6 +565,9 @@ decoder_free(decoder_t *d)
     logmath_free(d->lmath);
     config_free(d->config);
     ckd_free(d->json_result);
+    result_slot_free(d->results);
+    ckd_free(d->event_hyp);
+    ckd_free(d->queue);
 #ifndef __EMSCRIPTEN__
     if (d->logfh) {
         fclose(d->logfh);
@@ -587,6 +602,14 @@ decoder_feat(decoder_t *d)
     return d->fcb;
 }
 
+int32
+decoder_n_senones(decoder_t *d)
+{
+    if (d->acmod == NULL)
+        return 0;
+    return bin_mdef_n_sen(d->acmod->mdef);
+}
+
 mllr_t *
 decoder_apply_mllr(decoder_t *d, mllr_t *mllr)
 {
@@ -606,6 +629,87 @@ decoder_set_fsg(decoder_t *d, fsg_model_t *fsg)
     return 0;
 }
 
+static search_module_t *
+decoder_find_search(decoder_t *d, const char *name, gnode_t **out_pred)
+{
+    gnode_t *gn, *pred = NULL;
+
+    for (gn = d->searches; gn; pred = gn, gn = gnode_next(gn)) {
+        search_module_t *search = (search_module_t *)gnode_ptr(gn);
+        if (0 == strcmp(search_module_name(search), name)) {
+            if (out_pred)
+                *out_pred = pred;
+            return search;
+        }
+    }
+    return NULL;
+}
+
+static int
+decoder_in_utt(decoder_t *d)
+{
+    return d->acmod
+        && (d->acmod->state == ACMOD_STARTED
+            || d->acmod->state == ACMOD_PROCESSING);
+}
+
+int
+decoder_add_fsg(decoder_t *d, const char *name, fsg_model_t *fsg)
+{
+    search_module_t *search;
+
+    if (decoder_in_utt(d)) {
+        E_ERROR("Cannot add a search in the middle of an utterance\n");
+        fsg_model_free(fsg);
+        return -1;
+    }
+    if (decoder_find_search(d, name, NULL)) {
+        E_ERROR("Search %s already exists\n", name);
+        fsg_model_free(fsg);
+        return -1;
+    }
+    /* This frees fsg if it fails. */
+    search = fsg_search_init(name, fsg, d->config, d->acmod, d->dict, d->d2p);
+    if (search == NULL)
+        return -1;
+    d->searches = glist_add_ptr(d->searches, search);
+    return 0;
+}
+
+int
+decoder_remove_search(decoder_t *d, const char *name)
+{
+    search_module_t *search;
+    gnode_t *pred = NULL;
+
+    if (decoder_in_utt(d)) {
+        E_ERROR("Cannot remove a search in the middle of an utterance\n");
+        return -1;
+    }
+    if ((search = decoder_find_search(d, name, &pred)) == NULL) {
+        E_ERROR("No such search: %s\n", name);
+        return -1;
+    }
+    if (pred)
+        gnode_free(gnode_next(pred), pred);
+    else
+        d->searches = gnode_free(d->searches, NULL);
+    search_module_free(search);
+    return 0;
+}
+
+const char *
+decoder_search_hyp(decoder_t *d, const char *name, int32 *out_best_score)
+{
+    search_module_t *search;
+
+    if ((search = decoder_find_search(d, name, NULL)) == NULL) {
+        E_ERROR("No such search: %s\n", name);
+        return NULL;
+    }
+    return search_module_hyp(search, out_best_score);
+}
+
 int
 decoder_set_jsgf_file(decoder_t *d, const char *path)
 {
@@ -859,6 +963,12 @@ decoder_add_word(decoder_t *d,
          * will have updated the dictionary anyway. */
         search_module_reinit(d->search, d->dict, d->d2p);
     }
+    if (update) {
+        gnode_t *gn;
+        for (gn = d->searches; gn; gn = gnode_next(gn))
+            search_module_reinit((search_module_t *)gnode_ptr(gn),
+                                 d->dict, d->d2p);
+    }
 
     /* Rebuild the widmap and search tree if requested. */
     return wid;
@@ -887,9 +997,214 @@ decoder_lookup_word(decoder_t *d, const char *word)
     return phones;
 }
 
+/* Number of steps from the configured to the tightest pruning. */
+#define RTF_LEVELS 8
+/* Minimum number of frames searched between adjustments. */
+#define RTF_WINDOW 20
+
+static int
+search_is_fsg(search_module_t *search)
+{
+    return search && 0 == strcmp(search_module_type(search), PS_SEARCH_TYPE_FSG);
+}
+
+/*
+ * Set pruning parameters for the current adaptive pruning level, by
+ * interpolating between the configured ones and the rtf_* bounds.
+ */
+static void
+decoder_rtf_apply(decoder_t *d)
+{
+    config_t *config = d->config;
+    int32 level = d->rtf_level;
+    int32 beam, pbeam, wbeam, min_beam, maxhmmpf, min_maxhmmpf;
+    int topn, min_topn, ds, max_ds;
+    gnode_t *gn;
+
+    /* Parallel searches are pruned the same way as the main one. */
+    if (search_is_fsg(d->search) || d->searches) {
+        int n_searches = 0;
+
+        beam = (int32)logmath_log(d->lmath, config_float(config, "beam"))
+            >> SENSCR_SHIFT;
+        pbeam = (int32)logmath_log(d->lmath, config_float(config, "pbeam"))
+            >> SENSCR_SHIFT;
+        wbeam = (int32)logmath_log(d->lmath, config_float(config, "wbeam"))
+            >> SENSCR_SHIFT;
+        min_beam = (int32)logmath_log(d->lmath, config_float(config, "rtf_beam"))
+            >> SENSCR_SHIFT;
+        if (min_beam > beam)
+            beam += (min_beam - beam) * level / RTF_LEVELS;
+        /* Phone and word beams are never wider than the main one. */
+        if (pbeam < beam)
+            pbeam = beam;
+        if (wbeam < beam)
+            wbeam = beam;
+        maxhmmpf = config_int(config, "maxhmmpf");
+        min_maxhmmpf = config_int(config, "rtf_maxhmmpf");
+        if (level > 0 && min_maxhmmpf > 0) {
+            if (maxhmmpf == -1)
+                maxhmmpf = min_maxhmmpf;
+            else if (maxhmmpf > min_maxhmmpf)
+                maxhmmpf -= (maxhmmpf - min_maxhmmpf) * level / RTF_LEVELS;
+        }
+        if (search_is_fsg(d->search)) {
+            fsg_search_set_pruning(d->search, beam, pbeam, wbeam, maxhmmpf);
+            ++n_searches;
+        }
+        for (gn = d->searches; gn; gn = gnode_next(gn)) {
+            search_module_t *search = (search_module_t *)gnode_ptr(gn);
+            if (search_is_fsg(search)) {
+                fsg_search_set_pruning(search, beam, pbeam, wbeam, maxhmmpf);
+                ++n_searches;
+            }
+        }
+        if (n_searches > 0)
+            E_INFO("Adaptive pruning level %d: beam %d pbeam %d wbeam %d maxhmmpf %d"
+                   " for %d search%s\n",
+                   level, beam, pbeam, wbeam, maxhmmpf,
+                   n_searches, n_searches == 1 ? "" : "es");
+    }
+    topn = config_int(config, "topn");
+    min_topn = config_int(config, "rtf_topn");
+    if (min_topn > 0 && min_topn < topn)
+        topn -= (topn - min_topn) * level / RTF_LEVELS;
+    ds = config_int(config, "ds");
+    max_ds = config_int(config, "rtf_ds");
+    if (max_ds > ds)
+        ds += (max_ds - ds) * level / RTF_LEVELS;
+    /* The acoustic model tells us what it actually did. */
+    if (mgau_tune(d->acmod->mgau, &topn, &ds) == 0) {
+        if (ds > 0)
+            E_INFO("Adaptive pruning level %d: topn %d ds %d\n",
+                   level, topn, ds);
+        else
+            E_INFO("Adaptive pruning level %d: topn %d"
+                   " (no frame downsampling)\n", level, topn);
+    }
+}
+
+/*
+ * Tighten or relax pruning if the search is slower than, or well
+ * ahead of, the target real-time factor.
+ */
+static void
+decoder_rtf_update(decoder_t *d)
+{
+    double xrt = d->rtf_perf.t_elapsed * config_int(d->config, "frate")
+        / d->rtf_n_frame;
+    int32 level = d->rtf_level;
+
+    if (xrt > d->rtf_target && level < RTF_LEVELS)
+        ++level;
+    /* Leave some margin to avoid oscillating between levels. */
+    else if (xrt < d->rtf_target * 0.5 && level > 0)
+        --level;
+    ptmr_reset(&d->rtf_perf);
+    d->rtf_n_frame = 0;
+    if (level == d->rtf_level)
+        return;
+    d->rtf_level = level;
+    if (level > d->rtf_max_level)
+        d->rtf_max_level = level;
+    ++d->rtf_n_adjust;
+    decoder_rtf_apply(d);
+}
+
+static void
+reset_search_result(search_module_t *search)
+{
+    lattice_free(search->dag);
+    search->dag = NULL;
+    search->last_link = NULL;
+    search->post = 0;
+    ckd_free(search->hyp_str);
+    search->hyp_str = NULL;
+}
+
+static void
+decoder_emit(decoder_t *d, decoder_event_type_t type,
+             const char *hyp, int32 score, int frame)
+{
+    decoder_event_t event;
+
+    event.type = type;
+    event.hyp = hyp;
+    event.score = score;
+    event.frame = frame;
+    event.time = 0.0;
+    (*d->event_cb)(d->event_data, &event);
+}
+
+/* Tell the event callback about newly stable words and whether the
+ * partial hypothesis has changed since the last time. */
+static void
+decoder_emit_partial(decoder_t *d)
+{
+    const char *hyp;
+    int32 score, frame;
+
+    if (d->event_cb == NULL)
+        return;
+    if ((hyp = decoder_stable_hyp(d, &frame)) != NULL)
+        decoder_emit(d, DECODER_EVENT_STABLE, hyp, 0, frame);
+    /* Don't bother tracing back the hypothesis if it ends with the
+     * same word (in the same history) as last time. */
+    if (search_is_fsg(d->search)) {
+        fsg_search_t *fsgs = (fsg_search_t *)d->search;
+        int32 bpidx = fsg_search_hyp_entry(d->search);
+        if (bpidx == d->event_bpidx
+            && fsgs->collect_frame == d->event_collect_frame)
+            return;
+        d->event_bpidx = bpidx;
+        d->event_collect_frame = fsgs->collect_frame;
+    }
+    if ((hyp = decoder_hyp(d, &score)) == NULL)
+        hyp = "";
+    if (0 == strcmp(hyp, d->event_hyp ? d->event_hyp : ""))
+        return;
+    ckd_free(d->event_hyp);
+    d->event_hyp = ckd_salloc(hyp);
+    decoder_emit(d, DECODER_EVENT_PARTIAL, hyp, score,
+                 d->acmod->output_frame);
+}
+
+static void
+decoder_emit_final(decoder_t *d)
+{
+    const char *hyp;
+    int32 score, frame;
+
+    if (d->event_cb == NULL)
+        return;
+    if ((hyp = decoder_stable_hyp(d, &frame)) != NULL)
+        decoder_emit(d, DECODER_EVENT_STABLE, hyp, 0, frame);
+    if ((hyp = decoder_hyp(d, &score)) == NULL)
+        hyp = "";
+    decoder_emit(d, DECODER_EVENT_FINAL, hyp, score,
+                 d->acmod->output_frame);
+}
+
+void
+decoder_set_event_callback(decoder_t *d, decoder_event_cb_t cb,
+                           void *user_data)
+{
+    d->event_cb = cb;
+    d->event_data = user_data;
+}
+
+/* Give other threads a copy of the current result, if requested. */
+static void
+decoder_publish(decoder_t *d, int final)
+{
+    if (d->publish)
+        result_slot_publish(d->results, decoder_result_build(d, final));
+}
+
 int
 decoder_start_utt(decoder_t *d)
 {
+    gnode_t *gn;
     int rv;
     char uttid[16];
 
@@ -911,14 +1226,16 @@ decoder_start_utt(decoder_t *d)
     ++d->uttno;
 
     /* Remove any residual word lattice and hypothesis. */
-    lattice_free(d->search->dag);
-    d->search->dag = NULL;
-    d->search->last_link = NULL;
-    d->search->post = 0;
-    ckd_free(d->search->hyp_str);
-    d->search->hyp_str = NULL;
+    reset_search_result(d->search);
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        reset_search_result((search_module_t *)gnode_ptr(gn));
     ckd_free(d->json_result);
     d->json_result = NULL;
+    ckd_free(d->event_hyp);
+    d->event_hyp = NULL;
+    d->event_bpidx = 0;
+    d->event_collect_frame = -1;
+    d->queue_pos = d->queue_len = 0;
 
     /* Remove any state aligner. */
     if (d->align) {
@@ -928,12 +1245,75 @@ decoder_start_utt(decoder_t *d)
 
     if ((rv = acmod_start_utt(d->acmod)) < 0)
         return rv;
+    /* Continuous decoding cannot keep features for the whole utterance. */
+    acmod_set_grow(d->acmod, config_int(d->config, "rolling") <= 0);
 
-    return search_module_start(d->search);
+    if ((rv = search_module_start(d->search)) < 0)
+        return rv;
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        if ((rv = search_module_start((search_module_t *)gnode_ptr(gn))) < 0)
+            return rv;
+
+    /* Adaptive pruning carries over from the previous utterance, but
+     * the search or acoustic model may have been replaced since. */
+    d->rtf_target = config_float(d->config, "rtf");
+    if (d->rtf_target <= 0 && d->rtf_level > 0) {
+        d->rtf_target = 0;
+        d->rtf_level = 0;
+        decoder_rtf_apply(d);
+    }
+    if (d->rtf_target > 0) {
+        decoder_rtf_apply(d);
+        ptmr_reset(&d->rtf_perf);
+        d->rtf_n_frame = 0;
+        d->rtf_max_level = d->rtf_level;
+        d->rtf_n_adjust = 0;
+    }
+
+    /* Readers can see that a new utterance has started. */
+    d->publish = config_bool(d->config, "publish");
+    decoder_publish(d, FALSE);
+    return 0;
 }
 
+/*
+ * Score the current frame once for all searches, using the union of
+ * their active senones.
+ */
 static int
-search_module_forward(decoder_t *d)
+decoder_score_shared(decoder_t *d)
+{
+    int frame_idx = d->acmod->output_frame;
+    gnode_t *gn;
+
+    if (!d->acmod->compallsen) {
+        acmod_clear_active(d->acmod);
+        search_module_sen_active(d->search);
+        for (gn = d->searches; gn; gn = gnode_next(gn))
+            search_module_sen_active((search_module_t *)gnode_ptr(gn));
+    }
+    if (acmod_score(d->acmod, &frame_idx) == NULL)
+        return -1;
+    acmod_hold_active(d->acmod, TRUE);
+    return 0;
+}
+
+/* Stop a slice timer if it has run for long enough. */
+static int
+slice_expired(ptmr_t *slice, float64 max_time)
+{
+    ptmr_stop(slice);
+    if (slice->t_elapsed >= max_time)
+        return TRUE;
+    ptmr_start(slice);
+    return FALSE;
+}
+
+/* Search up to max_frames (or all, if 0) of the available features,
+ * or until the running slice timer (if any) passes max_time. */
+static int
+search_module_forward_slice(decoder_t *d, int max_frames,
+                            ptmr_t *slice, float64 max_time)
 {
     int nfr;
 
@@ -942,20 +1322,49 @@ search_module_forward(decoder_t *d)
                 "specify a language model or grammar?\n");
         return -1;
     }
+    if (d->rtf_target > 0)
+        ptmr_start(&d->rtf_perf);
     nfr = 0;
-    while (d->acmod->n_feat_frame > 0) {
+    while (d->acmod->n_feat_frame > 0
+           && (max_frames <= 0 || nfr < max_frames)) {
+        gnode_t *gn;
         int k;
+        if (d->searches && (k = decoder_score_shared(d)) < 0)
+            return k;
         if ((k = search_module_step(d->search,
                                     d->acmod->output_frame))
             < 0)
             return k;
+        for (gn = d->searches; gn; gn = gnode_next(gn)) {
+            if ((k = search_module_step((search_module_t *)gnode_ptr(gn),
+                                        d->acmod->output_frame))
+                < 0)
+                return k;
+        }
+        acmod_hold_active(d->acmod, FALSE);
         acmod_advance(d->acmod);
         ++d->n_frame;
         ++nfr;
+        if (slice && slice_expired(slice, max_time))
+            break;
+    }
+    if (d->rtf_target > 0) {
+        ptmr_stop(&d->rtf_perf);
+        d->rtf_n_frame += nfr;
+        if (d->rtf_n_frame >= RTF_WINDOW)
+            decoder_rtf_update(d);
     }
+    if (nfr > 0)
+        decoder_emit_partial(d);
     return nfr;
 }
 
+static int
+search_module_forward(decoder_t *d)
+{
+    return search_module_forward_slice(d, 0, NULL, 0.0);
+}
+
 int
 decoder_process_float32(decoder_t *d,
                         float32 *data,
@@ -989,6 +1398,8 @@ decoder_process_float32(decoder_t *d,
             return nfr;
         n_searchfr += nfr;
     }
+    if (!no_search)
+        decoder_publish(d, FALSE);
 
     return n_searchfr;
 }
@@ -1026,13 +1437,308 @@ decoder_process_int16(decoder_t *d,
             return nfr;
         n_searchfr += nfr;
     }
+    if (!no_search)
+        decoder_publish(d, FALSE);
+
+    return n_searchfr;
+}
+
+static int
+decoder_enqueue(decoder_t *d, const void *data, size_t n_samples,
+                int is_float32)
+{
+    size_t sample_size = is_float32 ? sizeof(float32) : sizeof(int16);
+
+    if (d->acmod->state == ACMOD_IDLE || d->acmod->state == ACMOD_ENDED) {
+        E_ERROR("Failed to queue data, utterance is not started. Use start_utt to start it\n");
+        return -1;
+    }
+    if (d->queue_pos == d->queue_len) {
+        d->queue_pos = d->queue_len = 0;
+        d->queue_float32 = is_float32;
+    }
+    else if (d->queue_float32 != is_float32) {
+        E_ERROR("Cannot queue %s data while %s data is still queued\n",
+                is_float32 ? "float32" : "int16",
+                is_float32 ? "int16" : "float32");
+        return -1;
+    }
+    if (d->queue_len + n_samples > d->queue_alloc && d->queue_pos > 0) {
+        /* Move what is left to the start before growing it. */
+        memmove(d->queue, (char *)d->queue + d->queue_pos * sample_size,
+                (d->queue_len - d->queue_pos) * sample_size);
+        d->queue_len -= d->queue_pos;
+        d->queue_pos = 0;
+    }
+    if (d->queue_len + n_samples > d->queue_alloc) {
+        d->queue_alloc = d->queue_alloc * 2;
+        if (d->queue_alloc < d->queue_len + n_samples)
+            d->queue_alloc = d->queue_len + n_samples;
+        /* Allocated as float32 so either type fits. */
+        d->queue = ckd_realloc(d->queue, d->queue_alloc * sizeof(float32));
+    }
+    memcpy((char *)d->queue + d->queue_len * sample_size,
+           data, n_samples * sample_size);
+    d->queue_len += n_samples;
+    return 0;
+}
+
+int
+decoder_enqueue_int16(decoder_t *d, const int16 *data, size_t n_samples)
+{
+    return decoder_enqueue(d, data, n_samples, FALSE);
+}
+
+int
+decoder_enqueue_float32(decoder_t *d, const float32 *data, size_t n_samples)
+{
+    return decoder_enqueue(d, data, n_samples, TRUE);
+}
+
+/* Compute features from queued audio, about n_frames worth at a time,
+ * until there are some to search or the queue is empty. */
+static int
+decoder_feed(decoder_t *d, int n_frames)
+{
+    int frame_shift, frame_size;
+
+    fe_get_input_size(d->acmod->fe, &frame_shift, &frame_size);
+    while (d->acmod->n_feat_frame == 0 && d->queue_pos < d->queue_len) {
+        size_t n_samples = d->queue_len - d->queue_pos, n_left;
+        int rv;
+
+        if (n_samples > (size_t)n_frames * frame_shift)
+            n_samples = (size_t)n_frames * frame_shift;
+        n_left = n_samples;
+        if (d->queue_float32) {
+            float32 *ptr = (float32 *)d->queue + d->queue_pos;
+            rv = acmod_process_float32(d->acmod, &ptr, &n_left, FALSE);
+        }
+        else {
+            int16 *ptr = (int16 *)d->queue + d->queue_pos;
+            rv = acmod_process_raw(d->acmod, &ptr, &n_left, FALSE);
+        }
+        if (rv < 0)
+            return rv;
+        d->queue_pos += n_samples - n_left;
+        if (n_left == n_samples)
+            break;
+    }
+    return 0;
+}
+
+/* Decode everything left in the queue. */
+static int
+decoder_drain(decoder_t *d)
+{
+    size_t n_samples = d->queue_len - d->queue_pos;
+    int rv;
+
+    if (n_samples == 0)
+        return 0;
+    if (d->queue_float32)
+        rv = decoder_process_float32(d, (float32 *)d->queue + d->queue_pos,
+                                     n_samples, FALSE, FALSE);
+    else
+        rv = decoder_process_int16(d, (int16 *)d->queue + d->queue_pos,
+                                   n_samples, FALSE, FALSE);
+    d->queue_pos = d->queue_len = 0;
+    return rv;
+}
+
+#define STEP_FEED_FRAMES 32 /**< Frames to feed at a time with no limit. */
+
+int
+decoder_step(decoder_t *d, int max_frames, int max_usec)
+{
+    ptmr_t slice;
+    float64 max_time = max_usec / 1e6;
+    int n_searchfr = 0;
+
+    if (d->acmod->state == ACMOD_IDLE) {
+        E_ERROR("Failed to process data, utterance is not started. Use start_utt to start it\n");
+        return -1;
+    }
+    if (max_usec > 0) {
+        ptmr_init(&slice);
+        ptmr_start(&slice);
+    }
+    while (max_frames <= 0 || n_searchfr < max_frames) {
+        int nfr, n_left = max_frames > 0 ? max_frames - n_searchfr : 0;
 
+        if ((nfr = decoder_feed(d, n_left ? n_left : STEP_FEED_FRAMES)) < 0)
+            return nfr;
+        if (d->acmod->n_feat_frame == 0)
+            break;
+        if ((nfr = search_module_forward_slice(d, n_left,
+                                               max_usec > 0 ? &slice : NULL,
+                                               max_time))
+            < 0)
+            return nfr;
+        n_searchfr += nfr;
+        if (max_usec > 0 && slice.t_elapsed >= max_time)
+            break;
+    }
+    if (n_searchfr > 0)
+        decoder_publish(d, FALSE);
     return n_searchfr;
 }
 
+static int
+process_archive_senscr(decoder_t *d, feat_archive_t *fa, int32 utt)
+{
+    int32 n_frames = feat_archive_n_frames(fa, utt);
+    int nfr;
+
+    if (feat_archive_n_sen(fa) != bin_mdef_n_sen(d->acmod->mdef)) {
+        E_ERROR("Archive has scores for %d senones, expected %d\n",
+                feat_archive_n_sen(fa), bin_mdef_n_sen(d->acmod->mdef));
+        return -1;
+    }
+    if (n_frames == 0)
+        return 0;
+    if (acmod_set_insen(d->acmod, feat_archive_senscr(fa, utt, 0), n_frames) < 0)
+        return -1;
+    if ((nfr = search_module_forward(d)) < 0)
+        return nfr;
+    decoder_publish(d, FALSE);
+    return nfr;
+}
+
+int
+decoder_process_archive(decoder_t *d, feat_archive_t *fa, int32 utt)
+{
+    mfcc_t **streams;
+    int32 i, j, n_frames;
+    int n_searchfr = 0;
+
+    if (d->acmod->state == ACMOD_IDLE || d->acmod->state == ACMOD_ENDED) {
+        E_ERROR("Failed to process data, utterance is not started. Use start_utt to start it\n");
+        return -1;
+    }
+    if ((n_frames = feat_archive_n_frames(fa, utt)) < 0) {
+        E_ERROR("No utterance %d in feature archive\n", utt);
+        return -1;
+    }
+    if (feat_archive_type(fa) == FEAT_ARCHIVE_SENSCR)
+        return process_archive_senscr(d, fa, utt);
+    if (feat_archive_mismatch(fa, d->acmod->fcb))
+        return -1;
+
+    /* Point the streams into the archive, acmod copies them into the
+     * feature buffer. */
+    streams = ckd_calloc(feat_dimension1(d->acmod->fcb), sizeof(*streams));
+    for (i = 0; i < n_frames; ++i) {
+        /* Mapped read-only, but acmod_process_feat() does not write it. */
+        mfcc_t *frame = (mfcc_t *)feat_archive_frame(fa, utt, i);
+        for (j = 0; j < feat_dimension1(d->acmod->fcb); ++j) {
+            streams[j] = frame;
+            frame += feat_dimension2(d->acmod->fcb, j);
+        }
+        /* Search whenever the feature buffer is full. */
+        while (acmod_process_feat(d->acmod, streams) == 0) {
+            int nfr;
+            if ((nfr = search_module_forward(d)) < 0) {
+                ckd_free(streams);
+                return nfr;
+            }
+            n_searchfr += nfr;
+        }
+    }
+    ckd_free(streams);
+    if ((i = search_module_forward(d)) < 0)
+        return i;
+    decoder_publish(d, FALSE);
+
+    return n_searchfr + i;
+}
+
+/* Write all the frames of senone scores in the feature buffer. */
+static int
+archive_senscr(acmod_t *acmod, feat_archive_writer_t *w, const char *uttid)
+{
+    int compallsen = acmod->compallsen;
+    int nfr = 0;
+
+    if (feat_archive_writer_start(w, uttid) < 0)
+        return -1;
+    acmod->compallsen = TRUE;
+    while (acmod->n_feat_frame > 0) {
+        int16 const *senscr;
+        if ((senscr = acmod_score(acmod, NULL)) == NULL
+            || feat_archive_writer_add_senscr(w, senscr) < 0) {
+            nfr = -1;
+            break;
+        }
+        acmod_advance(acmod);
+        ++nfr;
+    }
+    acmod->compallsen = compallsen;
+    return nfr;
+}
+
+static int
+archive_int16(decoder_t *d,
+              feat_archive_writer_t *w,
+              const char *uttid,
+              int16 *data,
+              size_t n_samples,
+              int senscr)
+{
+    acmod_t *acmod = d->acmod;
+    int nfr, grow;
+
+    if (acmod->state == ACMOD_STARTED || acmod->state == ACMOD_PROCESSING) {
+        E_ERROR("Cannot archive features during an utterance\n");
+        return -1;
+    }
+    acmod_start_utt(acmod);
+    grow = acmod_set_grow(acmod, TRUE);
+    /* Full utterance processing leaves all the features in the buffer
+     * starting at index 0. */
+    if ((nfr = acmod_process_raw(acmod, &data, &n_samples, TRUE)) >= 0) {
+        assert(acmod->feat_outidx == 0);
+        if (senscr)
+            nfr = archive_senscr(acmod, w, uttid);
+        else if (feat_archive_writer_add(w, uttid, acmod->feat_buf,
+                                         acmod->n_feat_frame)
+                 < 0)
+            nfr = -1;
+        else
+            nfr = acmod->n_feat_frame;
+    }
+    /* There is nothing left to search, so skip acmod_end_utt(). */
+    acmod->n_feat_frame = 0;
+    acmod->state = ACMOD_IDLE;
+    acmod_set_grow(acmod, grow);
+
+    return nfr;
+}
+
+int
+decoder_archive_int16(decoder_t *d,
+                      feat_archive_writer_t *w,
+                      const char *uttid,
+                      int16 *data,
+                      size_t n_samples)
+{
+    return archive_int16(d, w, uttid, data, n_samples, FALSE);
+}
+
+int
+decoder_archive_senscr_int16(decoder_t *d,
+                             feat_archive_writer_t *w,
+                             const char *uttid,
+                             int16 *data,
+                             size_t n_samples)
+{
+    return archive_int16(d, w, uttid, data, n_samples, TRUE);
+}
+
 int
 decoder_end_utt(decoder_t *d)
 {
+    gnode_t *gn;
     int rv = 0;
 
     if (d->search == NULL) {
@@ -1044,6 +1750,11 @@ decoder_end_utt(decoder_t *d)
         E_ERROR("Utterance is not started\n");
         return -1;
     }
+    /* Decode any queued audio. */
+    if ((rv = decoder_drain(d)) < 0) {
+        ptmr_stop(&d->perf);
+        return rv;
+    }
     acmod_end_utt(d->acmod);
 
     /* Search any remaining frames. */
@@ -1056,7 +1767,17 @@ decoder_end_utt(decoder_t *d)
         ptmr_stop(&d->perf);
         return rv;
     }
+    /* And any others. */
+    for (gn = d->searches; gn; gn = gnode_next(gn)) {
+        if ((rv = search_module_finish((search_module_t *)gnode_ptr(gn))) < 0) {
+            ptmr_stop(&d->perf);
+            return rv;
+        }
+    }
     ptmr_stop(&d->perf);
+    if (d->rtf_target > 0)
+        E_INFO("Adaptive pruning: %d adjustments, level %d (highest %d) of %d\n",
+               d->rtf_n_adjust, d->rtf_level, d->rtf_max_level, RTF_LEVELS);
     /* Log a backtrace if requested. */
     if (config_bool(d->config, "backtrace")) {
         const char *hyp;
@@ -1084,9 +1805,238 @@ decoder_end_utt(decoder_t *d)
             }
         }
     }
+    decoder_emit_final(d);
+    decoder_publish(d, TRUE);
+    return rv;
+}
+
+int
+decoder_rewind(decoder_t *d)
+{
+    gnode_t *gn;
+    frame_idx_t n_searched;
+    int ended, nfr, rv;
+
+    if (d->search == NULL) {
+        E_ERROR("No search module is selected, did you forget to "
+                "specify a language model or grammar?\n");
+        return -1;
+    }
+    if (d->acmod->state == ACMOD_IDLE) {
+        E_ERROR("No utterance to rewind\n");
+        return -1;
+    }
+    ended = (d->acmod->state == ACMOD_ENDED);
+    n_searched = d->acmod->output_frame;
+    if ((rv = acmod_rewind(d->acmod)) < 0)
+        return rv;
+    if (ended)
+        ptmr_start(&d->perf);
+
+    /* Results and alignment from the previous search are now stale. */
+    reset_search_result(d->search);
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        reset_search_result((search_module_t *)gnode_ptr(gn));
+    ckd_free(d->json_result);
+    d->json_result = NULL;
+    ckd_free(d->event_hyp);
+    d->event_hyp = NULL;
+    d->event_bpidx = 0;
+    d->event_collect_frame = -1;
+    if (d->align) {
+        search_module_free(d->align);
+        d->align = NULL;
+    }
+
+    /* A search still in progress has to be finished (which
+     * deactivates everything in it) before it can start again. */
+    if (!ended) {
+        if ((rv = search_module_finish(d->search)) < 0)
+            goto error_out;
+        for (gn = d->searches; gn; gn = gnode_next(gn))
+            if ((rv = search_module_finish((search_module_t *)gnode_ptr(gn))) < 0)
+                goto error_out;
+    }
+    if ((rv = search_module_start(d->search)) < 0)
+        goto error_out;
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        if ((rv = search_module_start((search_module_t *)gnode_ptr(gn))) < 0)
+            goto error_out;
+    if ((nfr = rv = search_module_forward(d)) < 0)
+        goto error_out;
+    /* Count only new frames in the total amount of speech. */
+    d->n_frame -= n_searched;
+    if (ended) {
+        if ((rv = search_module_finish(d->search)) < 0)
+            goto error_out;
+        for (gn = d->searches; gn; gn = gnode_next(gn))
+            if ((rv = search_module_finish((search_module_t *)gnode_ptr(gn))) < 0)
+                goto error_out;
+        ptmr_stop(&d->perf);
+        decoder_emit_final(d);
+    }
+    decoder_publish(d, ended);
+    return nfr;
+
+error_out:
+    if (ended)
+        ptmr_stop(&d->perf);
     return rv;
 }
 
+#define SNAPSHOT_MAGIC "SSDS"
+#define SNAPSHOT_BYTEORDER 0x11223344
+#define SNAPSHOT_VERSION 1
+/* Fixed and floating-point features are the same size, but not
+ * interchangeable. */
+#ifdef FIXED_POINT
+#define SNAPSHOT_MFCC_TYPE (0x100 | DEFAULT_RADIX)
+#else
+#define SNAPSHOT_MFCC_TYPE sizeof(mfcc_t)
+#endif
+
+static int
+search_snapshot_save(search_module_t *search, snapshot_t *s)
+{
+    if (search->vt->snapshot_save == NULL) {
+        E_ERROR("%s search does not support snapshots\n",
+                search_module_type(search));
+        return -1;
+    }
+    return search_module_snapshot_save(search, s);
+}
+
+uint8 *
+decoder_snapshot(decoder_t *d, size_t *out_size)
+{
+    snapshot_t *s;
+    gnode_t *gn;
+
+    if (d->search == NULL) {
+        E_ERROR("No search module is selected, did you forget to "
+                "specify a language model or grammar?\n");
+        return NULL;
+    }
+    s = snapshot_init();
+    snapshot_write(s, SNAPSHOT_MAGIC, 4);
+    snapshot_write_int32(s, SNAPSHOT_BYTEORDER);
+    snapshot_write_int32(s, SNAPSHOT_VERSION);
+    snapshot_write_int32(s, SNAPSHOT_MFCC_TYPE);
+    snapshot_write_int32(s, bin_mdef_n_sen(d->acmod->mdef));
+    snapshot_write_int32(s, d->rtf_level);
+    snapshot_write_int32(s, d->rtf_max_level);
+    snapshot_write_int32(s, d->rtf_n_adjust);
+    if (acmod_snapshot_save(d->acmod, s) < 0)
+        goto error_out;
+    if (search_snapshot_save(d->search, s) < 0)
+        goto error_out;
+    snapshot_write_int32(s, glist_count(d->searches));
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        if (search_snapshot_save((search_module_t *)gnode_ptr(gn), s) < 0)
+            goto error_out;
+    return snapshot_detach(s, out_size);
+error_out:
+    snapshot_free(s);
+    return NULL;
+}
+
+static int
+search_snapshot_load(search_module_t *search, snapshot_t *s)
+{
+    if (search->vt->snapshot_load == NULL) {
+        E_ERROR("%s search does not support snapshots\n",
+                search_module_type(search));
+        return -1;
+    }
+    return search_module_snapshot_load(search, s);
+}
+
+static int
+restore_utt(decoder_t *d, snapshot_t *s)
+{
+    char magic[4];
+    gnode_t *gn;
+    int32 rtf_level;
+
+    snapshot_read(s, magic, 4);
+    if (memcmp(magic, SNAPSHOT_MAGIC, 4) != 0
+        || snapshot_read_int32(s) != SNAPSHOT_BYTEORDER) {
+        E_ERROR("Not a snapshot, or saved with different byte order\n");
+        return -1;
+    }
+    if (snapshot_read_int32(s) != SNAPSHOT_VERSION) {
+        E_ERROR("Unsupported snapshot version\n");
+        return -1;
+    }
+    if (snapshot_read_int32(s) != SNAPSHOT_MFCC_TYPE
+        || snapshot_read_int32(s) != bin_mdef_n_sen(d->acmod->mdef)) {
+        E_ERROR("Snapshot was taken with a different acoustic model\n");
+        return -1;
+    }
+    rtf_level = snapshot_read_int32(s);
+    d->rtf_max_level = snapshot_read_int32(s);
+    d->rtf_n_adjust = snapshot_read_int32(s);
+    if (rtf_level < 0 || rtf_level > RTF_LEVELS) {
+        E_ERROR("Invalid adaptive pruning level %d in snapshot\n", rtf_level);
+        return -1;
+    }
+    if (d->rtf_target > 0 && rtf_level != d->rtf_level) {
+        d->rtf_level = rtf_level;
+        decoder_rtf_apply(d);
+    }
+    if (acmod_snapshot_load(d->acmod, s) < 0)
+        return -1;
+    if (search_snapshot_load(d->search, s) < 0)
+        return -1;
+    if (snapshot_read_int32(s) != glist_count(d->searches)) {
+        E_ERROR("Snapshot has a different number of searches\n");
+        return -1;
+    }
+    for (gn = d->searches; gn; gn = gnode_next(gn))
+        if (search_snapshot_load((search_module_t *)gnode_ptr(gn), s) < 0)
+            return -1;
+    if (s->error)
+        return -1;
+    if (s->pos != s->len) {
+        E_ERROR("Extra data at end of snapshot\n");
+        return -1;
+    }
+    return 0;
+}
+
+int
+decoder_restore(decoder_t *d, const uint8 *data, size_t size)
+{
+    snapshot_t *s;
+    gnode_t *gn;
+    int rv;
+
+    if (d->acmod->state == ACMOD_STARTED || d->acmod->state == ACMOD_PROCESSING) {
+        if ((rv = decoder_end_utt(d)) < 0)
+            return rv;
+    }
+    if ((rv = decoder_start_utt(d)) < 0)
+        return rv;
+    s = snapshot_init_data(data, size);
+    rv = restore_utt(d, s);
+    snapshot_free(s);
+    if (rv < 0) {
+        /* Abandon the utterance without searching anything. */
+        search_module_finish(d->search);
+        for (gn = d->searches; gn; gn = gnode_next(gn))
+            search_module_finish((search_module_t *)gnode_ptr(gn));
+        d->acmod->state = ACMOD_ENDED;
+    } else
+        decoder_publish(d, FALSE);
+    return rv;
+}
+
+decoder_result_t *
+decoder_result(decoder_t *d)
+{
+    return result_slot_get(d->results);
+}
+
 const char *
 decoder_hyp(decoder_t *d, int32 *out_best_score)
 {
@@ -1103,6 +2053,17 @@ decoder_hyp(decoder_t *d, int32 *out_best_score)
     return hyp;
 }
 
+const char *
+decoder_stable_hyp(decoder_t *d, int32 *out_frame)
+{
+    if (out_frame)
+        *out_frame = -1;
+    if (d->search == NULL
+        || 0 != strcmp(search_module_type(d->search), PS_SEARCH_TYPE_FSG))
+        return NULL;
+    return fsg_search_stable_hyp(d->search, out_frame);
+}
+
 int32
 decoder_prob(decoder_t *d)
 {
@@ -0,0 +1,282 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file decoder_result.c
+ * @brief Recognition results published for other threads.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+#include <soundswallower/decoder_result.h>
+#include <soundswallower/glist.h>
+
+#ifdef HAVE_STDATOMIC_H
+#include <stdatomic.h>
+#define ATOMIC(t) _Atomic(t)
+#define atomic_init_(p, v) atomic_init(p, v)
+#define atomic_inc(p) atomic_fetch_add(p, 1)
+#define atomic_dec(p) atomic_fetch_sub(p, 1)
+#define atomic_get(p) atomic_load(p)
+#define atomic_swap(p, v) atomic_exchange(p, v)
+#else
+/* Without C11 atomics, results can still be obtained safely by the
+ * decoding thread itself, but not from any others. */
+#define ATOMIC(t) t
+#define atomic_init_(p, v) (*(p) = (v))
+#define atomic_inc(p) ((*(p))++)
+#define atomic_dec(p) ((*(p))--)
+#define atomic_get(p) (*(p))
+static void *
+atomic_swap_(void **p, void *v)
+{
+    void *old = *p;
+    *p = v;
+    return old;
+}
+#define atomic_swap(p, v) atomic_swap_((void **)(p), v)
+#endif
+
+struct decoder_result_s {
+    ATOMIC(int) refcount;
+    int uttno;
+    int n_frames;
+    int final;
+    int32 score;
+    int32 prob;
+    int n_seg;
+    decoder_seg_t *seg;
+    char *hyp;
+    /* Followed by the segments and then all of the strings, so that
+     * the whole thing is one allocation. */
+};
+
+struct result_slot_s {
+    ATOMIC(decoder_result_t *) current;
+    ATOMIC(int) n_readers; /**< Threads in result_slot_get() */
+    glist_t retired; /**< Replaced results which a reader may still
+                        be about to retain (decoding thread only) */
+};
+
+decoder_result_t *
+decoder_result_retain(decoder_result_t *r)
+{
+    if (r == NULL)
+        return NULL;
+    atomic_inc(&r->refcount);
+    return r;
+}
+
+int
+decoder_result_free(decoder_result_t *r)
+{
+    int refcount;
+
+    if (r == NULL)
+        return 0;
+    refcount = atomic_dec(&r->refcount) - 1;
+    if (refcount > 0)
+        return refcount;
+    ckd_free(r);
+    return 0;
+}
+
+const char *
+decoder_result_hyp(decoder_result_t *r, int32 *out_best_score)
+{
+    if (out_best_score)
+        *out_best_score = r->score;
+    return r->hyp;
+}
+
+int32
+decoder_result_prob(decoder_result_t *r)
+{
+    return r->prob;
+}
+
+const decoder_seg_t *
+decoder_result_seg(decoder_result_t *r, int *out_n_seg)
+{
+    *out_n_seg = r->n_seg;
+    return r->seg;
+}
+
+int
+decoder_result_n_frames(decoder_result_t *r)
+{
+    return r->n_frames;
+}
+
+int
+decoder_result_uttno(decoder_result_t *r)
+{
+    return r->uttno;
+}
+
+int
+decoder_result_final(decoder_result_t *r)
+{
+    return r->final;
+}
+
+decoder_result_t *
+decoder_result_build(decoder_t *d, int final)
+{
+    decoder_result_t *r;
+    decoder_seg_t *segs;
+    seg_iter_t *itor;
+    const char *hyp;
+    char *words, *outptr;
+    size_t hyp_len, words_len, words_alloc, *word_off;
+    int32 score;
+    int n_seg, n_alloc, i;
+
+    if (d->search == NULL)
+        return NULL;
+    if ((hyp = decoder_hyp(d, &score)) == NULL) {
+        hyp = "";
+        score = 0;
+    }
+    hyp_len = strlen(hyp) + 1;
+
+    /* Segment words are only valid until the next one, so gather them
+     * up before we know how much space they need. */
+    n_seg = n_alloc = 0;
+    segs = NULL;
+    word_off = NULL;
+    words_len = words_alloc = 0;
+    words = NULL;
+    for (itor = decoder_seg_iter(d); itor; itor = seg_iter_next(itor)) {
+        size_t len = strlen(seg_iter_word(itor)) + 1;
+        if (n_seg == n_alloc) {
+            n_alloc = n_alloc ? n_alloc * 2 : 16;
+            segs = ckd_realloc(segs, n_alloc * sizeof(*segs));
+            word_off = ckd_realloc(word_off, n_alloc * sizeof(*word_off));
+        }
+        if (words_len + len > words_alloc) {
+            words_alloc = (words_len + len) * 2;
+            words = ckd_realloc(words, words_alloc);
+        }
+        memcpy(words + words_len, seg_iter_word(itor), len);
+        seg_iter_frames(itor, &segs[n_seg].sf, &segs[n_seg].ef);
+        segs[n_seg].prob = seg_iter_prob(itor, &segs[n_seg].ascr,
+                                         &segs[n_seg].lscr);
+        word_off[n_seg] = words_len;
+        words_len += len;
+        ++n_seg;
+    }
+
+    r = ckd_malloc(sizeof(*r) + n_seg * sizeof(*segs)
+                   + hyp_len + words_len);
+    atomic_init_(&r->refcount, 1);
+    r->uttno = d->uttno - 1;
+    r->n_frames = d->acmod->output_frame;
+    r->final = final;
+    r->score = score;
+    r->prob = final ? decoder_prob(d) : 0;
+    r->n_seg = n_seg;
+    r->seg = (decoder_seg_t *)(r + 1);
+    outptr = (char *)(r->seg + n_seg);
+    r->hyp = outptr;
+    memcpy(outptr, hyp, hyp_len);
+    outptr += hyp_len;
+    if (words_len)
+        memcpy(outptr, words, words_len);
+    for (i = 0; i < n_seg; ++i) {
+        r->seg[i] = segs[i];
+        r->seg[i].word = outptr + word_off[i];
+    }
+    ckd_free(segs);
+    ckd_free(word_off);
+    ckd_free(words);
+    return r;
+}
+
+result_slot_t *
+result_slot_init(void)
+{
+    result_slot_t *slot = ckd_calloc(1, sizeof(*slot));
+    atomic_init_(&slot->current, NULL);
+    atomic_init_(&slot->n_readers, 0);
+    return slot;
+}
+
+static void
+result_slot_reclaim(result_slot_t *slot)
+{
+    gnode_t *gn;
+
+    for (gn = slot->retired; gn; gn = gnode_next(gn))
+        decoder_result_free((decoder_result_t *)gnode_ptr(gn));
+    glist_free(slot->retired);
+    slot->retired = NULL;
+}
+
+void
+result_slot_free(result_slot_t *slot)
+{
+    if (slot == NULL)
+        return;
+    decoder_result_free(atomic_swap(&slot->current, NULL));
+    result_slot_reclaim(slot);
+    ckd_free(slot);
+}
+
+void
+result_slot_publish(result_slot_t *slot, decoder_result_t *r)
+{
+    decoder_result_t *old;
+
+    if (r == NULL)
+        return;
+    old = atomic_swap(&slot->current, r);
+    if (old)
+        slot->retired = glist_add_ptr(slot->retired, old);
+    /* Once no reader is in result_slot_get(), none of them can still
+     * be about to retain a result that is no longer current.  If
+     * there is one, try again next time. */
+    if (atomic_get(&slot->n_readers) == 0)
+        result_slot_reclaim(slot);
+}
+
+decoder_result_t *
+result_slot_get(result_slot_t *slot)
+{
+    decoder_result_t *r;
+
+    atomic_inc(&slot->n_readers);
+    r = decoder_result_retain(atomic_get(&slot->current));
+    atomic_dec(&slot->n_readers);
+    return r;
+}
@@ -359,6 +359,48 @@ fe_start(fe_t *fe)
     return 0;
 }
 
+void
+fe_snapshot_save(fe_t *fe, snapshot_t *s)
+{
+    snapshot_write_int32(s, fe->frame_size);
+    snapshot_write_int32(s, fe->num_overflow_samps);
+    snapshot_write(s, fe->overflow_samps,
+                   fe->num_overflow_samps * sizeof(*fe->overflow_samps));
+    snapshot_write(s, &fe->pre_emphasis_prior, sizeof(fe->pre_emphasis_prior));
+    snapshot_write_int32(s, fe->noise_stats != NULL);
+    if (fe->noise_stats)
+        fe_noisestats_snapshot_save(fe->noise_stats, s);
+}
+
+int
+fe_snapshot_load(fe_t *fe, snapshot_t *s)
+{
+    int num_overflow_samps;
+
+    if (snapshot_read_int32(s) != fe->frame_size) {
+        E_ERROR("Snapshot has a different frame size\n");
+        return -1;
+    }
+    num_overflow_samps = snapshot_read_int32(s);
+    if (num_overflow_samps < 0 || num_overflow_samps > fe->frame_size) {
+        E_ERROR("Invalid number of overflow samples %d in snapshot\n",
+                num_overflow_samps);
+        return -1;
+    }
+    fe->num_overflow_samps = num_overflow_samps;
+    snapshot_read(s, fe->overflow_samps,
+                  num_overflow_samps * sizeof(*fe->overflow_samps));
+    snapshot_read(s, &fe->pre_emphasis_prior, sizeof(fe->pre_emphasis_prior));
+    if (snapshot_read_int32(s) != (fe->noise_stats != NULL)) {
+        E_ERROR("Snapshot noise removal setting does not match\n");
+        return -1;
+    }
+    if (fe->noise_stats
+        && fe_noisestats_snapshot_load(fe->noise_stats, s) < 0)
+        return -1;
+    return s->error ? -1 : 0;
+}
+
 int
 fe_get_output_size(fe_t *fe)
 {
@@ -258,6 +258,40 @@ fe_free_noisestats(noise_stats_t *noise_stats)
     ckd_free(noise_stats);
 }
 
+void
+fe_noisestats_snapshot_save(noise_stats_t *noise_stats, snapshot_t *s)
+{
+    size_t size = noise_stats->num_filters * sizeof(powspec_t);
+
+    snapshot_write_int32(s, noise_stats->num_filters);
+    snapshot_write_int32(s, noise_stats->undefined);
+    snapshot_write(s, noise_stats->power, size);
+    snapshot_write(s, noise_stats->noise, size);
+    snapshot_write(s, noise_stats->floor, size);
+    snapshot_write(s, noise_stats->peak, size);
+    snapshot_write(s, &noise_stats->slow_peak_sum,
+                   sizeof(noise_stats->slow_peak_sum));
+}
+
+int
+fe_noisestats_snapshot_load(noise_stats_t *noise_stats, snapshot_t *s)
+{
+    size_t size = noise_stats->num_filters * sizeof(powspec_t);
+
+    if (snapshot_read_int32(s) != noise_stats->num_filters) {
+        E_ERROR("Snapshot has a different number of noise filters\n");
+        return -1;
+    }
+    noise_stats->undefined = snapshot_read_int32(s);
+    snapshot_read(s, noise_stats->power, size);
+    snapshot_read(s, noise_stats->noise, size);
+    snapshot_read(s, noise_stats->floor, size);
+    snapshot_read(s, noise_stats->peak, size);
+    snapshot_read(s, &noise_stats->slow_peak_sum,
+                  sizeof(noise_stats->slow_peak_sum));
+    return s->error ? -1 : 0;
+}
+
 /**
  * For fixed point we are doing the computation in a fixlog domain,
  * so we have to add many processing cases.
@@ -277,19 +311,30 @@ fe_remove_noise(fe_t *fe)
     num_filts = noise_stats->num_filters;
 
     if (noise_stats->undefined) {
-        noise_stats->slow_peak_sum = 0.0;
+        noise_stats->slow_peak_sum = 0;
         for (i = 0; i < num_filts; i++) {
             noise_stats->power[i] = mfspec[i];
+#ifndef FIXED_POINT
             noise_stats->noise[i] = mfspec[i] / noise_stats->max_gain;
             noise_stats->floor[i] = mfspec[i] / noise_stats->max_gain;
             noise_stats->peak[i] = 0.0;
+#else
+            noise_stats->noise[i] = mfspec[i] - noise_stats->max_gain;
+            noise_stats->floor[i] = mfspec[i] - noise_stats->max_gain;
+            noise_stats->peak[i] = MIN_FIXLOG;
+#endif
         }
         noise_stats->undefined = FALSE;
     }
 
     /* Calculate smoothed power */
     for (i = 0; i < num_filts; i++) {
+#ifndef FIXED_POINT
         noise_stats->power[i] = noise_stats->lambda_power * noise_stats->power[i] + noise_stats->comp_lambda_power * mfspec[i];
+#else
+        noise_stats->power[i] = fe_log_add(noise_stats->lambda_power + noise_stats->power[i],
+                                           noise_stats->comp_lambda_power + mfspec[i]);
+#endif
     }
 
     /* Update noise spectrum estimate */
@@ -297,9 +342,16 @@ fe_remove_noise(fe_t *fe)
 
     /* Drop out noise from signal */
     for (i = 0; i < num_filts; i++) {
+#ifndef FIXED_POINT
         noise_stats->signal[i] = noise_stats->power[i] - noise_stats->noise[i];
         if (noise_stats->signal[i] < 1.0)
             noise_stats->signal[i] = 1.0;
+#else
+        noise_stats->signal[i] = fe_log_sub(noise_stats->power[i],
+                                            noise_stats->noise[i]);
+        if (noise_stats->signal[i] < 0)
+            noise_stats->signal[i] = 0;
+#endif
     }
 
     /* FIXME: Somewhat unclear why we have to do this twice, but this
@@ -314,10 +366,17 @@ fe_remove_noise(fe_t *fe)
     }
 
     for (i = 0; i < num_filts; i++) {
+#ifndef FIXED_POINT
         if (noise_stats->signal[i] < noise_stats->max_gain * noise_stats->power[i])
             noise_stats->gain[i] = noise_stats->signal[i] / noise_stats->power[i];
         else
             noise_stats->gain[i] = noise_stats->max_gain;
+#else
+        if (noise_stats->signal[i] < noise_stats->max_gain + noise_stats->power[i])
+            noise_stats->gain[i] = noise_stats->signal[i] - noise_stats->power[i];
+        else
+            noise_stats->gain[i] = noise_stats->max_gain;
+#endif
         if (noise_stats->gain[i] < noise_stats->inv_max_gain)
             noise_stats->gain[i] = noise_stats->inv_max_gain;
     }
@@ -64,8 +64,226 @@
 
 /* Use extra precision for cosines, Hamming window, pre-emphasis
  * coefficient, twiddle factors. */
+#ifdef FIXED_POINT
+#define COS_BITS 30
+#define FLOAT2COS(x) FLOAT2FIX_ANY(x, COS_BITS)
+#define COSMUL(x, y) FIXMUL_ANY(x, y, COS_BITS)
+#define COS_SQRT_HALF FLOAT2COS(0.707106781186548)
+#else
 #define FLOAT2COS(x) (x)
 #define COSMUL(x, y) ((x) * (y))
+#define COS_SQRT_HALF SQRT_HALF
+#endif
+
+#ifdef FIXED_POINT
+/* ln(1 + e^-x) for x = k / 64, with DEFAULT_RADIX fractional bits. */
+static const uint16 fe_logadd_table[577] = {
+    2839, 2807, 2776, 2744, 2713, 2682, 2652, 2621,
+    2591, 2561, 2532, 2502, 2473, 2444, 2416, 2387,
+    2359, 2331, 2303, 2276, 2249, 2222, 2195, 2169,
+    2143, 2117, 2091, 2066, 2040, 2015, 1991, 1966,
+    1942, 1918, 1894, 1870, 1847, 1824, 1801, 1778,
+    1756, 1734, 1712, 1690, 1669, 1647, 1626, 1605,
+    1585, 1564, 1544, 1524, 1504, 1485, 1465, 1446,
+    1427, 1409, 1390, 1372, 1354, 1336, 1318, 1300,
+    1283, 1266, 1249, 1232, 1216, 1199, 1183, 1167,
+    1152, 1136, 1121, 1105, 1090, 1075, 1061, 1046,
+    1032, 1018, 1004, 990, 976, 963, 949, 936,
+    923, 910, 898, 885, 873, 861, 849, 837,
+    825, 813, 802, 791, 779, 768, 758, 747,
+    736, 726, 715, 705, 695, 685, 675, 666,
+    656, 647, 638, 628, 619, 610, 602, 593,
+    584, 576, 568, 559, 551, 543, 535, 528,
+    520, 512, 505, 497, 490, 483, 476, 469,
+    462, 455, 449, 442, 436, 429, 423, 417,
+    410, 404, 398, 393, 387, 381, 375, 370,
+    364, 359, 354, 348, 343, 338, 333, 328,
+    323, 318, 314, 309, 304, 300, 295, 291,
+    286, 282, 278, 274, 270, 266, 262, 258,
+    254, 250, 246, 243, 239, 235, 232, 228,
+    225, 221, 218, 215, 212, 208, 205, 202,
+    199, 196, 193, 190, 187, 184, 182, 179,
+    176, 173, 171, 168, 166, 163, 161, 158,
+    156, 153, 151, 149, 147, 144, 142, 140,
+    138, 136, 134, 132, 130, 128, 126, 124,
+    122, 120, 118, 116, 115, 113, 111, 109,
+    108, 106, 104, 103, 101, 100, 98, 97,
+    95, 94, 92, 91, 90, 88, 87, 85,
+    84, 83, 82, 80, 79, 78, 77, 76,
+    74, 73, 72, 71, 70, 69, 68, 67,
+    66, 65, 64, 63, 62, 61, 60, 59,
+    58, 57, 56, 55, 55, 54, 53, 52,
+    51, 50, 50, 49, 48, 47, 47, 46,
+    45, 45, 44, 43, 43, 42, 41, 41,
+    40, 39, 39, 38, 38, 37, 36, 36,
+    35, 35, 34, 34, 33, 33, 32, 32,
+    31, 31, 30, 30, 29, 29, 28, 28,
+    28, 27, 27, 26, 26, 25, 25, 25,
+    24, 24, 24, 23, 23, 22, 22, 22,
+    21, 21, 21, 20, 20, 20, 20, 19,
+    19, 19, 18, 18, 18, 18, 17, 17,
+    17, 16, 16, 16, 16, 15, 15, 15,
+    15, 15, 14, 14, 14, 14, 13, 13,
+    13, 13, 13, 12, 12, 12, 12, 12,
+    11, 11, 11, 11, 11, 11, 10, 10,
+    10, 10, 10, 10, 10, 9, 9, 9,
+    9, 9, 9, 9, 8, 8, 8, 8,
+    8, 8, 8, 8, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6,
+    5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1,
+};
+
+/* -ln(1 - e^-x) for x = 1 + k / 64, with DEFAULT_RADIX fractional
+ * bits. */
+static const uint16 fe_logsub_table[513] = {
+    1879, 1842, 1806, 1771, 1737, 1703, 1671, 1639,
+    1608, 1577, 1548, 1519, 1490, 1462, 1435, 1409,
+    1383, 1357, 1332, 1308, 1284, 1261, 1238, 1216,
+    1194, 1172, 1151, 1131, 1111, 1091, 1072, 1053,
+    1034, 1016, 998, 981, 964, 947, 930, 914,
+    898, 883, 867, 852, 838, 823, 809, 795,
+    782, 769, 755, 743, 730, 718, 705, 694,
+    682, 670, 659, 648, 637, 626, 616, 606,
+    596, 586, 576, 566, 557, 548, 539, 530,
+    521, 512, 504, 496, 487, 479, 472, 464,
+    456, 449, 441, 434, 427, 420, 413, 407,
+    400, 393, 387, 381, 375, 368, 362, 357,
+    351, 345, 340, 334, 329, 323, 318, 313,
+    308, 303, 298, 293, 289, 284, 279, 275,
+    271, 266, 262, 258, 254, 250, 246, 242,
+    238, 234, 230, 227, 223, 219, 216, 213,
+    209, 206, 203, 199, 196, 193, 190, 187,
+    184, 181, 178, 175, 173, 170, 167, 165,
+    162, 159, 157, 154, 152, 150, 147, 145,
+    143, 140, 138, 136, 134, 132, 130, 128,
+    126, 124, 122, 120, 118, 116, 114, 112,
+    111, 109, 107, 106, 104, 102, 101, 99,
+    97, 96, 94, 93, 92, 90, 89, 87,
+    86, 85, 83, 82, 81, 79, 78, 77,
+    76, 75, 73, 72, 71, 70, 69, 68,
+    67, 66, 65, 64, 63, 62, 61, 60,
+    59, 58, 57, 56, 55, 54, 54, 53,
+    52, 51, 50, 49, 49, 48, 47, 46,
+    46, 45, 44, 44, 43, 42, 42, 41,
+    40, 40, 39, 38, 38, 37, 37, 36,
+    36, 35, 34, 34, 33, 33, 32, 32,
+    31, 31, 30, 30, 29, 29, 29, 28,
+    28, 27, 27, 26, 26, 26, 25, 25,
+    24, 24, 24, 23, 23, 23, 22, 22,
+    22, 21, 21, 21, 20, 20, 20, 19,
+    19, 19, 18, 18, 18, 18, 17, 17,
+    17, 17, 16, 16, 16, 16, 15, 15,
+    15, 15, 14, 14, 14, 14, 13, 13,
+    13, 13, 13, 12, 12, 12, 12, 12,
+    12, 11, 11, 11, 11, 11, 10, 10,
+    10, 10, 10, 10, 10, 9, 9, 9,
+    9, 9, 9, 9, 8, 8, 8, 8,
+    8, 8, 8, 8, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6,
+    5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1,
+};
+
+/* -ln((1 - e^-x) / x) for x = k / 64, with DEFAULT_RADIX fractional
+ * bits.  Added to ln(x) for x < 1. */
+static const uint16 fe_logsub_small_table[65] = {
+    0, 32, 64, 96, 127, 159, 191, 222,
+    253, 285, 316, 347, 378, 409, 440, 471,
+    501, 532, 563, 593, 623, 654, 684, 714,
+    744, 774, 804, 834, 863, 893, 923, 952,
+    981, 1011, 1040, 1069, 1098, 1127, 1156, 1185,
+    1214, 1242, 1271, 1299, 1328, 1356, 1384, 1412,
+    1440, 1468, 1496, 1524, 1552, 1580, 1607, 1635,
+    1662, 1690, 1717, 1744, 1771, 1798, 1825, 1852,
+    1879,
+};
+
+fixed32
+fe_log_add(fixed32 x, fixed32 y)
+{
+    fixed32 d, r;
+    int32 k;
+
+    if (x < y) {
+        r = x;
+        x = y;
+        y = r;
+    }
+    d = x - y;
+    k = d >> 6;
+    if (k >= 576)
+        return x;
+    r = fe_logadd_table[k]
+        + (((fe_logadd_table[k + 1] - fe_logadd_table[k]) * (d & 63)) >> 6);
+    return x + r;
+}
+
+fixed32
+fe_log_sub(fixed32 x, fixed32 y)
+{
+    fixed32 d, r;
+    int32 k;
+
+    if (x <= y)
+        return MIN_FIXLOG;
+    d = x - y;
+    k = d >> 6;
+    if (k >= 576)
+        return x;
+    if (k >= 64) {
+        k -= 64;
+        r = fe_logsub_table[k]
+            + (((fe_logsub_table[k + 1] - fe_logsub_table[k]) * (d & 63)) >> 6);
+        return x - r;
+    }
+    /* ln(1 - e^-d) = ln(d) + ln((1 - e^-d) / d), where the second
+     * term is smooth, and the first is exact. */
+    r = fe_logsub_small_table[k]
+        + (((fe_logsub_small_table[k + 1] - fe_logsub_small_table[k])
+            * (d & 63))
+           >> 6);
+    return x + FIXLN(d) - r;
+}
+#endif /* FIXED_POINT */
 
 static float32
 fe_mel(melfb_t *mel, float32 x)
@@ -186,11 +404,21 @@ fe_build_melfilters(melfb_t *mel_fb)
                 loslope *= 2 / (freqs[2] - freqs[0]);
                 hislope *= 2 / (freqs[2] - freqs[0]);
             }
+#ifdef FIXED_POINT
+            /* Coefficients are applied in the log domain. */
+            if (loslope > hislope)
+                loslope = hislope;
+            if (loslope > 0)
+                mel_fb->filt_coeffs[n_coeffs] = FLOAT2FIX(log(loslope));
+            else
+                mel_fb->filt_coeffs[n_coeffs] = MIN_FIXLOG;
+#else
             if (loslope < hislope) {
                 mel_fb->filt_coeffs[n_coeffs] = loslope;
             } else {
                 mel_fb->filt_coeffs[n_coeffs] = hislope;
             }
+#endif
             ++n_coeffs;
         }
     }
@@ -240,10 +468,18 @@ fe_pre_emphasis(float32 const *in, frame_t *out, int32 len,
                 float32 factor, float32 prior)
 {
     int i;
+#ifdef FIXED_POINT
+    fixed32 fxd_alpha = FLOAT2FIX(factor);
 
+    out[0] = ((fixed32)in[0] << DEFAULT_RADIX) - (fixed32)prior * fxd_alpha;
+    for (i = 1; i < len; i++)
+        out[i] = ((fixed32)in[i] << DEFAULT_RADIX)
+            - (fixed32)in[i - 1] * fxd_alpha;
+#else
     out[0] = (frame_t)in[0] - (frame_t)prior * factor;
     for (i = 1; i < len; i++)
         out[i] = (frame_t)in[i] - (frame_t)in[i - 1] * factor;
+#endif
 }
 
 static void
@@ -252,7 +488,11 @@ fe_copy_to_frame(float32 const *in, frame_t *out, int32 len)
     int i;
 
     for (i = 0; i < len; i++)
+#ifdef FIXED_POINT
+        out[i] = (fixed32)in[i] << DEFAULT_RADIX;
+#else
         out[i] = (frame_t)in[i];
+#endif
 }
 
 void
@@ -275,7 +515,11 @@ fe_hamming_window(frame_t *in, window_t *window, int32 in_len,
     int i;
 
     if (remove_dc) {
+#ifdef FIXED_POINT
+        int64 mean = 0;
+#else
         frame_t mean = 0;
+#endif
 
         for (i = 0; i < in_len; i++)
             mean += in[i];
@@ -453,20 +697,58 @@ fe_create_twiddle(fe_t *fe)
 
     for (i = 0; i < fe->fft_size / 4; ++i) {
         float64 a = 2 * M_PI * i / fe->fft_size;
-        fe->ccc[i] = cos(a);
-        fe->sss[i] = sin(a);
+        fe->ccc[i] = FLOAT2COS(cos(a));
+        fe->sss[i] = FLOAT2COS(sin(a));
     }
 }
 
+#ifdef FIXED_POINT
+/**
+ * Scale the input to the FFT so that it uses as many bits as
+ * possible without overflowing (its magnitude can grow by a factor
+ * of n).  Returns the scaling factor, in bits.
+ */
+static int
+fe_fft_normalize(frame_t *x, int m, int n)
+{
+    uint32 bits;
+    int i, shift;
+
+    bits = 0;
+    for (i = 0; i < n; ++i)
+        bits |= (uint32)(x[i] < 0 ? -x[i] : x[i]);
+    if (bits == 0)
+        return 0;
+    /* Leave one bit of headroom for rounding in the butterflies. */
+    shift = 30 - m;
+    while (bits >>= 1)
+        --shift;
+    if (shift > 0) {
+        for (i = 0; i < n; ++i)
+            x[i] = (fixed32)((uint32)x[i] << shift);
+    } else if (shift < 0) {
+        for (i = 0; i < n; ++i)
+            x[i] >>= -shift;
+    }
+    return shift;
+}
+#endif
+
 static int
 fe_fft_real(fe_t *fe)
 {
     int i, j, k, m, n;
     frame_t *x, xt;
+#ifdef FIXED_POINT
+    int scale;
+#endif
 
     x = fe->frame;
     m = fe->fft_order;
     n = fe->fft_size;
+#ifdef FIXED_POINT
+    scale = fe_fft_normalize(x, m, n);
+#endif
 
     /* Bit-reverse the input. */
     j = 0;
@@ -552,8 +834,12 @@ fe_fft_real(fe_t *fe)
         }
     }
 
-    /* This isn't used, but return it for completeness. */
-    return m;
+#ifdef FIXED_POINT
+    return scale;
+#else
+    /* No scaling in floating-point. */
+    return 0;
+#endif
 }
 
 static void
@@ -561,20 +847,31 @@ fe_spec_magnitude(fe_t *fe)
 {
     frame_t *fft;
     powspec_t *spec;
-    int32 j, scale, fftsize;
-
-    /* Do FFT and get the scaling factor back (only actually used in
-     * fixed-point).  Note the scaling factor is expressed in bits. */
-    scale = fe_fft_real(fe);
+    int32 j, fftsize;
+#ifdef FIXED_POINT
+    fixed32 scale;
+
+    /* Do FFT and get the scaling factor back, in bits, which (along
+     * with the radix of the input) is removed from the log power. */
+    scale = FIXLN_2_MUL(2 * (fe_fft_real(fe) + DEFAULT_RADIX));
+#else
+    fe_fft_real(fe);
+#endif
 
     /* Convenience pointers to make things less awkward below. */
     fft = fe->frame;
     spec = fe->spec;
     fftsize = fe->fft_size;
 
-    /* We need to scale things up the rest of the way to N. */
-    scale = fe->fft_order - scale;
-
+#ifdef FIXED_POINT
+    /* The first point (DC coefficient) has no imaginary part */
+    spec[0] = fixlog((uint64)((int64)fft[0] * fft[0])) - scale;
+    for (j = 1; j <= fftsize / 2; j++) {
+        uint64 rr = (uint64)((int64)fft[j] * fft[j]);
+        uint64 ii = (uint64)((int64)fft[fftsize - j] * fft[fftsize - j]);
+        spec[j] = fixlog(rr + ii) - scale;
+    }
+#else
     /* The first point (DC coefficient) has no imaginary part */
     {
         spec[0] = fft[0] * fft[0];
@@ -583,6 +880,7 @@ fe_spec_magnitude(fe_t *fe)
     for (j = 1; j <= fftsize / 2; j++) {
         spec[j] = fft[j] * fft[j] + fft[fftsize - j] * fft[fftsize - j];
     }
+#endif
 }
 
 static void
@@ -600,13 +898,23 @@ fe_mel_spec(fe_t *fe)
         spec_start = fe->mel_fb->spec_start[whichfilt];
         filt_start = fe->mel_fb->filt_start[whichfilt];
 
+#ifdef FIXED_POINT
+        mfspec[whichfilt] = spec[spec_start] + fe->mel_fb->filt_coeffs[filt_start];
+        for (i = 1; i < fe->mel_fb->filt_width[whichfilt]; i++) {
+            mfspec[whichfilt] = fe_log_add(mfspec[whichfilt],
+                                           spec[spec_start + i] + fe->mel_fb->filt_coeffs[filt_start + i]);
+        }
+#else
         mfspec[whichfilt] = 0;
         for (i = 0; i < fe->mel_fb->filt_width[whichfilt]; i++)
             mfspec[whichfilt] += spec[spec_start + i] * fe->mel_fb->filt_coeffs[filt_start + i];
+#endif
     }
 }
 
 #define LOG_FLOOR 1e-4
+/* ln(LOG_FLOOR) */
+#define FIX_LOG_FLOOR FLOAT2FIX(-9.210340371976184)
 
 static void
 fe_mel_cep(fe_t *fe, mfcc_t *mfcep)
@@ -618,7 +926,12 @@ fe_mel_cep(fe_t *fe, mfcc_t *mfcep)
     mfspec = fe->mfspec;
 
     for (i = 0; i < fe->mel_fb->num_filters; ++i) {
+#ifdef FIXED_POINT
+        /* Already in the log domain. */
+        mfspec[i] = fe_log_add(mfspec[i], FIX_LOG_FLOOR);
+#else
         mfspec[i] = log(mfspec[i] + LOG_FLOOR);
+#endif
     }
 
     /* If we are doing LOG_SPEC, then do nothing. */
@@ -717,7 +1030,7 @@ fe_dct3(fe_t *fe, const mfcc_t *mfcep, powspec_t *mflogspec)
     int32 i, j;
 
     for (i = 0; i < fe->mel_fb->num_filters; ++i) {
-        mflogspec[i] = COSMUL(mfcep[0], SQRT_HALF);
+        mflogspec[i] = COSMUL(mfcep[0], COS_SQRT_HALF);
         for (j = 1; j < fe->num_cepstra; j++) {
             mflogspec[i] += COSMUL(mfcep[j], fe->mel_fb->mel_cosine[j][i]);
         }
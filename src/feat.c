@@ -949,6 +949,76 @@ feat_cmn(feat_t *fcb, mfcc_t **mfc, int32 nfr, int32 beginutt, int32 endutt)
     cep_dump_dbg(fcb, mfc, nfr, "After CMN");
 }
 
+void
+feat_snapshot_save(feat_t *fcb, snapshot_t *s)
+{
+    int32 win = feat_window_size(fcb);
+    int32 i, nbufcep, pos;
+
+    snapshot_write_int32(s, fcb->cepsize);
+    snapshot_write_int32(s, win);
+    snapshot_write_int32(s, fcb->cmn);
+    if (fcb->cmn_struct) {
+        snapshot_write(s, fcb->cmn_struct->cmn_mean,
+                       fcb->cepsize * sizeof(mfcc_t));
+        snapshot_write(s, fcb->cmn_struct->sum,
+                       fcb->cepsize * sizeof(mfcc_t));
+        snapshot_write_int32(s, fcb->cmn_struct->nframe);
+    }
+
+    /* Frames not yet used as the center of the window, preceded by
+     * the trailing window of frames already used. */
+    nbufcep = fcb->bufpos - fcb->curpos;
+    if (nbufcep < 0)
+        nbufcep += LIVEBUFBLOCKSIZE;
+    snapshot_write_int32(s, nbufcep);
+    pos = (fcb->curpos - win + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
+    for (i = 0; i < nbufcep + win; ++i) {
+        snapshot_write(s, fcb->cepbuf[pos], fcb->cepsize * sizeof(mfcc_t));
+        pos = (pos + 1) % LIVEBUFBLOCKSIZE;
+    }
+}
+
+int
+feat_snapshot_load(feat_t *fcb, snapshot_t *s)
+{
+    int32 win = feat_window_size(fcb);
+    int32 i, nbufcep;
+    cmn_type_t cmn;
+
+    if (snapshot_read_int32(s) != fcb->cepsize
+        || snapshot_read_int32(s) != win) {
+        E_ERROR("Snapshot has different feature parameters\n");
+        return -1;
+    }
+    cmn = snapshot_read_int32(s);
+    if ((cmn == CMN_NONE) != (fcb->cmn == CMN_NONE)) {
+        E_ERROR("Snapshot CMN setting does not match\n");
+        return -1;
+    }
+    fcb->cmn = cmn;
+    if (fcb->cmn_struct) {
+        snapshot_read(s, fcb->cmn_struct->cmn_mean,
+                      fcb->cepsize * sizeof(mfcc_t));
+        snapshot_read(s, fcb->cmn_struct->sum,
+                      fcb->cepsize * sizeof(mfcc_t));
+        fcb->cmn_struct->nframe = snapshot_read_int32(s);
+        cmn_update_repr(fcb->cmn_struct);
+    }
+
+    nbufcep = snapshot_read_int32(s);
+    if (nbufcep < 0 || nbufcep + win >= LIVEBUFBLOCKSIZE) {
+        E_ERROR("Invalid number of buffered frames %d in snapshot\n",
+                nbufcep);
+        return -1;
+    }
+    for (i = 0; i < nbufcep + win; ++i)
+        snapshot_read(s, fcb->cepbuf[i], fcb->cepsize * sizeof(mfcc_t));
+    fcb->curpos = win;
+    fcb->bufpos = win + nbufcep;
+    return s->error ? -1 : 0;
+}
+
 static void
 feat_compute_utt(feat_t *fcb, mfcc_t **mfc, int32 nfr, int32 win, mfcc_t ***feat)
 {
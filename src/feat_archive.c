@@ -0,0 +1,507 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file feat_archive.c
+ * @brief Archives of precomputed dynamic features.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/feat_archive.h>
+#include <soundswallower/mmio.h>
+
+#define FEAT_ARCHIVE_MAGIC "SSFA"
+#define FEAT_ARCHIVE_BYTEORDER 0x11223344
+#define FEAT_ARCHIVE_VERSION 2
+#define FEAT_ARCHIVE_ALIGN 16
+
+/* Fixed and floating-point features are the same size, but not
+ * interchangeable. */
+#ifdef FIXED_POINT
+#define FEAT_ARCHIVE_MFCC_TYPE (0x100 | DEFAULT_RADIX)
+#else
+#define FEAT_ARCHIVE_MFCC_TYPE sizeof(mfcc_t)
+#endif
+
+typedef struct feat_archive_header_s {
+    char magic[4];
+    uint32 byteorder;
+    uint32 version;
+    uint32 n_stream;
+    uint32 n_utt;
+    uint32 type;
+    uint32 elem_type; /**< Format of data elements (see elem_type()) */
+    uint32 pad;
+    uint64 index_offset;
+} feat_archive_header_t;
+
+typedef struct feat_archive_entry_s {
+    uint64 offset;
+    uint64 uttid_offset;
+    uint32 n_frames;
+    uint32 pad;
+} feat_archive_entry_t;
+
+struct feat_archive_writer_s {
+    FILE *fh;
+    char *filename;
+    uint64 pos; /**< Current offset in file. */
+    uint32 type;
+    uint32 n_stream;
+    uint32 *stream_len;
+    uint32 dim; /**< Total dimensionality of all streams. */
+    feat_archive_entry_t *index;
+    int32 n_utt, n_alloc;
+    char *uttids; /**< Utterance IDs, NUL-terminated. */
+    size_t uttids_len, uttids_alloc;
+};
+
+struct feat_archive_s {
+    mmio_file_t *mf;
+    const uint8 *data;
+    uint64 size;
+    const feat_archive_header_t *header;
+    const uint32 *stream_len;
+    const feat_archive_entry_t *index;
+    uint32 dim; /**< Total dimensionality of all streams. */
+    size_t frame_size; /**< Size in bytes of a frame. */
+};
+
+static size_t
+frame_size(uint32 type, uint32 dim)
+{
+    return dim * (type == FEAT_ARCHIVE_SENSCR ? sizeof(int16) : sizeof(mfcc_t));
+}
+
+static uint32
+elem_type(uint32 type)
+{
+    return type == FEAT_ARCHIVE_SENSCR ? sizeof(int16) : FEAT_ARCHIVE_MFCC_TYPE;
+}
+
+static uint64
+stream_offset(uint32 n_stream)
+{
+    uint64 end = sizeof(feat_archive_header_t) + n_stream * sizeof(uint32);
+    return (end + 7) & ~(uint64)7;
+}
+
+static int
+writer_write(feat_archive_writer_t *w, const void *data, size_t len)
+{
+    if (len && fwrite(data, 1, len, w->fh) != len) {
+        E_ERROR_SYSTEM("Failed to write to %s", w->filename);
+        return -1;
+    }
+    w->pos += len;
+    return 0;
+}
+
+static int
+writer_pad(feat_archive_writer_t *w, uint64 align)
+{
+    static const uint8 zeros[FEAT_ARCHIVE_ALIGN] = { 0 };
+    size_t npad = (size_t)((align - w->pos % align) % align);
+    return writer_write(w, zeros, npad);
+}
+
+static int
+writer_header(feat_archive_writer_t *w, uint64 index_offset)
+{
+    feat_archive_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FEAT_ARCHIVE_MAGIC, 4);
+    header.byteorder = FEAT_ARCHIVE_BYTEORDER;
+    header.version = FEAT_ARCHIVE_VERSION;
+    header.n_stream = w->n_stream;
+    header.n_utt = w->n_utt;
+    header.type = w->type;
+    header.elem_type = elem_type(w->type);
+    header.index_offset = index_offset;
+    return writer_write(w, &header, sizeof(header));
+}
+
+static void
+writer_free(feat_archive_writer_t *w)
+{
+    if (w->fh)
+        fclose(w->fh);
+    ckd_free(w->filename);
+    ckd_free(w->stream_len);
+    ckd_free(w->index);
+    ckd_free(w->uttids);
+    ckd_free(w);
+}
+
+static feat_archive_writer_t *
+writer_init(const char *filename, uint32 type, uint32 n_stream, uint32 *stream_len)
+{
+    feat_archive_writer_t *w;
+    uint32 i;
+
+    w = ckd_calloc(1, sizeof(*w));
+    w->filename = ckd_salloc(filename);
+    w->type = type;
+    w->n_stream = n_stream;
+    w->stream_len = stream_len;
+    if ((w->fh = fopen(filename, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open %s for writing", filename);
+        writer_free(w);
+        return NULL;
+    }
+    /* Header is rewritten with the index offset when closing. */
+    if (writer_header(w, 0) < 0)
+        goto error_out;
+    if (writer_write(w, stream_len, n_stream * sizeof(*stream_len)) < 0)
+        goto error_out;
+    for (i = 0; i < n_stream; ++i)
+        w->dim += stream_len[i];
+    if (writer_pad(w, 8) < 0)
+        goto error_out;
+    return w;
+error_out:
+    writer_free(w);
+    return NULL;
+}
+
+feat_archive_writer_t *
+feat_archive_writer_init(const char *filename, feat_t *fcb)
+{
+    uint32 *stream_len;
+    int i;
+
+    stream_len = ckd_calloc(feat_dimension1(fcb), sizeof(*stream_len));
+    for (i = 0; i < feat_dimension1(fcb); ++i)
+        stream_len[i] = feat_dimension2(fcb, i);
+    return writer_init(filename, FEAT_ARCHIVE_FEAT,
+                       feat_dimension1(fcb), stream_len);
+}
+
+feat_archive_writer_t *
+feat_archive_writer_init_senscr(const char *filename, int32 n_sen)
+{
+    uint32 *stream_len;
+
+    stream_len = ckd_calloc(1, sizeof(*stream_len));
+    stream_len[0] = n_sen;
+    return writer_init(filename, FEAT_ARCHIVE_SENSCR, 1, stream_len);
+}
+
+int
+feat_archive_writer_start(feat_archive_writer_t *w, const char *uttid)
+{
+    feat_archive_entry_t *ent;
+    size_t len;
+
+    if (writer_pad(w, FEAT_ARCHIVE_ALIGN) < 0)
+        return -1;
+    if (w->n_utt == w->n_alloc) {
+        w->n_alloc = w->n_alloc ? w->n_alloc * 2 : 16;
+        w->index = ckd_realloc(w->index, w->n_alloc * sizeof(*w->index));
+    }
+    ent = w->index + w->n_utt;
+    memset(ent, 0, sizeof(*ent));
+    ent->offset = w->pos;
+    ent->uttid_offset = w->uttids_len;
+
+    len = strlen(uttid) + 1;
+    if (w->uttids_len + len > w->uttids_alloc) {
+        w->uttids_alloc = (w->uttids_len + len) * 2;
+        w->uttids = ckd_realloc(w->uttids, w->uttids_alloc);
+    }
+    memcpy(w->uttids + w->uttids_len, uttid, len);
+    w->uttids_len += len;
+    ++w->n_utt;
+    return 0;
+}
+
+static int
+writer_frame(feat_archive_writer_t *w, uint32 type, const void *frame)
+{
+    if (w->type != type) {
+        E_ERROR("Wrong type of data for archive %s\n", w->filename);
+        return -1;
+    }
+    if (w->n_utt == 0) {
+        E_ERROR("No utterance started in archive %s\n", w->filename);
+        return -1;
+    }
+    if (writer_write(w, frame, frame_size(w->type, w->dim)) < 0)
+        return -1;
+    ++w->index[w->n_utt - 1].n_frames;
+    return 0;
+}
+
+int
+feat_archive_writer_add_senscr(feat_archive_writer_t *w, const int16 *senscr)
+{
+    return writer_frame(w, FEAT_ARCHIVE_SENSCR, senscr);
+}
+
+int
+feat_archive_writer_add(feat_archive_writer_t *w, const char *uttid,
+                        mfcc_t ***feat, int32 n_frames)
+{
+    int32 i;
+
+    if (w->type != FEAT_ARCHIVE_FEAT) {
+        E_ERROR("Cannot add features to senone score archive %s\n",
+                w->filename);
+        return -1;
+    }
+    if (feat_archive_writer_start(w, uttid) < 0)
+        return -1;
+    /* Streams are contiguous within a frame (see feat_array_alloc()) */
+    for (i = 0; i < n_frames; ++i)
+        if (writer_frame(w, FEAT_ARCHIVE_FEAT, feat[i][0]) < 0)
+            return -1;
+    return 0;
+}
+
+int
+feat_archive_writer_close(feat_archive_writer_t *w)
+{
+    uint64 index_offset, uttids_offset;
+    int32 i;
+    int rv = -1;
+
+    if (writer_pad(w, 8) < 0)
+        goto error_out;
+    index_offset = w->pos;
+    uttids_offset = index_offset + w->n_utt * sizeof(*w->index);
+    for (i = 0; i < w->n_utt; ++i)
+        w->index[i].uttid_offset += uttids_offset;
+    if (writer_write(w, w->index, w->n_utt * sizeof(*w->index)) < 0)
+        goto error_out;
+    if (writer_write(w, w->uttids, w->uttids_len) < 0)
+        goto error_out;
+    if (fseek(w->fh, 0, SEEK_SET) < 0) {
+        E_ERROR_SYSTEM("Failed to seek in %s", w->filename);
+        goto error_out;
+    }
+    if (writer_header(w, index_offset) < 0)
+        goto error_out;
+    if (fclose(w->fh) != 0) {
+        E_ERROR_SYSTEM("Failed to close %s", w->filename);
+        w->fh = NULL;
+        goto error_out;
+    }
+    w->fh = NULL;
+    E_INFO("Wrote %d utterances to feature archive %s\n",
+           w->n_utt, w->filename);
+    rv = 0;
+error_out:
+    writer_free(w);
+    return rv;
+}
+
+feat_archive_t *
+feat_archive_read(const char *filename)
+{
+    feat_archive_t *fa;
+    uint64 index_end;
+    uint32 i;
+
+    fa = ckd_calloc(1, sizeof(*fa));
+    if ((fa->mf = mmio_file_read(filename)) == NULL) {
+        E_ERROR("Failed to map feature archive %s\n", filename);
+        ckd_free(fa);
+        return NULL;
+    }
+    fa->data = mmio_file_ptr(fa->mf);
+    fa->size = mmio_file_size(fa->mf);
+    fa->header = (const feat_archive_header_t *)fa->data;
+    if (fa->size < sizeof(*fa->header)
+        || memcmp(fa->header->magic, FEAT_ARCHIVE_MAGIC, 4) != 0) {
+        E_ERROR("%s is not a feature archive\n", filename);
+        goto error_out;
+    }
+    if (fa->header->byteorder != FEAT_ARCHIVE_BYTEORDER) {
+        E_ERROR("Feature archive %s has the wrong byte order\n", filename);
+        goto error_out;
+    }
+    if (fa->header->version != FEAT_ARCHIVE_VERSION) {
+        E_ERROR("Feature archive %s has unsupported version %u\n",
+                filename, fa->header->version);
+        goto error_out;
+    }
+    if (stream_offset(fa->header->n_stream) > fa->size) {
+        E_ERROR("Feature archive %s is truncated\n", filename);
+        goto error_out;
+    }
+    if (fa->header->type != FEAT_ARCHIVE_FEAT
+        && fa->header->type != FEAT_ARCHIVE_SENSCR) {
+        E_ERROR("Feature archive %s has unknown type %u\n",
+                filename, fa->header->type);
+        goto error_out;
+    }
+    if (fa->header->elem_type != elem_type(fa->header->type)) {
+        E_ERROR("Feature archive %s has data in format 0x%x, expected 0x%x "
+                "(fixed and floating-point builds cannot share them)\n",
+                filename, fa->header->elem_type, elem_type(fa->header->type));
+        goto error_out;
+    }
+    fa->stream_len = (const uint32 *)(fa->data + sizeof(*fa->header));
+    for (i = 0; i < fa->header->n_stream; ++i)
+        fa->dim += fa->stream_len[i];
+    fa->frame_size = frame_size(fa->header->type, fa->dim);
+    index_end = fa->header->index_offset
+                + (uint64)fa->header->n_utt * sizeof(*fa->index);
+    if (fa->header->index_offset < stream_offset(fa->header->n_stream)
+        || index_end > fa->size) {
+        E_ERROR("Feature archive %s is truncated or was not closed\n",
+                filename);
+        goto error_out;
+    }
+    fa->index = (const feat_archive_entry_t *)(fa->data + fa->header->index_offset);
+    for (i = 0; i < fa->header->n_utt; ++i) {
+        const feat_archive_entry_t *ent = fa->index + i;
+        if (ent->offset + (uint64)ent->n_frames * fa->frame_size
+                > fa->header->index_offset
+            || ent->uttid_offset < index_end
+            || ent->uttid_offset >= fa->size
+            || memchr(fa->data + ent->uttid_offset, '\0',
+                      fa->size - ent->uttid_offset)
+                   == NULL) {
+            E_ERROR("Feature archive %s has invalid entry %u\n", filename, i);
+            goto error_out;
+        }
+    }
+    E_INFO("Mapped feature archive %s with %u utterances of %u-dimensional "
+           "%s\n",
+           filename, fa->header->n_utt, fa->dim,
+           fa->header->type == FEAT_ARCHIVE_SENSCR ? "senone scores" : "features");
+    return fa;
+error_out:
+    feat_archive_free(fa);
+    return NULL;
+}
+
+void
+feat_archive_free(feat_archive_t *fa)
+{
+    if (fa == NULL)
+        return;
+    mmio_file_unmap(fa->mf);
+    ckd_free(fa);
+}
+
+int
+feat_archive_mismatch(feat_archive_t *fa, feat_t *fcb)
+{
+    uint32 i;
+
+    if (fa->header->type != FEAT_ARCHIVE_FEAT) {
+        E_ERROR("Archive contains senone scores, not features\n");
+        return TRUE;
+    }
+    if (fa->header->n_stream != (uint32)feat_dimension1(fcb)) {
+        E_ERROR("Feature archive has %u streams, expected %d\n",
+                fa->header->n_stream, feat_dimension1(fcb));
+        return TRUE;
+    }
+    for (i = 0; i < fa->header->n_stream; ++i) {
+        if (fa->stream_len[i] != (uint32)feat_dimension2(fcb, i)) {
+            E_ERROR("Feature archive stream %u has dimension %u, expected %d\n",
+                    i, fa->stream_len[i], feat_dimension2(fcb, i));
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+int
+feat_archive_type(feat_archive_t *fa)
+{
+    return fa->header->type;
+}
+
+int32
+feat_archive_n_sen(feat_archive_t *fa)
+{
+    if (fa->header->type != FEAT_ARCHIVE_SENSCR)
+        return 0;
+    return fa->dim;
+}
+
+int32
+feat_archive_n_utt(feat_archive_t *fa)
+{
+    return fa->header->n_utt;
+}
+
+const char *
+feat_archive_uttid(feat_archive_t *fa, int32 utt)
+{
+    if (utt < 0 || (uint32)utt >= fa->header->n_utt)
+        return NULL;
+    return (const char *)fa->data + fa->index[utt].uttid_offset;
+}
+
+int32
+feat_archive_n_frames(feat_archive_t *fa, int32 utt)
+{
+    if (utt < 0 || (uint32)utt >= fa->header->n_utt)
+        return -1;
+    return fa->index[utt].n_frames;
+}
+
+static const void *
+archive_frame(feat_archive_t *fa, uint32 type, int32 utt, int32 frame)
+{
+    const feat_archive_entry_t *ent;
+
+    if (fa->header->type != type)
+        return NULL;
+    if (utt < 0 || (uint32)utt >= fa->header->n_utt)
+        return NULL;
+    ent = fa->index + utt;
+    if (frame < 0 || (uint32)frame >= ent->n_frames)
+        return NULL;
+    return fa->data + ent->offset + (uint64)frame * fa->frame_size;
+}
+
+const mfcc_t *
+feat_archive_frame(feat_archive_t *fa, int32 utt, int32 frame)
+{
+    return archive_frame(fa, FEAT_ARCHIVE_FEAT, utt, frame);
+}
+
+const int16 *
+feat_archive_senscr(feat_archive_t *fa, int32 utt, int32 frame)
+{
+    return archive_frame(fa, FEAT_ARCHIVE_SENSCR, utt, frame);
+}
@@ -239,12 +239,109 @@ fsg_history_reset(fsg_history_t *h)
     blkarray_list_reset(h->entries);
 }
 
+int32
+fsg_history_compact(fsg_history_t *h, int32 *keep)
+{
+    int32 i, n, n_free;
+
+    n_free = blkarray_list_compact(h->entries, keep);
+    n = blkarray_list_n_valid(h->entries);
+    for (i = 0; i < n; i++) {
+        fsg_hist_entry_t *entry = fsg_history_entry_get(h, i);
+        if (entry->pred >= 0)
+            entry->pred = keep[entry->pred];
+    }
+
+    return n_free;
+}
+
 int32
 fsg_history_n_entries(fsg_history_t *h)
 {
     return (blkarray_list_n_valid(h->entries));
 }
 
+void
+fsg_history_snapshot_save(fsg_history_t *h, snapshot_t *s)
+{
+    int32 i, n;
+
+    n = blkarray_list_n_valid(h->entries);
+    snapshot_write_int32(s, n);
+    for (i = 0; i < n; i++) {
+        fsg_hist_entry_t *entry = fsg_history_entry_get(h, i);
+        fsg_link_t *link = entry->fsglink;
+
+        snapshot_write_int32(s, link ? fsg_link_from_state(link) : -1);
+        snapshot_write_int32(s, link ? fsg_link_to_state(link) : -1);
+        snapshot_write_int32(s, link ? fsg_link_wid(link) : -1);
+        snapshot_write_int32(s, entry->score);
+        snapshot_write_int32(s, entry->pred);
+        snapshot_write_int32(s, entry->frame);
+        snapshot_write_int32(s, entry->lc);
+        snapshot_write(s, &entry->rc, sizeof(entry->rc));
+    }
+}
+
+static fsg_link_t *
+find_link(fsg_model_t *fsg, int32 from, int32 to, int32 wid)
+{
+    gnode_t *gn;
+
+    if (from < 0 || from >= fsg_model_n_state(fsg)
+        || to < 0 || to >= fsg_model_n_state(fsg))
+        return NULL;
+    if (wid < 0)
+        return fsg_model_null_trans(fsg, from, to);
+    for (gn = fsg_model_trans(fsg, from, to); gn; gn = gnode_next(gn)) {
+        fsg_link_t *link = (fsg_link_t *)gnode_ptr(gn);
+        if (fsg_link_wid(link) == wid)
+            return link;
+    }
+    return NULL;
+}
+
+int
+fsg_history_snapshot_load(fsg_history_t *h, snapshot_t *s)
+{
+    int32 i, n;
+
+    blkarray_list_reset(h->entries);
+    n = snapshot_read_int32(s);
+    for (i = 0; i < n && !s->error; i++) {
+        fsg_hist_entry_t *entry;
+        int32 from, to, wid;
+
+        entry = (fsg_hist_entry_t *)ckd_calloc(1, sizeof(fsg_hist_entry_t));
+        from = snapshot_read_int32(s);
+        to = snapshot_read_int32(s);
+        wid = snapshot_read_int32(s);
+        entry->score = snapshot_read_int32(s);
+        entry->pred = snapshot_read_int32(s);
+        entry->frame = snapshot_read_int32(s);
+        entry->lc = snapshot_read_int32(s);
+        snapshot_read(s, &entry->rc, sizeof(entry->rc));
+        if (from != -1
+            && (entry->fsglink = find_link(h->fsg, from, to, wid)) == NULL) {
+            E_ERROR("Transition %d -> %d (word %d) in snapshot not found in FSG\n",
+                    from, to, wid);
+            ckd_free(entry);
+            return -1;
+        }
+        if (entry->pred < -1 || entry->pred >= i
+            || entry->lc < 0 || entry->lc >= h->n_ciphone) {
+            E_ERROR("Invalid history entry %d in snapshot\n", i);
+            ckd_free(entry);
+            return -1;
+        }
+        if (blkarray_list_append(h->entries, entry) < 0) {
+            ckd_free(entry);
+            return -1;
+        }
+    }
+    return s->error ? -1 : 0;
+}
+
 void
 fsg_history_utt_start(fsg_history_t *h)
 {
@@ -241,7 +241,7 @@ fsg_lextree_init(fsg_model_t *fsg, dict_t *dict, dict2pid_t *d2p,
         lextree->root[s] = fsg_psubtree_init(lextree, fsg, s, &(lextree->alloc_head[s]));
 
         for (pn = lextree->alloc_head[s]; pn; pn = pn->alloc_next) {
-            lextree->n_pnode++;
+            pn->id = lextree->n_pnode++;
             if (pn->leaf)
                 ++n_leaves;
         }
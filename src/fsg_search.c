@@ -67,6 +67,7 @@
 static seg_iter_t *fsg_search_seg_iter(search_module_t *search);
 static lattice_t *fsg_search_lattice(search_module_t *search);
 static int fsg_search_prob(search_module_t *search);
+static void fsg_search_sen_active(search_module_t *search);
 
 static searchfuncs_t fsg_funcs = {
     /* start: */ fsg_search_start,
@@ -78,6 +79,9 @@ static searchfuncs_t fsg_funcs = {
     /* hyp: */ fsg_search_hyp,
     /* prob: */ fsg_search_prob,
     /* seg_iter: */ fsg_search_seg_iter,
+    /* sen_active: */ fsg_search_sen_active,
+    /* snapshot_save: */ fsg_search_snapshot_save,
+    /* snapshot_load: */ fsg_search_snapshot_load,
 };
 
 static int
@@ -194,7 +198,9 @@ fsg_search_init(const char *name,
     fsgs->frame = -1;
 
     /* Get search pruning parameters */
-    fsgs->beam_factor = 1.0f;
+    fsgs->maxhmmpf = config_int(config, "maxhmmpf");
+    fsgs->maxwpf = config_int(config, "maxwpf");
+    fsgs->collect_frame = fsgs->stable_frame = -1;
     fsgs->beam = fsgs->beam_orig
         = (int32)logmath_log(acmod->lmath, config_float(config, "beam"))
         >> SENSCR_SHIFT;
@@ -274,6 +280,14 @@ fsg_search_free(search_module_t *search)
         fsg_history_free(fsgs->history);
     }
     hmm_context_free(fsgs->hmmctx);
+    ckd_free(fsgs->stable_hyp);
+    ckd_free(fsgs->stable_out);
+    ckd_free(fsgs->keep);
+    ckd_free(fsgs->share_hmm);
+    ckd_free(fsgs->share_next);
+    ckd_free(fsgs->share_dup);
+    ckd_free(fsgs->share_group);
+    ckd_free(fsgs->share_hash);
     /* NOTE: Consuming semantics. */
     fsg_model_free(fsgs->fsg);
     ckd_free(fsgs);
@@ -306,15 +320,30 @@ fsg_search_reinit(search_module_t *search, dict_t *dict, dict2pid_t *d2p)
     return 0;
 }
 
+void
+fsg_search_set_pruning(search_module_t *search, int32 beam,
+                       int32 pbeam, int32 wbeam, int32 maxhmmpf)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+
+    fsgs->beam = fsgs->beam_orig = beam;
+    fsgs->pbeam = fsgs->pbeam_orig = pbeam;
+    fsgs->wbeam = fsgs->wbeam_orig = wbeam;
+    fsgs->maxhmmpf = maxhmmpf;
+}
+
+/*
+ * Activate the senones needed by HMMs active in this frame (without
+ * clearing any already activated by other searches).
+ */
 static void
-fsg_search_sen_active(fsg_search_t *fsgs)
+fsg_search_sen_active(search_module_t *search)
 {
+    fsg_search_t *fsgs = (fsg_search_t *)search;
     gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
 
-    acmod_clear_active(search_module_acmod(fsgs));
-
     for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
         pnode = (fsg_pnode_t *)gnode_ptr(gn);
         hmm = fsg_pnode_hmmptr(pnode);
@@ -324,46 +353,213 @@ fsg_search_sen_active(fsg_search_t *fsgs)
 }
 
 /*
- * Evaluate all the active HMMs.
- * (Executed once per frame.)
+ * Find the tightest beam relative to bestscore which keeps at most
+ * max_active of the scores counted in bins, where bin i counts scores
+ * in (bestscore - (i + 1) * bw, bestscore - i * bw].  The best bin is
+ * always kept, and the beam is never widened past orig_beam.
+ */
+static int32
+fsg_search_histogram_beam(int32 *bins, int32 bw, int32 max_active,
+                          int32 orig_beam)
+{
+    int32 i, n;
+
+    for (n = bins[0], i = 1; i < FSG_SEARCH_HIST_BINS; ++i) {
+        if (n + bins[i] > max_active)
+            break;
+        n += bins[i];
+    }
+    if (i == FSG_SEARCH_HIST_BINS)
+        return orig_beam;
+    /* Keep scores strictly better than bestscore - i * bw */
+    n = -i * bw + 1;
+    return (n > orig_beam) ? n : orig_beam;
+}
+
+/*
+ * Histogram pruning: bucket the scores of active HMMs (and of word
+ * exits) relative to the best score in this frame, and set the
+ * effective beams to the ones that keep at most maxhmmpf HMMs (and
+ * maxwpf word exits) active.
  */
 static void
-fsg_search_hmm_eval(fsg_search_t *fsgs)
+fsg_search_histogram_prune(fsg_search_t *fsgs, int32 bestscore)
 {
+    int32 *hmm_bins = fsgs->hmm_hist, *word_bins = fsgs->word_hist;
+    int32 bw, wbw, thresh, n_hmm, n_word;
     gnode_t *gn;
-    fsg_pnode_t *pnode;
-    hmm_t *hmm;
-    int32 bestscore;
-    int32 n, maxhmmpf;
 
-    bestscore = WORST_SCORE;
+    /* Bin widths, such that the original beams span all the bins. */
+    bw = -fsgs->beam_orig / FSG_SEARCH_HIST_BINS + 1;
+    wbw = -fsgs->wbeam_orig / FSG_SEARCH_HIST_BINS + 1;
 
-    if (!fsgs->pnode_active) {
-        E_ERROR("Frame %d: No active HMM!!\n", fsgs->frame);
+    memset(hmm_bins, 0, FSG_SEARCH_HIST_BINS * sizeof(*hmm_bins));
+    n_hmm = 0;
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+        hmm_t *hmm = fsg_pnode_hmmptr((fsg_pnode_t *)gnode_ptr(gn));
+        int32 b = (bestscore - hmm_bestscore(hmm)) / bw;
+        if (b < FSG_SEARCH_HIST_BINS) {
+            ++hmm_bins[b];
+            ++n_hmm;
+        }
+    }
+    if (fsgs->maxhmmpf != -1 && n_hmm > fsgs->maxhmmpf) {
+        fsgs->beam = fsg_search_histogram_beam(hmm_bins, bw, fsgs->maxhmmpf,
+                                               fsgs->beam_orig);
+        /* Phone and word beams are never wider than the main one. */
+        if (fsgs->pbeam < fsgs->beam)
+            fsgs->pbeam = fsgs->beam;
+        if (fsgs->wbeam < fsgs->beam)
+            fsgs->wbeam = fsgs->beam;
+    }
+    if (fsgs->maxwpf == -1)
         return;
+
+    /* Now count word exits from the HMMs which survived. */
+    memset(word_bins, 0, FSG_SEARCH_HIST_BINS * sizeof(*word_bins));
+    thresh = bestscore + fsgs->beam;
+    n_word = 0;
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+        fsg_pnode_t *pnode = (fsg_pnode_t *)gnode_ptr(gn);
+        hmm_t *hmm = fsg_pnode_hmmptr(pnode);
+        int32 b;
+        if (!fsg_pnode_leaf(pnode) || hmm_bestscore(hmm) < thresh)
+            continue;
+        b = (bestscore - hmm_out_score(hmm)) / wbw;
+        if (b < 0)
+            b = 0;
+        if (b < FSG_SEARCH_HIST_BINS) {
+            ++word_bins[b];
+            ++n_word;
+        }
     }
+    if (n_word > fsgs->maxwpf)
+        fsgs->wbeam = fsg_search_histogram_beam(word_bins, wbw, fsgs->maxwpf,
+                                                fsgs->wbeam);
+}
+
+/*
+ * Hash the state of an HMM for fsg_search_hmm_group().
+ */
+static uint32
+fsg_search_hmm_hash(hmm_t const *hmm)
+{
+    uint32 h;
+    int32 i;
+
+    h = hmm_tmatid(hmm) * 31 + hmm_is_mpx(hmm);
+    if (hmm_is_mpx(hmm)) {
+        for (i = 0; i < hmm_n_emit_state(hmm); ++i)
+            h = h * 31 + hmm_mpx_ssid(hmm, i);
+    } else
+        h = h * 31 + hmm_nonmpx_ssid(hmm);
+    for (i = 0; i < hmm_n_emit_state(hmm); ++i)
+        h = h * 31 + (uint32)hmm_score(hmm, i);
+    return h ^ (h >> 15);
+}
 
+/*
+ * Group the active HMMs which are in exactly the same state, which
+ * happens a lot when the same phones are entered from several FSG
+ * states with the same score (e.g. via null transitions), so that
+ * each group only needs to be evaluated once.
+ */
+static int32
+fsg_search_hmm_group(fsg_search_t *fsgs, int32 *out_n_leaf)
+{
+    gnode_t *gn;
+    int32 n, n_leaf, n_hash;
+
+    n = glist_count(fsgs->pnode_active);
+    if (fsgs->n_share_alloc < n) {
+        fsgs->n_share_alloc = n * 2;
+        ckd_free(fsgs->share_hmm);
+        ckd_free(fsgs->share_next);
+        ckd_free(fsgs->share_dup);
+        ckd_free(fsgs->share_group);
+        fsgs->share_hmm = ckd_calloc(fsgs->n_share_alloc,
+                                     sizeof(*fsgs->share_hmm));
+        fsgs->share_next = ckd_calloc(fsgs->n_share_alloc,
+                                      sizeof(*fsgs->share_next));
+        fsgs->share_dup = ckd_calloc(fsgs->n_share_alloc,
+                                     sizeof(*fsgs->share_dup));
+        fsgs->share_group = ckd_calloc(fsgs->n_share_alloc,
+                                       sizeof(*fsgs->share_group));
+    }
+    for (n_hash = 16; n_hash < n * 2; n_hash *= 2)
+        ;
+    if (fsgs->n_share_hash < n_hash) {
+        fsgs->n_share_hash = n_hash;
+        ckd_free(fsgs->share_hash);
+        fsgs->share_hash = ckd_calloc(n_hash, sizeof(*fsgs->share_hash));
+    }
+    memset(fsgs->share_hash, -1, n_hash * sizeof(*fsgs->share_hash));
+
+    n_leaf = 0;
     for (n = 0, gn = fsgs->pnode_active; gn; gn = gnode_next(gn), n++) {
-        int32 score;
+        fsg_pnode_t *pnode = (fsg_pnode_t *)gnode_ptr(gn);
+        hmm_t *hmm = fsg_pnode_hmmptr(pnode);
+        uint32 h;
 
-        pnode = (fsg_pnode_t *)gnode_ptr(gn);
-        hmm = fsg_pnode_hmmptr(pnode);
         assert(hmm_frame(hmm) == fsgs->frame);
-
 #if __FSG_DBG__
         E_INFO("pnode(%08x) active @frm %5d\n", (int32)pnode,
                fsgs->frame);
-#if __FSG_DBG_CHAN__
-        hmm_dump(hmm, stdout);
-#endif
-#endif
-        score = hmm_vit_eval(hmm);
-#if __FSG_DBG_CHAN__
-        E_INFO("pnode(%08x) after eval @frm %5d\n",
-               (int32)pnode, fsgs->frame);
-        hmm_dump(hmm, stdout);
 #endif
+        fsgs->share_hmm[n] = hmm;
+        fsgs->share_next[n] = -1;
+        fsgs->share_dup[n] = FALSE;
+        for (h = fsg_search_hmm_hash(hmm) & (n_hash - 1);
+             fsgs->share_hash[h] != -1; h = (h + 1) & (n_hash - 1)) {
+            int32 first = fsgs->share_hash[h];
+            if (hmm_same_state(fsgs->share_hmm[first], hmm)) {
+                fsgs->share_next[n] = fsgs->share_next[first];
+                fsgs->share_next[first] = n;
+                fsgs->share_dup[n] = TRUE;
+                break;
+            }
+        }
+        if (!fsgs->share_dup[n])
+            fsgs->share_hash[h] = n;
+        if (fsg_pnode_leaf(pnode))
+            ++n_leaf;
+    }
+
+    *out_n_leaf = n_leaf;
+    return n;
+}
+
+/*
+ * Evaluate all the active HMMs.
+ * (Executed once per frame.)
+ */
+static void
+fsg_search_hmm_eval(fsg_search_t *fsgs)
+{
+    int32 bestscore;
+    int32 i, n, n_leaf;
+
+    bestscore = WORST_SCORE;
 
+    if (!fsgs->pnode_active) {
+        E_ERROR("Frame %d: No active HMM!!\n", fsgs->frame);
+        return;
+    }
+
+    n = fsg_search_hmm_group(fsgs, &n_leaf);
+    for (i = 0; i < n; ++i) {
+        int32 score, j, n_group;
+
+        if (fsgs->share_dup[i])
+            continue;
+        if (fsgs->share_next[i] == -1)
+            score = hmm_vit_eval(fsgs->share_hmm[i]);
+        else {
+            n_group = 0;
+            for (j = i; j != -1; j = fsgs->share_next[j])
+                fsgs->share_group[n_group++] = fsgs->share_hmm[j];
+            score = hmm_vit_eval_shared(fsgs->share_group, n_group);
+        }
         if (score BETTER_THAN bestscore)
             bestscore = score;
     }
@@ -373,25 +569,13 @@ fsg_search_hmm_eval(fsg_search_t *fsgs)
 #endif
     fsgs->n_hmm_eval += n;
 
-    /* Adjust beams if #active HMMs larger than absolute threshold */
-    maxhmmpf = config_int(search_module_config(fsgs), "maxhmmpf");
-    if (maxhmmpf != -1 && n > maxhmmpf) {
-        /*
-         * Too many HMMs active; reduce the beam factor applied to the default
-         * beams, but not if the factor is already at a floor (0.1).
-         */
-        if (fsgs->beam_factor > 0.1) { /* Hack!!  Hardwired constant 0.1 */
-            fsgs->beam_factor *= 0.9f; /* Hack!!  Hardwired constant 0.9 */
-            fsgs->beam = (int32)(fsgs->beam_orig * fsgs->beam_factor);
-            fsgs->pbeam = (int32)(fsgs->pbeam_orig * fsgs->beam_factor);
-            fsgs->wbeam = (int32)(fsgs->wbeam_orig * fsgs->beam_factor);
-        }
-    } else {
-        fsgs->beam_factor = 1.0f;
-        fsgs->beam = fsgs->beam_orig;
-        fsgs->pbeam = fsgs->pbeam_orig;
-        fsgs->wbeam = fsgs->wbeam_orig;
-    }
+    /* Tighten beams if too many HMMs or word exits are active */
+    fsgs->beam = fsgs->beam_orig;
+    fsgs->pbeam = fsgs->pbeam_orig;
+    fsgs->wbeam = fsgs->wbeam_orig;
+    if ((fsgs->maxhmmpf != -1 && n > fsgs->maxhmmpf)
+        || (fsgs->maxwpf != -1 && n_leaf > fsgs->maxwpf))
+        fsg_search_histogram_prune(fsgs, bestscore);
 
     if (n > fsg_lextree_n_pnode(fsgs->lextree))
         E_FATAL("PANIC! Frame %d: #HMM evaluated(%d) > #PNodes(%d)\n",
@@ -673,8 +857,10 @@ fsg_search_step(search_module_t *search, int frame_idx)
 
     assert(fsgs->frame == frame_idx);
     /* Activate our HMMs for the current frame if need be. */
-    if (!acmod->compallsen)
-        fsg_search_sen_active(fsgs);
+    if (!acmod->compallsen) {
+        acmod_clear_active(acmod);
+        fsg_search_sen_active(search);
+    }
     /* Compute GMM scores for the current frame. */
     senscr = acmod_score(acmod, &frame_idx);
     fsgs->n_sen_eval += acmod->n_senone_active;
@@ -735,6 +921,12 @@ fsg_search_step(search_module_t *search, int frame_idx)
     /* End of this frame; ready for the next */
     ++fsgs->frame;
 
+    /* Periodically discard history behind the stable part. */
+    if (fsgs->rolling > 0
+        && fsgs->frame - (fsgs->collect_frame < 0 ? 0 : fsgs->collect_frame)
+            >= fsgs->rolling)
+        fsg_search_collect(search);
+
     return 1;
 }
 
@@ -750,8 +942,7 @@ fsg_search_start(search_module_t *search)
     int32 silcipid;
     fsg_pnode_ctxt_t ctxt;
 
-    /* Reset dynamic adjustment factor for beams */
-    fsgs->beam_factor = 1.0f;
+    /* Reset effective beams */
     fsgs->beam = fsgs->beam_orig;
     fsgs->pbeam = fsgs->pbeam_orig;
     fsgs->wbeam = fsgs->wbeam_orig;
@@ -790,6 +981,9 @@ fsg_search_start(search_module_t *search)
 
     fsgs->n_hmm_eval = 0;
     fsgs->n_sen_eval = 0;
+    fsgs->rolling = config_int(search_module_config(fsgs), "rolling");
+    fsgs->collect_frame = fsgs->stable_frame = -1;
+    fsgs->stable_len = 0;
 
     ptmr_reset(&fsgs->perf);
     ptmr_start(&fsgs->perf);
@@ -850,6 +1044,341 @@ fsg_search_finish(search_module_t *search)
     return 0;
 }
 
+/*
+ * Append the words on the path ending in a history entry (back to
+ * the root entry, which is not included) to the stable words.
+ */
+static void
+fsg_search_append_stable(fsg_search_t *fsgs, int32 bpidx)
+{
+    dict_t *dict = search_module_dict(fsgs);
+    char *c, *start;
+    size_t len, total;
+    int32 bp;
+
+    len = 0;
+    for (bp = bpidx; bp > 0;) {
+        fsg_hist_entry_t *hist_entry = fsg_history_entry_get(fsgs->history, bp);
+        int32 wid = fsg_link_wid(fsg_hist_entry_fsglink(hist_entry));
+
+        bp = fsg_hist_entry_pred(hist_entry);
+        if (wid < 0 || fsg_model_is_filler(fsgs->fsg, wid))
+            continue;
+        len += strlen(dict_basestr(dict,
+                                   dict_wordid(dict,
+                                               fsg_model_word_str(fsgs->fsg, wid))))
+            + 1;
+    }
+    if (len == 0)
+        return;
+
+    /* Separate from the previous words with a space. */
+    total = fsgs->stable_len + (fsgs->stable_len > 0) + len;
+    if (total > fsgs->stable_alloc) {
+        fsgs->stable_alloc = total * 2;
+        fsgs->stable_hyp = ckd_realloc(fsgs->stable_hyp, fsgs->stable_alloc);
+    }
+    if (fsgs->stable_len > 0)
+        fsgs->stable_hyp[fsgs->stable_len++] = ' ';
+    start = fsgs->stable_hyp + fsgs->stable_len;
+    c = start + len - 1;
+    *c = '\0';
+    for (bp = bpidx; bp > 0;) {
+        fsg_hist_entry_t *hist_entry = fsg_history_entry_get(fsgs->history, bp);
+        int32 wid = fsg_link_wid(fsg_hist_entry_fsglink(hist_entry));
+        const char *baseword;
+
+        bp = fsg_hist_entry_pred(hist_entry);
+        if (wid < 0 || fsg_model_is_filler(fsgs->fsg, wid))
+            continue;
+        baseword = dict_basestr(dict,
+                                dict_wordid(dict,
+                                            fsg_model_word_str(fsgs->fsg, wid)));
+        len = strlen(baseword);
+        c -= len;
+        memcpy(c, baseword, len);
+        if (c > start) {
+            --c;
+            *c = ' ';
+        }
+    }
+    fsgs->stable_len += strlen(start);
+}
+
+/*
+ * Update the history indices in an HMM after collection.
+ */
+static void
+fsg_search_remap_hmm(hmm_t *hmm, int32 const *keep)
+{
+    int i;
+
+    for (i = 0; i < hmm_n_emit_state(hmm); i++) {
+        if (hmm_score(hmm, i) BETTER_THAN WORST_SCORE)
+            hmm_history(hmm, i) = keep[hmm_history(hmm, i)];
+    }
+    if (hmm_out_score(hmm) BETTER_THAN WORST_SCORE)
+        hmm_out_history(hmm) = keep[hmm_out_history(hmm)];
+}
+
+int32
+fsg_search_collect(search_module_t *search)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+    int32 *keep;
+    int32 i, n_entries, n_ref, stable, n_free, shift;
+    gnode_t *gn;
+
+    n_entries = fsg_history_n_entries(fsgs->history);
+    if (n_entries == 0)
+        return 0;
+    if (fsgs->n_keep_alloc < n_entries) {
+        fsgs->n_keep_alloc = n_entries * 2;
+        ckd_free(fsgs->keep);
+        fsgs->keep = ckd_calloc(fsgs->n_keep_alloc, sizeof(*fsgs->keep));
+    }
+    keep = fsgs->keep;
+    memset(keep, 0, n_entries * sizeof(*keep));
+
+    /* Live paths end in the entries from the last frame (needed for
+     * the partial hypothesis) and in the active HMMs. */
+    n_ref = 0;
+    for (i = fsgs->bpidx_start; i < n_entries; i++) {
+        ++keep[i];
+        ++n_ref;
+    }
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+        hmm_t *hmm = fsg_pnode_hmmptr((fsg_pnode_t *)gnode_ptr(gn));
+        int j;
+
+        for (j = 0; j < hmm_n_emit_state(hmm); j++) {
+            if (hmm_score(hmm, j) BETTER_THAN WORST_SCORE) {
+                ++keep[hmm_history(hmm, j)];
+                ++n_ref;
+            }
+        }
+        if (hmm_out_score(hmm) BETTER_THAN WORST_SCORE) {
+            ++keep[hmm_out_history(hmm)];
+            ++n_ref;
+        }
+    }
+    if (n_ref == 0)
+        return 0;
+
+    /* Since predecessors always come first, one backwards pass
+     * counts the references below each entry.  The stable part ends
+     * with the last one that every live path goes through. */
+    for (i = n_entries - 1; i > 0; i--) {
+        int32 pred = fsg_hist_entry_pred(fsg_history_entry_get(fsgs->history, i));
+        if (keep[i] && pred >= 0)
+            keep[pred] += keep[i];
+    }
+    for (stable = n_entries - 1; stable > 0; stable--) {
+        if (keep[stable] == n_ref)
+            break;
+    }
+    if (stable > 0) {
+        fsg_search_append_stable(fsgs, stable);
+        fsgs->stable_frame
+            = fsg_hist_entry_frame(fsg_history_entry_get(fsgs->history, stable));
+    }
+
+    /* Keep the stable entry (as the new root) and the live ones after it. */
+    for (i = 0; i < stable; i++)
+        keep[i] = 0;
+    n_free = fsg_history_compact(fsgs->history, keep);
+    fsgs->bpidx_start = (fsgs->bpidx_start < n_entries)
+        ? keep[fsgs->bpidx_start]
+        : fsg_history_n_entries(fsgs->history);
+
+    /* Renormalize scores so they do not grow without bound. */
+    shift = (fsgs->bestscore BETTER_THAN WORST_SCORE) ? fsgs->bestscore : 0;
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+        hmm_t *hmm = fsg_pnode_hmmptr((fsg_pnode_t *)gnode_ptr(gn));
+        fsg_search_remap_hmm(hmm, keep);
+        hmm_normalize(hmm, shift);
+    }
+    n_entries = fsg_history_n_entries(fsgs->history);
+    for (i = 0; i < n_entries; i++)
+        fsg_history_entry_get(fsgs->history, i)->score -= shift;
+    fsgs->bestscore -= shift;
+    fsgs->collect_frame = fsgs->frame;
+
+    E_DEBUG("Frame %d: freed %d history entries, kept %d, stable to frame %d\n",
+            fsgs->frame, n_free, n_entries, fsgs->stable_frame);
+    return n_free;
+}
+
+int
+fsg_search_snapshot_save(search_module_t *search, snapshot_t *s)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+    gnode_t *gn;
+
+    if (fsgs->final) {
+        E_ERROR("Cannot save state of a finished search\n");
+        return -1;
+    }
+    snapshot_write_int32(s, fsg_model_n_state(fsgs->fsg));
+    snapshot_write_int32(s, fsg_lextree_n_pnode(fsgs->lextree));
+    snapshot_write_int32(s, fsgs->frame);
+    snapshot_write_int32(s, fsgs->beam);
+    snapshot_write_int32(s, fsgs->pbeam);
+    snapshot_write_int32(s, fsgs->wbeam);
+    snapshot_write_int32(s, fsgs->bestscore);
+    snapshot_write_int32(s, fsgs->bpidx_start);
+    snapshot_write_int32(s, fsgs->n_hmm_eval);
+    snapshot_write_int32(s, fsgs->n_sen_eval);
+    snapshot_write_int32(s, fsgs->collect_frame);
+    snapshot_write_int32(s, fsgs->stable_frame);
+    snapshot_write_int32(s, (int32)fsgs->stable_len);
+    snapshot_write(s, fsgs->stable_hyp, fsgs->stable_len);
+
+    fsg_history_snapshot_save(fsgs->history, s);
+
+    snapshot_write_int32(s, glist_count(fsgs->pnode_active));
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+        fsg_pnode_t *pnode = (fsg_pnode_t *)gnode_ptr(gn);
+        hmm_t *hmm = fsg_pnode_hmmptr(pnode);
+
+        snapshot_write_int32(s, pnode->id);
+        snapshot_write(s, hmm->score, hmm_n_emit_state(hmm) * sizeof(*hmm->score));
+        snapshot_write(s, hmm->history, hmm_n_emit_state(hmm) * sizeof(*hmm->history));
+        snapshot_write_int32(s, hmm_out_score(hmm));
+        snapshot_write_int32(s, hmm_out_history(hmm));
+        snapshot_write_int32(s, hmm_bestscore(hmm));
+        snapshot_write_int32(s, hmm_frame(hmm));
+    }
+    return 0;
+}
+
+int
+fsg_search_snapshot_load(search_module_t *search, snapshot_t *s)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+    fsg_pnode_t **pnodes;
+    int32 i, n_pnode, n_active, n_entries, stable_len;
+    gnode_t *gn;
+
+    n_pnode = fsg_lextree_n_pnode(fsgs->lextree);
+    if (snapshot_read_int32(s) != fsg_model_n_state(fsgs->fsg)
+        || snapshot_read_int32(s) != n_pnode) {
+        E_ERROR("Snapshot was taken with a different grammar\n");
+        return -1;
+    }
+
+    /* Forget about the start of the utterance. */
+    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn))
+        fsg_psubtree_pnode_deactivate((fsg_pnode_t *)gnode_ptr(gn));
+    glist_free(fsgs->pnode_active);
+    fsgs->pnode_active = NULL;
+
+    fsgs->frame = snapshot_read_int32(s);
+    fsgs->beam = snapshot_read_int32(s);
+    fsgs->pbeam = snapshot_read_int32(s);
+    fsgs->wbeam = snapshot_read_int32(s);
+    fsgs->bestscore = snapshot_read_int32(s);
+    fsgs->bpidx_start = snapshot_read_int32(s);
+    fsgs->n_hmm_eval = snapshot_read_int32(s);
+    fsgs->n_sen_eval = snapshot_read_int32(s);
+    fsgs->collect_frame = snapshot_read_int32(s);
+    fsgs->stable_frame = snapshot_read_int32(s);
+    stable_len = snapshot_read_int32(s);
+    /* Don't allocate more than could possibly be there. */
+    if (s->error || stable_len < 0 || (size_t)stable_len > s->len - s->pos) {
+        E_ERROR("Invalid stable hypothesis length %d in snapshot\n",
+                stable_len);
+        return -1;
+    }
+    if ((size_t)stable_len + 1 > fsgs->stable_alloc) {
+        fsgs->stable_alloc = stable_len + 1;
+        fsgs->stable_hyp = ckd_realloc(fsgs->stable_hyp, fsgs->stable_alloc);
+    }
+    snapshot_read(s, fsgs->stable_hyp, stable_len);
+    fsgs->stable_hyp[stable_len] = '\0';
+    fsgs->stable_len = stable_len;
+    if (s->error)
+        return -1;
+
+    if (fsg_history_snapshot_load(fsgs->history, s) < 0)
+        return -1;
+    n_entries = fsg_history_n_entries(fsgs->history);
+    if (fsgs->frame < 0 || fsgs->bpidx_start < 0
+        || fsgs->bpidx_start > n_entries) {
+        E_ERROR("Invalid search state in snapshot\n");
+        return -1;
+    }
+
+    /* Find lextree nodes by index. */
+    pnodes = ckd_calloc(n_pnode, sizeof(*pnodes));
+    for (i = 0; i < fsg_model_n_state(fsgs->fsg); i++) {
+        fsg_pnode_t *pn;
+        for (pn = fsgs->lextree->alloc_head[i]; pn; pn = pn->alloc_next)
+            pnodes[pn->id] = pn;
+    }
+    n_active = snapshot_read_int32(s);
+    for (i = 0; i < n_active && !s->error; i++) {
+        int32 id = snapshot_read_int32(s);
+        hmm_t *hmm;
+        int j;
+
+        if (id < 0 || id >= n_pnode
+            || hmm_frame(fsg_pnode_hmmptr(pnodes[id])) >= 0) {
+            E_ERROR("Invalid active HMM %d in snapshot\n", id);
+            break;
+        }
+        hmm = fsg_pnode_hmmptr(pnodes[id]);
+        fsgs->pnode_active = glist_add_ptr(fsgs->pnode_active, pnodes[id]);
+        snapshot_read(s, hmm->score, hmm_n_emit_state(hmm) * sizeof(*hmm->score));
+        snapshot_read(s, hmm->history, hmm_n_emit_state(hmm) * sizeof(*hmm->history));
+        hmm_out_score(hmm) = snapshot_read_int32(s);
+        hmm_out_history(hmm) = snapshot_read_int32(s);
+        hmm_bestscore(hmm) = snapshot_read_int32(s);
+        hmm_frame(hmm) = snapshot_read_int32(s);
+        for (j = 0; j < hmm_n_emit_state(hmm); j++) {
+            if (hmm_score(hmm, j) BETTER_THAN WORST_SCORE
+                && (hmm_history(hmm, j) < 0 || hmm_history(hmm, j) >= n_entries))
+                break;
+        }
+        if (j < hmm_n_emit_state(hmm)
+            || (hmm_out_score(hmm) BETTER_THAN WORST_SCORE
+                && (hmm_out_history(hmm) < 0 || hmm_out_history(hmm) >= n_entries))
+            || hmm_frame(hmm) != fsgs->frame) {
+            E_ERROR("Invalid active HMM %d in snapshot\n", id);
+            break;
+        }
+    }
+    ckd_free(pnodes);
+    /* Keep them in the same order as when saved. */
+    fsgs->pnode_active = glist_reverse(fsgs->pnode_active);
+    if (i < n_active || s->error) {
+        for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn))
+            fsg_psubtree_pnode_deactivate((fsg_pnode_t *)gnode_ptr(gn));
+        glist_free(fsgs->pnode_active);
+        fsgs->pnode_active = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+const char *
+fsg_search_stable_hyp(search_module_t *search, int32 *out_frame)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+
+    ckd_free(fsgs->stable_out);
+    fsgs->stable_out = NULL;
+    if (out_frame)
+        *out_frame = fsgs->stable_frame;
+    if (fsgs->stable_len == 0)
+        return NULL;
+    /* Hand over the buffer, so it does not grow without bound. */
+    fsgs->stable_out = fsgs->stable_hyp;
+    fsgs->stable_hyp = NULL;
+    fsgs->stable_len = fsgs->stable_alloc = 0;
+    return fsgs->stable_out;
+}
+
 static int
 fsg_search_find_exit(fsg_search_t *fsgs, int frame_idx, int final, int32 *out_score)
 {
@@ -923,6 +1452,24 @@ fsg_search_find_exit(fsg_search_t *fsgs, int frame_idx, int final, int32 *out_sc
     return besthist;
 }
 
+int32
+fsg_search_hyp_entry(search_module_t *search)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)search;
+    int bp;
+
+    bp = fsg_search_find_exit(fsgs, fsgs->frame, fsgs->final, NULL);
+    /* Fillers and null transitions are not part of the hypothesis. */
+    while (bp > 0) {
+        fsg_hist_entry_t *hist_entry = fsg_history_entry_get(fsgs->history, bp);
+        int32 wid = fsg_link_wid(fsg_hist_entry_fsglink(hist_entry));
+        if (wid >= 0 && !fsg_model_is_filler(fsgs->fsg, wid))
+            break;
+        bp = fsg_hist_entry_pred(hist_entry);
+    }
+    return bp < 0 ? 0 : bp;
+}
+
 /* FIXME: Mostly duplicated with ngram_search_bestpath(). */
 static latlink_t *
 fsg_search_bestpath(search_module_t *search, int32 *out_score, int backward)
@@ -962,7 +1509,7 @@ fsg_search_hyp(search_module_t *search, int32 *out_score)
 
     /* If bestpath is enabled and the utterance is complete, then run it.
      * Note that setting bestpath in fsg_search_init is disabled by default. */
-    if (fsgs->bestpath && fsgs->final) {
+    if (fsgs->bestpath && fsgs->final && fsgs->collect_frame < 0) {
         lattice_t *dag;
         latlink_t *link;
 
@@ -1096,7 +1643,7 @@ fsg_search_seg_iter(search_module_t *search)
 
     /* If bestpath is enabled and the utterance is complete, then run it.
      * Note that setting bestpath in fsg_search_init is disabled by default. */
-    if (fsgs->bestpath && fsgs->final) {
+    if (fsgs->bestpath && fsgs->final && fsgs->collect_frame < 0) {
         lattice_t *dag;
         latlink_t *link;
 
@@ -1352,6 +1899,12 @@ fsg_search_lattice(search_module_t *search)
 
     fsgs = (fsg_search_t *)search;
 
+    /* The history no longer goes back to the start. */
+    if (fsgs->collect_frame >= 0) {
+        E_ERROR("Lattice is not available after history has been collected\n");
+        return NULL;
+    }
+
     /* Check to see if a lattice has previously been created over the
      * same number of frames, and reuse it if so. */
     if (search->dag && search->dag->n_frames == fsgs->frame)
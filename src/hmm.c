@@ -757,6 +757,80 @@ hmm_vit_eval(hmm_t *hmm)
             return hmm_vit_eval_anytopo(hmm);
     }
 }
+
+int
+hmm_same_state(hmm_t const *a, hmm_t const *b)
+{
+    int32 i;
+
+    if (a->tmatid != b->tmatid || a->mpx != b->mpx
+        || a->n_emit_state != b->n_emit_state)
+        return FALSE;
+    if (a->mpx) {
+        for (i = 0; i < a->n_emit_state; ++i)
+            if (a->senid[i] != b->senid[i])
+                return FALSE;
+    } else if (a->ssid != b->ssid)
+        return FALSE;
+    for (i = 0; i < a->n_emit_state; ++i)
+        if (a->score[i] != b->score[i])
+            return FALSE;
+    return TRUE;
+}
+
+int32
+hmm_vit_eval_shared(hmm_t **hmms, int32 n_hmm)
+{
+    hmm_t *hmm = hmms[0];
+    int32 history[HMM_MAX_NSTATE], old[HMM_MAX_NSTATE];
+    int32 out_history, out_score, n_emit, bestscore;
+    int32 i, j;
+
+    if (n_hmm == 1)
+        return hmm_vit_eval(hmm);
+
+    /* Evaluate the first HMM with state indices in place of its
+     * histories, which tells us where each state's history comes
+     * from.  States whose scores are not updated keep their own
+     * history (and the exit state its own score). */
+    n_emit = hmm_n_emit_state(hmm);
+    memcpy(history, hmm->history, n_emit * sizeof(*history));
+    out_history = hmm_out_history(hmm);
+    out_score = hmm_out_score(hmm);
+    for (i = 0; i < n_emit; ++i)
+        hmm_history(hmm, i) = i;
+    hmm_out_history(hmm) = n_emit;
+    hmm_out_score(hmm) = MAX_INT32;
+    bestscore = hmm_vit_eval(hmm);
+
+    for (j = 1; j < n_hmm; ++j) {
+        hmm_t *h = hmms[j];
+
+        memcpy(old, h->history, n_emit * sizeof(*old));
+        for (i = 0; i < n_emit; ++i) {
+            hmm_score(h, i) = hmm_score(hmm, i);
+            hmm_history(h, i) = old[hmm_history(hmm, i)];
+        }
+        if (hmm_out_history(hmm) != n_emit)
+            hmm_out_history(h) = old[hmm_out_history(hmm)];
+        if (hmm_out_score(hmm) != MAX_INT32)
+            hmm_out_score(h) = hmm_out_score(hmm);
+        if (hmm_is_mpx(hmm))
+            memcpy(h->senid, hmm->senid, n_emit * sizeof(*h->senid));
+        hmm_bestscore(h) = bestscore;
+    }
+
+    for (i = 0; i < n_emit; ++i)
+        hmm_history(hmm, i) = history[hmm_history(hmm, i)];
+    hmm_out_history(hmm) = (hmm_out_history(hmm) == n_emit)
+        ? out_history
+        : history[hmm_out_history(hmm)];
+    if (hmm_out_score(hmm) == MAX_INT32)
+        hmm_out_score(hmm) = out_score;
+
+    return bestscore;
+}
+
 void
 hmm_dump(hmm_t *hmm,
          FILE *fp)
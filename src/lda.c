@@ -105,6 +105,23 @@ feat_read_lda_s3file(feat_t *feat, s3file_t *s, int32 dim)
         return -1;
     }
     feat->lda = (void *)outlda;
+#ifdef FIXED_POINT
+    {
+        uint8 *mem = (uint8 *)outlda[0][0];
+        uint32 i;
+
+        /* Convert to fixed-point in place (float32 and mfcc_t are
+         * the same size). */
+        for (i = 0; i < feat->n_lda * m * n; ++i) {
+            float32 f;
+            mfcc_t x;
+
+            memcpy(&f, mem + i * sizeof(f), sizeof(f));
+            x = FLOAT2MFCC(f);
+            memcpy(mem + i * sizeof(x), &x, sizeof(x));
+        }
+    }
+#endif
 
     /* Note that SphinxTrain stores the eigenvectors as row vectors. */
     if (n != feat->stream_len[0]) {
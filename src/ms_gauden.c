@@ -44,6 +44,7 @@
 #include <soundswallower/err.h>
 #include <soundswallower/mllr.h>
 #include <soundswallower/ms_gauden.h>
+#include <soundswallower/tied_mgau_common.h>
 
 #define GAUDEN_PARAM_VERSION "1.0"
 
@@ -51,8 +52,6 @@
 #define M_PI 3.1415926535897932385e0
 #endif
 
-#define WORST_DIST (int32)(0x80000000)
-
 void
 gauden_dump(const gauden_t *g)
 {
@@ -238,6 +237,10 @@ gauden_dist_precompute(gauden_t *g, logmath_t *lmath, float32 varfloor)
                      i < flen; i++, varp++, meanp++) {
                     float32 *fvarp = (float32 *)varp;
 
+#ifdef FIXED_POINT
+                    /* Means are read as floating-point */
+                    *meanp = FLOAT2MFCC(*(float32 *)meanp);
+#endif
                     if (*fvarp < varfloor) {
                         *fvarp = varfloor;
                         ++floored;
@@ -247,6 +250,10 @@ gauden_dist_precompute(gauden_t *g, logmath_t *lmath, float32 varfloor)
                     /* Precompute this part of the exponential */
                     *varp = (mfcc_t)logmath_ln_to_log(lmath,
                                                       (1.0 / (*fvarp * 2.0)));
+#ifdef FIXED_POINT
+                    if (*varp > GMM_MAX_VAR)
+                        *varp = GMM_MAX_VAR;
+#endif
                 }
             }
         }
@@ -291,6 +298,7 @@ gauden_init_s3file(s3file_t *means, /**< Input: File containing means of mixture
     }
     ckd_free(flen);
     gauden_dist_precompute(g, lmath, varfloor);
+    g->seed = ckd_calloc(g->n_density, sizeof(*g->seed));
     return g;
 
 error_out:
@@ -340,6 +348,7 @@ gauden_free(gauden_t *g)
         ckd_free_3d(g->det);
     if (g->featlen)
         ckd_free(g->featlen);
+    ckd_free(g->seed);
     if (g->lmath)
         logmath_free(g->lmath);
     ckd_free(g);
@@ -365,9 +374,13 @@ compute_dist_all(gauden_dist_t *out_dist, mfcc_t *obs, int32 featlen,
         for (i = 0; i < featlen; i++) {
             mfcc_t diff;
             diff = obs[i] - m[i];
+#ifdef FIXED_POINT
+            dval = GMMSUB(dval, GMMCOMPL(diff, v[i]));
+#else
             /* The compiler really likes this to be a single
              * expression, for whatever reason. */
             dval -= diff * diff * v[i];
+#endif
         }
 
         out_dist[d].dist = dval;
@@ -377,55 +390,91 @@ compute_dist_all(gauden_dist_t *out_dist, mfcc_t *obs, int32 featlen,
     return 0;
 }
 
+/*
+ * Evaluate codeword d and insert it in the top-N list if it is at
+ * least as good as the worst one so far.
+ */
+static inline void
+compute_dist_one(gauden_dist_t *out_dist, int32 n_top,
+                 mfcc_t *obs, int32 featlen,
+                 mfcc_t *m, mfcc_t *v, mfcc_t dval, int32 d)
+{
+    /* Keep this in a local since the compiler can't know that
+     * out_dist doesn't alias the means and variances. */
+    mfcc_t worst = out_dist[n_top - 1].dist;
+    int32 i, j;
+
+    for (i = 0; (i < featlen) && (dval >= worst); i++) {
+        mfcc_t diff;
+        diff = obs[i] - m[i];
+#ifdef FIXED_POINT
+        dval = GMMSUB(dval, GMMCOMPL(diff, v[i]));
+#else
+        /* The compiler really likes this to be a single
+         * expression, for whatever reason. */
+        dval -= diff * diff * v[i];
+#endif
+    }
+
+    if ((i < featlen) || (dval < worst)) /* Codeword d worse than worst */
+        return;
+
+    /* Codeword d at least as good as worst so far; insert in the ordered list */
+    for (i = 0; (i < n_top) && (dval < out_dist[i].dist); i++)
+        ;
+    assert(i < n_top);
+    for (j = n_top - 1; j > i; --j)
+        out_dist[j] = out_dist[j - 1];
+    out_dist[i].dist = dval;
+    out_dist[i].id = d;
+}
+
 /*
  * Compute the top-N closest gaussians from the chosen set (mgau,feat)
- * for the given input observation vector.
+ * for the given input observation vector.  On entry, out_dist holds
+ * the top-N from the last time this codebook was evaluated.  These
+ * are likely to be close to this frame too, so they are evaluated
+ * first to get a tight threshold for early termination on the rest.
  */
 static int32
-compute_dist(gauden_dist_t *out_dist, int32 n_top,
+compute_dist(gauden_dist_t *out_dist, int32 n_top, int32 *seed,
              mfcc_t *obs, int32 featlen,
              mfcc_t **mean, mfcc_t **var, mfcc_t *det,
              int32 n_density)
 {
-    int32 i, j, d;
-    gauden_dist_t *worst;
+    int32 i, j, d, n_seed;
 
     /* Special case optimization when n_density <= n_top */
     if (n_top >= n_density)
         return (compute_dist_all(out_dist, obs, featlen, mean, var, det, n_density));
 
+    /* Sort last frame's codewords so we can skip them below (they
+     * may not be unique, since out_dist starts out zeroed) */
+    for (n_seed = i = 0; i < n_top; i++) {
+        int32 id = out_dist[i].id;
+        for (j = 0; j < n_seed && seed[j] < id; j++)
+            ;
+        if (j < n_seed && seed[j] == id)
+            continue;
+        memmove(seed + j + 1, seed + j, (n_seed - j) * sizeof(*seed));
+        seed[j] = id;
+        ++n_seed;
+    }
+
     for (i = 0; i < n_top; i++)
         out_dist[i].dist = WORST_DIST;
-    worst = &(out_dist[n_top - 1]);
-
-    for (d = 0; d < n_density; d++) {
-        mfcc_t *m;
-        mfcc_t *v;
-        mfcc_t dval;
-
-        m = mean[d];
-        v = var[d];
-        dval = det[d];
-
-        for (i = 0; (i < featlen) && (dval >= worst->dist); i++) {
-            mfcc_t diff;
-            diff = obs[i] - m[i];
-            /* The compiler really likes this to be a single
-             * expression, for whatever reason. */
-            dval -= diff * diff * v[i];
-        }
-
-        if ((i < featlen) || (dval < worst->dist)) /* Codeword d worse than worst */
+    for (i = 0; i < n_seed; i++) {
+        d = seed[i];
+        compute_dist_one(out_dist, n_top, obs, featlen,
+                         mean[d], var[d], det[d], d);
+    }
+    for (i = d = 0; d < n_density; d++) {
+        if (i < n_seed && d == seed[i]) {
+            ++i;
             continue;
-
-        /* Codeword d at least as good as worst so far; insert in the ordered list */
-        for (i = 0; (i < n_top) && (dval < out_dist[i].dist); i++)
-            ;
-        assert(i < n_top);
-        for (j = n_top - 1; j > i; --j)
-            out_dist[j] = out_dist[j - 1];
-        out_dist[i].dist = dval;
-        out_dist[i].id = d;
+        }
+        compute_dist_one(out_dist, n_top, obs, featlen,
+                         mean[d], var[d], det[d], d);
     }
 
     return 0;
@@ -445,7 +494,7 @@ gauden_dist(gauden_t *g,
     assert((n_top > 0) && (n_top <= g->n_density));
 
     for (f = 0; f < g->n_feat; f++) {
-        compute_dist(out_dist[f], n_top,
+        compute_dist(out_dist[f], n_top, g->seed,
                      obs[f], g->featlen[f],
                      g->mean[mgau][f], g->var[mgau][f], g->det[mgau][f],
                      g->n_density);
@@ -456,6 +505,26 @@ gauden_dist(gauden_t *g,
     return 0;
 }
 
+int32
+gauden_dist_subset(gauden_t *g, int mgau, int feat, int32 n_top,
+                   mfcc_t *obs, gauden_dist_t *out_dist,
+                   int32 const *cw, int32 n_cw)
+{
+    int32 i;
+
+    assert((n_top > 0) && (n_top <= n_cw));
+    for (i = 0; i < n_top; i++)
+        out_dist[i].dist = WORST_DIST;
+    for (i = 0; i < n_cw; i++) {
+        int32 d = cw[i];
+        compute_dist_one(out_dist, n_top, obs, g->featlen[feat],
+                         g->mean[mgau][feat][d], g->var[mgau][feat][d],
+                         g->det[mgau][feat][d], d);
+    }
+
+    return 0;
+}
+
 int32
 gauden_mllr_transform(gauden_t *g, mllr_t *mllr, config_t *config)
 {
@@ -513,19 +582,23 @@ gauden_mllr_transform(gauden_t *g, mllr_t *mllr, config_t *config)
             temp = (float64 *)ckd_calloc(g->featlen[f], sizeof(float64));
             /* Transform each density d in selected codebook */
             for (d = 0; d < g->n_density; d++) {
+                /* Not precomputed yet, so these are floating-point
+                 * even if mfcc_t is not. */
+                float32 *mean = (float32 *)g->mean[i][f][d];
+                float32 *var = (float32 *)g->var[i][f][d];
                 int l;
                 for (l = 0; l < g->featlen[f]; l++) {
                     temp[l] = 0.0;
                     for (m = 0; m < g->featlen[f]; m++) {
                         /* FIXME: For now, only one class, hence the zeros below. */
-                        temp[l] += mllr->A[f][0][l][m] * g->mean[i][f][d][m];
+                        temp[l] += mllr->A[f][0][l][m] * mean[m];
                     }
                     temp[l] += mllr->b[f][0][l];
                 }
 
                 for (l = 0; l < g->featlen[f]; l++) {
-                    g->mean[i][f][d][l] = (float32)temp[l];
-                    g->var[i][f][d][l] *= mllr->h[f][0][l];
+                    mean[l] = (float32)temp[l];
+                    var[l] *= mllr->h[f][0][l];
                 }
             }
             ckd_free(temp);
@@ -75,9 +75,41 @@ static mgaufuncs_t ms_mgau_funcs = {
     "ms",
     ms_cont_mgau_frame_eval, /* frame_eval */
     ms_mgau_mllr_transform, /* transform */
-    ms_mgau_free /* free */
+    ms_mgau_free, /* free */
+    ms_mgau_tune, /* tune */
+    NULL, /* snapshot_save */
+    NULL /* snapshot_load */
 };
 
+/*
+ * Set up sub-vector quantized preselection if requested.
+ */
+static int
+ms_mgau_init_subvq(ms_mgau_model_t *msg)
+{
+    int32 n_rescore = config_int(msg->config, "subvq");
+
+    subvq_free(msg->svq);
+    msg->svq = NULL;
+    if (n_rescore <= 0)
+        return 0;
+    if (n_rescore < msg->max_topn) {
+        E_WARN("-subvq (%d) < -topn (%d); set to latter\n",
+               n_rescore, msg->max_topn);
+        n_rescore = msg->max_topn;
+    }
+    if (n_rescore >= msg->g->n_density) {
+        E_INFO("-subvq (%d) >= #density codewords (%d); not using sub-vector quantization\n",
+               n_rescore, msg->g->n_density);
+        return 0;
+    }
+    if ((msg->svq = subvq_init(msg->g, config_int(msg->config, "subvqsize"),
+                               n_rescore))
+        == NULL)
+        return -1;
+    return 0;
+}
+
 mgau_t *
 ms_mgau_init_s3file(acmod_t *acmod,
                     s3file_t *means, s3file_t *vars, s3file_t *mixw,
@@ -148,11 +180,14 @@ ms_mgau_init_s3file(acmod_t *acmod,
                msg->topn, msg->g->n_density);
         msg->topn = msg->g->n_density;
     }
+    msg->max_topn = msg->topn;
 
     msg->dist = (gauden_dist_t ***)
         ckd_calloc_3d(g->n_mgau, g->n_feat, msg->topn,
                       sizeof(gauden_dist_t));
     msg->mgau_active = ckd_calloc(g->n_mgau, sizeof(int8));
+    if (ms_mgau_init_subvq(msg) < 0)
+        goto error_out;
 
     mg = (mgau_t *)msg;
     mg->vt = &ms_mgau_funcs;
@@ -234,11 +269,14 @@ ms_mgau_init(acmod_t *acmod)
                msg->topn, msg->g->n_density);
         msg->topn = msg->g->n_density;
     }
+    msg->max_topn = msg->topn;
 
     msg->dist = (gauden_dist_t ***)
         ckd_calloc_3d(g->n_mgau, g->n_feat, msg->topn,
                       sizeof(gauden_dist_t));
     msg->mgau_active = ckd_calloc(g->n_mgau, sizeof(int8));
+    if (ms_mgau_init_subvq(msg) < 0)
+        goto error_out;
 
     mg = (mgau_t *)msg;
     mg->vt = &ms_mgau_funcs;
@@ -263,6 +301,7 @@ ms_mgau_free(mgau_t *mg)
         ckd_free_3d((void *)msg->dist);
     if (msg->mgau_active)
         ckd_free(msg->mgau_active);
+    subvq_free(msg->svq);
 
     ckd_free(msg);
 }
@@ -272,7 +311,38 @@ ms_mgau_mllr_transform(mgau_t *s,
                        mllr_t *mllr)
 {
     ms_mgau_model_t *msg = (ms_mgau_model_t *)s;
-    return gauden_mllr_transform(msg->g, mllr, msg->config);
+    if (gauden_mllr_transform(msg->g, mllr, msg->config) < 0)
+        return -1;
+    /* Sub-vector codebooks have to be retrained on the new means. */
+    return ms_mgau_init_subvq(msg);
+}
+
+int
+ms_mgau_tune(mgau_t *s, int *inout_topn, int *inout_ds)
+{
+    ms_mgau_model_t *msg = (ms_mgau_model_t *)s;
+
+    if (*inout_topn < 1)
+        *inout_topn = 1;
+    if (*inout_topn > msg->max_topn)
+        *inout_topn = msg->max_topn;
+    msg->topn = *inout_topn;
+    /* Frame downsampling is not supported (yet) */
+    *inout_ds = 0;
+    return 0;
+}
+
+/*
+ * Compute top-N Gaussians for a codebook, with preselection if
+ * enabled.
+ */
+static void
+ms_mgau_dist(ms_mgau_model_t *msg, int gid, int32 topn, mfcc_t **feat)
+{
+    if (msg->svq)
+        subvq_gauden_dist(msg->svq, msg->g, gid, topn, feat, msg->dist[gid]);
+    else
+        gauden_dist(msg->g, gid, topn, feat, msg->dist[gid]);
 }
 
 int32
@@ -295,20 +365,16 @@ ms_cont_mgau_frame_eval(mgau_t *mg,
     topn = ms_mgau_topn(msg);
     g = ms_mgau_gauden(msg);
     sen = ms_mgau_senone(msg);
+    if (msg->svq)
+        subvq_frame_eval(msg->svq, feat);
 
     if (compallsen) {
         int32 s;
 
         for (gid = 0; gid < g->n_mgau; gid++)
-            gauden_dist(g, gid, topn, feat, msg->dist[gid]);
+            ms_mgau_dist(msg, gid, topn, feat);
 
-        best = MAX_INT32;
-        for (s = 0; (uint32)s < sen->n_sen; s++) {
-            senscr[s] = senone_eval(sen, s, msg->dist[sen->mgau[s]], topn);
-            if (best > senscr[s]) {
-                best = senscr[s];
-            }
-        }
+        best = senone_eval_range(sen, msg->dist, topn, 0, sen->n_sen, senscr);
 
         /* Normalize senone scores */
         for (s = 0; (uint32)s < sen->n_sen; s++) {
@@ -336,19 +402,11 @@ ms_cont_mgau_frame_eval(mgau_t *mg,
         /* Compute topn gaussian density values (for active codebooks) */
         for (gid = 0; gid < g->n_mgau; gid++) {
             if (msg->mgau_active[gid])
-                gauden_dist(g, gid, topn, feat, msg->dist[gid]);
+                ms_mgau_dist(msg, gid, topn, feat);
         }
 
-        best = MAX_INT32;
-        n = 0;
-        for (i = 0; i < n_senone_active; i++) {
-            int32 s = senone_active[i] + n;
-            senscr[s] = senone_eval(sen, s, msg->dist[sen->mgau[s]], topn);
-            if (best > senscr[s]) {
-                best = senscr[s];
-            }
-            n = s;
-        }
+        best = senone_eval_active(sen, msg->dist, topn,
+                                  senone_active, n_senone_active, senscr);
 
         /* Normalize senone scores */
         n = 0;
@@ -210,6 +210,11 @@ senone_init_s3file(gauden_t *g,
 
     s = (senone_t *)ckd_calloc(1, sizeof(senone_t));
     s->lmath = logmath_init(logmath_get_base(lmath), SENSCR_SHIFT, TRUE);
+    s->logzero = logmath_get_zero(s->lmath);
+    if (logmath_get_width(s->lmath) == 1) {
+        s->logadd = (uint8 const *)LOGMATH_TABLE(s->lmath)->table;
+        s->logadd_size = LOGMATH_TABLE(s->lmath)->table_size;
+    }
     s->mixwfloor = mixwfloor;
 
     s->n_gauden = g->n_mgau;
@@ -307,44 +312,72 @@ senone_free(senone_t *s)
 }
 
 /*
- * Compute senone score for one senone.
- * NOTE:  Remember that senone PDF tables contain SCALED, NEGATED logs3 values.
- * NOTE:  Remember also that PDF data may be transposed or not depending on s->n_gauden.
+ * Scale a Gaussian density for combination with mixture weights.
  */
-int32
-senone_eval(senone_t *s, int id, gauden_dist_t **dist, int32 n_top)
+static inline int32
+senone_fden(mfcc_t dist)
+{
+    if (dist < (mfcc_t)MAX_NEG_INT32)
+        return MAX_NEG_INT32 >> SENSCR_SHIFT;
+    return ((int32)dist + ((1 << SENSCR_SHIFT) - 1)) >> SENSCR_SHIFT;
+}
+
+/*
+ * Exactly the same as logmath_add(), inlined for 8-bit tables, since
+ * this is the innermost loop of senone scoring.
+ */
+static inline int32
+senone_logadd(senone_t *s, int32 x, int32 y)
+{
+    int32 d, r;
+
+    if (s->logadd == NULL)
+        return logmath_add(s->lmath, x, y);
+    if (x <= s->logzero)
+        return y;
+    if (y <= s->logzero)
+        return x;
+    if (x > y) {
+        d = x - y;
+        r = x;
+    } else {
+        d = y - x;
+        r = y;
+    }
+    if (d < 0 || (uint32)d >= s->logadd_size)
+        return r;
+    return r + s->logadd[d];
+}
+
+/*
+ * Compute senone score for one senone.  This is inlined with a
+ * constant for transposed into the loops below, so that the choice
+ * of PDF layout is made once rather than for every codeword.
+ */
+static inline int32
+senone_eval_one(senone_t *s, int id, gauden_dist_t **dist, int32 n_top,
+                int transposed)
 {
     int32 scr; /* total senone score */
-    int32 fden; /* Gaussian density */
     int32 fscr; /* senone score for one feature */
     int32 fwscr; /* senone score for one feature, one codeword */
     int32 f, t;
     gauden_dist_t *fdist;
 
-    assert((id >= 0) && ((uint32)id < s->n_sen));
-    assert((n_top > 0) && ((uint32)n_top <= s->n_cw));
-
     scr = 0;
-
     for (f = 0; (uint32)f < s->n_feat; f++) {
         fdist = dist[f];
-
-        if (fdist[0].dist < (mfcc_t)MAX_NEG_INT32)
-            fden = MAX_NEG_INT32 >> SENSCR_SHIFT;
-        else
-            fden = ((int32)fdist[0].dist + ((1 << SENSCR_SHIFT) - 1)) >> SENSCR_SHIFT;
-        fscr = (s->n_gauden > 1)
-            ? (fden + -s->pdf[id][f][fdist[0].id]) /* untransposed */
-            : (fden + -s->pdf[f][fdist[0].id][id]); /* transposed */
+        fscr = senone_fden(fdist[0].dist)
+            - (transposed
+                   ? s->pdf[f][fdist[0].id][id]
+                   : s->pdf[id][f][fdist[0].id]);
         /* Remaining of n_top codewords for feature f */
         for (t = 1; t < n_top; t++) {
-            if (fdist[t].dist < (mfcc_t)MAX_NEG_INT32)
-                fden = MAX_NEG_INT32 >> SENSCR_SHIFT;
-            else
-                fden = ((int32)fdist[t].dist + ((1 << SENSCR_SHIFT) - 1)) >> SENSCR_SHIFT;
-
-            fwscr = (s->n_gauden > 1) ? (fden + -s->pdf[id][f][fdist[t].id]) : (fden + -s->pdf[f][fdist[t].id][id]);
-            fscr = logmath_add(s->lmath, fscr, fwscr);
+            fwscr = senone_fden(fdist[t].dist)
+                - (transposed
+                       ? s->pdf[f][fdist[t].id][id]
+                       : s->pdf[id][f][fdist[t].id]);
+            fscr = senone_logadd(s, fscr, fwscr);
         }
         /* Senone scores are also scaled, negated logs3 values.  Hence
          * we have to negate the stuff we calculated above. */
@@ -360,3 +393,72 @@ senone_eval(senone_t *s, int id, gauden_dist_t **dist, int32 n_top)
         scr = -32768;
     return scr;
 }
+
+/*
+ * Compute senone score for one senone.
+ * NOTE:  Remember that senone PDF tables contain SCALED, NEGATED logs3 values.
+ * NOTE:  Remember also that PDF data may be transposed or not depending on s->n_gauden.
+ */
+int32
+senone_eval(senone_t *s, int id, gauden_dist_t **dist, int32 n_top)
+{
+    assert((id >= 0) && ((uint32)id < s->n_sen));
+    assert((n_top > 0) && ((uint32)n_top <= s->n_cw));
+
+    if (s->n_gauden > 1)
+        return senone_eval_one(s, id, dist, n_top, FALSE);
+    else
+        return senone_eval_one(s, id, dist, n_top, TRUE);
+}
+
+int32
+senone_eval_range(senone_t *s, gauden_dist_t ***dist, int32 n_top,
+                  int32 start, int32 end, int16 *senscr)
+{
+    int32 i, best = MAX_INT32;
+
+    assert((n_top > 0) && ((uint32)n_top <= s->n_cw));
+    assert(start >= 0 && (uint32)end <= s->n_sen);
+    if (s->n_gauden > 1) {
+        for (i = start; i < end; ++i) {
+            senscr[i] = senone_eval_one(s, i, dist[s->mgau[i]], n_top, FALSE);
+            if (senscr[i] < best)
+                best = senscr[i];
+        }
+    } else {
+        for (i = start; i < end; ++i) {
+            senscr[i] = senone_eval_one(s, i, dist[0], n_top, TRUE);
+            if (senscr[i] < best)
+                best = senscr[i];
+        }
+    }
+    return best;
+}
+
+int32
+senone_eval_active(senone_t *s, gauden_dist_t ***dist, int32 n_top,
+                   uint8 const *senone_active, int32 n_senone_active,
+                   int16 *senscr)
+{
+    int32 i, n, best = MAX_INT32;
+
+    assert((n_top > 0) && ((uint32)n_top <= s->n_cw));
+    n = 0;
+    if (s->n_gauden > 1) {
+        for (i = 0; i < n_senone_active; i++) {
+            /* senone_active consists of deltas. */
+            n += senone_active[i];
+            senscr[n] = senone_eval_one(s, n, dist[s->mgau[n]], n_top, FALSE);
+            if (senscr[n] < best)
+                best = senscr[n];
+        }
+    } else {
+        for (i = 0; i < n_senone_active; i++) {
+            n += senone_active[i];
+            senscr[n] = senone_eval_one(s, n, dist[0], n_top, TRUE);
+            if (senscr[n] < best)
+                best = senscr[n];
+        }
+    }
+    return best;
+}
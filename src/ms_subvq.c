@@ -0,0 +1,325 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file ms_subvq.c
+ * @brief Sub-vector quantized Gaussian preselection for ms_gauden.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/ms_subvq.h>
+#include <soundswallower/tied_mgau_common.h>
+
+#define SUBVQ_MAX_ITER 10
+
+/*
+ * Vector quantize sub-vector [start, end) of the (mean, variance)
+ * pairs of all Gaussians in stream f with k-means.  Dimensions are
+ * scaled to unit variance so that means and (precomputed) variances
+ * count equally.  Codewords start out evenly spaced over the
+ * Gaussians, so the result is deterministic.
+ */
+static void
+subvq_train(subvq_t *vq, gauden_t *g, int32 f, int32 sv)
+{
+    int32 start = vq->sv_start[f][sv];
+    int32 svlen = vq->sv_start[f][sv + 1] - start;
+    int32 dim = svlen * 2;
+    int32 n_pts = vq->n_mgau * vq->n_density;
+    float64 *scale, *cw, *sum;
+    float32 *pts;
+    int32 *count, *assign;
+    int32 i, j, k, iter;
+
+    /* Gather (mean, var) pairs and scale them. */
+    pts = ckd_calloc((size_t)n_pts * dim, sizeof(*pts));
+    for (i = 0; i < n_pts; ++i) {
+        int32 m = i / vq->n_density, d = i % vq->n_density;
+        for (j = 0; j < svlen; ++j) {
+            pts[i * dim + j] = g->mean[m][f][d][start + j];
+            pts[i * dim + svlen + j] = g->var[m][f][d][start + j];
+        }
+    }
+    scale = ckd_calloc(dim, sizeof(*scale));
+    for (j = 0; j < dim; ++j) {
+        float64 mean = 0, var = 0;
+        for (i = 0; i < n_pts; ++i)
+            mean += pts[i * dim + j];
+        mean /= n_pts;
+        for (i = 0; i < n_pts; ++i)
+            var += (pts[i * dim + j] - mean) * (pts[i * dim + j] - mean);
+        var /= n_pts;
+        scale[j] = var > 0 ? 1.0 / sqrt(var) : 1.0;
+        for (i = 0; i < n_pts; ++i)
+            pts[i * dim + j] *= scale[j];
+    }
+
+    cw = ckd_calloc((size_t)vq->n_cw * dim, sizeof(*cw));
+    sum = ckd_calloc((size_t)vq->n_cw * dim, sizeof(*sum));
+    count = ckd_calloc(vq->n_cw, sizeof(*count));
+    assign = ckd_calloc(n_pts, sizeof(*assign));
+    for (k = 0; k < vq->n_cw; ++k) {
+        i = (int32)((int64)k * n_pts / vq->n_cw);
+        for (j = 0; j < dim; ++j)
+            cw[k * dim + j] = pts[i * dim + j];
+    }
+    for (iter = 0; iter < SUBVQ_MAX_ITER; ++iter) {
+        int32 changed = 0;
+        for (i = 0; i < n_pts; ++i) {
+            float64 best = HUGE_VAL;
+            int32 bestk = 0;
+            for (k = 0; k < vq->n_cw; ++k) {
+                float64 dist = 0;
+                for (j = 0; j < dim && dist < best; ++j) {
+                    float64 diff = pts[i * dim + j] - cw[k * dim + j];
+                    dist += diff * diff;
+                }
+                if (dist < best) {
+                    best = dist;
+                    bestk = k;
+                }
+            }
+            if (iter == 0 || assign[i] != bestk)
+                ++changed;
+            assign[i] = bestk;
+        }
+        if (changed == 0)
+            break;
+        memset(sum, 0, (size_t)vq->n_cw * dim * sizeof(*sum));
+        memset(count, 0, vq->n_cw * sizeof(*count));
+        for (i = 0; i < n_pts; ++i) {
+            ++count[assign[i]];
+            for (j = 0; j < dim; ++j)
+                sum[assign[i] * dim + j] += pts[i * dim + j];
+        }
+        /* Empty codewords just stay where they are. */
+        for (k = 0; k < vq->n_cw; ++k)
+            if (count[k])
+                for (j = 0; j < dim; ++j)
+                    cw[k * dim + j] = sum[k * dim + j] / count[k];
+    }
+
+    for (k = 0; k < vq->n_cw; ++k) {
+        for (j = 0; j < svlen; ++j) {
+            vq->mean[f][sv][k * svlen + j]
+                = (mfcc_t)(cw[k * dim + j] / scale[j]);
+            vq->var[f][sv][k * svlen + j]
+                = (mfcc_t)(cw[k * dim + svlen + j] / scale[svlen + j]);
+        }
+    }
+    for (i = 0; i < n_pts; ++i) {
+        int32 m = i / vq->n_density, d = i % vq->n_density;
+        vq->map[f][m][sv * vq->n_density + d] = (uint8)assign[i];
+    }
+
+    ckd_free(pts);
+    ckd_free(scale);
+    ckd_free(cw);
+    ckd_free(sum);
+    ckd_free(count);
+    ckd_free(assign);
+}
+
+subvq_t *
+subvq_init(gauden_t *g, int32 n_cw, int32 n_rescore)
+{
+    subvq_t *vq;
+    int32 f, sv;
+
+    if (n_cw < 1 || n_cw > 256) {
+        E_ERROR("Sub-vector codebook size must be between 1 and 256 (got %d)\n",
+                n_cw);
+        return NULL;
+    }
+    if (n_rescore < 1 || n_rescore > g->n_density) {
+        E_ERROR("Number of Gaussians to rescore must be between 1 and %d (got %d)\n",
+                g->n_density, n_rescore);
+        return NULL;
+    }
+    vq = ckd_calloc(1, sizeof(*vq));
+    vq->n_feat = g->n_feat;
+    vq->n_mgau = g->n_mgau;
+    vq->n_density = g->n_density;
+    vq->n_cw = n_cw;
+    if (vq->n_cw > vq->n_mgau * vq->n_density)
+        vq->n_cw = vq->n_mgau * vq->n_density;
+    vq->n_rescore = n_rescore;
+    vq->n_sv = ckd_calloc(vq->n_feat, sizeof(*vq->n_sv));
+    vq->sv_start = ckd_calloc(vq->n_feat, sizeof(*vq->sv_start));
+    vq->mean = ckd_calloc(vq->n_feat, sizeof(*vq->mean));
+    vq->var = ckd_calloc(vq->n_feat, sizeof(*vq->var));
+    vq->map = ckd_calloc(vq->n_feat, sizeof(*vq->map));
+    vq->dist = ckd_calloc(vq->n_feat, sizeof(*vq->dist));
+    for (f = 0; f < vq->n_feat; ++f) {
+        int32 featlen = g->featlen[f];
+        int32 n_sv = (featlen + SUBVQ_MAX_SVLEN - 1) / SUBVQ_MAX_SVLEN;
+
+        vq->n_sv[f] = n_sv;
+        vq->sv_start[f] = ckd_calloc(n_sv + 1, sizeof(**vq->sv_start));
+        for (sv = 0; sv <= n_sv; ++sv)
+            vq->sv_start[f][sv] = sv * featlen / n_sv;
+        vq->mean[f] = ckd_calloc(n_sv, sizeof(**vq->mean));
+        vq->var[f] = ckd_calloc(n_sv, sizeof(**vq->var));
+        for (sv = 0; sv < n_sv; ++sv) {
+            int32 svlen = vq->sv_start[f][sv + 1] - vq->sv_start[f][sv];
+            vq->mean[f][sv] = ckd_calloc(vq->n_cw * svlen, sizeof(***vq->mean));
+            vq->var[f][sv] = ckd_calloc(vq->n_cw * svlen, sizeof(***vq->var));
+        }
+        vq->map[f] = (uint8 **)ckd_calloc_2d(vq->n_mgau, vq->n_density * n_sv,
+                                             sizeof(***vq->map));
+        vq->dist[f] = (mfcc_t **)ckd_calloc_2d(n_sv, vq->n_cw,
+                                               sizeof(***vq->dist));
+        for (sv = 0; sv < n_sv; ++sv)
+            subvq_train(vq, g, f, sv);
+    }
+    vq->cand = ckd_calloc(vq->n_rescore, sizeof(*vq->cand));
+    vq->cand_id = ckd_calloc(vq->n_rescore, sizeof(*vq->cand_id));
+    vq->approx = ckd_calloc(vq->n_density, sizeof(*vq->approx));
+    E_INFO("Sub-vector quantized %d x %d Gaussians with %d codewords, rescoring %d\n",
+           vq->n_mgau, vq->n_density, vq->n_cw, vq->n_rescore);
+
+    return vq;
+}
+
+void
+subvq_free(subvq_t *vq)
+{
+    int32 f, sv;
+
+    if (vq == NULL)
+        return;
+    for (f = 0; f < vq->n_feat; ++f) {
+        for (sv = 0; sv < vq->n_sv[f]; ++sv) {
+            ckd_free(vq->mean[f][sv]);
+            ckd_free(vq->var[f][sv]);
+        }
+        ckd_free(vq->mean[f]);
+        ckd_free(vq->var[f]);
+        ckd_free(vq->sv_start[f]);
+        ckd_free_2d(vq->map[f]);
+        ckd_free_2d(vq->dist[f]);
+    }
+    ckd_free(vq->mean);
+    ckd_free(vq->var);
+    ckd_free(vq->sv_start);
+    ckd_free(vq->map);
+    ckd_free(vq->dist);
+    ckd_free(vq->n_sv);
+    ckd_free(vq->cand);
+    ckd_free(vq->cand_id);
+    ckd_free(vq->approx);
+    ckd_free(vq);
+}
+
+void
+subvq_frame_eval(subvq_t *vq, mfcc_t **obs)
+{
+    int32 f, sv, k, i;
+
+    for (f = 0; f < vq->n_feat; ++f) {
+        for (sv = 0; sv < vq->n_sv[f]; ++sv) {
+            int32 start = vq->sv_start[f][sv];
+            int32 svlen = vq->sv_start[f][sv + 1] - start;
+            mfcc_t *x = obs[f] + start;
+            mfcc_t *m = vq->mean[f][sv];
+            mfcc_t *v = vq->var[f][sv];
+
+            for (k = 0; k < vq->n_cw; ++k) {
+                mfcc_t dval = 0;
+                for (i = 0; i < svlen; ++i) {
+                    mfcc_t diff = x[i] - m[i];
+#ifdef FIXED_POINT
+                    dval = GMMSUB(dval, GMMCOMPL(diff, v[i]));
+#else
+                    dval -= diff * diff * v[i];
+#endif
+                }
+                vq->dist[f][sv][k] = dval;
+                m += svlen;
+                v += svlen;
+            }
+        }
+    }
+}
+
+int32
+subvq_gauden_dist(subvq_t *vq, gauden_t *g, int mgau, int32 n_top,
+                  mfcc_t **obs, gauden_dist_t **out_dist)
+{
+    int32 f;
+
+    assert(n_top <= vq->n_rescore);
+    for (f = 0; f < vq->n_feat; ++f) {
+        gauden_dist_t *cand = vq->cand;
+        mfcc_t *approx = vq->approx;
+        uint8 *map = vq->map[f][mgau];
+        int32 n_cand = 0;
+        int32 d, i, j, sv;
+
+        /* Approximate scores for all Gaussians, one sub-vector at a
+         * time (no branches, so this is faster than stopping early) */
+        memcpy(approx, g->det[mgau][f], vq->n_density * sizeof(*approx));
+        for (sv = 0; sv < vq->n_sv[f]; ++sv, map += vq->n_density) {
+            mfcc_t *dist = vq->dist[f][sv];
+            for (d = 0; d < vq->n_density; ++d) {
+#ifdef FIXED_POINT
+                int64 a = (int64)approx[d] + dist[map[d]];
+                approx[d] = (a < MAX_NEG_INT32) ? MAX_NEG_INT32 : (mfcc_t)a;
+#else
+                approx[d] += dist[map[d]];
+#endif
+            }
+        }
+        /* Keep the n_rescore best ones. */
+        for (d = 0; d < vq->n_density; ++d) {
+            mfcc_t dval = approx[d];
+            if (n_cand == vq->n_rescore && dval < cand[n_cand - 1].dist)
+                continue;
+            for (i = 0; i < n_cand && dval < cand[i].dist; ++i)
+                ;
+            if (n_cand < vq->n_rescore)
+                ++n_cand;
+            for (j = n_cand - 1; j > i; --j)
+                cand[j] = cand[j - 1];
+            cand[i].dist = dval;
+            cand[i].id = d;
+        }
+        for (i = 0; i < n_cand; ++i)
+            vq->cand_id[i] = cand[i].id;
+        gauden_dist_subset(g, mgau, f, n_top, obs[f], out_dist[f],
+                           vq->cand_id, n_cand);
+    }
+
+    return 0;
+}
@@ -0,0 +1,517 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file nn_mgau.c
+ * @brief Small feed-forward neural network senone scorer.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/configuration.h>
+#include <soundswallower/err.h>
+#include <soundswallower/feat.h>
+#include <soundswallower/hmm.h>
+#include <soundswallower/nn_mgau.h>
+
+#define NNET_PARAM_VERSION "1.0"
+
+static mgaufuncs_t nn_mgau_funcs = {
+    "nn",
+    nn_mgau_frame_eval, /* frame_eval */
+    nn_mgau_mllr_transform, /* transform */
+    nn_mgau_free, /* free */
+    NULL, /* tune */
+    NULL, /* snapshot_save */
+    NULL /* snapshot_load */
+};
+
+static int
+read_layer(nn_layer_t *l, s3file_t *s3f)
+{
+    int32 hdr[4];
+    uint32 n;
+    void *ptr;
+
+    if (s3file_get(hdr, sizeof(int32), 4, s3f) != 4) {
+        E_ERROR("Failed to read layer header\n");
+        return -1;
+    }
+    l->n_out = hdr[0];
+    l->n_in = hdr[1];
+    l->activation = hdr[2];
+    l->weight_type = hdr[3];
+    if (l->n_out <= 0 || l->n_in <= 0) {
+        E_ERROR("Invalid layer dimensions %d x %d\n", l->n_out, l->n_in);
+        return -1;
+    }
+    if (l->activation != NN_ACT_LINEAR && l->activation != NN_ACT_RELU) {
+        E_ERROR("Unknown activation function %d\n", l->activation);
+        return -1;
+    }
+    switch (l->weight_type) {
+    case NN_WEIGHT_FLOAT32:
+        if (s3file_get_1d(&ptr, sizeof(float32), &n, s3f) < 0)
+            return -1;
+        l->weights = ptr;
+        break;
+    case NN_WEIGHT_INT8:
+        if (s3file_get_1d(&ptr, sizeof(float32), &n, s3f) < 0)
+            return -1;
+        l->scale = ptr;
+        if (n != (uint32)l->n_out) {
+            E_ERROR("Number of row scales %d != %d\n", n, l->n_out);
+            return -1;
+        }
+        if (s3file_get_1d(&ptr, sizeof(int8), &n, s3f) < 0)
+            return -1;
+        l->qweights = ptr;
+        break;
+    default:
+        E_ERROR("Unknown weight type %d\n", l->weight_type);
+        return -1;
+    }
+    if (n != (uint32)l->n_out * l->n_in) {
+        E_ERROR("Number of weights %d != %d x %d\n", n, l->n_out, l->n_in);
+        return -1;
+    }
+    if (s3file_get_1d(&ptr, sizeof(float32), &n, s3f) < 0)
+        return -1;
+    l->bias = ptr;
+    if (n != (uint32)l->n_out) {
+        E_ERROR("Number of biases %d != %d\n", n, l->n_out);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+read_nnet(nn_mgau_t *s, s3file_t *s3f)
+{
+    uint32 n;
+    void *ptr;
+    size_t i;
+    int32 l;
+
+    if (s3file_parse_header(s3f, NNET_PARAM_VERSION) < 0) {
+        E_ERROR("Failed to read nnet header\n");
+        return -1;
+    }
+    s->feat_len = s->n_layer = -1;
+    for (i = 0; i < s3f->nhdr; i++) {
+        char *val;
+        int32 *dest = NULL;
+        if (s3file_header_name_is(s3f, i, "feat_len"))
+            dest = &s->feat_len;
+        else if (s3file_header_name_is(s3f, i, "ctx_left"))
+            dest = &s->ctx_left;
+        else if (s3file_header_name_is(s3f, i, "ctx_right"))
+            dest = &s->ctx_right;
+        else if (s3file_header_name_is(s3f, i, "n_layer"))
+            dest = &s->n_layer;
+        if (dest == NULL)
+            continue;
+        val = s3file_copy_header_value(s3f, i);
+        *dest = atoi(val);
+        ckd_free(val);
+    }
+    if (s->feat_len <= 0 || s->n_layer <= 0
+        || s->ctx_left < 0 || s->ctx_right < 0) {
+        E_ERROR("Missing or invalid feat_len, ctx_left, ctx_right, or n_layer "
+                "in nnet header\n");
+        return -1;
+    }
+
+    s->layers = ckd_calloc(s->n_layer, sizeof(*s->layers));
+    for (l = 0; l < s->n_layer; ++l) {
+        if (read_layer(s->layers + l, s3f) < 0) {
+            E_ERROR("Failed to read layer %d\n", l);
+            return -1;
+        }
+        if (l > 0 && s->layers[l].n_in != s->layers[l - 1].n_out) {
+            E_ERROR("Layer %d input dimension %d != %d\n",
+                    l, s->layers[l].n_in, s->layers[l - 1].n_out);
+            return -1;
+        }
+    }
+    if (s->layers[0].n_in != (s->ctx_left + 1 + s->ctx_right) * s->feat_len) {
+        E_ERROR("Input dimension %d != (%d + 1 + %d) x %d\n",
+                s->layers[0].n_in, s->ctx_left, s->ctx_right, s->feat_len);
+        return -1;
+    }
+    s->n_sen = s->layers[s->n_layer - 1].n_out;
+    if (s3file_get_1d(&ptr, sizeof(float32), &n, s3f) < 0)
+        return -1;
+    s->log_prior = ptr;
+    if (n != (uint32)s->n_sen) {
+        E_ERROR("Number of priors %d != %d\n", n, s->n_sen);
+        return -1;
+    }
+    if (s3file_verify_chksum(s3f) < 0)
+        return -1;
+
+    E_INFO("Read %d-layer network, %d x (%d + 1 + %d) inputs, %d outputs\n",
+           s->n_layer, s->feat_len, s->ctx_left, s->ctx_right, s->n_sen);
+    return 0;
+}
+
+mgau_t *
+nn_mgau_init_s3file(acmod_t *acmod, s3file_t *nnet)
+{
+    nn_mgau_t *s;
+    int32 feat_len, l, i;
+
+    s = ckd_calloc(1, sizeof(*s));
+    s->base.vt = &nn_mgau_funcs;
+    s->acmod = acmod;
+    if (read_nnet(s, nnet) < 0)
+        goto error_out;
+
+    feat_len = 0;
+    for (i = 0; i < feat_dimension1(acmod->fcb); ++i)
+        feat_len += feat_dimension2(acmod->fcb, i);
+    if (feat_len != s->feat_len) {
+        E_ERROR("Network feature length %d does not match feature length %d\n",
+                s->feat_len, feat_len);
+        goto error_out;
+    }
+    if (s->n_sen != bin_mdef_n_sen(acmod->mdef)) {
+        E_ERROR("Network outputs %d do not match number of senones %d\n",
+                s->n_sen, bin_mdef_n_sen(acmod->mdef));
+        goto error_out;
+    }
+
+    s->max_batch = config_int(acmod->config, "nnbatch");
+    if (s->max_batch < 1)
+        s->max_batch = 1;
+    s->max_dim = 0;
+    for (l = 0; l < s->n_layer; ++l) {
+        if (s->layers[l].n_in > s->max_dim)
+            s->max_dim = s->layers[l].n_in;
+        if (s->layers[l].n_out > s->max_dim)
+            s->max_dim = s->layers[l].n_out;
+    }
+    /* Log-likelihoods come out in natural log, senone scores are
+     * negated, shifted logmath values divided by the acoustic
+     * weight. */
+    s->inv_scale = 1.0 / (log(logmath_get_base(acmod->lmath))
+                          * (1 << SENSCR_SHIFT)
+                          * config_int(acmod->config, "aw"));
+
+    s->act_in = ckd_calloc_2d(s->max_batch, s->max_dim, sizeof(**s->act_in));
+    s->act_out = ckd_calloc_2d(s->max_batch, s->max_dim, sizeof(**s->act_out));
+    s->qin = ckd_calloc_2d(s->max_batch, s->max_dim, sizeof(**s->qin));
+    s->qin_scale = ckd_calloc(s->max_batch, sizeof(*s->qin_scale));
+    s->cache = ckd_calloc_2d(s->max_batch, s->n_sen, sizeof(**s->cache));
+    s->n_cache = 0;
+    E_INFO("Scoring up to %d frames per network evaluation\n", s->max_batch);
+
+    return ps_mgau_base(s);
+error_out:
+    nn_mgau_free(ps_mgau_base(s));
+    return NULL;
+}
+
+mgau_t *
+nn_mgau_init(acmod_t *acmod)
+{
+    s3file_t *nnet;
+    const char *path;
+    mgau_t *ps;
+
+    if ((path = config_str(acmod->config, "nnet")) == NULL) {
+        E_ERROR("No neural network file specified\n");
+        return NULL;
+    }
+    E_INFO("Reading neural network acoustic model: %s\n", path);
+    if ((nnet = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open neural network '%s' for reading", path);
+        return NULL;
+    }
+    ps = nn_mgau_init_s3file(acmod, nnet);
+    s3file_free(nnet);
+    return ps;
+}
+
+void
+nn_mgau_free(mgau_t *ps)
+{
+    nn_mgau_t *s = (nn_mgau_t *)ps;
+    int32 l;
+
+    if (s == NULL)
+        return;
+    if (s->layers) {
+        for (l = 0; l < s->n_layer; ++l) {
+            ckd_free(s->layers[l].weights);
+            ckd_free(s->layers[l].qweights);
+            ckd_free(s->layers[l].scale);
+            ckd_free(s->layers[l].bias);
+        }
+        ckd_free(s->layers);
+    }
+    ckd_free(s->log_prior);
+    ckd_free_2d(s->act_in);
+    ckd_free_2d(s->act_out);
+    ckd_free_2d(s->qin);
+    ckd_free(s->qin_scale);
+    ckd_free_2d(s->cache);
+    ckd_free(s);
+}
+
+int
+nn_mgau_mllr_transform(mgau_t *ps, mllr_t *mllr)
+{
+    (void)ps;
+    (void)mllr;
+    E_ERROR("MLLR is not supported for neural network acoustic models\n");
+    return -1;
+}
+
+/**
+ * Copy a frame of features, concatenating all streams.
+ */
+static void
+copy_feat(float32 *out, mfcc_t **feat, feat_t *fcb)
+{
+    int32 i, j;
+
+    for (i = 0; i < feat_dimension1(fcb); ++i) {
+        for (j = 0; j < (int32)feat_dimension2(fcb, i); ++j)
+            *out++ = MFCC2FLOAT(feat[i][j]);
+    }
+}
+
+/**
+ * Build spliced input vectors for n_frame frames starting at frame.
+ * Context frames which are not (or no longer) in the feature buffer
+ * are replaced by the nearest one that is.
+ */
+static void
+splice_input(nn_mgau_t *s, int32 frame, int32 n_frame,
+             int32 first_avail, int32 last_avail)
+{
+    acmod_t *acmod = s->acmod;
+    int32 b, c;
+
+    for (b = 0; b < n_frame; ++b) {
+        float32 *out = s->act_in[b];
+        for (c = -s->ctx_left; c <= s->ctx_right; ++c) {
+            int32 fr = frame + b + c;
+            mfcc_t **feat;
+            if (fr < first_avail)
+                fr = first_avail;
+            if (fr > last_avail)
+                fr = last_avail;
+            feat = acmod_get_frame(acmod, &fr);
+            copy_feat(out, feat, acmod->fcb);
+            out += s->feat_len;
+        }
+    }
+}
+
+/**
+ * Quantize layer inputs to 8 bits, one scale per frame.
+ */
+static void
+quantize_input(nn_mgau_t *s, int32 n_in, int32 n_frame)
+{
+    int32 b, k;
+
+    for (b = 0; b < n_frame; ++b) {
+        float32 const *x = s->act_in[b];
+        int8 *q = s->qin[b];
+        float32 maxabs = 0.0f, iscale;
+
+        for (k = 0; k < n_in; ++k) {
+            float32 a = fabsf(x[k]);
+            if (a > maxabs)
+                maxabs = a;
+        }
+        if (maxabs == 0.0f) {
+            memset(q, 0, n_in * sizeof(*q));
+            s->qin_scale[b] = 0.0f;
+            continue;
+        }
+        s->qin_scale[b] = maxabs / 127.0f;
+        iscale = 127.0f / maxabs;
+        for (k = 0; k < n_in; ++k)
+            q[k] = (int8)lrintf(x[k] * iscale);
+    }
+}
+
+/**
+ * Evaluate one layer for n_frame frames, from act_in to act_out.
+ *
+ * Each weight row is applied to every frame in the batch before
+ * moving on to the next, so that it is only fetched from memory
+ * once per batch.
+ */
+static void
+layer_eval(nn_mgau_t *s, nn_layer_t *l, int32 n_frame)
+{
+    int32 j, b, k;
+
+    if (l->weight_type == NN_WEIGHT_INT8) {
+        quantize_input(s, l->n_in, n_frame);
+        for (j = 0; j < l->n_out; ++j) {
+            int8 const *w = l->qweights + (size_t)j * l->n_in;
+            for (b = 0; b < n_frame; ++b) {
+                int8 const *x = s->qin[b];
+                int32 acc = 0;
+                for (k = 0; k < l->n_in; ++k)
+                    acc += (int32)w[k] * x[k];
+                s->act_out[b][j] = acc * s->qin_scale[b] * l->scale[j]
+                                   + l->bias[j];
+            }
+        }
+    } else {
+        for (j = 0; j < l->n_out; ++j) {
+            float32 const *w = l->weights + (size_t)j * l->n_in;
+            for (b = 0; b < n_frame; ++b) {
+                float32 const *x = s->act_in[b];
+                float32 acc = 0.0f;
+                for (k = 0; k < l->n_in; ++k)
+                    acc += w[k] * x[k];
+                s->act_out[b][j] = acc + l->bias[j];
+            }
+        }
+    }
+    if (l->activation == NN_ACT_RELU) {
+        for (b = 0; b < n_frame; ++b) {
+            for (j = 0; j < l->n_out; ++j) {
+                if (s->act_out[b][j] < 0.0f)
+                    s->act_out[b][j] = 0.0f;
+            }
+        }
+    }
+}
+
+/**
+ * Convert network outputs to normalized senone scores.
+ *
+ * The log-softmax normalizer is the same for all senones in a frame
+ * and is removed by normalizing to the best score, so it is never
+ * computed.
+ */
+static void
+output_to_senscr(nn_mgau_t *s, float32 const *out, int16 *senscr)
+{
+    float32 best;
+    int32 j;
+
+    best = -INFINITY;
+    for (j = 0; j < s->n_sen; ++j) {
+        float32 ll = out[j] - s->log_prior[j];
+        if (ll > best)
+            best = ll;
+    }
+    for (j = 0; j < s->n_sen; ++j) {
+        float32 ll = out[j] - s->log_prior[j];
+        int32 scr = (int32)((best - ll) * s->inv_scale);
+        if (scr > 32767)
+            scr = 32767;
+        senscr[j] = scr;
+    }
+}
+
+/**
+ * Run the network on n_frame frames starting at frame, filling the
+ * score cache.
+ */
+static void
+batch_eval(nn_mgau_t *s, int32 frame, int32 n_frame,
+           int32 first_avail, int32 last_avail)
+{
+    int32 l, b;
+
+    splice_input(s, frame, n_frame, first_avail, last_avail);
+    for (l = 0; l < s->n_layer; ++l) {
+        float32 **tmp;
+        layer_eval(s, s->layers + l, n_frame);
+        tmp = s->act_in;
+        s->act_in = s->act_out;
+        s->act_out = tmp;
+    }
+    for (b = 0; b < n_frame; ++b)
+        output_to_senscr(s, s->act_in[b], s->cache[b]);
+    s->cache_start = frame;
+    s->n_cache = n_frame;
+}
+
+int
+nn_mgau_frame_eval(mgau_t *ps,
+                   int16 *senone_scores,
+                   uint8 *senone_active,
+                   int32 n_senone_active,
+                   mfcc_t **featbuf, int32 frame,
+                   int32 compallsen)
+{
+    nn_mgau_t *s = (nn_mgau_t *)ps;
+    acmod_t *acmod = s->acmod;
+
+    (void)senone_active;
+    (void)n_senone_active;
+    (void)featbuf;
+    (void)compallsen;
+    /* A new utterance (or a rewind) restarts at frame 0, so never
+     * trust the cache there. */
+    if (frame == 0 || frame < s->cache_start
+        || frame >= s->cache_start + s->n_cache) {
+        int32 first_avail, last_avail, n_frame;
+
+        first_avail = acmod->output_frame
+                      - (acmod->n_feat_alloc - acmod->n_feat_frame);
+        if (first_avail < 0)
+            first_avail = 0;
+        last_avail = acmod->output_frame + acmod->n_feat_frame - 1;
+        if (last_avail < frame)
+            last_avail = frame;
+        /* Only score ahead those frames whose right context is
+         * complete, unless the utterance is over and it never will
+         * be.  The requested frame is scored regardless. */
+        n_frame = last_avail - frame + 1;
+        if (acmod->state != ACMOD_ENDED)
+            n_frame -= s->ctx_right;
+        if (n_frame > s->max_batch)
+            n_frame = s->max_batch;
+        if (n_frame < 1)
+            n_frame = 1;
+        batch_eval(s, frame, n_frame, first_avail, last_avail);
+    }
+    memcpy(senone_scores, s->cache[frame - s->cache_start],
+           s->n_sen * sizeof(*senone_scores));
+
+    return 0;
+}
@@ -48,6 +48,8 @@ struct endpointer_s {
     int pos, n;
     double qstart_time, timestamp;
     double speech_start, speech_end;
+    decoder_event_cb_t event_cb;
+    void *event_data;
 };
 
 endpointer_t *
@@ -126,6 +128,27 @@ endpointer_vad(endpointer_t *ep)
     return ep->vad;
 }
 
+void
+endpointer_set_event_callback(endpointer_t *ep, decoder_event_cb_t cb,
+                              void *user_data)
+{
+    ep->event_cb = cb;
+    ep->event_data = user_data;
+}
+
+static void
+ep_emit(endpointer_t *ep, decoder_event_type_t type, double time)
+{
+    decoder_event_t event;
+
+    if (ep->event_cb == NULL)
+        return;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.time = time;
+    (*ep->event_cb)(ep->event_data, &event);
+}
+
 static int
 ep_empty(endpointer_t *ep)
 {
@@ -277,6 +300,7 @@ endpointer_end_stream(endpointer_t *ep,
         }
     }
     ep_clear(ep);
+    ep_emit(ep, DECODER_EVENT_SPEECH_END, ep->speech_end);
     return ep->buf;
 }
 
@@ -306,6 +330,7 @@ endpointer_process(endpointer_t *ep,
             int16 *pcm = ep_pop(ep, NULL);
             ep->speech_end = ep->qstart_time;
             ep->in_speech = FALSE;
+            ep_emit(ep, DECODER_EVENT_SPEECH_END, ep->speech_end);
             return pcm;
         }
     } else {
@@ -313,6 +338,7 @@ endpointer_process(endpointer_t *ep,
             ep->speech_start = ep->qstart_time;
             ep->speech_end = 0;
             ep->in_speech = TRUE;
+            ep_emit(ep, DECODER_EVENT_SPEECH_START, ep->speech_start);
         }
     }
     if (ep->in_speech)
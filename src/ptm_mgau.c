@@ -57,13 +57,15 @@ static mgaufuncs_t ptm_mgau_funcs = {
     "ptm",
     ptm_mgau_frame_eval, /* frame_eval */
     ptm_mgau_mllr_transform, /* transform */
-    ptm_mgau_free /* free */
+    ptm_mgau_free, /* free */
+    ptm_mgau_tune, /* tune */
+    ptm_mgau_snapshot_save, /* snapshot_save */
+    ptm_mgau_snapshot_load /* snapshot_load */
 };
 
-#define COMPUTE_GMM_MAP(_idx)                       \
-    diff[_idx] = obs[_idx] - mean[_idx];            \
-    sqdiff[_idx] = MFCCMUL(diff[_idx], diff[_idx]); \
-    compl[_idx] = MFCCMUL(sqdiff[_idx], var[_idx]);
+#define COMPUTE_GMM_MAP(_idx)            \
+    diff[_idx] = obs[_idx] - mean[_idx]; \
+    compl[_idx] = GMMCOMPL(diff[_idx], var[_idx]);
 #define COMPUTE_GMM_REDUCE(_idx) \
     d = GMMSUB(d, compl[_idx]);
 
@@ -93,7 +95,7 @@ eval_topn(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
     ceplen = s->g->featlen[feat];
 
     for (i = 0; i < s->max_topn; i++) {
-        mfcc_t *mean, diff[4], sqdiff[4], compl[4]; /* diff, diff^2, component likelihood */
+        mfcc_t *mean, diff[4], compl[4]; /* diff, component likelihood */
         mfcc_t *var, d;
         mfcc_t *obs;
         int32 cw, j;
@@ -105,8 +107,7 @@ eval_topn(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
         obs = z;
         for (j = 0; j < ceplen % 4; ++j) {
             diff[0] = *obs++ - *mean++;
-            sqdiff[0] = MFCCMUL(diff[0], diff[0]);
-            compl[0] = MFCCMUL(sqdiff[0], *var);
+            compl[0] = GMMCOMPL(diff[0], *var);
             d = GMMSUB(d, compl[0]);
             ++var;
         }
@@ -164,7 +165,7 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
     ceplen = s->g->featlen[feat];
 
     for (detP = det; detP < detE; ++detP) {
-        mfcc_t diff[4], sqdiff[4], compl[4]; /* diff, diff^2, component likelihood */
+        mfcc_t diff[4], compl[4]; /* diff, component likelihood */
         mfcc_t d, thresh;
         mfcc_t *obs;
         ptm_topn_t *cur;
@@ -180,8 +181,7 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
          * "knocked out" by C0. In practice not. */
         for (j = 0; (j < ceplen % 4) && (d >= thresh); ++j) {
             diff[0] = *obs++ - *mean++;
-            sqdiff[0] = MFCCMUL(diff[0], diff[0]);
-            compl[0] = MFCCMUL(sqdiff[0], *var++);
+            compl[0] = GMMCOMPL(diff[0], *var++);
             d = GMMSUB(d, compl[0]);
         }
         /* Now do 4 dimensions at a time.  You'd think that GCC would
@@ -320,84 +320,203 @@ ptm_mgau_calc_cb_active(ptm_mgau_t *s, uint8 *senone_active,
     return 0;
 }
 
-/**
- * Compute senone scores from top-N densities for active codebooks.
+/*
+ * Set up to compute senone scores from top-N densities for active
+ * codebooks.  Because senone_active is deltas we can't really "knock
+ * out" senones from pruned codebooks, and in any case, it wouldn't
+ * make any difference to the search code, which doesn't expect
+ * senone_active to change, so instead their top-N get the worst
+ * possible score.
  */
+static void
+ptm_mgau_senone_prune(ptm_mgau_t *s)
+{
+    int cb, f, j;
+
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        if (bitvec_is_set(s->f->mgau_active, cb))
+            continue;
+        for (f = 0; f < s->g->n_feat; ++f)
+            for (j = 0; j < s->max_topn; ++j)
+                s->f->topn[cb][f][j].score = MAX_NEG_ASCR;
+    }
+}
+
+/*
+ * Group the senones to evaluate by codebook, in increasing order
+ * within each one, so that the mixture weights for each top-N
+ * codeword are read sequentially.  Returns the start of each
+ * codebook's senones in *out_sen, with n_mgau + 1 entries.
+ */
+static int32 const *
+ptm_mgau_senone_group(ptm_mgau_t *s, uint8 *senone_active,
+                      int32 n_senone_active, int compall,
+                      int32 const **out_sen)
+{
+    int32 *start = s->eval_start;
+    int32 i, cb, lastsen;
+
+    if (compall) {
+        *out_sen = s->cb_sen;
+        return s->cb_sen_start;
+    }
+    /* Counting sort (stable, since senone_active is in order). */
+    memset(start, 0, (s->g->n_mgau + 1) * sizeof(*start));
+    for (lastsen = i = 0; i < n_senone_active; ++i) {
+        lastsen += senone_active[i];
+        ++start[s->sen2cb[lastsen] + 1];
+    }
+    for (cb = 0; cb < s->g->n_mgau; ++cb)
+        start[cb + 1] += start[cb];
+    memcpy(s->eval_next, start, s->g->n_mgau * sizeof(*start));
+    for (lastsen = i = 0; i < n_senone_active; ++i) {
+        lastsen += senone_active[i];
+        s->eval_sen[s->eval_next[s->sen2cb[lastsen]]++] = lastsen;
+    }
+    *out_sen = s->eval_sen;
+    return start;
+}
+
+/* Normalize the scores again (finishing the job we started above in
+ * ptm_mgau_codebook_eval...)  Only the senones we evaluated are
+ * touched, since nobody looks at the others. */
+static void
+ptm_mgau_senone_norm(int16 *senone_scores, int32 const *sen, int32 n,
+                     int32 bestscore)
+{
+    int32 i;
+
+    for (i = 0; i < n; ++i)
+        senone_scores[sen[i]] -= bestscore;
+}
+
+/*
+ * Store the scores for a codebook's senones and return the best one.
+ */
+static int32
+ptm_mgau_senone_store(int16 *senone_scores, int32 const *sen,
+                      int32 const *ascore, int n, int32 bestscore)
+{
+    int k;
+
+    for (k = 0; k < n; ++k) {
+        if (ascore[k] < bestscore)
+            bestscore = ascore[k];
+        senone_scores[sen[k]] = ascore[k];
+    }
+    return bestscore;
+}
+
+/*
+ * One kernel for each way of storing mixture weights, chosen once in
+ * ptm_mgau_init_s3file(), so that the inner loop does nothing but
+ * look up weights and log-add them to codeword scores.  Senones are
+ * evaluated codeword by codeword: for each active codebook and
+ * feature, log-sum codeword scores + mixw to get feature density,
+ * one top-N codeword at a time (so mixw is read one row at a time),
+ * then sum (multiply) to get ascore.
+ */
+
+/* 8-bit weights, indexed directly by senone. */
 static int
-ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
-                     uint8 *senone_active, int32 n_senone_active,
-                     int compall)
+ptm_mgau_senone_eval_8b(ptm_mgau_t *s, int16 *senone_scores,
+                        uint8 *senone_active, int32 n_senone_active,
+                        int compall)
 {
-    int32 i, lastsen, bestscore;
-
-    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
-    /* FIXME: This is the non-cache-efficient way to do this.  We want
-     * to evaluate one codeword at a time but this requires us to have
-     * a reverse codebook to senone mapping, which we don't have
-     * (yet), since different codebooks have different top-N
-     * codewords. */
-    if (compall)
-        n_senone_active = s->n_sen;
+    int32 const *sen, *start;
+    int32 bestscore;
+    int cb;
+
+    ptm_mgau_senone_prune(s);
+    start = ptm_mgau_senone_group(s, senone_active, n_senone_active,
+                                  compall, &sen);
     bestscore = MAX_INT32;
-    for (lastsen = i = 0; i < n_senone_active; ++i) {
-        int sen, f, cb;
-        int ascore;
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        int32 const *cbsen = sen + start[cb];
+        int32 *fden = s->eval_fden, *ascore = s->eval_ascore;
+        int n = start[cb + 1] - start[cb];
+        int f, j, k;
 
-        if (compall)
-            sen = i;
-        else
-            sen = senone_active[i] + lastsen;
-        lastsen = sen;
-        cb = s->sen2cb[sen];
-
-        if (bitvec_is_clear(s->f->mgau_active, cb)) {
-            int j;
-            /* Because senone_active is deltas we can't really "knock
-             * out" senones from pruned codebooks, and in any case,
-             * it wouldn't make any difference to the search code,
-             * which doesn't expect senone_active to change. */
-            for (f = 0; f < s->g->n_feat; ++f) {
-                for (j = 0; j < s->max_topn; ++j) {
-                    s->f->topn[cb][f][j].score = MAX_NEG_ASCR;
-                }
+        if (n == 0)
+            continue;
+        memset(ascore, 0, n * sizeof(*ascore));
+        for (f = 0; f < s->g->n_feat; ++f) {
+            ptm_topn_t *topn = s->f->topn[cb][f];
+            uint8 const *mixw = s->mixw[f][topn[0].cw];
+            int score = topn[0].score;
+
+            for (k = 0; k < n; ++k)
+                fden[k] = mixw[cbsen[k]] + score;
+            for (j = 1; j < s->max_topn; ++j) {
+                mixw = s->mixw[f][topn[j].cw];
+                score = topn[j].score;
+                for (k = 0; k < n; ++k)
+                    fden[k] = fast_logmath_add(s->lmath_8b, fden[k],
+                                               mixw[cbsen[k]] + score);
             }
+            for (k = 0; k < n; ++k)
+                ascore[k] += fden[k];
         }
-        /* For each feature, log-sum codeword scores + mixw to get
-         * feature density, then sum (multiply) to get ascore */
-        ascore = 0;
+        bestscore = ptm_mgau_senone_store(senone_scores, cbsen,
+                                          ascore, n, bestscore);
+    }
+    ptm_mgau_senone_norm(senone_scores, sen, start[s->g->n_mgau], bestscore);
+
+    return 0;
+}
+
+/* 4-bit indices into a 16-entry codebook, two senones per byte (the
+ * odd one in the high nibble). */
+static int
+ptm_mgau_senone_eval_4b(ptm_mgau_t *s, int16 *senone_scores,
+                        uint8 *senone_active, int32 n_senone_active,
+                        int compall)
+{
+    int32 const *sen, *start;
+    int32 bestscore;
+    uint8 const *mixw_cb = s->mixw_cb;
+    int cb;
+
+    ptm_mgau_senone_prune(s);
+    start = ptm_mgau_senone_group(s, senone_active, n_senone_active,
+                                  compall, &sen);
+    bestscore = MAX_INT32;
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        int32 const *cbsen = sen + start[cb];
+        int32 *fden = s->eval_fden, *ascore = s->eval_ascore;
+        int n = start[cb + 1] - start[cb];
+        int f, j, k;
+
+        if (n == 0)
+            continue;
+        memset(ascore, 0, n * sizeof(*ascore));
         for (f = 0; f < s->g->n_feat; ++f) {
-            ptm_topn_t *topn;
-            int j, fden = 0;
-            topn = s->f->topn[cb][f];
-            for (j = 0; j < s->max_topn; ++j) {
-                int mixw;
-                /* Find mixture weight for this codeword. */
-                if (s->mixw_cb) {
-                    int dcw = s->mixw[f][topn[j].cw][sen / 2];
-                    dcw = (dcw & 1) ? dcw >> 4 : dcw & 0x0f;
-                    mixw = s->mixw_cb[dcw];
-                } else {
-                    mixw = s->mixw[f][topn[j].cw][sen];
+            ptm_topn_t *topn = s->f->topn[cb][f];
+            uint8 const *mixw = s->mixw[f][topn[0].cw];
+            int score = topn[0].score;
+
+            for (k = 0; k < n; ++k) {
+                int32 sk = cbsen[k];
+                fden[k] = mixw_cb[(mixw[sk >> 1] >> ((sk & 1) << 2)) & 0x0f]
+                    + score;
+            }
+            for (j = 1; j < s->max_topn; ++j) {
+                mixw = s->mixw[f][topn[j].cw];
+                score = topn[j].score;
+                for (k = 0; k < n; ++k) {
+                    int32 sk = cbsen[k];
+                    fden[k] = fast_logmath_add(s->lmath_8b, fden[k],
+                                               mixw_cb[(mixw[sk >> 1] >> ((sk & 1) << 2)) & 0x0f]
+                                                   + score);
                 }
-                if (j == 0)
-                    fden = mixw + topn[j].score;
-                else
-                    fden = fast_logmath_add(s->lmath_8b, fden,
-                                            mixw + topn[j].score);
-                E_DEBUG("fden[%d][%d] l+= %d + %d = %d\n",
-                        sen, f, mixw, topn[j].score, fden);
             }
-            ascore += fden;
+            for (k = 0; k < n; ++k)
+                ascore[k] += fden[k];
         }
-        if (ascore < bestscore)
-            bestscore = ascore;
-        senone_scores[sen] = ascore;
-    }
-    /* Normalize the scores again (finishing the job we started above
-     * in ptm_mgau_codebook_eval...) */
-    for (i = 0; i < s->n_sen; ++i) {
-        senone_scores[i] -= bestscore;
+        bestscore = ptm_mgau_senone_store(senone_scores, cbsen,
+                                          ascore, n, bestscore);
     }
+    ptm_mgau_senone_norm(senone_scores, sen, start[s->g->n_mgau], bestscore);
 
     return 0;
 }
@@ -438,7 +557,7 @@ ptm_mgau_frame_eval(mgau_t *ps,
             lastf = s->hist + fast_eval_idx - 1;
         /* Copy in initial top-N info */
         memcpy(s->f->topn[0][0], lastf->topn[0][0],
-               s->g->n_mgau * s->g->n_feat * s->max_topn * sizeof(ptm_topn_t));
+               s->g->n_mgau * s->g->n_feat * s->alloc_topn * sizeof(ptm_topn_t));
         /* Generate initial active codebook list (this might not be
          * necessary) */
         ptm_mgau_calc_cb_active(s, senone_active, n_senone_active, compallsen);
@@ -447,12 +566,44 @@ ptm_mgau_frame_eval(mgau_t *ps,
         ptm_mgau_codebook_norm(s, featbuf, frame);
     }
     /* Evaluate intersection of active senones and active codebooks. */
-    ptm_mgau_senone_eval(s, senone_scores, senone_active,
-                         n_senone_active, compallsen);
+    s->senone_eval(s, senone_scores, senone_active,
+                   n_senone_active, compallsen);
 
     return 0;
 }
 
+/* Only the top-N for the last frame scored is used in the next one. */
+void
+ptm_mgau_snapshot_save(mgau_t *ps, snapshot_t *sn)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    int idx = (ps->frame_idx + s->n_fast_hist - 1) % s->n_fast_hist;
+
+    snapshot_write_int32(sn, s->g->n_mgau);
+    snapshot_write_int32(sn, s->g->n_feat);
+    snapshot_write_int32(sn, s->alloc_topn);
+    snapshot_write(sn, s->hist[idx].topn[0][0],
+                   s->g->n_mgau * s->g->n_feat * s->alloc_topn
+                       * sizeof(ptm_topn_t));
+}
+
+int
+ptm_mgau_snapshot_load(mgau_t *ps, snapshot_t *sn)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    int idx = (ps->frame_idx + s->n_fast_hist - 1) % s->n_fast_hist;
+
+    if (snapshot_read_int32(sn) != s->g->n_mgau
+        || snapshot_read_int32(sn) != s->g->n_feat
+        || snapshot_read_int32(sn) != s->alloc_topn) {
+        E_ERROR("Snapshot has a different number of codebooks or top-N\n");
+        return -1;
+    }
+    return snapshot_read(sn, s->hist[idx].topn[0][0],
+                         s->g->n_mgau * s->g->n_feat * s->alloc_topn
+                             * sizeof(ptm_topn_t));
+}
+
 int
 read_sendump(s3file_t *s3f, gauden_t *g,
              int32 mdef_n_sen, uint8 **out_mixw_cb,
@@ -576,7 +727,13 @@ read_sendump(s3file_t *s3f, gauden_t *g,
         ++n_clust;
 
     if (!((n_bits == 8) || (n_bits == 4))) {
-        E_ERROR("Cluster count must be 4 or 8\n");
+        E_ERROR("Cluster bits must be 4 or 8\n");
+        return -1;
+    }
+    /* Senone evaluation only knows these two layouts. */
+    if ((n_clust != 0) != (n_bits == 4)) {
+        E_ERROR("Only 4-bit mixture weights can be clustered (%d clusters, %d bits)\n",
+                n_clust, n_bits);
         return -1;
     }
 
@@ -691,6 +848,52 @@ read_mixw(s3file_t *s3f, gauden_t *g, logmath_t *lmath,
     return n_sen;
 }
 
+/*
+ * Build the reverse of sen2cb, from codebooks to their senones, and
+ * allocate space to evaluate them.
+ */
+static void
+ptm_mgau_init_cb_sen(ptm_mgau_t *s)
+{
+    int32 i, cb, max_cb_sen;
+
+    s->cb_sen_start = ckd_calloc(s->g->n_mgau + 1, sizeof(*s->cb_sen_start));
+    s->cb_sen = ckd_calloc(s->n_sen, sizeof(*s->cb_sen));
+    for (i = 0; i < s->n_sen; ++i)
+        ++s->cb_sen_start[s->sen2cb[i] + 1];
+    max_cb_sen = 0;
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        if (s->cb_sen_start[cb + 1] > max_cb_sen)
+            max_cb_sen = s->cb_sen_start[cb + 1];
+        s->cb_sen_start[cb + 1] += s->cb_sen_start[cb];
+    }
+    s->eval_next = ckd_calloc(s->g->n_mgau, sizeof(*s->eval_next));
+    memcpy(s->eval_next, s->cb_sen_start, s->g->n_mgau * sizeof(*s->eval_next));
+    for (i = 0; i < s->n_sen; ++i)
+        s->cb_sen[s->eval_next[s->sen2cb[i]]++] = i;
+
+    s->eval_sen = ckd_calloc(s->n_sen, sizeof(*s->eval_sen));
+    s->eval_start = ckd_calloc(s->g->n_mgau + 1, sizeof(*s->eval_start));
+    s->eval_fden = ckd_calloc(max_cb_sen, sizeof(*s->eval_fden));
+    s->eval_ascore = ckd_calloc(max_cb_sen, sizeof(*s->eval_ascore));
+}
+
+static void
+ptm_mgau_init_topn(ptm_mgau_t *s, ptm_topn_t ***topn)
+{
+    int j, k, m;
+
+    /* Initialize them to sane (yet arbitrary) defaults. */
+    for (j = 0; j < s->g->n_mgau; ++j) {
+        for (k = 0; k < s->g->n_feat; ++k) {
+            for (m = 0; m < s->alloc_topn; ++m) {
+                topn[j][k][m].cw = m;
+                topn[j][k][m].score = WORST_DIST;
+            }
+        }
+    }
+}
+
 void
 ptm_mgau_reset_fast_hist(mgau_t *ps)
 {
@@ -698,19 +901,10 @@ ptm_mgau_reset_fast_hist(mgau_t *ps)
     int i;
 
     for (i = 0; i < s->n_fast_hist; ++i) {
-        int j, k, m;
         /* Top-N codewords for every codebook and feature. */
         s->hist[i].topn = ckd_calloc_3d(s->g->n_mgau, s->g->n_feat,
-                                        s->max_topn, sizeof(ptm_topn_t));
-        /* Initialize them to sane (yet arbitrary) defaults. */
-        for (j = 0; j < s->g->n_mgau; ++j) {
-            for (k = 0; k < s->g->n_feat; ++k) {
-                for (m = 0; m < s->max_topn; ++m) {
-                    s->hist[i].topn[j][k][m].cw = m;
-                    s->hist[i].topn[j][k][m].score = WORST_DIST;
-                }
-            }
-        }
+                                        s->alloc_topn, sizeof(ptm_topn_t));
+        ptm_mgau_init_topn(s, s->hist[i].topn);
         /* Active codebook mapping (just codebook, not features,
            at least not yet) */
         s->hist[i].mgau_active = bitvec_alloc(s->g->n_mgau);
@@ -788,8 +982,14 @@ ptm_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
         if (read_mixw(mixw, s->g, s->lmath_8b, &s->n_sen, &s->mixw, mixw_floor) < 0)
             goto error_out;
     }
+    if (s->mixw_cb) {
+        E_INFO("Using 4-bit quantized mixture weights\n");
+        s->senone_eval = ptm_mgau_senone_eval_4b;
+    } else {
+        s->senone_eval = ptm_mgau_senone_eval_8b;
+    }
     s->ds_ratio = config_int(s->config, "ds");
-    s->max_topn = config_int(s->config, "topn");
+    s->alloc_topn = s->max_topn = config_int(s->config, "topn");
     E_INFO("Maximum top-N: %d\n", s->max_topn);
 
     /* Assume mapping of senones to their base phones, though this
@@ -797,6 +997,7 @@ ptm_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
     s->sen2cb = ckd_calloc(s->n_sen, sizeof(*s->sen2cb));
     for (i = 0; i < s->n_sen; ++i)
         s->sen2cb[i] = (uint8)bin_mdef_sen2cimap(acmod->mdef, i);
+    ptm_mgau_init_cb_sen(s);
 
     /* Allocate fast-match history buffers.  We need enough for the
      * phoneme lookahead window, plus the current frame, plus one for
@@ -870,6 +1071,31 @@ ptm_mgau_mllr_transform(mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
+int
+ptm_mgau_tune(mgau_t *ps, int *inout_topn, int *inout_ds)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    int topn = *inout_topn;
+    int i;
+
+    if (topn < 1)
+        topn = 1;
+    if (topn > s->alloc_topn)
+        topn = s->alloc_topn;
+    /* Codewords left over past the old top-N may duplicate the ones
+     * in it, so start over when it grows. */
+    if (topn > s->max_topn) {
+        for (i = 0; i < s->n_fast_hist; ++i)
+            ptm_mgau_init_topn(s, s->hist[i].topn);
+    }
+    s->max_topn = topn;
+    if (*inout_ds > 0)
+        s->ds_ratio = *inout_ds;
+    *inout_topn = topn;
+    *inout_ds = s->ds_ratio;
+    return 0;
+}
+
 void
 ptm_mgau_free(mgau_t *ps)
 {
@@ -885,6 +1111,13 @@ ptm_mgau_free(mgau_t *ps)
         ckd_free_3d(s->mixw);
     }
     ckd_free(s->sen2cb);
+    ckd_free(s->cb_sen);
+    ckd_free(s->cb_sen_start);
+    ckd_free(s->eval_sen);
+    ckd_free(s->eval_start);
+    ckd_free(s->eval_next);
+    ckd_free(s->eval_fden);
+    ckd_free(s->eval_ascore);
 
     for (i = 0; i < s->n_fast_hist; i++) {
         ckd_free_3d(s->hist[i].topn);
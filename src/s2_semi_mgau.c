@@ -57,7 +57,10 @@ static mgaufuncs_t s2_semi_mgau_funcs = {
     "s2_semi",
     s2_semi_mgau_frame_eval, /* frame_eval */
     s2_semi_mgau_mllr_transform, /* transform */
-    s2_semi_mgau_free /* free */
+    s2_semi_mgau_free, /* free */
+    s2_semi_mgau_tune, /* tune */
+    s2_semi_mgau_snapshot_save, /* snapshot_save */
+    s2_semi_mgau_snapshot_load /* snapshot_load */
 };
 
 struct vqFeature_s {
@@ -75,7 +78,7 @@ eval_topn(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
     ceplen = s->g->featlen[feat];
 
     for (i = 0; i < s->max_topn; i++) {
-        mfcc_t *mean, diff, sqdiff, compl; /* diff, diff^2, component likelihood */
+        mfcc_t *mean, diff, compl; /* diff, component likelihood */
         vqFeature_t vtmp;
         mfcc_t *var, d;
         mfcc_t *obs;
@@ -88,8 +91,7 @@ eval_topn(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
         obs = z;
         for (j = 0; j < ceplen; j++) {
             diff = *obs++ - *mean++;
-            sqdiff = MFCCMUL(diff, diff);
-            compl = MFCCMUL(sqdiff, *var);
+            compl = GMMCOMPL(diff, *var);
             d = GMMSUB(d, compl);
             ++var;
         }
@@ -124,7 +126,7 @@ eval_cb(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
     ceplen = s->g->featlen[feat];
 
     for (detP = det; detP < detE; ++detP) {
-        mfcc_t diff, sqdiff, compl; /* diff, diff^2, component likelihood */
+        mfcc_t diff, compl; /* diff, component likelihood */
         mfcc_t d;
         mfcc_t *obs;
         vqFeature_t *cur;
@@ -135,8 +137,7 @@ eval_cb(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
         cw = (int)(detP - det);
         for (j = 0; (j < ceplen) && (d >= worst->score); ++j) {
             diff = *obs++ - *mean++;
-            sqdiff = MFCCMUL(diff, diff);
-            compl = MFCCMUL(sqdiff, *var);
+            compl = GMMCOMPL(diff, *var);
             d = GMMSUB(d, compl);
             ++var;
         }
@@ -168,6 +169,21 @@ eval_cb(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
     }
 }
 
+static void
+s2_semi_mgau_init_topn(s2_semi_mgau_t *s)
+{
+    int i, j, k;
+
+    for (i = 0; i < s->n_topn_hist; ++i) {
+        for (j = 0; j < s->g->n_feat; ++j) {
+            for (k = 0; k < s->alloc_topn; ++k) {
+                s->topn_hist[i][j][k].score = WORST_DIST;
+                s->topn_hist[i][j][k].codeword = k;
+            }
+        }
+    }
+}
+
 static void
 mgau_dist(s2_semi_mgau_t *s, int32 frame, int32 feat, mfcc_t *z)
 {
@@ -838,7 +854,17 @@ s2_semi_mgau_frame_eval(mgau_t *ps,
     int i, topn_idx;
     int n_feat = s->g->n_feat;
 
-    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
+    /* Scores are accumulated over features, so clear the ones we
+     * will compute (nobody looks at the others). */
+    if (compallsen)
+        memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
+    else {
+        int32 lastsen = 0;
+        for (i = 0; i < n_senone_active; ++i) {
+            lastsen += senone_active[i];
+            senone_scores[lastsen] = 0;
+        }
+    }
     /* No bounds checking is done here, which just means you'll get
      * semi-random crap if you request a frame in the future or one
      * that's too far in the past. */
@@ -874,6 +900,36 @@ s2_semi_mgau_frame_eval(mgau_t *ps,
     return 0;
 }
 
+/* Only the top-N for the last frame scored is used in the next one. */
+void
+s2_semi_mgau_snapshot_save(mgau_t *ps, snapshot_t *sn)
+{
+    s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
+    int idx = (ps->frame_idx + s->n_topn_hist - 1) % s->n_topn_hist;
+
+    snapshot_write_int32(sn, s->g->n_feat);
+    snapshot_write_int32(sn, s->alloc_topn);
+    snapshot_write(sn, s->topn_hist[idx][0],
+                   s->g->n_feat * s->alloc_topn * sizeof(vqFeature_t));
+    snapshot_write(sn, s->topn_hist_n[idx], s->g->n_feat);
+}
+
+int
+s2_semi_mgau_snapshot_load(mgau_t *ps, snapshot_t *sn)
+{
+    s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
+    int idx = (ps->frame_idx + s->n_topn_hist - 1) % s->n_topn_hist;
+
+    if (snapshot_read_int32(sn) != s->g->n_feat
+        || snapshot_read_int32(sn) != s->alloc_topn) {
+        E_ERROR("Snapshot has a different number of features or top-N\n");
+        return -1;
+    }
+    snapshot_read(sn, s->topn_hist[idx][0],
+                  s->g->n_feat * s->alloc_topn * sizeof(vqFeature_t));
+    return snapshot_read(sn, s->topn_hist_n[idx], s->g->n_feat);
+}
+
 static int
 split_topn(const char *str, uint8 *out, int nfeat)
 {
@@ -974,7 +1030,7 @@ s2_semi_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
 
     /* Determine top-N for each feature */
     s->topn_beam = ckd_calloc(n_feat, sizeof(*s->topn_beam));
-    s->max_topn = config_int(s->config, "topn");
+    s->alloc_topn = s->max_topn = config_int(s->config, "topn");
     split_topn(config_str(s->config, "topn_beam"), s->topn_beam, n_feat);
     E_INFO("Maximum top-N: %d ", s->max_topn);
     E_INFOCONT("Top-N beams:");
@@ -990,16 +1046,7 @@ s2_semi_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
                       sizeof(***s->topn_hist));
     s->topn_hist_n = ckd_calloc_2d(s->n_topn_hist, n_feat,
                                    sizeof(**s->topn_hist_n));
-    for (i = 0; i < s->n_topn_hist; ++i) {
-        int j;
-        for (j = 0; j < n_feat; ++j) {
-            int k;
-            for (k = 0; k < s->max_topn; ++k) {
-                s->topn_hist[i][j][k].score = WORST_DIST;
-                s->topn_hist[i][j][k].codeword = k;
-            }
-        }
-    }
+    s2_semi_mgau_init_topn(s);
 
     ps = (mgau_t *)s;
     ps->vt = &s2_semi_mgau_funcs;
@@ -1065,6 +1112,28 @@ s2_semi_mgau_mllr_transform(mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
+int
+s2_semi_mgau_tune(mgau_t *ps, int *inout_topn, int *inout_ds)
+{
+    s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
+    int topn = *inout_topn;
+
+    if (topn < 1)
+        topn = 1;
+    if (topn > s->alloc_topn)
+        topn = s->alloc_topn;
+    /* Codewords left over past the old top-N may duplicate the ones
+     * in it, so start over when it grows. */
+    if (topn > s->max_topn)
+        s2_semi_mgau_init_topn(s);
+    s->max_topn = topn;
+    if (*inout_ds > 0)
+        s->ds_ratio = *inout_ds;
+    *inout_topn = topn;
+    *inout_ds = s->ds_ratio;
+    return 0;
+}
+
 void
 s2_semi_mgau_free(mgau_t *ps)
 {
@@ -0,0 +1,124 @@
+/* -*- c-basic-offset:4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2024 David Huggins-Daines.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+/**
+ * @file snapshot.c
+ * @brief Serialization of decoder state in the middle of an utterance.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/snapshot.h>
+
+snapshot_t *
+snapshot_init(void)
+{
+    snapshot_t *s = ckd_calloc(1, sizeof(*s));
+    s->alloc = 1024;
+    s->buf = ckd_malloc(s->alloc);
+    return s;
+}
+
+snapshot_t *
+snapshot_init_data(const void *data, size_t len)
+{
+    snapshot_t *s = ckd_calloc(1, sizeof(*s));
+    s->buf = (uint8 *)data;
+    s->len = len;
+    return s;
+}
+
+void
+snapshot_free(snapshot_t *s)
+{
+    if (s == NULL)
+        return;
+    if (s->alloc)
+        ckd_free(s->buf);
+    ckd_free(s);
+}
+
+uint8 *
+snapshot_detach(snapshot_t *s, size_t *out_len)
+{
+    uint8 *buf = s->buf;
+
+    if (out_len)
+        *out_len = s->len;
+    s->buf = NULL;
+    s->alloc = 0;
+    snapshot_free(s);
+    return buf;
+}
+
+void
+snapshot_write(snapshot_t *s, const void *data, size_t size)
+{
+    if (s->len + size > s->alloc) {
+        while (s->len + size > s->alloc)
+            s->alloc *= 2;
+        s->buf = ckd_realloc(s->buf, s->alloc);
+    }
+    memcpy(s->buf + s->len, data, size);
+    s->len += size;
+}
+
+int
+snapshot_read(snapshot_t *s, void *data, size_t size)
+{
+    if (s->error || size > s->len - s->pos) {
+        if (!s->error)
+            E_ERROR("Snapshot truncated at %zu bytes\n", s->len);
+        s->error = TRUE;
+        memset(data, 0, size);
+        return -1;
+    }
+    memcpy(data, s->buf + s->pos, size);
+    s->pos += size;
+    return 0;
+}
+
+void
+snapshot_write_int32(snapshot_t *s, int32 val)
+{
+    snapshot_write(s, &val, sizeof(val));
+}
+
+int32
+snapshot_read_int32(snapshot_t *s)
+{
+    int32 val;
+
+    snapshot_read(s, &val, sizeof(val));
+    return val;
+}
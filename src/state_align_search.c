@@ -424,6 +424,9 @@ static searchfuncs_t state_align_search_funcs = {
     /* hyp: */ state_align_search_hyp,
     /* prob: */ NULL,
     /* seg_iter: */ state_align_search_seg_iter,
+    /* sen_active: */ NULL,
+    /* snapshot_save: */ NULL,
+    /* snapshot_load: */ NULL,
 };
 
 search_module_t *
@@ -26,6 +26,34 @@ static float labels[] = {
 };
 static const int n_labels = sizeof(labels) / sizeof(labels[0]);
 
+static decoder_event_t last_event;
+static int n_events;
+
+static void
+count_events(void *user_data, const decoder_event_t *event)
+{
+    (void)user_data;
+    last_event = *event;
+    ++n_events;
+}
+
+/* Check that an event was emitted for a change in state, and only then. */
+static void
+check_events(endpointer_t *ep, int prev_in_speech, int prev_n_events)
+{
+    if (endpointer_in_speech(ep) == prev_in_speech) {
+        TEST_EQUAL(prev_n_events, n_events);
+    } else if (endpointer_in_speech(ep)) {
+        TEST_EQUAL(prev_n_events + 1, n_events);
+        TEST_EQUAL(DECODER_EVENT_SPEECH_START, last_event.type);
+        TEST_EQUAL(endpointer_speech_start(ep), last_event.time);
+    } else {
+        TEST_EQUAL(prev_n_events + 1, n_events);
+        TEST_EQUAL(DECODER_EVENT_SPEECH_END, last_event.type);
+        TEST_EQUAL(endpointer_speech_end(ep), last_event.time);
+    }
+}
+
 static FILE *
 open_data(int sample_rate)
 {
@@ -53,18 +81,23 @@ test_sample_rate(int sample_rate)
     const short *speech;
     short *frame;
     FILE *fh;
+    int prev_in_speech, prev_n_events;
     int i;
 
     E_INFO("Sample rate %d\n", sample_rate);
     ep = endpointer_init(0, 0, 0, sample_rate, 0);
+    endpointer_set_event_callback(ep, count_events, NULL);
+    n_events = 0;
     frame_size = endpointer_frame_size(ep);
     frame = ckd_calloc(sizeof(*frame), frame_size);
     fh = open_data(sample_rate);
     TEST_ASSERT(fh);
     i = 0;
     while ((nsamp = fread(frame, sizeof(*frame), frame_size, fh)) == frame_size) {
-        int prev_in_speech = endpointer_in_speech(ep);
+        prev_in_speech = endpointer_in_speech(ep);
+        prev_n_events = n_events;
         speech = endpointer_process(ep, frame);
+        check_events(ep, prev_in_speech, prev_n_events);
         if (speech != NULL) {
             if (!prev_in_speech) {
                 TEST_ASSERT(i < n_labels);
@@ -85,7 +118,10 @@ test_sample_rate(int sample_rate)
             }
         }
     }
+    prev_in_speech = endpointer_in_speech(ep);
+    prev_n_events = n_events;
     speech = endpointer_end_stream(ep, frame, nsamp, &end_nsamp);
+    check_events(ep, prev_in_speech, prev_n_events);
     if (speech != NULL) {
         TEST_ASSERT(i < n_labels);
         E_INFO("Speech end at %.2f (label %.2f)\n",
@@ -0,0 +1,173 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/decoder.h>
+
+#include "test_macros.h"
+
+static const char *grammar = "#JSGF V1.0;\n"
+                             "grammar loop;\n"
+                             "public <loop> = <move>+;\n"
+                             "<move> = go (forward | backward)"
+                             " (one | two | three | four | five | six"
+                             " | seven | eight | nine | ten) meters;\n";
+
+typedef struct events_s {
+    int n_partial;
+    int n_final;
+    char partial[1024];
+    char stable[1024];
+    char final[1024];
+    int32 final_score;
+    int last_frame;
+} events_t;
+
+static void
+append(char *buf, const char *words)
+{
+    if (words == NULL)
+        return;
+    if (buf[0])
+        strcat(buf, " ");
+    strcat(buf, words);
+}
+
+static void
+record_event(void *user_data, const decoder_event_t *event)
+{
+    events_t *ev = (events_t *)user_data;
+
+    TEST_ASSERT(event->hyp);
+    switch (event->type) {
+    case DECODER_EVENT_PARTIAL:
+        /* Only told when it changes. */
+        TEST_ASSERT(0 != strcmp(ev->partial, event->hyp));
+        TEST_ASSERT(event->frame > ev->last_frame);
+        TEST_EQUAL(0, ev->n_final);
+        strcpy(ev->partial, event->hyp);
+        ev->last_frame = event->frame;
+        ++ev->n_partial;
+        break;
+    case DECODER_EVENT_STABLE:
+        TEST_EQUAL(0, ev->n_final);
+        append(ev->stable, event->hyp);
+        break;
+    case DECODER_EVENT_FINAL:
+        TEST_ASSERT(event->frame >= ev->last_frame);
+        strcpy(ev->final, event->hyp);
+        ev->final_score = event->score;
+        ++ev->n_final;
+        break;
+    default:
+        TEST_ASSERT(!"Unexpected event");
+    }
+}
+
+static void
+decode_file(decoder_t *ps, events_t *ev, int n_repeat)
+{
+    int16 buf[2048];
+    size_t nread;
+    int i;
+
+    memset(ev, 0, sizeof(*ev));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    for (i = 0; i < n_repeat; ++i) {
+        FILE *rawfh;
+        TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+        while ((nread = fread(buf, sizeof(*buf),
+                              sizeof(buf) / sizeof(*buf), rawfh))
+               > 0)
+            decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+        fclose(rawfh);
+    }
+    TEST_EQUAL(0, decoder_end_utt(ps));
+}
+
+/* Decode one frame at a time, making sure no change is missed. */
+static void
+decode_steps(decoder_t *ps, events_t *ev)
+{
+    int16 buf[2048];
+    size_t nread;
+    FILE *rawfh;
+    const char *hyp;
+
+    memset(ev, 0, sizeof(*ev));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    while ((nread = fread(buf, sizeof(*buf),
+                          sizeof(buf) / sizeof(*buf), rawfh))
+           > 0) {
+        TEST_EQUAL(0, decoder_enqueue_int16(ps, buf, nread));
+        while (decoder_step(ps, 1, 0) > 0) {
+            hyp = decoder_hyp(ps, NULL);
+            TEST_EQUAL(0, strcmp(hyp ? hyp : "", ev->partial));
+        }
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    events_t ev;
+    char expected[1024];
+    int32 score;
+    int i;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+    decoder_set_event_callback(ps, record_event, &ev);
+
+    /* Partial results as they change, then one final one. */
+    decode_file(ps, &ev, 1);
+    printf("%d partial results, final: %s (%d)\n",
+           ev.n_partial, ev.final, ev.final_score);
+    TEST_ASSERT(ev.n_partial > 1);
+    TEST_EQUAL(1, ev.n_final);
+    TEST_EQUAL(0, strlen(ev.stable));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ev.final));
+    TEST_EQUAL(0, strcmp(decoder_hyp(ps, &score), ev.final));
+    TEST_EQUAL(score, ev.final_score);
+    decode_steps(ps, &ev);
+    TEST_EQUAL(1, ev.n_final);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ev.final));
+
+    /* Stable words and the final hypothesis cover the whole stream. */
+    TEST_EQUAL(0, decoder_set_jsgf_string(ps, grammar));
+    config_set_int(decoder_config(ps), "rolling", 50);
+    decode_file(ps, &ev, 3);
+    printf("stable: %s\nfinal: %s\n", ev.stable, ev.final);
+    TEST_ASSERT(strlen(ev.stable) > 0);
+    TEST_EQUAL(1, ev.n_final);
+    expected[0] = '\0';
+    for (i = 0; i < 3; ++i)
+        append(expected, "go forward ten meters");
+    append(ev.stable, ev.final);
+    TEST_EQUAL(0, strcmp(expected, ev.stable));
+    decode_steps(ps, &ev);
+    append(ev.stable, ev.final);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ev.stable));
+
+    /* And nothing once the callback is removed. */
+    decoder_set_event_callback(ps, NULL, NULL);
+    decode_file(ps, &ev, 1);
+    TEST_EQUAL(0, ev.n_partial);
+    TEST_EQUAL(0, ev.n_final);
+
+    decoder_free(ps);
+    return 0;
+}
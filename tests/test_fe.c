@@ -244,7 +244,7 @@ compare_cepstra(mfcc_t **c1, mfcc_t **c2, int nfr, int ncep)
             printf("%.2f,%.2f ",
                    MFCC2FLOAT(c1[i][j]),
                    MFCC2FLOAT(c2[i][j]));
-            TEST_EQUAL_FLOAT(c1[i][j], c2[i][j]);
+            TEST_EQUAL_FLOAT(MFCC2FLOAT(c1[i][j]), MFCC2FLOAT(c2[i][j]));
         }
         printf("\n");
     }
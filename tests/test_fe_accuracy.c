@@ -0,0 +1,129 @@
+/* -*- c-basic-offset: 4 -*- */
+/*
+ * Compare features and recognition results to reference ones from
+ * the floating-point build.  These are exact in floating-point, but
+ * with FIXED_POINT this checks that the front end and acoustic model
+ * stay close enough to them.
+ *
+ * To regenerate the reference features (floating-point build only):
+ *   test_fe_accuracy tests/data/goforward.cep
+ */
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+#include <soundswallower/fe.h>
+
+#include "test_macros.h"
+
+/* Largest and average absolute difference in any coefficient,
+ * relative to the largest and average magnitude of the reference
+ * ones (with noise removal, DCT and liftering, fixed-point errors in
+ * near-silent frames get amplified quite a lot). */
+#define MAX_ERROR 0.05
+#define MEAN_ERROR 0.005
+/* Score of the reference result, and how far from it we can be. */
+#define REF_SCORE -7517
+#define SCORE_EPSILON 50
+
+static mfcc_t **
+compute_features(fe_t *fe, int16 *data, size_t nsamp, int *out_nfr)
+{
+    mfcc_t **cep;
+    int16 *inptr = data;
+    int nfr, ncep;
+
+    ncep = fe_get_output_size(fe);
+    TEST_ASSERT((nfr = fe_process_int16(fe, NULL, &nsamp, NULL, 0)) > 0);
+    cep = (mfcc_t **)ckd_calloc_2d(nfr + 1, ncep, sizeof(**cep));
+    TEST_EQUAL(0, fe_start(fe));
+    *out_nfr = fe_process_int16(fe, &inptr, &nsamp, cep, nfr);
+    *out_nfr += fe_end(fe, cep + *out_nfr, 1);
+    return cep;
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    fe_t *fe;
+    FILE *fh;
+    int16 *data;
+    size_t nsamp;
+    mfcc_t **cep;
+    const char *hyp;
+    float64 err, max_err, ref_sum, ref_max;
+    int32 score;
+    int nfr, ncep, i, j;
+
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "compallsen", "yes");
+    TEST_ASSERT(ps = decoder_init(config));
+
+    TEST_ASSERT(fh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    data = ckd_malloc(1 << 20);
+    nsamp = fread(data, sizeof(*data), (1 << 20) / sizeof(*data), fh);
+    fclose(fh);
+
+    /* Features with the same parameters as the decoder. */
+    TEST_ASSERT(fe = fe_init(decoder_config(ps)));
+    cep = compute_features(fe, data, nsamp, &nfr);
+    ncep = fe_get_output_size(fe);
+    if (argc > 1) {
+        TEST_ASSERT(fh = fopen(argv[1], "w"));
+        for (i = 0; i < nfr; ++i) {
+            for (j = 0; j < ncep; ++j)
+                fprintf(fh, "%.5f ", MFCC2FLOAT(cep[i][j]));
+            fprintf(fh, "\n");
+        }
+        fclose(fh);
+        return 0;
+    }
+
+    TEST_ASSERT(fh = fopen(TESTDATADIR "/goforward.cep", "r"));
+    err = max_err = ref_sum = ref_max = 0;
+    for (i = 0; i < nfr; ++i) {
+        for (j = 0; j < ncep; ++j) {
+            float64 ref, diff;
+            TEST_EQUAL(1, fscanf(fh, "%lf", &ref));
+            diff = fabs(MFCC2FLOAT(cep[i][j]) - ref);
+            err += diff;
+            if (diff > max_err)
+                max_err = diff;
+            ref_sum += fabs(ref);
+            if (fabs(ref) > ref_max)
+                ref_max = fabs(ref);
+        }
+    }
+    TEST_EQUAL(EOF, fscanf(fh, "%lf", &err));
+    fclose(fh);
+    printf("%d frames, max error %f mean error %f\n",
+           nfr, max_err, err / (nfr * ncep));
+    TEST_ASSERT(max_err < MAX_ERROR * ref_max);
+    TEST_ASSERT(err < MEAN_ERROR * ref_sum);
+
+    /* And the same result from the decoder. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_EQUAL(nfr, decoder_process_int16(ps, data, nsamp, FALSE, TRUE));
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    hyp = decoder_hyp(ps, &score);
+    printf("%s (%d)\n", hyp, score);
+    TEST_ASSERT(hyp);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(abs(score - REF_SCORE) < SCORE_EPSILON);
+
+    ckd_free_2d(cep);
+    ckd_free(data);
+    fe_free(fe);
+    decoder_free(ps);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+#include <soundswallower/feat_archive.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ARCHIVE "test_feat_archive.feat"
+
+static int16 *
+read_audio(size_t *out_n_samples)
+{
+    FILE *rawfh;
+    int16 *data;
+    long size;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    size = ftell(rawfh);
+    fseek(rawfh, 0, SEEK_SET);
+    data = ckd_malloc(size);
+    *out_n_samples = fread(data, sizeof(*data), size / sizeof(*data), rawfh);
+    fclose(rawfh);
+    return data;
+}
+
+/* Offset of the data format, after the magic string and five uint32. */
+#define ELEM_TYPE_OFFSET 24
+
+static uint32
+patch_header(const char *filename, long offset, uint32 val)
+{
+    FILE *fh;
+    uint32 old;
+
+    TEST_ASSERT(fh = fopen(filename, "r+b"));
+    TEST_EQUAL(0, fseek(fh, offset, SEEK_SET));
+    TEST_EQUAL(1, fread(&old, sizeof(old), 1, fh));
+    TEST_EQUAL(0, fseek(fh, offset, SEEK_SET));
+    TEST_EQUAL(1, fwrite(&val, sizeof(val), 1, fh));
+    fclose(fh);
+    return old;
+}
+
+static decoder_t *
+make_decoder(int rolling, int compallsen)
+{
+    config_t *config;
+    decoder_t *ps;
+
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "samprate", "16000");
+    config_set_int(config, "rolling", rolling);
+    config_set_bool(config, "compallsen", compallsen);
+    TEST_ASSERT(ps = decoder_init(config));
+    return ps;
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    feat_archive_writer_t *w;
+    feat_archive_t *fa;
+    int16 *data;
+    size_t n_samples;
+    const char *hyp;
+    char *ref, stable[256];
+    int nfr, ref_nfr, n_searchfr, i;
+    int32 score, ref_score;
+    uint32 elem_type, other_type;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(ps = make_decoder(0, FALSE));
+    data = read_audio(&n_samples);
+
+    /* Reference result, decoding the whole utterance at once. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_process_int16(ps, data, n_samples, FALSE, TRUE) > 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(ref = ckd_salloc(decoder_hyp(ps, NULL)));
+    ref_nfr = decoder_n_frames(ps);
+    printf("reference: %s (%d frames)\n", ref, ref_nfr);
+
+    TEST_ASSERT(w = feat_archive_writer_init(ARCHIVE, decoder_feat(ps)));
+    nfr = decoder_archive_int16(ps, w, "goforward", data, n_samples);
+    TEST_ASSERT(nfr > 0);
+    TEST_EQUAL(nfr, decoder_archive_int16(ps, w, "again", data, n_samples));
+    TEST_EQUAL(0, feat_archive_writer_close(w));
+    /* Not in the middle of an utterance. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(w = feat_archive_writer_init(ARCHIVE ".tmp", decoder_feat(ps)));
+    TEST_ASSERT(decoder_archive_int16(ps, w, "fail", data, n_samples) < 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_EQUAL(0, feat_archive_writer_close(w));
+    remove(ARCHIVE ".tmp");
+
+    /* Features from a fixed-point build can't be read by a
+     * floating-point one, or vice versa. */
+#ifdef FIXED_POINT
+    other_type = sizeof(mfcc_t);
+#else
+    other_type = 0x100 | DEFAULT_RADIX;
+#endif
+    elem_type = patch_header(ARCHIVE, ELEM_TYPE_OFFSET, other_type);
+    TEST_ASSERT(feat_archive_read(ARCHIVE) == NULL);
+    patch_header(ARCHIVE, ELEM_TYPE_OFFSET, elem_type);
+
+    TEST_ASSERT(fa = feat_archive_read(ARCHIVE));
+    TEST_EQUAL(2, feat_archive_n_utt(fa));
+    TEST_EQUAL(0, strcmp("goforward", feat_archive_uttid(fa, 0)));
+    TEST_EQUAL(0, strcmp("again", feat_archive_uttid(fa, 1)));
+    TEST_ASSERT(feat_archive_uttid(fa, 2) == NULL);
+    TEST_EQUAL(nfr, feat_archive_n_frames(fa, 1));
+    TEST_ASSERT(feat_archive_frame(fa, 1, nfr - 1) != NULL);
+    TEST_ASSERT(feat_archive_frame(fa, 1, nfr) == NULL);
+    TEST_EQUAL(0, memcmp(feat_archive_frame(fa, 0, 0),
+                         feat_archive_frame(fa, 1, 0),
+                         feat_dimension(decoder_feat(ps)) * sizeof(mfcc_t)));
+
+    /* Decoding from the archive gives the same result. */
+    for (i = 0; i < feat_archive_n_utt(fa); ++i) {
+        TEST_EQUAL(0, decoder_start_utt(ps));
+        n_searchfr = decoder_process_archive(ps, fa, i);
+        TEST_EQUAL(0, decoder_end_utt(ps));
+        printf("%s: %s (%d frames)\n", feat_archive_uttid(fa, i),
+               decoder_hyp(ps, NULL), decoder_n_frames(ps));
+        TEST_EQUAL(nfr, n_searchfr);
+        TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+        TEST_EQUAL(0, strcmp(ref, decoder_hyp(ps, NULL)));
+    }
+    /* Also with a circular feature buffer. */
+    decoder_free(ps);
+    TEST_ASSERT(ps = make_decoder(50, FALSE));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_EQUAL(nfr, decoder_process_archive(ps, fa, 0));
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(ps->acmod->n_feat_alloc < nfr);
+    stable[0] = '\0';
+    if ((hyp = decoder_stable_hyp(ps, NULL)) != NULL) {
+        strcat(stable, hyp);
+        strcat(stable, " ");
+    }
+    strcat(stable, decoder_hyp(ps, NULL));
+    printf("rolling: %s\n", stable);
+    TEST_EQUAL(0, strcmp(ref, stable));
+    /* Outside an utterance, or out of range, fails. */
+    TEST_ASSERT(decoder_process_archive(ps, fa, 0) < 0);
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_process_archive(ps, fa, 2) < 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+
+    feat_archive_free(fa);
+
+    /* Senone scores give the same result as computing all of them. */
+    decoder_free(ps);
+    TEST_ASSERT(ps = make_decoder(0, TRUE));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_process_int16(ps, data, n_samples, FALSE, TRUE) > 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    ckd_free(ref);
+    TEST_ASSERT(ref = ckd_salloc(decoder_hyp(ps, &ref_score)));
+    TEST_ASSERT(w = feat_archive_writer_init_senscr(ARCHIVE, decoder_n_senones(ps)));
+    TEST_EQUAL(nfr, decoder_archive_senscr_int16(ps, w, "senscr", data, n_samples));
+    TEST_ASSERT(feat_archive_writer_add(w, "fail", NULL, 0) < 0);
+    TEST_EQUAL(0, feat_archive_writer_close(w));
+    TEST_ASSERT(fa = feat_archive_read(ARCHIVE));
+    TEST_EQUAL(FEAT_ARCHIVE_SENSCR, feat_archive_type(fa));
+    TEST_EQUAL(decoder_n_senones(ps), feat_archive_n_sen(fa));
+    TEST_EQUAL(nfr, feat_archive_n_frames(fa, 0));
+    TEST_ASSERT(feat_archive_frame(fa, 0, 0) == NULL);
+    TEST_ASSERT(feat_archive_senscr(fa, 0, nfr - 1) != NULL);
+    TEST_ASSERT(feat_archive_mismatch(fa, decoder_feat(ps)));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_EQUAL(nfr, decoder_process_archive(ps, fa, 0));
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    printf("senscr: %s (%d frames)\n", decoder_hyp(ps, &score), decoder_n_frames(ps));
+    TEST_EQUAL(0, strcmp(ref, decoder_hyp(ps, &score)));
+    TEST_EQUAL(ref_score, score);
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+    feat_archive_free(fa);
+
+    remove(ARCHIVE);
+    ckd_free(ref);
+    ckd_free(data);
+    decoder_free(ps);
+    return 0;
+}
@@ -3,10 +3,28 @@
 
 #include "test_macros.h"
 #include <soundswallower/decoder.h>
+#include <soundswallower/fsg_search.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 
+static void
+decode_file(decoder_t *ps)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    decoder_start_utt(ps);
+    while (!feof(rawfh)) {
+        nread = fread(buf, sizeof(*buf), sizeof(buf) / sizeof(*buf), rawfh);
+        decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    decoder_end_utt(ps);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -16,9 +34,8 @@ main(int argc, char *argv[])
     const char *hyp;
     seg_iter_t *seg;
     int32 score, prob;
-    FILE *rawfh;
-    int16 buf[2048];
-    size_t nread;
+    fsg_search_t *fsgs;
+    int32 n_hmm_eval;
 
     (void)argc;
     (void)argv;
@@ -45,14 +62,7 @@ main(int argc, char *argv[])
     config_set_str(config, "sendump", MODELDIR "/en-us/sendump");
     TEST_ASSERT(ps = decoder_init(config));
 
-    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
-    decoder_start_utt(ps);
-    while (!feof(rawfh)) {
-        nread = fread(buf, sizeof(*buf), sizeof(buf) / sizeof(*buf), rawfh);
-        decoder_process_int16(ps, buf, nread, FALSE, FALSE);
-    }
-    fclose(rawfh);
-    decoder_end_utt(ps);
+    decode_file(ps);
     hyp = decoder_hyp(ps, &score);
     prob = decoder_prob(ps);
     printf("%s (%d, %d)\n", hyp, score, prob);
@@ -79,6 +89,24 @@ main(int argc, char *argv[])
     printf("BESTPATH: %s\n",
            lattice_hyp(dag, lattice_bestpath(dag, 15.0)));
     lattice_posterior(dag, 15.0);
+
+    /* Histogram pruning should reduce the search effort without
+     * changing the result. */
+    fsgs = (fsg_search_t *)ps->search;
+    n_hmm_eval = fsgs->n_hmm_eval;
+    config_set_int(decoder_config(ps), "maxhmmpf", 5);
+    config_set_int(decoder_config(ps), "maxwpf", 1);
+    TEST_EQUAL(0, decoder_reinit(ps, NULL));
+    fsgs = (fsg_search_t *)ps->search;
+    TEST_EQUAL(5, fsgs->maxhmmpf);
+    TEST_EQUAL(1, fsgs->maxwpf);
+    decode_file(ps);
+    hyp = decoder_hyp(ps, &score);
+    printf("%s (%d) %d HMMs (was %d)\n", hyp, score,
+           fsgs->n_hmm_eval, n_hmm_eval);
+    TEST_ASSERT(hyp);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(fsgs->n_hmm_eval < n_hmm_eval);
     decoder_free(ps);
 
     return 0;
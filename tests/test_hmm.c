@@ -0,0 +1,98 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/hmm.h>
+
+#include "test_macros.h"
+
+#define N_SEN 6
+#define N_FRAME 20
+
+static void
+check_same(hmm_t *a, hmm_t *b)
+{
+    int i;
+
+    for (i = 0; i < hmm_n_emit_state(a); ++i) {
+        TEST_EQUAL(hmm_score(a, i), hmm_score(b, i));
+        TEST_EQUAL(hmm_history(a, i), hmm_history(b, i));
+        TEST_EQUAL(a->senid[i], b->senid[i]);
+    }
+    TEST_EQUAL(hmm_out_score(a), hmm_out_score(b));
+    TEST_EQUAL(hmm_out_history(a), hmm_out_history(b));
+    TEST_EQUAL(hmm_bestscore(a), hmm_bestscore(b));
+}
+
+/* Evaluate a group of HMMs together and each one separately. */
+static void
+test_shared(hmm_context_t *ctx, int16 *senscr, int mpx)
+{
+    hmm_t shared[3], ref[3];
+    hmm_t *group[3];
+    int i, j, f;
+
+    for (i = 0; i < 3; ++i) {
+        hmm_init(ctx, &shared[i], mpx, 1, 0);
+        /* Different histories and stale exit scores */
+        hmm_enter(&shared[i], -100, 10 + i, 0);
+        hmm_out_score(&shared[i]) = -1000 * i;
+        hmm_out_history(&shared[i]) = 20 + i;
+        group[i] = &shared[i];
+    }
+    TEST_ASSERT(hmm_same_state(&shared[0], &shared[1]));
+    TEST_ASSERT(hmm_same_state(&shared[0], &shared[2]));
+    memcpy(ref, shared, sizeof(ref));
+
+    for (f = 0; f < N_FRAME; ++f) {
+        for (j = 0; j < N_SEN; ++j)
+            senscr[j] = rand() % 200;
+        hmm_vit_eval_shared(group, 3);
+        for (i = 0; i < 3; ++i) {
+            hmm_vit_eval(&ref[i]);
+            check_same(&shared[i], &ref[i]);
+            /* Re-enter now and then, as in search */
+            if (f % 7 == 3) {
+                hmm_enter(&shared[i], hmm_out_score(&shared[i]), 30 + i, f);
+                hmm_enter(&ref[i], hmm_out_score(&ref[i]), 30 + i, f);
+            }
+        }
+        TEST_ASSERT(hmm_same_state(&shared[0], &shared[1]));
+    }
+    hmm_init(ctx, &ref[0], mpx, 2, 0);
+    TEST_ASSERT(!hmm_same_state(&shared[0], &ref[0]));
+}
+
+int
+main(int argc, char *argv[])
+{
+    hmm_context_t *ctx;
+    uint8 ***tp;
+    uint16 **sseq;
+    int16 senscr[N_SEN];
+    int i, j;
+
+    (void)argc;
+    (void)argv;
+    tp = (uint8 ***)ckd_calloc_3d(1, 4, 4, sizeof(***tp));
+    for (i = 0; i < 3; ++i) {
+        for (j = 0; j < 4; ++j)
+            tp[0][i][j] = (j < i || j > i + 2) ? 255 : 5 + i + j;
+    }
+    sseq = (uint16 **)ckd_calloc_2d(3, 3, sizeof(**sseq));
+    for (i = 0; i < 3; ++i)
+        for (j = 0; j < 3; ++j)
+            sseq[i][j] = (i + j) % N_SEN;
+    TEST_ASSERT(ctx = hmm_context_init(3, tp, senscr, sseq));
+
+    test_shared(ctx, senscr, FALSE);
+    test_shared(ctx, senscr, TRUE);
+
+    hmm_context_free(ctx);
+    ckd_free_3d(tp);
+    ckd_free_2d(sseq);
+    return 0;
+}
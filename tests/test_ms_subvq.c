@@ -0,0 +1,91 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/ms_subvq.h>
+
+#include "test_macros.h"
+
+/* Use the means of a few Gaussians as observations. */
+static void
+make_obs(gauden_t *g, int32 mgau, int32 d, mfcc_t **obs)
+{
+    int32 f;
+
+    for (f = 0; f < g->n_feat; ++f)
+        memcpy(obs[f], g->mean[mgau][f][d], g->featlen[f] * sizeof(**obs));
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    gauden_t *g;
+    subvq_t *vq;
+    gauden_dist_t **ref, **out;
+    mfcc_t **obs;
+    int32 m, d, f, i, n_obs, n_best;
+
+    (void)argc;
+    (void)argv;
+    lmath = logmath_init(1.0001, 0, 0);
+    TEST_ASSERT(g = gauden_init(MODELDIR "/en-us/means",
+                                MODELDIR "/en-us/variances",
+                                0.0001f, lmath));
+    ref = (gauden_dist_t **)ckd_calloc_2d(g->n_feat, 4, sizeof(**ref));
+    out = (gauden_dist_t **)ckd_calloc_2d(g->n_feat, 4, sizeof(**out));
+    obs = (mfcc_t **)ckd_calloc_2d(g->n_feat, g->featlen[0], sizeof(**obs));
+
+    TEST_ASSERT(subvq_init(g, 257, 8) == NULL);
+    TEST_ASSERT(subvq_init(g, 64, g->n_density + 1) == NULL);
+
+    /* Rescoring everything gives exactly the same result. */
+    TEST_ASSERT(vq = subvq_init(g, 64, g->n_density));
+    for (f = 0; f < g->n_feat; ++f)
+        TEST_ASSERT(vq->sv_start[f][vq->n_sv[f]] == g->featlen[f]);
+    for (m = 0; m < g->n_mgau; m += 5) {
+        make_obs(g, m, m, obs);
+        subvq_frame_eval(vq, obs);
+        gauden_dist(g, m, 4, obs, ref);
+        subvq_gauden_dist(vq, g, m, 4, obs, out);
+        for (f = 0; f < g->n_feat; ++f) {
+            for (i = 0; i < 4; ++i) {
+                TEST_EQUAL(ref[f][i].id, out[f][i].id);
+                TEST_EQUAL(ref[f][i].dist, out[f][i].dist);
+            }
+        }
+    }
+    subvq_free(vq);
+
+    /* Rescoring a few usually finds the best one. */
+    TEST_ASSERT(vq = subvq_init(g, 64, 16));
+    n_obs = n_best = 0;
+    for (m = 0; m < g->n_mgau; m += 3) {
+        for (d = 0; d < g->n_density; d += 17) {
+            make_obs(g, m, d, obs);
+            subvq_frame_eval(vq, obs);
+            gauden_dist(g, m, 4, obs, ref);
+            subvq_gauden_dist(vq, g, m, 4, obs, out);
+            for (f = 0; f < g->n_feat; ++f) {
+                /* Whatever is found is scored exactly. */
+                for (i = 0; i < 4; ++i)
+                    TEST_ASSERT(out[f][i].dist <= ref[f][0].dist);
+                ++n_obs;
+                if (out[f][0].id == ref[f][0].id)
+                    ++n_best;
+            }
+        }
+    }
+    printf("Best Gaussian found for %d of %d observations\n", n_best, n_obs);
+    TEST_ASSERT(n_best > n_obs * 9 / 10);
+    subvq_free(vq);
+
+    ckd_free_2d(ref);
+    ckd_free_2d(out);
+    ckd_free_2d(obs);
+    gauden_free(g);
+    logmath_free(lmath);
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/decoder.h>
+#include <soundswallower/nn_mgau.h>
+
+#include "test_macros.h"
+
+#define NNET_FILE "test_nn_mgau.nnet"
+#define FEAT_LEN 39
+#define CTX 2
+#define N_HIDDEN 32
+#define MAX_FRAMES 1000
+
+static const mfcc_t cmninit[13] = {
+    FLOAT2MFCC(41.00),
+    FLOAT2MFCC(-5.29),
+    FLOAT2MFCC(-0.12),
+    FLOAT2MFCC(5.09),
+    FLOAT2MFCC(2.48),
+    FLOAT2MFCC(-4.07),
+    FLOAT2MFCC(-1.37),
+    FLOAT2MFCC(-1.78),
+    FLOAT2MFCC(-5.08),
+    FLOAT2MFCC(-2.05),
+    FLOAT2MFCC(-6.45),
+    FLOAT2MFCC(-1.42),
+    FLOAT2MFCC(1.17)
+};
+
+static uint32 seed = 42;
+
+static float32
+rand_weight(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return ((float32)((seed >> 16) & 0x7fff) / 32768.0f - 0.5f) * 0.2f;
+}
+
+static void
+write_1d(FILE *fh, const void *data, size_t el_sz, int32 n)
+{
+    fwrite(&n, sizeof(n), 1, fh);
+    fwrite(data, el_sz, n, fh);
+}
+
+static void
+write_layer_header(FILE *fh, int32 n_out, int32 n_in,
+                   int32 activation, int32 weight_type)
+{
+    int32 hdr[4];
+    hdr[0] = n_out;
+    hdr[1] = n_in;
+    hdr[2] = activation;
+    hdr[3] = weight_type;
+    fwrite(hdr, sizeof(int32), 4, fh);
+}
+
+/* Write a random two-layer network, int8 then float32. */
+static void
+write_nnet(const char *path, int32 n_sen)
+{
+    int32 n_in = (2 * CTX + 1) * FEAT_LEN;
+    uint32 magic = 0x11223344;
+    float32 *scale, *weights, *bias;
+    int8 *qweights;
+    FILE *fh;
+    int i;
+
+    TEST_ASSERT(fh = fopen(path, "wb"));
+    fprintf(fh, "s3\nversion 1.0\nfeat_len %d\nctx_left %d\nctx_right %d\n"
+                "n_layer 2\nendhdr\n",
+            FEAT_LEN, CTX, CTX);
+    fwrite(&magic, sizeof(magic), 1, fh);
+
+    write_layer_header(fh, N_HIDDEN, n_in, NN_ACT_RELU, NN_WEIGHT_INT8);
+    scale = ckd_calloc(N_HIDDEN, sizeof(*scale));
+    for (i = 0; i < N_HIDDEN; ++i)
+        scale[i] = 0.001f;
+    write_1d(fh, scale, sizeof(*scale), N_HIDDEN);
+    qweights = ckd_calloc(N_HIDDEN * n_in, sizeof(*qweights));
+    for (i = 0; i < N_HIDDEN * n_in; ++i)
+        qweights[i] = (int8)(rand_weight() * 1270);
+    write_1d(fh, qweights, sizeof(*qweights), N_HIDDEN * n_in);
+    bias = ckd_calloc(n_sen, sizeof(*bias));
+    write_1d(fh, bias, sizeof(*bias), N_HIDDEN);
+
+    write_layer_header(fh, n_sen, N_HIDDEN, NN_ACT_LINEAR, NN_WEIGHT_FLOAT32);
+    weights = ckd_calloc(n_sen * N_HIDDEN, sizeof(*weights));
+    for (i = 0; i < n_sen * N_HIDDEN; ++i)
+        weights[i] = rand_weight();
+    write_1d(fh, weights, sizeof(*weights), n_sen * N_HIDDEN);
+    for (i = 0; i < n_sen; ++i)
+        bias[i] = rand_weight();
+    write_1d(fh, bias, sizeof(*bias), n_sen);
+    /* Priors (uniform, doesn't matter) */
+    for (i = 0; i < n_sen; ++i)
+        bias[i] = -8.0f;
+    write_1d(fh, bias, sizeof(*bias), n_sen);
+
+    fclose(fh);
+    ckd_free(scale);
+    ckd_free(qweights);
+    ckd_free(weights);
+    ckd_free(bias);
+}
+
+static int
+score_frames(acmod_t *acmod, int16 **scores, int n_frame)
+{
+    int n_sen = bin_mdef_n_sen(acmod->mdef);
+
+    while (acmod->n_feat_frame > 0) {
+        int frame_idx = -1, best_senid, i;
+        int16 const *senscr = acmod_score(acmod, &frame_idx);
+        TEST_EQUAL(n_frame, frame_idx);
+        TEST_EQUAL(0, acmod_best_score(acmod, &best_senid));
+        for (i = 0; i < n_sen; ++i)
+            TEST_ASSERT(senscr[i] >= 0);
+        TEST_ASSERT(n_frame < MAX_FRAMES);
+        memcpy(scores[n_frame], senscr, n_sen * sizeof(**scores));
+        acmod_advance(acmod);
+        ++n_frame;
+    }
+    return n_frame;
+}
+
+/* Score a whole utterance incrementally, returning the number of frames. */
+static int
+score_utt(acmod_t *acmod, int16 **scores)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    int16 *bptr;
+    size_t nread;
+    int n_frame = 0;
+
+    cmn_live_set(acmod->fcb->cmn_struct, cmninit);
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    while (!feof(rawfh)) {
+        nread = fread(buf, sizeof(*buf), 2048, rawfh);
+        bptr = buf;
+        while (acmod_process_raw(acmod, &bptr, &nread, FALSE) > 0)
+            n_frame = score_frames(acmod, scores, n_frame);
+    }
+    acmod_end_utt(acmod);
+    n_frame = score_frames(acmod, scores, n_frame);
+    fclose(rawfh);
+    return n_frame;
+}
+
+static acmod_t *
+init_acmod(config_t *config, logmath_t *lmath, int batch)
+{
+    acmod_t *acmod;
+    fe_t *fe;
+    feat_t *fcb;
+
+    config_set_int(config, "nnbatch", batch);
+    fe = fe_init(config);
+    fcb = feat_init(config);
+    acmod = acmod_init(config, lmath, fe, fcb);
+    fe_free(fe);
+    feat_free(fcb);
+    return acmod;
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    config_t *config;
+    bin_mdef_t *mdef;
+    acmod_t *acmod;
+    int16 **scores, **batch_scores;
+    int n_sen, n_frame, i;
+
+    (void)argc;
+    (void)argv;
+    lmath = logmath_init(1.0001, 0, 0);
+    err_set_loglevel(ERR_INFO);
+    config = config_init(NULL);
+    config_set_str(config, "compallsen", "yes");
+    config_set_str(config, "input_endian", "little");
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "nnet", NNET_FILE);
+    config_expand(config);
+
+    TEST_ASSERT(mdef = bin_mdef_read(config, config_str(config, "mdef")));
+    n_sen = bin_mdef_n_sen(mdef);
+    bin_mdef_free(mdef);
+    write_nnet(NNET_FILE, n_sen);
+    scores = ckd_calloc_2d(MAX_FRAMES, n_sen, sizeof(**scores));
+    batch_scores = ckd_calloc_2d(MAX_FRAMES, n_sen, sizeof(**batch_scores));
+
+    /* Score one frame at a time. */
+    TEST_ASSERT(acmod = init_acmod(config, lmath, 1));
+    TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "nn"));
+    n_frame = score_utt(acmod, scores);
+    E_INFO("Scored %d frames one at a time\n", n_frame);
+    TEST_ASSERT(n_frame > 0);
+    acmod_free(acmod);
+
+    /* Batching must not change the scores. */
+    TEST_ASSERT(acmod = init_acmod(config, lmath, 8));
+    TEST_EQUAL(n_frame, score_utt(acmod, batch_scores));
+    for (i = 0; i < n_frame; ++i)
+        TEST_EQUAL(0, memcmp(scores[i], batch_scores[i],
+                             n_sen * sizeof(**scores)));
+    /* And scoring a second utterance must not reuse stale ones. */
+    TEST_EQUAL(n_frame, score_utt(acmod, batch_scores));
+    for (i = 0; i < n_frame; ++i)
+        TEST_EQUAL(0, memcmp(scores[i], batch_scores[i],
+                             n_sen * sizeof(**scores)));
+    /* No MLLR for you. */
+    TEST_ASSERT(mgau_transform(acmod->mgau, NULL) < 0);
+    acmod_free(acmod);
+
+    /* Mismatched senone count is an error. */
+    write_nnet(NNET_FILE, n_sen - 1);
+    TEST_ASSERT(NULL == init_acmod(config, lmath, 8));
+
+    ckd_free_2d(scores);
+    ckd_free_2d(batch_scores);
+    logmath_free(lmath);
+    config_free(config);
+    remove(NNET_FILE);
+    return 0;
+}
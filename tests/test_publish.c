@@ -0,0 +1,141 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <soundswallower/decoder.h>
+
+#include "test_macros.h"
+
+/* Check that a result is consistent with itself. */
+static void
+check_result(decoder_result_t *r)
+{
+    const decoder_seg_t *seg;
+    const char *hyp;
+    int n_seg, i;
+
+    hyp = decoder_result_hyp(r, NULL);
+    seg = decoder_result_seg(r, &n_seg);
+    TEST_ASSERT(hyp);
+    for (i = 0; i < n_seg; ++i) {
+        TEST_ASSERT(seg[i].word[0] != '\0');
+        TEST_ASSERT(seg[i].sf <= seg[i].ef);
+        TEST_ASSERT(seg[i].ef < decoder_result_n_frames(r));
+        if (i > 0)
+            TEST_ASSERT(seg[i].sf >= seg[i - 1].ef);
+        /* Every word (but not filler or null) is in the hypothesis. */
+        if (seg[i].word[0] != '<' && seg[i].word[0] != '(')
+            TEST_ASSERT(strstr(hyp, seg[i].word) != NULL);
+    }
+}
+
+#ifdef HAVE_PTHREAD
+/* Read results until the final one, while the main thread decodes. */
+static void *
+reader(void *arg)
+{
+    decoder_t *ps = (decoder_t *)arg;
+    int n_frames = 0, n_read = 0, final = FALSE;
+
+    while (!final) {
+        decoder_result_t *r = decoder_result(ps);
+        if (r == NULL)
+            continue;
+        check_result(r);
+        TEST_ASSERT(decoder_result_n_frames(r) >= n_frames);
+        n_frames = decoder_result_n_frames(r);
+        final = decoder_result_final(r);
+        decoder_result_free(r);
+        ++n_read;
+    }
+    printf("Read %d results from another thread\n", n_read);
+    return NULL;
+}
+#endif
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    decoder_result_t *r, *first;
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+    int32 score, rscore;
+    int nfr;
+    const char *hyp;
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+#endif
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+
+    /* Nothing is published unless requested. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_result(ps) == NULL);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(decoder_result(ps) == NULL);
+
+    config_set_bool(decoder_config(ps), "publish", TRUE);
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(first = decoder_result(ps));
+    TEST_EQUAL(1, decoder_result_uttno(first));
+    TEST_EQUAL(0, decoder_result_n_frames(first));
+    TEST_ASSERT(!decoder_result_final(first));
+    TEST_EQUAL(0, strcmp("", decoder_result_hyp(first, NULL)));
+#ifdef HAVE_PTHREAD
+    TEST_EQUAL(0, pthread_create(&thread, NULL, reader, ps));
+#endif
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    nfr = 0;
+    while ((nread = fread(buf, sizeof(*buf),
+                          sizeof(buf) / sizeof(*buf), rawfh))
+           > 0) {
+        nfr += decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+        /* The same as what we get from the decoder directly. */
+        TEST_ASSERT(r = decoder_result(ps));
+        TEST_EQUAL(nfr, decoder_result_n_frames(r));
+        if ((hyp = decoder_hyp(ps, &score)) != NULL) {
+            TEST_EQUAL(0, strcmp(hyp, decoder_result_hyp(r, &rscore)));
+            TEST_EQUAL(score, rscore);
+        }
+        decoder_result_free(r);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+#ifdef HAVE_PTHREAD
+    TEST_EQUAL(0, pthread_join(thread, NULL));
+#endif
+
+    TEST_ASSERT(r = decoder_result(ps));
+    TEST_ASSERT(decoder_result_final(r));
+    check_result(r);
+    hyp = decoder_result_hyp(r, &rscore);
+    printf("%s (%d)\n", hyp, rscore);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(0, strcmp(decoder_hyp(ps, &score), hyp));
+    TEST_EQUAL(score, rscore);
+    TEST_EQUAL(decoder_prob(ps), decoder_result_prob(r));
+
+    /* Results outlive later ones and the decoder itself. */
+    TEST_EQUAL(0, strcmp("", decoder_result_hyp(first, NULL)));
+    decoder_free(ps);
+    TEST_EQUAL(0, strcmp("go forward ten meters", decoder_result_hyp(r, NULL)));
+    TEST_EQUAL(0, decoder_result_free(r));
+    TEST_EQUAL(0, decoder_result_free(first));
+    return 0;
+}
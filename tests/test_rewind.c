@@ -0,0 +1,107 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *grammar = "#JSGF V1.0;\n"
+                             "grammar move;\n"
+                             "public <move> = go (forward | backward)"
+                             " (one | two | ten) meters;\n";
+static const char *fallback = "#JSGF V1.0;\n"
+                              "grammar fallback;\n"
+                              "public <move> = go backward (one | two) meters;\n";
+
+static int16 *
+read_audio(size_t *out_n_samples)
+{
+    FILE *rawfh;
+    int16 *data;
+    long size;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    size = ftell(rawfh);
+    fseek(rawfh, 0, SEEK_SET);
+    data = ckd_malloc(size);
+    *out_n_samples = fread(data, sizeof(*data), size / sizeof(*data), rawfh);
+    fclose(rawfh);
+    return data;
+}
+
+int
+main(int argc, char *argv[])
+{
+    config_t *config;
+    decoder_t *ps;
+    int16 *data;
+    size_t n_samples;
+    char *ref;
+    const char *hyp;
+    int32 score, ref_score;
+    int nfr, ref_nfr;
+
+    (void)argc;
+    (void)argv;
+    data = read_audio(&n_samples);
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+    TEST_EQUAL(0, decoder_set_jsgf_string(ps, grammar));
+
+    /* Nothing to rewind yet. */
+    TEST_ASSERT(decoder_rewind(ps) < 0);
+
+    /* Reference result. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_process_int16(ps, data, n_samples, FALSE, FALSE) > 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &ref_score));
+    ref = ckd_salloc(hyp);
+    ref_nfr = decoder_n_frames(ps);
+    printf("reference: %s (%d, %d frames)\n", ref, ref_score, ref_nfr);
+    TEST_EQUAL(0, strcmp(ref, "go forward ten meters"));
+
+    /* Search it again with another grammar. */
+    TEST_EQUAL(0, decoder_set_jsgf_string(ps, fallback));
+    TEST_EQUAL(ref_nfr - 1, decoder_rewind(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    printf("fallback: %s (%d, %d frames)\n", hyp, score, decoder_n_frames(ps));
+    TEST_ASSERT(0 == strncmp(hyp, "go backward", 11));
+    TEST_ASSERT(score < ref_score);
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+
+    /* And back to the original one, which gives the same result. */
+    TEST_EQUAL(0, decoder_set_jsgf_string(ps, grammar));
+    TEST_EQUAL(ref_nfr - 1, decoder_rewind(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp(ref, hyp));
+    TEST_EQUAL(ref_score, score);
+
+    /* Rewind in the middle of an utterance and continue. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(decoder_process_int16(ps, data, n_samples / 2, FALSE, FALSE) > 0);
+    nfr = decoder_n_frames(ps);
+    TEST_EQUAL(nfr - 1, decoder_rewind(ps));
+    TEST_EQUAL(nfr, decoder_n_frames(ps));
+    TEST_ASSERT(decoder_process_int16(ps, data + n_samples / 2,
+                                      n_samples - n_samples / 2, FALSE, FALSE)
+                > 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    printf("rewound: %s (%d, %d frames)\n", hyp, score, decoder_n_frames(ps));
+    TEST_EQUAL(0, strcmp(ref, hyp));
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+
+    ckd_free(ref);
+    ckd_free(data);
+    decoder_free(ps);
+
+    return 0;
+}
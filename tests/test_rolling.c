@@ -0,0 +1,112 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/decoder.h>
+#include <soundswallower/fsg_search.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N_REPEAT 6
+
+static const char *grammar = "#JSGF V1.0;\n"
+                             "grammar loop;\n"
+                             "public <loop> = <move>+;\n"
+                             "<move> = go (forward | backward)"
+                             " (one | two | three | four | five | six"
+                             " | seven | eight | nine | ten) meters;\n";
+
+static void
+append(char *buf, const char *words)
+{
+    if (words == NULL)
+        return;
+    if (buf[0])
+        strcat(buf, " ");
+    strcat(buf, words);
+}
+
+/* Decode the test file several times over in one utterance. */
+static const char *
+decode_stream(decoder_t *ps, char *stable, int32 *max_hist)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)ps->search;
+    int16 buf[2048];
+    size_t nread;
+    int i;
+
+    *max_hist = 0;
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    for (i = 0; i < N_REPEAT; ++i) {
+        FILE *rawfh;
+        TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+        while (!feof(rawfh)) {
+            nread = fread(buf, sizeof(*buf), sizeof(buf) / sizeof(*buf), rawfh);
+            decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+            if (fsg_history_n_entries(fsgs->history) > *max_hist)
+                *max_hist = fsg_history_n_entries(fsgs->history);
+            append(stable, decoder_stable_hyp(ps, NULL));
+        }
+        fclose(rawfh);
+    }
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    append(stable, decoder_stable_hyp(ps, NULL));
+    return decoder_hyp(ps, NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    char expected[1024], stable[1024];
+    const char *hyp;
+    int32 max_hist, max_hist_rolling, stable_frame;
+    int i;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "input_endian", "little");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+    TEST_EQUAL(0, decoder_set_jsgf_string(ps, grammar));
+
+    expected[0] = '\0';
+    for (i = 0; i < N_REPEAT; ++i)
+        append(expected, "go forward ten meters");
+
+    /* Decode with rolling collection first, so the feature buffer
+     * has not already grown to fit the whole stream. */
+    config_set_int(decoder_config(ps), "rolling", 50);
+    stable[0] = '\0';
+    hyp = decode_stream(ps, stable, &max_hist_rolling);
+    printf("stable: %s\n", stable);
+    printf("rest: %s\n", hyp ? hyp : "(null)");
+    append(stable, hyp);
+    TEST_EQUAL(0, strcmp(expected, stable));
+    /* Stable words were only returned once. */
+    TEST_ASSERT(decoder_stable_hyp(ps, &stable_frame) == NULL);
+    TEST_ASSERT(stable_frame > 0);
+    /* Features were not kept for the whole stream. */
+    TEST_ASSERT(ps->acmod->n_feat_alloc < decoder_n_frames(ps));
+    /* And there is no lattice. */
+    TEST_ASSERT(decoder_lattice(ps) == NULL);
+
+    /* Without it, we get the same result, but keep much more history. */
+    config_set_int(decoder_config(ps), "rolling", 0);
+    stable[0] = '\0';
+    TEST_ASSERT(hyp = decode_stream(ps, stable, &max_hist));
+    printf("%s\n", hyp);
+    TEST_EQUAL(0, strcmp(expected, hyp));
+    TEST_EQUAL(0, strlen(stable));
+    TEST_ASSERT(decoder_lattice(ps) != NULL);
+    printf("max history %d, %d with rolling\n", max_hist, max_hist_rolling);
+    TEST_ASSERT(max_hist_rolling * 2 < max_hist);
+
+    decoder_free(ps);
+    return 0;
+}
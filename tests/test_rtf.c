@@ -0,0 +1,133 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/decoder.h>
+#include <soundswallower/fsg_search.h>
+#include <soundswallower/ptm_mgau.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *
+decode_file(decoder_t *ps)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+    int32 score;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    while (!feof(rawfh)) {
+        nread = fread(buf, sizeof(*buf), sizeof(buf) / sizeof(*buf), rawfh);
+        decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    return decoder_hyp(ps, &score);
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    fsg_search_t *fsgs, *copy;
+    ptm_mgau_t *ptm;
+    const char *hyp;
+    int32 beam, wbeam;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "input_endian", "little");
+    config_set_str(config, "samprate", "16000");
+    config_set_int(config, "topn", 4);
+    TEST_ASSERT(ps = decoder_init(config));
+    fsgs = (fsg_search_t *)ps->search;
+    beam = fsgs->beam_orig;
+    wbeam = fsgs->wbeam_orig;
+    TEST_EQUAL(0, strcmp(ps->acmod->mgau->vt->name, "ptm"));
+    ptm = (ptm_mgau_t *)ps->acmod->mgau;
+
+    /* No adaptation by default. */
+    hyp = decode_file(ps);
+    TEST_ASSERT(hyp);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(0, ps->rtf_level);
+
+    /* Parallel searches are pruned along with the main one. */
+    TEST_EQUAL(0, decoder_add_fsg(ps, "copy",
+                                  fsg_model_readfile(TESTDATADIR "/goforward.fsg",
+                                                     decoder_logmath(ps),
+                                                     config_float(config, "lw"))));
+    copy = (fsg_search_t *)gnode_ptr(ps->searches);
+
+    /* An impossible target should tighten pruning all the way. */
+    config_set_float(decoder_config(ps), "rtf", 1e-9);
+    hyp = decode_file(ps);
+    TEST_ASSERT(hyp);
+    printf("rtf 1e-9: %s level %d\n", hyp, ps->rtf_level);
+    TEST_EQUAL(8, ps->rtf_level);
+    TEST_EQUAL(8, ps->rtf_max_level);
+    TEST_EQUAL(8, ps->rtf_n_adjust);
+    TEST_ASSERT(fsgs->beam_orig > beam);
+    TEST_ASSERT(fsgs->pbeam_orig >= fsgs->beam_orig);
+    TEST_ASSERT(fsgs->wbeam_orig >= fsgs->beam_orig);
+    TEST_EQUAL(1000, fsgs->maxhmmpf);
+    TEST_EQUAL(fsgs->beam_orig, copy->beam_orig);
+    TEST_EQUAL(fsgs->wbeam_orig, copy->wbeam_orig);
+    TEST_EQUAL(1000, copy->maxhmmpf);
+    TEST_EQUAL(1, ptm->max_topn);
+    TEST_EQUAL(2, ptm->ds_ratio);
+
+    /* A generous one should relax it back to the configuration. */
+    config_set_float(decoder_config(ps), "rtf", 1e9);
+    hyp = decode_file(ps);
+    TEST_ASSERT(hyp);
+    printf("rtf 1e9: %s level %d\n", hyp, ps->rtf_level);
+    TEST_EQUAL(0, ps->rtf_level);
+    TEST_EQUAL(beam, fsgs->beam_orig);
+    TEST_EQUAL(wbeam, fsgs->wbeam_orig);
+    TEST_EQUAL(30000, fsgs->maxhmmpf);
+    TEST_EQUAL(beam, copy->beam_orig);
+    TEST_EQUAL(30000, copy->maxhmmpf);
+    TEST_EQUAL(4, ptm->max_topn);
+    TEST_EQUAL(1, ptm->ds_ratio);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+
+    /* Disabling it restores the configuration too. */
+    config_set_float(decoder_config(ps), "rtf", 1e-9);
+    decode_file(ps);
+    TEST_ASSERT(ps->rtf_level > 0);
+    config_set_float(decoder_config(ps), "rtf", 0);
+    hyp = decode_file(ps);
+    TEST_EQUAL(0, ps->rtf_level);
+    TEST_EQUAL(beam, fsgs->beam_orig);
+    TEST_EQUAL(beam, copy->beam_orig);
+    TEST_EQUAL(4, ptm->max_topn);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+
+    /* Acoustic models report what they actually changed. */
+    {
+        int topn = 100, ds = 3;
+        TEST_EQUAL(0, mgau_tune(ps->acmod->mgau, &topn, &ds));
+        TEST_EQUAL(ptm->alloc_topn, topn);
+        TEST_EQUAL(3, ds);
+        /* And back to the configuration. */
+        topn = 4;
+        ds = 1;
+        TEST_EQUAL(0, mgau_tune(ps->acmod->mgau, &topn, &ds));
+        TEST_EQUAL(4, topn);
+        TEST_EQUAL(1, ds);
+        TEST_EQUAL(4, ptm->max_topn);
+        TEST_EQUAL(1, ptm->ds_ratio);
+    }
+
+    decoder_free(ps);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/decoder.h>
+#include <soundswallower/fsg_search.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Decode the test file, rewinding after rewind_block blocks (if >= 0). */
+static void
+decode_file(decoder_t *ps, int rewind_block)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+    int i;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    for (i = 0; !feof(rawfh); ++i) {
+        if (i == rewind_block)
+            TEST_ASSERT(decoder_rewind(ps) > 0);
+        nread = fread(buf, sizeof(*buf), sizeof(buf) / sizeof(*buf), rawfh);
+        decoder_process_int16(ps, buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+}
+
+static fsg_model_t *
+read_fsg(decoder_t *ps, const char *path)
+{
+    return fsg_model_readfile(path, decoder_logmath(ps),
+                              config_float(decoder_config(ps), "lw"));
+}
+
+/* A grammar with a word that is not in the dictionary. */
+static fsg_model_t *
+oov_fsg(decoder_t *ps)
+{
+    fsg_model_t *fsg;
+
+    fsg = fsg_model_init("oov", decoder_logmath(ps),
+                         config_float(decoder_config(ps), "lw"), 2);
+    fsg->start_state = 0;
+    fsg->final_state = 1;
+    fsg_model_trans_add(fsg, 0, 1, 0, fsg_model_word_add(fsg, "nonesuch"));
+    return fsg;
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    fsg_search_t *fsgs;
+    const char *hyp;
+    int32 score, copy_score, n_sen_eval, n_sen_eval_all;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "input_endian", "little");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+
+    /* Decode with just the main grammar. */
+    decode_file(ps, -1);
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    fsgs = (fsg_search_t *)ps->search;
+    n_sen_eval = fsgs->n_sen_eval;
+
+    /* Add the same grammar again, and a different one. */
+    TEST_EQUAL(0, decoder_add_fsg(ps, "copy",
+                                  read_fsg(ps, TESTDATADIR "/goforward.fsg")));
+    TEST_EQUAL(0, decoder_add_fsg(ps, "two",
+                                  read_fsg(ps, TESTDATADIR "/goforward2.fsg")));
+    /* Grammars are freed if they cannot be added. */
+    TEST_ASSERT(0 > decoder_add_fsg(ps, "two",
+                                    read_fsg(ps, TESTDATADIR "/goforward2.fsg")));
+    TEST_ASSERT(0 > decoder_add_fsg(ps, "oov", oov_fsg(ps)));
+    decode_file(ps, -1);
+    /* The main result must not change (though the score can, since
+     * senone scores are normalized over a different active set). */
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    /* Senones are scored for all searches at once. */
+    printf("%d senones evaluated alone, %d together\n",
+           n_sen_eval, fsgs->n_sen_eval);
+    TEST_ASSERT(fsgs->n_sen_eval >= n_sen_eval);
+    n_sen_eval_all = fsgs->n_sen_eval;
+    /* The copy sees the same scores, so gets the same result. */
+    TEST_ASSERT(hyp = decoder_search_hyp(ps, "copy", &copy_score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, copy_score);
+    /* And the other one a result from its own grammar. */
+    TEST_ASSERT(hyp = decoder_search_hyp(ps, "two", &copy_score));
+    printf("two: %s (%d)\n", hyp, copy_score);
+    TEST_ASSERT(strstr(hyp, "two") != NULL);
+    TEST_ASSERT(decoder_search_hyp(ps, "nonesuch", &copy_score) == NULL);
+
+    /* All of them can be rewound in the middle of an utterance. */
+    decode_file(ps, 10);
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(hyp = decoder_search_hyp(ps, "copy", &copy_score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, copy_score);
+    TEST_ASSERT(hyp = decoder_search_hyp(ps, "two", &copy_score));
+    TEST_ASSERT(strstr(hyp, "two") != NULL);
+
+    /* Can't change searches in the middle of an utterance. */
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    TEST_ASSERT(0 > decoder_remove_search(ps, "copy"));
+    TEST_ASSERT(0 > decoder_add_fsg(ps, "three",
+                                    read_fsg(ps, TESTDATADIR "/goforward.fsg")));
+    TEST_EQUAL(0, decoder_end_utt(ps));
+
+    /* Remove them again. */
+    TEST_EQUAL(0, decoder_remove_search(ps, "copy"));
+    TEST_ASSERT(0 > decoder_remove_search(ps, "copy"));
+    TEST_ASSERT(decoder_search_hyp(ps, "copy", &copy_score) == NULL);
+    TEST_EQUAL(0, decoder_remove_search(ps, "two"));
+    TEST_ASSERT(ps->searches == NULL);
+    decode_file(ps, -1);
+    TEST_ASSERT(hyp = decoder_hyp(ps, &copy_score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(fsgs->n_sen_eval < n_sen_eval_all);
+
+    decoder_free(ps);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include "test_macros.h"
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+#include <soundswallower/fsg_search.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Not a multiple of the frame shift, so there are leftover samples. */
+#define CHUNK 1111
+
+static int16 *
+read_audio(size_t *out_n_samples)
+{
+    FILE *rawfh;
+    int16 *data;
+    long size;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    size = ftell(rawfh);
+    fseek(rawfh, 0, SEEK_SET);
+    data = ckd_malloc(size);
+    *out_n_samples = fread(data, sizeof(*data), size / sizeof(*data), rawfh);
+    fclose(rawfh);
+    return data;
+}
+
+static decoder_t *
+make_decoder(int rolling)
+{
+    config_t *config;
+    decoder_t *ps;
+
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "loglevel", "INFO");
+    config_set_str(config, "samprate", "16000");
+    config_set_int(config, "rolling", rolling);
+    TEST_ASSERT(ps = decoder_init(config));
+    return ps;
+}
+
+static void
+process(decoder_t *ps, int16 *data, size_t start, size_t end)
+{
+    while (start < end) {
+        size_t n = end - start;
+        if (n > CHUNK)
+            n = CHUNK;
+        TEST_ASSERT(decoder_process_int16(ps, data + start, n, FALSE, FALSE) >= 0);
+        start += n;
+    }
+}
+
+/* Full hypothesis, including words which have become stable. */
+static char *
+finish(decoder_t *ps, char *stable, int32 *out_score, int *out_nfr)
+{
+    const char *hyp, *more;
+
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    if ((more = decoder_stable_hyp(ps, NULL)) != NULL) {
+        if (*stable)
+            strcat(stable, " ");
+        strcat(stable, more);
+    }
+    hyp = decoder_hyp(ps, out_score);
+    if (hyp && *hyp) {
+        if (*stable)
+            strcat(stable, " ");
+        strcat(stable, hyp);
+    }
+    *out_nfr = decoder_n_frames(ps);
+    return ckd_salloc(stable);
+}
+
+/* Find where the length of the stable hypothesis is in a snapshot. */
+static size_t
+find_stable_len(decoder_t *ps, const uint8 *snapshot, size_t size)
+{
+    fsg_search_t *fsgs = (fsg_search_t *)ps->search;
+    int32 head[6], stable_len;
+    size_t pos;
+
+    /* The start of the search state. */
+    head[0] = fsg_model_n_state(fsgs->fsg);
+    head[1] = fsg_lextree_n_pnode(fsgs->lextree);
+    head[2] = fsgs->frame;
+    head[3] = fsgs->beam;
+    head[4] = fsgs->pbeam;
+    head[5] = fsgs->wbeam;
+    for (pos = 0; pos + 13 * sizeof(int32) <= size; ++pos) {
+        if (0 == memcmp(snapshot + pos, head, sizeof(head))) {
+            pos += 12 * sizeof(int32);
+            memcpy(&stable_len, snapshot + pos, sizeof(stable_len));
+            TEST_EQUAL((int32)fsgs->stable_len, stable_len);
+            return pos;
+        }
+    }
+    TEST_ASSERT(!"Search state not found in snapshot");
+    return 0;
+}
+
+/* Check that a snapshot with a bad stable length is rejected. */
+static void
+test_bad_stable_len(decoder_t *ps, const uint8 *snapshot, size_t size,
+                    size_t pos, int32 stable_len)
+{
+    uint8 *bad = ckd_malloc(size);
+
+    memcpy(bad, snapshot, size);
+    memcpy(bad + pos, &stable_len, sizeof(stable_len));
+    TEST_ASSERT(decoder_restore(ps, bad, size) < 0);
+    ckd_free(bad);
+}
+
+static void
+test_restore(int rolling, int16 *data, size_t n_samples)
+{
+    decoder_t *ps, *ps2;
+    char *ref, *hyp, stable[256];
+    const char *partial;
+    uint8 *snapshot;
+    size_t size, stable_pos;
+    int32 score, ref_score;
+    int nfr, ref_nfr;
+
+    /* Reference result. */
+    TEST_ASSERT(ps = make_decoder(rolling));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    process(ps, data, 0, n_samples);
+    stable[0] = '\0';
+    ref = finish(ps, stable, &ref_score, &ref_nfr);
+    printf("reference: %s (%d, %d frames)\n", ref, ref_score, ref_nfr);
+    decoder_free(ps);
+
+    /* Take a snapshot in the middle (of the first utterance, since
+     * live CMN is updated at the end of each one)... */
+    TEST_ASSERT(ps = make_decoder(rolling));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+    process(ps, data, 0, n_samples / 2);
+    stable[0] = '\0';
+    if ((partial = decoder_stable_hyp(ps, NULL)) != NULL)
+        strcpy(stable, partial);
+    TEST_ASSERT(snapshot = decoder_snapshot(ps, &size));
+    printf("snapshot at frame %d: %zu bytes\n", decoder_n_frames(ps), size);
+    stable_pos = find_stable_len(ps, snapshot, size);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    /* Not in the middle of an utterance. */
+    TEST_ASSERT(decoder_snapshot(ps, &size) == NULL);
+    decoder_free(ps);
+
+    /* ...and finish it in another decoder. */
+    TEST_ASSERT(ps2 = make_decoder(rolling));
+    TEST_EQUAL(0, decoder_restore(ps2, snapshot, size));
+    process(ps2, data, n_samples / 2, n_samples);
+    hyp = finish(ps2, stable, &score, &nfr);
+    printf("restored: %s (%d, %d frames)\n", hyp, score, nfr);
+    TEST_EQUAL(0, strcmp(ref, hyp));
+    TEST_EQUAL(ref_score, score);
+    TEST_EQUAL(ref_nfr, nfr);
+    ckd_free(hyp);
+
+    /* Restoring replaces the current utterance. */
+    TEST_EQUAL(0, decoder_start_utt(ps2));
+    process(ps2, data, 0, n_samples / 4);
+    TEST_EQUAL(0, decoder_restore(ps2, snapshot, size));
+    process(ps2, data, n_samples / 2, n_samples);
+    stable[0] = '\0';
+    if ((partial = decoder_stable_hyp(ps2, NULL)) != NULL)
+        strcpy(stable, partial);
+    decoder_end_utt(ps2);
+
+    /* Truncated snapshots are rejected. */
+    TEST_ASSERT(decoder_restore(ps2, snapshot, size - 4) < 0);
+    TEST_ASSERT(decoder_restore(ps2, snapshot, 12) < 0);
+    /* As are ones with impossible lengths (not fatal errors). */
+    test_bad_stable_len(ps2, snapshot, size, stable_pos, -1);
+    test_bad_stable_len(ps2, snapshot, size, stable_pos, 0x7fffffff);
+    test_bad_stable_len(ps2, snapshot, size, stable_pos,
+                        (int32)(size - stable_pos));
+    /* And the decoder can still be used. */
+    TEST_EQUAL(0, decoder_start_utt(ps2));
+    process(ps2, data, 0, n_samples);
+    stable[0] = '\0';
+    hyp = finish(ps2, stable, &score, &nfr);
+    TEST_EQUAL(0, strcmp(ref, hyp));
+    ckd_free(hyp);
+
+    ckd_free(snapshot);
+    ckd_free(ref);
+    decoder_free(ps2);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int16 *data;
+    size_t n_samples;
+
+    (void)argc;
+    (void)argv;
+    data = read_audio(&n_samples);
+    test_restore(0, data, n_samples);
+    test_restore(50, data, n_samples);
+    ckd_free(data);
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/decoder.h>
+
+#include "test_macros.h"
+
+static int16 *
+read_data(size_t *out_nsamp)
+{
+    FILE *fh;
+    int16 *data;
+
+    TEST_ASSERT(fh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    data = ckd_malloc(1 << 20);
+    *out_nsamp = fread(data, sizeof(*data), (1 << 20) / sizeof(*data), fh);
+    fclose(fh);
+    return data;
+}
+
+/* Initial CMN, so that every utterance is decoded the same way. */
+static char *init_cmn;
+
+static void
+start_utt(decoder_t *ps)
+{
+    TEST_EQUAL(0, decoder_set_cmn(ps, init_cmn));
+    TEST_EQUAL(0, decoder_start_utt(ps));
+}
+
+/* Queue all the data in blocks, then decode it in small steps. */
+static int
+decode_steps(decoder_t *ps, int16 *data, size_t nsamp,
+             int max_frames, int max_usec)
+{
+    size_t pos;
+    int nfr, n_searchfr = 0;
+
+    start_utt(ps);
+    for (pos = 0; pos < nsamp; pos += 2048) {
+        size_t n = nsamp - pos > 2048 ? 2048 : nsamp - pos;
+        TEST_EQUAL(0, decoder_enqueue_int16(ps, data + pos, n));
+        /* Interleave some steps with queueing more data. */
+        TEST_ASSERT((nfr = decoder_step(ps, max_frames, max_usec)) >= 0);
+        n_searchfr += nfr;
+    }
+    while ((nfr = decoder_step(ps, max_frames, max_usec)) > 0) {
+        if (max_frames > 0)
+            TEST_ASSERT(nfr <= max_frames);
+        /* A step can always search at least one frame. */
+        if (max_usec == 1)
+            TEST_EQUAL(1, nfr);
+        n_searchfr += nfr;
+    }
+    TEST_EQUAL(0, nfr);
+    TEST_EQUAL(n_searchfr, decoder_n_frames(ps) - 1);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    return n_searchfr;
+}
+
+int
+main(int argc, char *argv[])
+{
+    decoder_t *ps;
+    config_t *config;
+    int16 *data;
+    float32 fdata[16] = { 0 };
+    size_t nsamp;
+    const char *hyp;
+    int32 score, ref_score;
+    int nfr, ref_nfr;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config = config_init(NULL));
+    config_set_str(config, "hmm", MODELDIR "/en-us");
+    config_set_str(config, "fsg", TESTDATADIR "/goforward.fsg");
+    config_set_str(config, "dict", TESTDATADIR "/turtle.dic");
+    config_set_str(config, "samprate", "16000");
+    TEST_ASSERT(ps = decoder_init(config));
+    data = read_data(&nsamp);
+    init_cmn = ckd_salloc(decoder_get_cmn(ps, FALSE));
+
+    /* Nothing can be queued outside an utterance. */
+    TEST_ASSERT(decoder_enqueue_int16(ps, data, nsamp) < 0);
+    TEST_ASSERT(decoder_step(ps, 0, 0) < 0);
+
+    /* Reference result, decoded all at once. */
+    start_utt(ps);
+    ref_nfr = decoder_process_int16(ps, data, nsamp, FALSE, FALSE);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &ref_score));
+    printf("%s (%d, %d frames)\n", hyp, ref_score, ref_nfr);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    ref_nfr = decoder_n_frames(ps);
+
+    /* The same result in steps of a few frames. */
+    nfr = decode_steps(ps, data, nsamp, 5, 0);
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    printf("%s (%d, %d frames in steps)\n", hyp, score, nfr);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(ref_score, score);
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+
+    /* Or in steps of very little time. */
+    decode_steps(ps, data, nsamp, 0, 1);
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(ref_score, score);
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+
+    /* Anything left in the queue is decoded at the end. */
+    start_utt(ps);
+    TEST_EQUAL(0, decoder_enqueue_int16(ps, data, nsamp));
+    /* And integer and floating-point data cannot be mixed. */
+    TEST_ASSERT(decoder_enqueue_float32(ps, fdata, 16) < 0);
+    TEST_EQUAL(0, decoder_end_utt(ps));
+    TEST_ASSERT(hyp = decoder_hyp(ps, &score));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(ref_score, score);
+    TEST_EQUAL(ref_nfr, decoder_n_frames(ps));
+    TEST_ASSERT(decoder_enqueue_int16(ps, data, nsamp) < 0);
+
+    ckd_free(init_cmn);
+    ckd_free(data);
+    decoder_free(ps);
+    return 0;
+}